@@ -112,6 +112,7 @@ gstbt_audio_delay_start (GstBaseTransform * base)
   GstBtAudioDelay *self = GSTBT_AUDIO_DELAY (base);
 
   gstbt_delay_start (self->delay, self->samplerate);
+  self->silent_samples = self->delay->max_delaytime;
   return TRUE;
 }
 
@@ -125,7 +126,7 @@ gstbt_audio_delay_transform_ip (GstBaseTransform * base, GstBuffer * outbuf)
   gdouble feedback, dry, wet;
   gint16 *data;
   gdouble val_dry, val_fx;
-  glong val, sum_fx = 0;
+  glong val, sum_fx = 0, sum_rb = 0;
   guint i, num_samples, rb_in, rb_out;
 
   if (!gst_buffer_map (outbuf, &info, GST_MAP_READ | GST_MAP_WRITE)) {
@@ -138,6 +139,7 @@ gstbt_audio_delay_transform_ip (GstBaseTransform * base, GstBuffer * outbuf)
   /* flush ring_buffer on DISCONT */
   if (GST_BUFFER_FLAG_IS_SET (outbuf, GST_BUFFER_FLAG_DISCONT)) {
     gstbt_delay_flush (delay);
+    self->silent_samples = delay->max_delaytime;
   }
 
   timestamp = gst_segment_to_stream_time (&base->segment, GST_FORMAT_TIME,
@@ -145,6 +147,14 @@ gstbt_audio_delay_transform_ip (GstBaseTransform * base, GstBuffer * outbuf)
   if (GST_CLOCK_TIME_IS_VALID (timestamp))
     gst_object_sync_values (GST_OBJECT (self), timestamp);
 
+  /* once the delay line only contains silence, the tail has decayed and we
+   * can pass silent input through */
+  if (GST_BUFFER_FLAG_IS_SET (outbuf, GST_BUFFER_FLAG_GAP) &&
+      self->silent_samples >= delay->max_delaytime) {
+    gst_buffer_unmap (outbuf, &info);
+    return GST_FLOW_OK;
+  }
+
   feedback = (gdouble) self->feedback / 100.0;
   wet = (gdouble) self->drywet / 100.0;
   dry = 1.0 - wet;
@@ -156,6 +166,7 @@ gstbt_audio_delay_transform_ip (GstBaseTransform * base, GstBuffer * outbuf)
     for (i = 0; i < num_samples; i++) {
       GSTBT_DELAY_READ (delay, rb_out, val_fx);
       val = (glong) (val_fx * feedback);
+      sum_rb |= val;
       GSTBT_DELAY_WRITE (delay, rb_in, CLAMP (val, G_MININT16, G_MAXINT16));
       val = (glong) (wet * val_fx);
       sum_fx += abs (val);
@@ -166,6 +177,7 @@ gstbt_audio_delay_transform_ip (GstBaseTransform * base, GstBuffer * outbuf)
       GSTBT_DELAY_READ (delay, rb_out, val_fx);
       val_dry = (gdouble) * data;
       val = (glong) (val_fx * feedback + val_dry);
+      sum_rb |= val;
       GSTBT_DELAY_WRITE (delay, rb_in, CLAMP (val, G_MININT16, G_MAXINT16));
       val = (glong) (wet * val_fx + dry * val_dry);
       sum_fx += abs (val);
@@ -173,6 +185,11 @@ gstbt_audio_delay_transform_ip (GstBaseTransform * base, GstBuffer * outbuf)
     }
   }
   GSTBT_DELAY_AFTER (delay, rb_in, rb_out);
+  if (sum_rb) {
+    self->silent_samples = 0;
+  } else if (self->silent_samples < delay->max_delaytime) {
+    self->silent_samples += num_samples;
+  }
 
   if (GST_BUFFER_FLAG_IS_SET (outbuf, GST_BUFFER_FLAG_GAP) && sum_fx) {
     GST_BUFFER_FLAG_UNSET (outbuf, GST_BUFFER_FLAG_GAP);
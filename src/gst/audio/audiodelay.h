@@ -50,6 +50,7 @@ struct _GstBtAudioDelay {
 
   gint samplerate;
   GstBtDelay *delay;
+  guint silent_samples;   /* written to the delay line since the last signal */
 
   /* tempo handling */
   gulong beats_per_minute;
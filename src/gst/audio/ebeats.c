@@ -266,6 +266,14 @@ gstbt_e_beats_process (GstBtAudioSynth * base, GstBuffer * data,
   return FALSE;
 }
 
+static gboolean
+gstbt_e_beats_process_segment (GstBtAudioSynth * base, GstBuffer * data,
+    GstMapInfo * info, guint offset)
+{
+  /* oscillators and filter keep their state, a part needs no extra handling */
+  return gstbt_e_beats_process (base, data, info);
+}
+
 //-- gobject vmethods
 
 static void
@@ -530,6 +538,7 @@ gstbt_e_beats_class_init (GstBtEBeatsClass * klass)
   GObjectClass *component, *env_component;
 
   audio_synth_class->process = gstbt_e_beats_process;
+  audio_synth_class->process_segment = gstbt_e_beats_process_segment;
   audio_synth_class->reset = gstbt_e_beats_reset;
   audio_synth_class->negotiate = gstbt_e_beats_negotiate;
   audio_synth_class->setup = gstbt_e_beats_setup;
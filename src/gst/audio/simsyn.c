@@ -115,6 +115,14 @@ gstbt_sim_syn_process (GstBtAudioSynth * base, GstBuffer * data,
   return FALSE;
 }
 
+static gboolean
+gstbt_sim_syn_process_segment (GstBtAudioSynth * base, GstBuffer * data,
+    GstMapInfo * info, guint offset)
+{
+  /* oscillator and filter keep their state, a part needs no extra handling */
+  return gstbt_sim_syn_process (base, data, info);
+}
+
 //-- gobject vmethods
 
 static void
@@ -233,6 +241,7 @@ gstbt_sim_syn_class_init (GstBtSimSynClass * klass)
   GObjectClass *component;
 
   audio_synth_class->process = gstbt_sim_syn_process;
+  audio_synth_class->process_segment = gstbt_sim_syn_process_segment;
   audio_synth_class->reset = gstbt_sim_syn_reset;
   audio_synth_class->negotiate = gstbt_sim_syn_negotiate;
   audio_synth_class->setup = gstbt_sim_syn_setup;
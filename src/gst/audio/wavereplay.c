@@ -87,6 +87,14 @@ gstbt_wave_replay_process (GstBtAudioSynth * base, GstBuffer * data,
   return FALSE;
 }
 
+static gboolean
+gstbt_wave_replay_process_segment (GstBtAudioSynth * base, GstBuffer * data,
+    GstMapInfo * info, guint offset)
+{
+  /* the wave position comes from the timestamp of the part */
+  return gstbt_wave_replay_process (base, data, info);
+}
+
 //-- interfaces
 
 //-- gobject vmethods
@@ -154,6 +162,7 @@ gstbt_wave_replay_class_init (GstBtWaveReplayClass * klass)
   GObjectClass *component;
 
   audio_synth_class->process = gstbt_wave_replay_process;
+  audio_synth_class->process_segment = gstbt_wave_replay_process_segment;
   audio_synth_class->negotiate = gstbt_wave_replay_negotiate;
 
   gobject_class->set_property = gstbt_wave_replay_set_property;
@@ -159,6 +159,14 @@ gstbt_wave_tab_syn_process (GstBtAudioSynth * base, GstBuffer * data,
   return FALSE;
 }
 
+static gboolean
+gstbt_wave_tab_syn_process_segment (GstBtAudioSynth * base, GstBuffer * data,
+    GstMapInfo * info, guint offset)
+{
+  /* the wave position is kept in src->offset, a part needs no extra handling */
+  return gstbt_wave_tab_syn_process (base, data, info);
+}
+
 //-- interfaces
 
 //-- gobject vmethods
@@ -288,6 +296,7 @@ gstbt_wave_tab_syn_class_init (GstBtWaveTabSynClass * klass)
   GObjectClass *component;
 
   audio_synth_class->process = gstbt_wave_tab_syn_process;
+  audio_synth_class->process_segment = gstbt_wave_tab_syn_process_segment;
   audio_synth_class->reset = gstbt_wave_tab_syn_reset;
   audio_synth_class->negotiate = gstbt_wave_tab_syn_negotiate;
 
@@ -428,6 +428,8 @@ bml (gstbml_tempo_change_tempo (GObject * gstbml, GstBML * bml,
     if (GST_IS_BASE_SRC (gstbml)) {
       gst_base_src_set_blocksize (GST_BASE_SRC (gstbml),
           gstbml_calculate_buffer_size (bml));
+      // renegotiate the buffer pool for the new buffer size
+      gst_pad_mark_reconfigure (GST_BASE_SRC_PAD (GST_BASE_SRC (gstbml)));
     }
     // update timevalues in buzzmachine
     bml (set_master_info (bml->beats_per_minute, bml->ticks_per_beat,
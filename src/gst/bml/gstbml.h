@@ -98,6 +98,8 @@ struct _GstBML {
   gboolean eos_reached;
   gboolean reverse;                  /* play backwards */
   gboolean discont;                  /* discont buffer flag on loops */
+  guint buffer_frames;               /* fixed buffer size, 0 for subticks */
+  guint subtick_frames_left;         /* of the subtick that spans buffers */
 };
 
 struct _GstBMLClass {
@@ -51,6 +51,9 @@ GST_STATIC_PAD_TEMPLATE ("src",
 
 static GstBaseSrcClass *parent_class = NULL;
 
+/* number of buffers we preallocate in the pool */
+#define BML_SRC_MIN_BUFFERS 4
+
 //-- child bin interface implementations
 
 
@@ -214,11 +217,18 @@ gst_bml_preset_interface_init (gpointer g_iface, gpointer iface_data)
 static void
 gstbt_bml_src_set_context (GstElement * element, GstContext * context)
 {
-  guint bpm, tpb, stpb;
+  guint bpm, tpb, stpb, frames = 0;
 
   if (gstbt_audio_tempo_context_get_tempo (context, &bpm, &tpb, &stpb)) {
     GstBML *bml = GST_BML (GST_BML_SRC (element));
 
+    gstbt_audio_tempo_context_get_buffer_frames (context, &frames);
+    if (bml->buffer_frames != frames) {
+      GST_INFO_OBJECT (element, "buffer-frames=%u", frames);
+      bml->buffer_frames = frames;
+      // renegotiate the buffer pool for the new buffer size
+      gst_pad_mark_reconfigure (GST_BASE_SRC_PAD (element));
+    }
     bml (gstbml_tempo_change_tempo (G_OBJECT (element), bml, bpm, tpb, stpb));
   }
 #if GST_CHECK_VERSION (1,8,0)
@@ -335,6 +345,56 @@ error:
 }
 
 
+static gboolean
+gst_bml_src_decide_allocation (GstBaseSrc * base, GstQuery * query)
+{
+  GstBMLSrc *bml_src = GST_BML_SRC (base);
+  GstBML *bml = GST_BML (bml_src);
+  GstBMLClass *bml_class = GST_BML_CLASS (GST_BML_SRC_GET_CLASS (bml_src));
+  GstBufferPool *pool = NULL;
+  guint size, pool_size, min, max;
+
+  /* samples_per_buffer is truncated and the rounding error compensation can
+   * add one more frame */
+  size = MAX (bml->buffer_frames, bml->samples_per_buffer + 2) *
+      bml_class->output_channels * sizeof (BMLData);
+
+  /* always use a pool, so that create() does not allocate memory while we're
+   * playing, the base class makes a default pool if downstream has none */
+  if (gst_query_get_n_allocation_pools (query) > 0) {
+    gst_query_parse_nth_allocation_pool (query, 0, &pool, &pool_size, &min,
+        &max);
+    gst_query_set_nth_allocation_pool (query, 0, pool, MAX (pool_size, size),
+        MAX (min, BML_SRC_MIN_BUFFERS), max);
+    if (pool)
+      gst_object_unref (pool);
+  } else {
+    gst_query_add_allocation_pool (query, NULL, size, BML_SRC_MIN_BUFFERS, 0);
+  }
+  GST_INFO_OBJECT (bml_src, "buffer pool: size=%u", size);
+
+  return GST_BASE_SRC_CLASS (parent_class)->decide_allocation (base, query);
+}
+
+/* pooled buffers have the max size, trim them to what we generate, a tempo
+ * change can make them too small until the pool has been renegotiated */
+static GstBuffer *
+gst_bml_src_fit_buffer (GstBaseSrc * base, GstBuffer * buf, guint size)
+{
+  gsize maxsize;
+
+  gst_buffer_get_sizes (buf, NULL, &maxsize);
+  if (G_LIKELY (maxsize >= size)) {
+    gst_buffer_set_size (buf, size);
+  } else {
+    GST_DEBUG_OBJECT (base, "pool buffer too small: %" G_GSIZE_FORMAT " < %u",
+        maxsize, size);
+    gst_buffer_unref (buf);
+    buf = gst_buffer_new_allocate (NULL, size, NULL);
+  }
+  return buf;
+}
+
 static gboolean
 gst_bml_src_start (GstBaseSrc * base)
 {
@@ -342,6 +402,7 @@ gst_bml_src_start (GstBaseSrc * base)
   GstBML *bml = GST_BML (bml_src);
 
   bml->discont = FALSE;
+  bml->subtick_frames_left = 0;
   return TRUE;
 }
 
@@ -367,6 +428,7 @@ gst_bml_src_do_seek (GstBaseSrc * base, GstSegment * segment)
   bml->reverse = (segment->rate < 0.0);
   bml->running_time = time;
   bml->ticktime_err_accum = 0.0;
+  bml->subtick_frames_left = 0;
   /* Assume that seeks in < PAUSED configure the playback segment. Don't
    * generate disconts on them as there is nothing to reset.
    * Doing needless resets breaks comamndline usage, where we'd reset the
@@ -425,6 +487,125 @@ gst_bml_src_is_seekable (GstBaseSrc * base)
   return TRUE;
 }
 
+/* Render a buffer of buffer_frames and split the processing at the subtick
+ * boundaries. The machine gets its tick() at the start of each tick, as if we
+ * would render one buffer per subtick. */
+static GstFlowReturn
+gst_bml_src_create_block (GstBaseSrc * base, guint channels,
+    GstBuffer ** buffer)
+{
+  GstFlowReturn res;
+  GstMapInfo info;
+  GstBMLSrc *bml_src = GST_BML_SRC (base);
+  GstBMLSrcClass *klass = GST_BML_SRC_GET_CLASS (bml_src);
+  GstBML *bml = GST_BML (bml_src);
+  GstBMLClass *bml_class = GST_BML_CLASS (klass);
+  GstBuffer *buf;
+  GstClockTime ts, subtick_ts;
+  gdouble samples_done, subtick_frames;
+  BMLData *data, *seg_data;
+  gpointer bm = bml->bm;
+  guint frames = bml->buffer_frames, todo, seg_size;
+  gboolean has_data = FALSE;
+
+  /* check for eos */
+  if (bml->check_eos) {
+    if (bml->n_samples_stop <= bml->n_samples) {
+      GST_WARNING_OBJECT (bml_src, "0 samples left -> EOS reached");
+      bml->eos_reached = TRUE;
+      return GST_FLOW_EOS;
+    }
+    if (bml->n_samples_stop - bml->n_samples <= frames) {
+      frames = (guint) (bml->n_samples_stop - bml->n_samples);
+      bml->eos_reached = TRUE;
+    }
+  }
+
+  res = GST_BASE_SRC_GET_CLASS (base)->alloc (base, bml->n_samples,
+      frames * channels * sizeof (BMLData), &buf);
+  if (G_UNLIKELY (res != GST_FLOW_OK)) {
+    return res;
+  }
+  buf = gst_bml_src_fit_buffer (base, buf,
+      frames * channels * sizeof (BMLData));
+
+  ts = gst_util_uint64_scale_int (bml->n_samples, GST_SECOND, bml->samplerate);
+  GST_BUFFER_TIMESTAMP (buf) = ts;
+  GST_BUFFER_DURATION (buf) =
+      gst_util_uint64_scale_int (bml->n_samples + frames, GST_SECOND,
+      bml->samplerate) - ts;
+  GST_BUFFER_OFFSET (buf) = bml->n_samples;
+  GST_BUFFER_OFFSET_END (buf) = bml->n_samples + frames;
+
+  if (bml->discont) {
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+    bml->discont = FALSE;
+  }
+
+  if (!gst_buffer_map (buf, &info, GST_MAP_READ | GST_MAP_WRITE)) {
+    GST_WARNING_OBJECT (base, "unable to map buffer for read & write");
+    gst_buffer_unref (buf);
+    return GST_FLOW_ERROR;
+  }
+  data = (BMLData *) info.data;
+  // some buzzmachines expect a cleared buffer
+  orc_memset (data, 0, frames * channels * sizeof (BMLData));
+
+  seg_data = data;
+  todo = frames;
+  while (todo) {
+    if (!bml->subtick_frames_left) {
+      /* start the next subtick, the length handles rounding errors like
+       * gst_bml_src_create_{mono,stereo}() */
+      samples_done =
+          (gdouble) bml->running_time * (gdouble) bml->samplerate /
+          (gdouble) GST_SECOND;
+      subtick_frames = bml->samples_per_buffer +
+          (samples_done - (gdouble) (bml->n_samples + frames - todo));
+      /* clamp before the cast, the rounding error can make this negative */
+      bml->subtick_frames_left =
+          (subtick_frames < 1.0) ? 1 : (guint) subtick_frames;
+      subtick_ts = bml->running_time + (GstClockTime) bml->ticktime_err_accum;
+      bml->running_time += bml->ticktime;
+      bml->ticktime_err_accum += bml->ticktime_err;
+      if (bml->subtick_count >= bml->subticks_per_tick) {
+        bml (gstbml_reset_triggers (bml, bml_class));
+        bml (gstbml_sync_values (bml, bml_class, subtick_ts));
+        bml (tick (bm));
+        bml->subtick_count = 1;
+      } else {
+        bml->subtick_count++;
+      }
+    }
+    // 256 is MachineInterface.h::MAX_BUFFER_LENGTH
+    seg_size = MIN (MIN (todo, 256), bml->subtick_frames_left);
+    /* mode does not really matter for generators */
+    if (channels == 1) {
+      has_data |= bml (work (bm, seg_data, (int) seg_size, 2 /*WM_WRITE */ ));
+    } else {
+      has_data |=
+          bml (work_m2s (bm, NULL, seg_data, (int) seg_size,
+              2 /*WM_WRITE */ ));
+    }
+    seg_data = &seg_data[seg_size * channels];
+    todo -= seg_size;
+    bml->subtick_frames_left -= seg_size;
+  }
+  bml->n_samples += frames;
+
+  if (gstbml_fix_data ((GstElement *) bml_src, &info, has_data)) {
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_GAP);
+  } else {
+    GST_BUFFER_FLAG_UNSET (buf, GST_BUFFER_FLAG_GAP);
+  }
+
+  // return results
+  gst_buffer_unmap (buf, &info);
+  *buffer = buf;
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_bml_src_create_mono (GstBaseSrc * base, GstClockTime offset, guint length,
     GstBuffer ** buffer)
@@ -449,6 +630,9 @@ gst_bml_src_create_mono (GstBaseSrc * base, GstClockTime offset, guint length,
     GST_DEBUG_OBJECT (bml_src, "EOS reached");
     return GST_FLOW_EOS;
   }
+  if (bml->buffer_frames && !bml->reverse) {
+    return gst_bml_src_create_block (base, 1, buffer);
+  }
   // the amount of samples to produce (handle rounding errors by collecting left over fractions)
   samples_done =
       (gdouble) bml->running_time * (gdouble) bml->samplerate /
@@ -507,6 +691,8 @@ gst_bml_src_create_mono (GstBaseSrc * base, GstClockTime offset, guint length,
   if (G_UNLIKELY (res != GST_FLOW_OK)) {
     return res;
   }
+  buf = gst_bml_src_fit_buffer (base, buf,
+      samples_per_buffer * sizeof (BMLData));
 
   if (!bml->reverse) {
     GST_BUFFER_TIMESTAMP (buf) =
@@ -562,9 +748,9 @@ gst_bml_src_create_mono (GstBaseSrc * base, GstClockTime offset, guint length,
     todo -= seg_size;
   }
   if (gstbml_fix_data ((GstElement *) bml_src, &info, has_data)) {
-    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_GAP);
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_GAP);
   } else {
-    GST_BUFFER_FLAG_UNSET (buffer, GST_BUFFER_FLAG_GAP);
+    GST_BUFFER_FLAG_UNSET (buf, GST_BUFFER_FLAG_GAP);
   }
 
   // return results
@@ -598,6 +784,9 @@ gst_bml_src_create_stereo (GstBaseSrc * base, GstClockTime offset, guint length,
     GST_WARNING_OBJECT (bml_src, "EOS reached");
     return GST_FLOW_EOS;
   }
+  if (bml->buffer_frames && !bml->reverse) {
+    return gst_bml_src_create_block (base, 2, buffer);
+  }
   // the amount of samples to produce (handle rounding errors by collecting left over fractions)
   samples_done =
       (gdouble) bml->running_time * (gdouble) bml->samplerate /
@@ -654,6 +843,8 @@ gst_bml_src_create_stereo (GstBaseSrc * base, GstClockTime offset, guint length,
   if (G_UNLIKELY (res != GST_FLOW_OK)) {
     return res;
   }
+  buf = gst_bml_src_fit_buffer (base, buf,
+      samples_per_buffer * 2 * sizeof (BMLData));
 
   if (!bml->reverse) {
     GST_BUFFER_TIMESTAMP (buf) =
@@ -710,9 +901,9 @@ gst_bml_src_create_stereo (GstBaseSrc * base, GstClockTime offset, guint length,
     todo -= seg_size;
   }
   if (gstbml_fix_data ((GstElement *) bml_src, &info, has_data)) {
-    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_GAP);
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_GAP);
   } else {
-    GST_BUFFER_FLAG_UNSET (buffer, GST_BUFFER_FLAG_GAP);
+    GST_BUFFER_FLAG_UNSET (buf, GST_BUFFER_FLAG_GAP);
   }
 
   // return results
@@ -820,6 +1011,8 @@ gst_bml_src_class_init (GstBMLSrcClass * klass)
   gstbasesrc_class->is_seekable = GST_DEBUG_FUNCPTR (gst_bml_src_is_seekable);
   gstbasesrc_class->do_seek = GST_DEBUG_FUNCPTR (gst_bml_src_do_seek);
   gstbasesrc_class->query = GST_DEBUG_FUNCPTR (gst_bml_src_query);
+  gstbasesrc_class->decide_allocation =
+      GST_DEBUG_FUNCPTR (gst_bml_src_decide_allocation);
   gstbasesrc_class->start = GST_DEBUG_FUNCPTR (gst_bml_src_start);
   gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_bml_src_stop);
   if (bml_class->output_channels == 1) {
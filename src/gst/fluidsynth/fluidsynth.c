@@ -435,12 +435,13 @@ gstbt_fluid_synth_reset (GstBtAudioSynth * base)
 }
 
 static gboolean
-gstbt_fluid_synth_process (GstBtAudioSynth * base, GstBuffer * data,
-    GstMapInfo * info)
+gstbt_fluid_synth_process_segment (GstBtAudioSynth * base, GstBuffer * data,
+    GstMapInfo * info, guint offset)
 {
   GstBtFluidSynth *src = ((GstBtFluidSynth *) base);
 
-  if (src->cur_note_length) {
+  /* the note length is counted in subticks */
+  if (src->cur_note_length && !offset) {
     src->cur_note_length--;
     if (!src->cur_note_length) {
       fluid_synth_noteoff (src->fluid, /*chan */ 0, src->key);
@@ -456,6 +457,13 @@ gstbt_fluid_synth_process (GstBtAudioSynth * base, GstBuffer * data,
   return TRUE;
 }
 
+static gboolean
+gstbt_fluid_synth_process (GstBtAudioSynth * base, GstBuffer * data,
+    GstMapInfo * info)
+{
+  return gstbt_fluid_synth_process_segment (base, data, info, 0);
+}
+
 //-- interfaces
 
 //-- gobject vmethods
@@ -817,6 +825,7 @@ gstbt_fluid_synth_class_init (GstBtFluidSynthClass * klass)
   gint count = 0;
 
   audio_synth_class->process = gstbt_fluid_synth_process;
+  audio_synth_class->process_segment = gstbt_fluid_synth_process_segment;
   audio_synth_class->reset = gstbt_fluid_synth_reset;
   audio_synth_class->negotiate = gstbt_fluid_synth_negotiate;
 
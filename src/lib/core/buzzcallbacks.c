@@ -115,6 +115,9 @@ GetWaveLevel (CHostCallbacks * self, int const i, int const level)
   if (G_UNLIKELY (!wavetable))
     return NULL;
   if ((wave = bt_wavetable_get_wave_by_index (wavetable, i))) {
+    // machines get a writable pointer and never tell when they are done
+    bt_wave_mark_modified (wave);
+    bt_wavetable_touch_wave (wavetable, wave);
     if ((wavelevel = bt_wave_get_level_by_index (wave, level))) {
       gulong length, rate;
       glong ls, le;
@@ -164,6 +167,8 @@ GetNearestWaveLevel (CHostCallbacks * self, int const i, int const note)
     gint max_diff = /*NOTE_MAX */ 200 + 1;
     GstBtNote root_note;
 
+    bt_wave_mark_modified (wave);
+    bt_wavetable_touch_wave (wavetable, wave);
     g_object_get (wave, "wavelevels", &list, NULL);
     for (node = list; node; node = g_list_next (node)) {
       wavelevel = BT_WAVELEVEL (node->data);
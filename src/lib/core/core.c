@@ -67,6 +67,7 @@ GST_DEBUG_CATEGORY_STATIC (libxml_category);
 
 static gboolean arg_version = FALSE;
 static gchar **arg_experiments = NULL;
+static gchar *arg_trace = NULL;
 
 GstCaps *bt_default_caps = NULL;
 
@@ -127,6 +128,12 @@ bt_init_post (void)
     arg_experiments = NULL;
   }
 
+  if (arg_trace || g_getenv ("BT_TRACE")) {
+    bt_trace_init (arg_trace ? arg_trace : g_getenv ("BT_TRACE"));
+    g_free (arg_trace);
+    arg_trace = NULL;
+  }
+
   // dbeswick: During tests, a single process destroys and re-initializes an application
   // repeatedly. When the plugin was being repeatedly re-registered, I found that
   // segfaults were occurring as factories returned from elements seemed to have
@@ -229,10 +236,14 @@ bt_init_get_option_group (void)
         N_("Print the buzztrax core version"), NULL},
     {"bt-core-experiment", 0, 0,
         G_OPTION_ARG_STRING_ARRAY, NULL, N_("Experiments"), "{audiomixer}"},
+    {"bt-trace", 0, 0, G_OPTION_ARG_FILENAME, NULL,
+        N_("Write a timeline of the engine activity as chrome trace to FILE"),
+        N_("FILE")},
     {NULL}
   };
   options[0].arg_data = &arg_version;
   options[1].arg_data = &arg_experiments;
+  options[2].arg_data = &arg_trace;
 
   group =
       g_option_group_new ("bt-core", _("Buzztrax core options"),
@@ -352,6 +363,7 @@ bt_deinit (void)
 {
   // release some static ressources
   gst_caps_replace (&bt_default_caps, NULL);
+  bt_trace_deinit ();
   bt_g_object_idle_add_cleanup ();
 }
 
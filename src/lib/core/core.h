@@ -46,6 +46,7 @@
 #include "core/song-io.h"
 #include "core/song.h"
 #include "core/source-machine.h"
+#include "core/trace.h"
 #include "core/value-group.h"
 #include "core/wave.h"
 #include "core/wavelevel.h"
@@ -56,6 +56,7 @@
 #include "core.h"
 #include "version.h"
 #include "persistence.h"
+#include "song-io-native-bzt.h"
 
 #include "marshal.h"
 
@@ -89,6 +90,11 @@ BtCmdPattern *bt_machine_get_pattern_by_id(const BtMachine * const self, const g
 
 gpointer bt_wavetable_get_callbacks(BtWavetable * self);
 
+gboolean bt_pattern_load_event(const BtPattern * const self, const gulong tick, const glong voice, const gchar * const name, const gchar * const value);
+gboolean bt_value_group_load_event(const BtValueGroup * const self, const gulong tick, const gulong param, const gchar * const value);
+gboolean bt_value_group_check_packed_column(const guint8 * data, const gsize size, const gulong length);
+guint bt_song_io_native_bzt_get_reused_members(const BtSongIONativeBZT * const self);
+
 //-- debug helper --------------------------------------------------------------
 
 GList *bt_machine_get_element_list(const BtMachine * const self);
@@ -1150,6 +1150,83 @@ Error:
 
 //-- init helpers
 
+static GstPadProbeReturn
+bt_machine_trace_process_begin(GstPad *pad, GstPadProbeInfo *info,
+                               gpointer user_data)
+{
+  BT_TRACE_BEGIN("machine", (const gchar *)user_data);
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+bt_machine_trace_process_end(GstPad *pad, GstPadProbeInfo *info,
+                             gpointer user_data)
+{
+  BT_TRACE_END("machine", (const gchar *)user_data);
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+bt_machine_trace_produce(GstPad *pad, GstPadProbeInfo *info,
+                         gpointer user_data)
+{
+  BT_TRACE_INSTANT("machine", (const gchar *)user_data,
+                   GST_BUFFER_OFFSET((GstBuffer *)info->data));
+  return GST_PAD_PROBE_OK;
+}
+
+/*
+ * bt_machine_add_trace_probes:
+ *
+ * Record machine processing for the timeline tracer. A buffer arriving on a
+ * sink pad starts the processing, the buffer leaving on the src pad ends it.
+ * Sources have no input, we only mark when they push a buffer.
+ */
+static void
+bt_machine_add_trace_probes(const BtMachine *const self)
+{
+  GstElement *machine = self->priv->machines[PART_MACHINE];
+  // the name has to stay valid until the trace is written
+  const gchar *name = g_intern_string(self->priv->id);
+  gboolean has_sink = machine->numsinkpads > 0;
+  GstIterator *it;
+  GValue item = {0, };
+  GstPad *pad;
+  gboolean done = FALSE;
+
+  it = gst_element_iterate_pads(machine);
+  while (!done)
+  {
+    switch (gst_iterator_next(it, &item))
+    {
+    case GST_ITERATOR_OK:
+      pad = GST_PAD(g_value_get_object(&item));
+      if (gst_pad_get_direction(pad) == GST_PAD_SINK)
+      {
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER,
+                          bt_machine_trace_process_begin, (gpointer)name, NULL);
+      }
+      else
+      {
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER,
+                          has_sink ? bt_machine_trace_process_end : bt_machine_trace_produce,
+                          (gpointer)name, NULL);
+      }
+      g_value_reset(&item);
+      break;
+    case GST_ITERATOR_RESYNC:
+      gst_iterator_resync(it);
+      break;
+    case GST_ITERATOR_ERROR:
+    case GST_ITERATOR_DONE:
+      done = TRUE;
+      break;
+    }
+  }
+  g_value_unset(&item);
+  gst_iterator_free(it);
+}
+
 static gboolean
 bt_machine_init_core_machine(BtMachine *const self)
 {
@@ -1162,6 +1239,9 @@ bt_machine_init_core_machine(BtMachine *const self)
            self->priv->plugin_name,
            G_OBJECT_LOG_REF_COUNT(self->priv->machines[PART_MACHINE]));
 
+  if (bt_trace_enabled)
+    bt_machine_add_trace_probes(self);
+
   res = TRUE;
 Error:
   return res;
@@ -3058,8 +3138,10 @@ void bt_machine_varargs_to_constructor_params(va_list var_args, gchar *id,
 /**
  * bt_machine_persistence_save
  * @userdata: a gchar* that indicates the 'context' of the save operation.
- *            Possible values are NULL, "clone". "clone" means the save is being
- *            used to clone the machine.
+ *            Possible values are NULL, "clone" and "no-pattern-data". "clone"
+ *            means the save is being used to clone the machine.
+ *            "no-pattern-data" means that the patterns are saved without their
+ *            events, as those are stored separately.
  *
  * Processes varargs to get common inputs that all machine subclass 'new' functions may use.
  *
@@ -3237,7 +3319,7 @@ bt_machine_persistence_save(const BtPersistence *const persistence,
       if ((child_node =
                xmlNewChild(node, NULL, XML_CHAR_PTR("patterns"), NULL)))
       {
-        bt_persistence_save_list(self->priv->patterns, child_node, NULL);
+        bt_persistence_save_list(self->priv->patterns, child_node, userdata);
       }
       else
         goto Error;
@@ -124,6 +124,7 @@ bt_pattern_control_source_get_value (GstControlBinding * self_,
   gulong tick = bt_song_info_time_to_tick (song_info, timestamp);
   GstClockTime ts = bt_song_info_tick_to_time (song_info, tick);
 
+  BT_TRACE_BEGIN ("sync", bt_parameter_group_get_param_name (pg, param_index));
   GST_LOG_OBJECT (machine, "get control_value for param %ld at tick%4lu,"
       " %1d: %" G_GUINT64_FORMAT " == %" G_GUINT64_FORMAT,
       param_index, tick, (ts == timestamp), timestamp, ts);
@@ -181,6 +182,7 @@ bt_pattern_control_source_get_value (GstControlBinding * self_,
         "tick %lu: Set value for %s", tick,
         bt_parameter_group_get_param_name (pg, param_index));
 
+    BT_TRACE_END ("sync", bt_parameter_group_get_param_name (pg, param_index));
     return res;
   } else {
     if (self->priv->is_trigger || !timestamp) {
@@ -190,9 +192,12 @@ bt_pattern_control_source_get_value (GstControlBinding * self_,
           "tick %lu: Set default for %s", tick,
           bt_parameter_group_get_param_name (pg, param_index));
 
+      BT_TRACE_END ("sync", bt_parameter_group_get_param_name (pg,
+              param_index));
       return &self->priv->def_value;
     }
   }
+  BT_TRACE_END ("sync", bt_parameter_group_get_param_name (pg, param_index));
   return NULL;
 }
 
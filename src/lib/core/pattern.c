@@ -896,6 +896,10 @@ bt_pattern_persistence_save (const BtPersistence * const persistence,
         XML_CHAR_PTR (bt_str_format_ulong (length)));
     g_free (name);
 
+    // the pattern data is stored separately
+    if (!g_strcmp0 ((gchar *) userdata, "no-pattern-data"))
+      return node;
+
     // save pattern data
     for (i = 0; i < length; i++) {
       // check if there are any GValues stored ?
@@ -941,6 +945,47 @@ bt_pattern_persistence_save (const BtPersistence * const persistence,
   return node;
 }
 
+/*
+ * bt_pattern_load_event:
+ * @self: the pattern that is being loaded
+ * @tick: the tick (time) position starting with 0
+ * @voice: the voice number starting with 0 or -1 for global parameters
+ * @name: the parameter name from the song file
+ * @value: the value string from the song file
+ *
+ * Stores one pattern cell from a song file. The value is parsed straight into
+ * the value-group storage. This is shared by the #BtPersistence loader and
+ * the streaming loader in song-io-native.c.
+ *
+ * Returns: %TRUE for success
+ */
+gboolean
+bt_pattern_load_event (const BtPattern * const self, const gulong tick,
+    const glong voice, const gchar * const name, const gchar * const value)
+{
+  BtValueGroup *vg;
+  BtParameterGroup *pg;
+  glong param;
+
+  if (voice < 0) {
+    vg = self->priv->global_value_group;
+    pg = bt_machine_get_global_param_group (self->priv->machine);
+  } else if ((gulong) voice < self->priv->voices) {
+    vg = self->priv->voice_value_groups[voice];
+    pg = bt_machine_get_voice_param_group (self->priv->machine, voice);
+  } else {
+    GST_WARNING ("voice %ld > max_voices %lu", voice, self->priv->voices);
+    return FALSE;
+  }
+  if (!name || (param = bt_parameter_group_get_param_index (pg, name)) == -1) {
+    GST_WARNING
+        ("error while loading pattern data at tick %lu, param %s, voice %ld",
+        tick, name, voice);
+    return FALSE;
+  }
+  return bt_value_group_load_event (vg, tick, param, value);
+}
+
 static BtPersistence *
 bt_pattern_persistence_load (const GType type,
     const BtPersistence * const persistence, xmlNodePtr node, GError ** err,
@@ -949,7 +994,7 @@ bt_pattern_persistence_load (const GType type,
   BtPattern *self;
   BtPersistence *result;
   xmlChar *id, *name, *length_str, *tick_str, *value, *voice_str;
-  glong tick, voice, param;
+  glong tick, voice;
   gulong length;
   xmlNodePtr child_node;
 
@@ -1012,37 +1057,13 @@ bt_pattern_persistence_load (const GType type,
           value = xmlGetProp (child_node, XML_CHAR_PTR ("value"));
           //GST_LOG("     \"%s\" -> \"%s\"",safe_string(name),safe_string(value));
           if (!strncmp ((char *) child_node->name, "globaldata\0", 11)) {
-            param =
-                bt_parameter_group_get_param_index
-                (bt_machine_get_global_param_group (self->priv->machine),
-                (gchar *) name);
-            if (param != -1) {
-              bt_pattern_set_global_event (self, tick, param, (gchar *) value);
-            } else {
-              GST_WARNING
-                  ("error while loading global pattern data at tick %ld, param %ld",
-                  tick, param);
-            }
+            bt_pattern_load_event (self, tick, -1, (gchar *) name,
+                (gchar *) value);
           } else if (!strncmp ((char *) child_node->name, "voicedata\0", 10)) {
             voice_str = xmlGetProp (child_node, XML_CHAR_PTR ("voice"));
-            voice = atol ((char *) voice_str);
-            if (voice < self->priv->voices) {
-              param =
-                  bt_parameter_group_get_param_index
-                  (bt_machine_get_voice_param_group (self->priv->machine,
-                      voice), (gchar *) name);
-              if (param != -1) {
-                bt_pattern_set_voice_event (self, tick, voice, param,
-                    (gchar *) value);
-              } else {
-                GST_WARNING
-                    ("error while loading voice pattern data at tick %ld, param %ld, voice %ld",
-                    tick, param, voice);
-              }
-            } else {
-              GST_WARNING ("voice %ld > max_voices %lu", voice,
-                  self->priv->voices);
-            }
+            voice = voice_str ? atol ((char *) voice_str) : 0;
+            bt_pattern_load_event (self, tick, voice, (gchar *) name,
+                (gchar *) value);
             xmlFree (voice_str);
           }
           xmlFree (name);
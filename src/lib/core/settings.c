@@ -75,6 +75,7 @@ enum
   BT_SETTINGS_SAMPLE_RATE,
   BT_SETTINGS_CHANNELS,
   BT_SETTINGS_LATENCY,
+  BT_SETTINGS_BUFFER_SIZE,
   BT_SETTINGS_PLAYBACK_CONTROLLER_COHERENCE_UPNP_ACTIVE,
   BT_SETTINGS_PLAYBACK_CONTROLLER_COHERENCE_UPNP_PORT,
   BT_SETTINGS_PLAYBACK_CONTROLLER_JACK_TRANSPORT_MASTER,
@@ -84,6 +85,10 @@ enum
   BT_SETTINGS_FOLDER_SONG,
   BT_SETTINGS_FOLDER_RECORD,
   BT_SETTINGS_FOLDER_SAMPLE,
+  BT_SETTINGS_XML_PATTERN_DATA,
+  BT_SETTINGS_WAVETABLE_MEMORY_BUDGET,
+  BT_SETTINGS_WAVE_CACHE_SIZE,
+  BT_SETTINGS_UNDO_MEMORY_BUDGET,
   BT_SETTINGS_UI_DARK_THEME,
   BT_SETTINGS_UI_COMPACT_THEME,
   /* system settings */
@@ -657,6 +662,10 @@ bt_settings_get_property (GObject * const object, const guint property_id,
       read_uint_def (self->priv->org_buzztrax_audio, "latency", value,
           (GParamSpecUInt *) pspec);
       break;
+    case BT_SETTINGS_BUFFER_SIZE:
+      read_uint_def (self->priv->org_buzztrax_audio, "buffer-size", value,
+          (GParamSpecUInt *) pspec);
+      break;
       /* playback controller */
     case BT_SETTINGS_PLAYBACK_CONTROLLER_COHERENCE_UPNP_ACTIVE:
       read_boolean (self->priv->org_buzztrax_playback_controller,
@@ -695,6 +704,18 @@ bt_settings_get_property (GObject * const object, const guint property_id,
       read_string_def (self->priv->org_buzztrax_directories, "sample-folder",
           value, (GParamSpecString *) pspec);
       break;
+    case BT_SETTINGS_XML_PATTERN_DATA:
+      read_boolean (self->priv->org_buzztrax, "xml-pattern-data", value);
+      break;
+    case BT_SETTINGS_WAVETABLE_MEMORY_BUDGET:
+      read_uint (self->priv->org_buzztrax, "wavetable-memory-budget", value);
+      break;
+    case BT_SETTINGS_WAVE_CACHE_SIZE:
+      read_uint (self->priv->org_buzztrax, "wave-cache-size", value);
+      break;
+    case BT_SETTINGS_UNDO_MEMORY_BUDGET:
+      read_uint (self->priv->org_buzztrax, "undo-memory-budget", value);
+      break;
     case BT_SETTINGS_UI_DARK_THEME:
       read_boolean (self->priv->org_buzztrax_ui, "dark-theme", value);
       break;
@@ -784,6 +805,9 @@ bt_settings_set_property (GObject * const object, const guint property_id,
     case BT_SETTINGS_LATENCY:
       write_uint (self->priv->org_buzztrax_audio, "latency", value);
       break;
+    case BT_SETTINGS_BUFFER_SIZE:
+      write_uint (self->priv->org_buzztrax_audio, "buffer-size", value);
+      break;
       /* playback controller */
     case BT_SETTINGS_PLAYBACK_CONTROLLER_COHERENCE_UPNP_ACTIVE:
       write_boolean (self->priv->org_buzztrax_playback_controller,
@@ -821,6 +845,18 @@ bt_settings_set_property (GObject * const object, const guint property_id,
       write_string (self->priv->org_buzztrax_directories, "sample-folder",
           value);
       break;
+    case BT_SETTINGS_XML_PATTERN_DATA:
+      write_boolean (self->priv->org_buzztrax, "xml-pattern-data", value);
+      break;
+    case BT_SETTINGS_WAVETABLE_MEMORY_BUDGET:
+      write_uint (self->priv->org_buzztrax, "wavetable-memory-budget", value);
+      break;
+    case BT_SETTINGS_WAVE_CACHE_SIZE:
+      write_uint (self->priv->org_buzztrax, "wave-cache-size", value);
+      break;
+    case BT_SETTINGS_UNDO_MEMORY_BUDGET:
+      write_uint (self->priv->org_buzztrax, "undo-memory-budget", value);
+      break;
     case BT_SETTINGS_UI_DARK_THEME:
       write_boolean (self->priv->org_buzztrax_ui, "dark-theme", value);
       break;
@@ -966,6 +1002,11 @@ bt_settings_class_init (BtSettingsClass * const klass)
           "target audio latency in ms", 1, 200, 30,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, BT_SETTINGS_BUFFER_SIZE,
+      g_param_spec_uint ("buffer-size", "buffer-size prop",
+          "audio buffer size in frames, 0 for one sub-tick per buffer", 0,
+          8192, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   // playback controller
   g_object_class_install_property (gobject_class,
       BT_SETTINGS_PLAYBACK_CONTROLLER_COHERENCE_UPNP_ACTIVE,
@@ -1019,6 +1060,35 @@ bt_settings_class_init (BtSettingsClass * const klass)
           "default directory for sample-waveforms", g_get_home_dir (),
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, BT_SETTINGS_XML_PATTERN_DATA,
+      g_param_spec_boolean ("xml-pattern-data", "xml-pattern-data prop",
+          "also store pattern data as xml in bzt song files", TRUE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      BT_SETTINGS_WAVETABLE_MEMORY_BUDGET,
+      g_param_spec_uint ("wavetable-memory-budget",
+          "wavetable-memory-budget prop",
+          "memory for wave data in MB, unused waves are released when over "
+          "budget (0 for no limit)", 0, G_MAXUINT, 1024,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      BT_SETTINGS_WAVE_CACHE_SIZE,
+      g_param_spec_uint ("wave-cache-size",
+          "wave-cache-size prop",
+          "disk space for decoded samples in MB, the least recently used "
+          "samples are removed when over the limit (0 for no limit)", 0,
+          G_MAXUINT, 4096, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      BT_SETTINGS_UNDO_MEMORY_BUDGET,
+      g_param_spec_uint ("undo-memory-budget",
+          "undo-memory-budget prop",
+          "memory for the undo history in MB, the oldest changes are "
+          "compressed and dropped when over budget (0 for no limit)", 0,
+          G_MAXUINT, 64, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   // ui settings
   g_object_class_install_property (gobject_class,
       BT_SETTINGS_UI_DARK_THEME,
@@ -1093,6 +1093,7 @@ async_add_to_pipeline (GstPad * peer, GstPadProbeInfo * info,
   const BtSetup *const self = BT_SETUP (user_data);
   BtSetupPrivate *const p = self->priv;
 
+  BT_TRACE_BEGIN ("setup", "add-to-pipeline");
   if (p->last_wire) {
     link_wire_end (self, (GstElement *) p->last_wire, NULL, GST_PAD_SRC);
   }
@@ -1119,6 +1120,7 @@ async_add_to_pipeline (GstPad * peer, GstPadProbeInfo * info,
 
   GST_INFO ("pipeline updated for add --------------------------------");
   g_mutex_unlock (&self->priv->update_mutex);
+  BT_TRACE_END ("setup", "add-to-pipeline");
 
   return GST_PAD_PROBE_REMOVE;
 }
@@ -1200,6 +1202,7 @@ async_remove_from_pipeline (GstPad * peer, GstPadProbeInfo * info,
   const BtSetup *const self = BT_SETUP (user_data);
   BtSetupPrivate *const p = self->priv;
 
+  BT_TRACE_BEGIN ("setup", "remove-from-pipeline");
   // apply state changes for the above lists
   GST_INFO ("sync states");
   sync_states_for_stop (self);
@@ -1233,6 +1236,7 @@ async_remove_from_pipeline (GstPad * peer, GstPadProbeInfo * info,
 
   GST_INFO ("pipeline updated for del --------------------------------");
   g_mutex_unlock (&self->priv->update_mutex);
+  BT_TRACE_END ("setup", "remove-from-pipeline");
 
   return GST_PAD_PROBE_REMOVE;
 }
@@ -1317,6 +1321,7 @@ bt_setup_update_pipeline (const BtSetup * const self)
 
   g_return_val_if_fail (master != NULL, FALSE);
 
+  BT_TRACE_BEGIN ("setup", "update-pipeline");
   // make a copy of lists and check what is connected from master and
   // remove all visited items
   not_visited_machines = g_list_copy (self->priv->machines);
@@ -1365,6 +1370,7 @@ bt_setup_update_pipeline (const BtSetup * const self)
   }
 
   GST_INFO ("result of graph update = %d", res);
+  BT_TRACE_END ("setup", "update-pipeline");
   return res;
 }
 
@@ -1989,7 +1995,7 @@ bt_setup_persistence_save (const BtPersistence * const persistence,
       goto Error;
     if ((child_node =
             xmlNewChild (node, NULL, XML_CHAR_PTR ("machines"), NULL))) {
-      bt_persistence_save_list (self->priv->machines, child_node, NULL);
+      bt_persistence_save_list (self->priv->machines, child_node, userdata);
     } else
       goto Error;
     if ((child_node = xmlNewChild (node, NULL, XML_CHAR_PTR ("wires"), NULL))) {
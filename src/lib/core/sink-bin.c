@@ -186,6 +186,22 @@ struct _BtSinkBinPrivate
   gulong beats_per_minute;
   gulong ticks_per_beat;
   gulong subticks_per_tick;
+  guint buffer_frames;
+  /* last tick seen by the master volume probe, for tracing */
+  gint64 last_tick;
+  /* segment for the buffers passing the master volume */
+  GstSegment segment;
+
+  /* position of the last buffer, guarded by a sequence counter that is odd
+   * while the streaming thread updates it, see
+   * bt_sink_bin_get_playback_position(); only the buffer probe writes it */
+  gint pos_seq;
+  GstClockTime pos_running_time;
+  gint64 pos_tick;
+  gint pos_reset_seen;
+  /* bumped from any thread to drop the position, the position is only valid
+   * if it has been published after the last reset */
+  gint pos_reset;
 
   /* master analyzers */
   GList *analyzers;
@@ -362,6 +378,13 @@ bt_sink_bin_configure_latency (const BtSinkBin * const self)
       // configure buffer size
       gint64 chunk = GST_TIME_AS_USECONDS ((GST_SECOND * 60) / div);
 
+      // sources render fixed size buffers, don't go below that
+      if (self->priv->buffer_frames && self->priv->sample_rate) {
+        chunk = MAX (chunk, GST_TIME_AS_USECONDS (gst_util_uint64_scale_int (
+                    GST_SECOND, self->priv->buffer_frames,
+                    self->priv->sample_rate)));
+      }
+
       GST_INFO_OBJECT (sink,
           "changing audio chunk-size to %" G_GUINT64_FORMAT " µs = %"
           G_GUINT64_FORMAT " ms", chunk, (chunk / G_GINT64_CONSTANT (1000)));
@@ -1000,12 +1023,70 @@ on_channels_changed (const BtSettings * const settings, GParamSpec * const arg,
   // affect wire patterns - how do we want to handle it
 }
 
+/* called from the streaming thread for each buffer */
+static void
+bt_sink_bin_publish_position (BtSinkBin * self, GstClockTime running_time,
+    gint64 tick)
+{
+  BtSinkBinPrivate *p = self->priv;
+  gint reset = g_atomic_int_get (&p->pos_reset);
+
+  g_atomic_int_inc (&p->pos_seq);
+  p->pos_running_time = running_time;
+  p->pos_tick = tick;
+  p->pos_reset_seen = reset;
+  g_atomic_int_inc (&p->pos_seq);
+}
+
+/* can be called from any thread, the position is published again with the
+ * next buffer */
+static void
+bt_sink_bin_reset_position (const BtSinkBin * self)
+{
+  g_atomic_int_inc (&self->priv->pos_reset);
+}
+
 static GstPadProbeReturn
 master_volume_sync_handler (GstPad * pad, GstPadProbeInfo * info,
     gpointer user_data)
 {
-  gst_object_sync_values (GST_OBJECT (user_data),
-      GST_BUFFER_TIMESTAMP ((GstBuffer *) info->data));
+  BtSinkBin *self = BT_SINK_BIN (user_data);
+  GstClockTime ts;
+  gulong ticks_per_minute;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_EVENT_BOTH) {
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+
+    switch (GST_EVENT_TYPE (event)) {
+      case GST_EVENT_SEGMENT:
+        gst_event_copy_segment (event, &self->priv->segment);
+        break;
+      case GST_EVENT_STREAM_START:
+      case GST_EVENT_FLUSH_STOP:
+        // the old position is gone
+        bt_sink_bin_reset_position (self);
+        break;
+      default:
+        break;
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  ts = GST_BUFFER_TIMESTAMP (GST_PAD_PROBE_INFO_BUFFER (info));
+  ticks_per_minute = self->priv->beats_per_minute * self->priv->ticks_per_beat;
+  if (ticks_per_minute && GST_CLOCK_TIME_IS_VALID (ts)) {
+    gint64 tick = gst_util_uint64_scale (ts, ticks_per_minute,
+        G_GUINT64_CONSTANT (60) * GST_SECOND);
+
+    if (G_UNLIKELY (bt_trace_enabled) && tick != self->priv->last_tick) {
+      BT_TRACE_COUNTER ("sink", "tick", tick);
+      self->priv->last_tick = tick;
+    }
+    bt_sink_bin_publish_position (self,
+        gst_segment_to_running_time (&self->priv->segment, GST_FORMAT_TIME,
+            ts), tick);
+  }
+  gst_object_sync_values (GST_OBJECT (user_data), ts);
   return GST_PAD_PROBE_OK;
 }
 
@@ -1041,6 +1122,52 @@ bt_sink_bin_is_record_format_supported (BtSinkBinRecordFormat format)
   return format_states[format] > RECORD_FORMAT_STATE_NOT_CHECKED;
 }
 
+/**
+ * bt_sink_bin_get_playback_position:
+ * @self: the sink-bin
+ * @running_time: (out) (allow-none): location for the running-time of the
+ * buffer or %NULL
+ * @tick: (out): location for the tick of the buffer
+ *
+ * Get the position of the last buffer that passed the master volume. The
+ * streaming thread publishes it for each buffer without taking a lock. Reading
+ * it does not query the pipeline and is cheap enough to be done for each frame
+ * of a user interface.
+ *
+ * Returns: %FALSE if no buffer has been seen since the last seek
+ *
+ * Since: 0.12
+ */
+gboolean
+bt_sink_bin_get_playback_position (BtSinkBin * self,
+    GstClockTime * running_time, gulong * tick)
+{
+  BtSinkBinPrivate *p;
+  GstClockTime rt;
+  gint64 t;
+  gint seq, reset_seen;
+
+  g_return_val_if_fail (BT_IS_SINK_BIN (self), FALSE);
+  g_return_val_if_fail (tick, FALSE);
+
+  p = self->priv;
+  do {
+    // retry while the streaming thread is updating the position
+    while ((seq = g_atomic_int_get (&p->pos_seq)) & 1);
+    rt = p->pos_running_time;
+    t = p->pos_tick;
+    reset_seen = p->pos_reset_seen;
+    // a read-modify-write, so that the reads above can't be moved behind it
+  } while (g_atomic_int_add (&p->pos_seq, 0) != seq);
+
+  if (t < 0 || reset_seen != g_atomic_int_get (&p->pos_reset))
+    return FALSE;
+  if (running_time)
+    *running_time = rt;
+  *tick = (gulong) t;
+  return TRUE;
+}
+
 //-- wrapper
 
 //-- class internals
@@ -1062,6 +1189,7 @@ bt_sink_bin_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
+      bt_sink_bin_reset_position (self);
       if (self->priv->pending_update) {
         self->priv->pending_update = FALSE;
         bt_sink_bin_update (self);
@@ -1089,15 +1217,18 @@ static void
 bt_sink_bin_set_context (GstElement * element, GstContext * context)
 {
   const BtSinkBin *const self = BT_SINK_BIN (element);
-  guint bpm, tpb, stpb;
+  guint bpm, tpb, stpb, frames = 0;
 
   if (gstbt_audio_tempo_context_get_tempo (context, &bpm, &tpb, &stpb)) {
+    gstbt_audio_tempo_context_get_buffer_frames (context, &frames);
     if (self->priv->beats_per_minute != bpm ||
         self->priv->ticks_per_beat != tpb ||
-        self->priv->subticks_per_tick != stpb) {
+        self->priv->subticks_per_tick != stpb ||
+        self->priv->buffer_frames != frames) {
       self->priv->beats_per_minute = bpm;
       self->priv->ticks_per_beat = tpb;
       self->priv->subticks_per_tick = stpb;
+      self->priv->buffer_frames = frames;
 
       GST_INFO_OBJECT (self, "audio tempo context: bmp=%u, tpb=%u, stpb=%u",
           bpm, tpb, stpb);
@@ -1206,7 +1337,8 @@ bt_sink_bin_set_property (GObject * const object, const guint property_id,
       g_object_set (self->priv->gain, "volume", self->priv->volume, NULL);
       sink_pad = gst_element_get_static_pad (self->priv->gain, "sink");
       self->priv->mv_handler_id =
-          gst_pad_add_probe (sink_pad, GST_PAD_PROBE_TYPE_BUFFER,
+          gst_pad_add_probe (sink_pad, GST_PAD_PROBE_TYPE_BUFFER |
+          GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM | GST_PAD_PROBE_TYPE_EVENT_FLUSH,
           master_volume_sync_handler, (gpointer) self, NULL);
       gst_object_unref (sink_pad);
       break;
@@ -1287,6 +1419,10 @@ static void
 bt_sink_bin_init (BtSinkBin * self)
 {
   self->priv = bt_sink_bin_get_instance_private(self);
+  self->priv->last_tick = -1;
+  self->priv->pos_tick = -1;
+  self->priv->pos_running_time = GST_CLOCK_TIME_NONE;
+  gst_segment_init (&self->priv->segment, GST_FORMAT_TIME);
 
   GST_INFO ("!!!! self=%p", self);
 
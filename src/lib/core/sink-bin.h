@@ -99,6 +99,7 @@ typedef enum {
 } BtSinkBinRecordFormat;
 
 gboolean bt_sink_bin_is_record_format_supported(BtSinkBinRecordFormat format);
+gboolean bt_sink_bin_get_playback_position(BtSinkBin *self, GstClockTime *running_time, gulong *tick);
 
 GType bt_sink_bin_get_type(void) G_GNUC_CONST;
 GType bt_sink_bin_mode_get_type(void) G_GNUC_CONST;
@@ -22,11 +22,32 @@
  * xml format with externals.
  * The format is an archive, that contains an XML file and optionally binary
  * data, such as audio samples.
+ *
+ * The pattern events are stored in a binary "patterns.bin" member, which is
+ * preferred over the events in the XML file when loading. All of it is checked
+ * before the song is loaded, if it is damaged the events from the XML file are
+ * used. By default the events are also stored in the XML file, so that older
+ * versions can read the song. Turning off the #BtSettings property
+ * "xml-pattern-data" makes the files smaller, but older versions will then
+ * load the patterns without their events.
+ *
+ * When saving, a snapshot of the song is taken first. It holds the XML tree,
+ * the packed pattern events and the sources of the wave data. The snapshot is
+ * written and compressed without accessing the song, so that
+ * bt_song_io_save_async() can do this in the background.
+ *
+ * If the song file already exists (or has been moved to a ".bak" file before
+ * saving), external files that have not changed are not compressed again.
+ * Their compressed data is copied from the previous song file as is. The other
+ * external files are compressed in parallel on a pool of worker threads.
+ * Files that are already compressed (e.g. flac or ogg) are stored as is.
  */
 
 #define BT_CORE
 #define BT_SONG_IO_NATIVE_BZT_C
 
+#include <errno.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -34,6 +55,8 @@
 #include "core_private.h"
 #include "song-io-native-bzt.h"
 #include <glib/gprintf.h>
+#include <glib/gstdio.h>
+#include <libxml/xmlreader.h>
 
 #ifdef USE_GSF
 #include <gsf/gsf-utils.h>
@@ -45,14 +68,17 @@
 #include <gsf/gsf-output-stdio.h>
 #include <gsf/gsf-outfile.h>
 #include <gsf/gsf-outfile-zip.h>
+#include <zlib.h>
 #endif
 
 //-- common helpers
 
-gboolean bt_song_io_native_load (xmlDocPtr song_doc, const BtSong * const song,
+gboolean bt_song_io_native_load (xmlTextReaderPtr reader,
+    const BtSong * const song, GHashTable * packed_lengths,
     GError ** err);
-void bt_song_io_native_load_set_error (xmlParserCtxtPtr const ctxt,
-    gchar * const file_name, GError ** err);
+gchar *bt_song_io_native_get_pattern_key (const gchar * machine_id,
+    const gchar * pattern_name);
+void bt_song_io_native_load_set_error (gchar * const file_name, GError ** err);
 
 struct _BtSongIONativeBZTPrivate
 {
@@ -65,8 +91,44 @@ struct _BtSongIONativeBZTPrivate
   GsfOutput *output;
   GsfOutfile *outfile;
 #endif
+  /* external files collected while taking a snapshot */
+  GList *members;               // each entry points to a BtSongIONativeBZTMember
+  /* number of members copied from the previous file by the last save */
+  guint reused_members;
 };
 
+/* a member of an existing zip file */
+typedef struct
+{
+  /* the central directory record, including the name and the extra fields */
+  guint8 *record;
+  gsize record_len;
+  gchar *file_name;
+  guint16 flags, method;
+  guint32 crc, compressed_size, size, offset;
+} BtSongIONativeBZTZipEntry;
+
+/* an external file that is copied into the song file */
+typedef struct
+{
+  /* the path inside the song file */
+  gchar *file_name;
+  /* the source, either a file or a (dup'ed) file descriptor */
+  gchar *src_file_name;
+  gint fd;
+  /* the same data in the previous song file or NULL */
+  const BtSongIONativeBZTZipEntry *reuse;
+} BtSongIONativeBZTMember;
+
+/* everything that is needed to write the song file without the song */
+typedef struct
+{
+  gchar *file_name;
+  xmlDocPtr song_doc;
+  GByteArray *patterns;
+  GList *members;
+} BtSongIONativeBZTSnapshot;
+
 static GQuark error_domain = 0;
 
 //-- the class
@@ -75,6 +137,1084 @@ G_DEFINE_TYPE_WITH_CODE (BtSongIONativeBZT, bt_song_io_native_bzt,
     BT_TYPE_SONG_IO_NATIVE,
     G_ADD_PRIVATE(BtSongIONativeBZT));
 
+//-- helper methods
+
+static void
+bt_song_io_native_bzt_member_free (BtSongIONativeBZTMember * member)
+{
+  if (member->fd != -1)
+    close (member->fd);
+  g_free (member->src_file_name);
+  g_free (member->file_name);
+  g_slice_free (BtSongIONativeBZTMember, member);
+}
+
+#ifdef USE_GSF
+static void
+bt_song_io_native_bzt_snapshot_free (BtSongIONativeBZTSnapshot * snapshot)
+{
+  g_list_free_full (snapshot->members,
+      (GDestroyNotify) bt_song_io_native_bzt_member_free);
+  if (snapshot->patterns)
+    g_byte_array_free (snapshot->patterns, TRUE);
+  if (snapshot->song_doc)
+    xmlFreeDoc (snapshot->song_doc);
+  g_free (snapshot->file_name);
+  g_slice_free (BtSongIONativeBZTSnapshot, snapshot);
+}
+
+/* The patterns.bin layout, all integers are little endian guint32 and strings
+ * are stored as their length followed by the chars:
+ *   "BTPD", version, number of patterns
+ *   per pattern: machine id, pattern name, length, number of columns
+ *   per column: voice (PATTERN_DATA_GLOBAL for global params), param name,
+ *     param type name, size, size bytes from bt_value_group_pack_column()
+ * Only columns with events are stored. Version 1 lost the invalid values of
+ * enum columns and is not read anymore.
+ */
+#define PATTERN_DATA_FILE "patterns.bin"
+#define PATTERN_DATA_MAGIC "BTPD"
+#define PATTERN_DATA_VERSION 2
+#define PATTERN_DATA_GLOBAL G_MAXUINT32
+
+/* external files are copied in blocks of this size */
+#define MEMBER_BLOCK_SIZE (64 * 1024)
+/* number of compressed blocks a worker thread keeps before it waits for the
+ * writer */
+#define MEMBER_QUEUE_LEN 16
+
+static void
+put_uint32 (GByteArray * data, guint32 val)
+{
+  val = GUINT32_TO_LE (val);
+  g_byte_array_append (data, (guint8 *) & val, sizeof (val));
+}
+
+static void
+set_uint32 (GByteArray * data, guint pos, guint32 val)
+{
+  val = GUINT32_TO_LE (val);
+  memcpy (&data->data[pos], &val, sizeof (val));
+}
+
+static void
+put_string (GByteArray * data, const gchar * str)
+{
+  const guint32 len = (guint32) strlen (str);
+
+  put_uint32 (data, len);
+  g_byte_array_append (data, (const guint8 *) str, len);
+}
+
+static gboolean
+get_uint32 (const guint8 ** data, const guint8 * end, guint32 * val)
+{
+  if ((gsize) (end - *data) < sizeof (*val))
+    return FALSE;
+  memcpy (val, *data, sizeof (*val));
+  *val = GUINT32_FROM_LE (*val);
+  *data += sizeof (*val);
+  return TRUE;
+}
+
+static gchar *
+get_string (const guint8 ** data, const guint8 * end)
+{
+  gchar *str;
+  guint32 len;
+
+  if (!get_uint32 (data, end, &len) || ((gsize) (end - *data) < len))
+    return NULL;
+  str = g_strndup ((const gchar *) *data, len);
+  *data += len;
+  return str;
+}
+
+static guint32
+bt_song_io_native_bzt_pack_group (GByteArray * data, BtValueGroup * vg,
+    BtParameterGroup * pg, guint32 voice, GByteArray * column)
+{
+  gulong i, params;
+  guint32 columns = 0;
+
+  g_object_get (pg, "num-params", &params, NULL);
+  for (i = 0; i < params; i++) {
+    g_byte_array_set_size (column, 0);
+    bt_value_group_pack_column (vg, i, column);
+    if (!column->len)
+      continue;
+    put_uint32 (data, voice);
+    put_string (data, bt_parameter_group_get_param_name (pg, i));
+    put_string (data, g_type_name (bt_parameter_group_get_param_type (pg, i)));
+    put_uint32 (data, column->len);
+    g_byte_array_append (data, column->data, column->len);
+    columns++;
+  }
+  return columns;
+}
+
+static GByteArray *
+bt_song_io_native_bzt_pack_patterns (const BtSong * const song)
+{
+  GByteArray *data = g_byte_array_new ();
+  GByteArray *column = g_byte_array_new ();
+  BtSetup *setup;
+  GList *machines, *patterns, *mnode, *pnode;
+  guint32 num_patterns = 0, columns;
+  gulong v, voices, length;
+  guint pos;
+  gchar *id, *name;
+
+  g_byte_array_append (data, (const guint8 *) PATTERN_DATA_MAGIC, 4);
+  put_uint32 (data, PATTERN_DATA_VERSION);
+  put_uint32 (data, 0);
+
+  g_object_get ((gpointer) song, "setup", &setup, NULL);
+  g_object_get (setup, "machines", &machines, NULL);
+  for (mnode = machines; mnode; mnode = g_list_next (mnode)) {
+    BtMachine *machine = BT_MACHINE (mnode->data);
+
+    patterns = NULL;
+    g_object_get (machine, "id", &id, "patterns", &patterns, NULL);
+    for (pnode = patterns; pnode; pnode = g_list_next (pnode)) {
+      BtPattern *pattern;
+
+      if (!BT_IS_PATTERN (pnode->data))
+        continue;
+      pattern = BT_PATTERN (pnode->data);
+      g_object_get (pattern, "name", &name, "voices", &voices, "length",
+          &length, NULL);
+      put_string (data, id);
+      put_string (data, name);
+      put_uint32 (data, (guint32) length);
+      g_free (name);
+      pos = data->len;
+      put_uint32 (data, 0);
+      columns = bt_song_io_native_bzt_pack_group (data,
+          bt_pattern_get_global_group (pattern),
+          bt_machine_get_global_param_group (machine), PATTERN_DATA_GLOBAL,
+          column);
+      for (v = 0; v < voices; v++) {
+        columns += bt_song_io_native_bzt_pack_group (data,
+            bt_pattern_get_voice_group (pattern, v),
+            bt_machine_get_voice_param_group (machine, v), v, column);
+      }
+      set_uint32 (data, pos, columns);
+      num_patterns++;
+    }
+    g_list_free_full (patterns, g_object_unref);
+    g_free (id);
+  }
+  set_uint32 (data, 8, num_patterns);
+  GST_INFO ("packed %u patterns into %u bytes", num_patterns, data->len);
+
+  g_list_free (machines);
+  g_object_unref (setup);
+  g_byte_array_free (column, TRUE);
+  return data;
+}
+
+static gboolean
+bt_song_io_native_bzt_skip_string (const guint8 ** data, const guint8 * end)
+{
+  guint32 len;
+
+  if (!get_uint32 (data, end, &len) || ((gsize) (end - *data) < len))
+    return FALSE;
+  *data += len;
+  return TRUE;
+}
+
+/* Walks through all of the pattern data before the song is loaded and
+ * records the length of each packed pattern. If anything is wrong, the events
+ * are loaded from the XML file instead. */
+static gboolean
+bt_song_io_native_bzt_check_patterns (const guint8 * data, gsize len,
+    GHashTable * lengths)
+{
+  const guint8 *end = data + len;
+  guint32 version, num_patterns, length, num_columns, voice, size, i, j;
+  gchar *id, *name;
+  gboolean res;
+
+  if (len < 4 || memcmp (data, PATTERN_DATA_MAGIC, 4)) {
+    GST_WARNING ("pattern data has a wrong header");
+    return FALSE;
+  }
+  data += 4;
+  if (!get_uint32 (&data, end, &version) || version != PATTERN_DATA_VERSION) {
+    GST_WARNING ("pattern data has an unsupported version");
+    return FALSE;
+  }
+  if (!get_uint32 (&data, end, &num_patterns))
+    goto Error;
+  for (i = 0; i < num_patterns; i++) {
+    id = get_string (&data, end);
+    name = get_string (&data, end);
+    res = id && name && get_uint32 (&data, end, &length) &&
+        get_uint32 (&data, end, &num_columns);
+    if (res) {
+      g_hash_table_insert (lengths, bt_song_io_native_get_pattern_key (id,
+              name), GUINT_TO_POINTER (length));
+    }
+    g_free (id);
+    g_free (name);
+    if (!res)
+      goto Error;
+    for (j = 0; j < num_columns; j++) {
+      if (!get_uint32 (&data, end, &voice) ||
+          !bt_song_io_native_bzt_skip_string (&data, end) ||
+          !bt_song_io_native_bzt_skip_string (&data, end) ||
+          !get_uint32 (&data, end, &size) || ((gsize) (end - data) < size) ||
+          !bt_value_group_check_packed_column (data, size, length))
+        goto Error;
+      data += size;
+    }
+  }
+  if (data == end)
+    return TRUE;
+Error:
+  GST_WARNING ("pattern data is corrupt");
+  return FALSE;
+}
+
+/* Only called for data that passed bt_song_io_native_bzt_check_patterns(). */
+static void
+bt_song_io_native_bzt_unpack_patterns (const BtSong * const song,
+    const guint8 * data, gsize len)
+{
+  const guint8 *end = data + len;
+  BtSetup *setup;
+  BtMachine *machine;
+  BtCmdPattern *pattern;
+  BtValueGroup *vg;
+  BtParameterGroup *pg;
+  guint32 version, num_patterns, length, num_columns, voice, size, i, j;
+  gulong voices, pattern_length;
+  glong param;
+  gchar *id, *name, *param_name, *type_name;
+
+  g_object_get ((gpointer) song, "setup", &setup, NULL);
+
+  data += 4;
+  get_uint32 (&data, end, &version);
+  get_uint32 (&data, end, &num_patterns);
+
+  for (i = 0; i < num_patterns; i++) {
+    id = get_string (&data, end);
+    name = get_string (&data, end);
+    get_uint32 (&data, end, &length);
+    get_uint32 (&data, end, &num_columns);
+
+    pattern = NULL;
+    voices = pattern_length = 0;
+    if ((machine = bt_setup_get_machine_by_id (setup, id))) {
+      if ((pattern = bt_machine_get_pattern_by_name (machine, name))) {
+        g_object_get (pattern, "voices", &voices, "length", &pattern_length,
+            NULL);
+      }
+    }
+    if (!BT_IS_PATTERN (pattern)) {
+      GST_INFO ("no pattern '%s' for machine '%s'", name, id);
+    } else if (pattern_length != length) {
+      // the events have been loaded from the XML file
+      GST_WARNING ("pattern '%s:%s' has %lu ticks, pattern data has %u", id,
+          name, pattern_length, length);
+    }
+
+    for (j = 0; j < num_columns; j++) {
+      get_uint32 (&data, end, &voice);
+      param_name = get_string (&data, end);
+      type_name = get_string (&data, end);
+      get_uint32 (&data, end, &size);
+      vg = NULL;
+      pg = NULL;
+      if (BT_IS_PATTERN (pattern) && pattern_length == length) {
+        if (voice == PATTERN_DATA_GLOBAL) {
+          vg = bt_pattern_get_global_group ((BtPattern *) pattern);
+          pg = bt_machine_get_global_param_group (machine);
+        } else if (voice < voices) {
+          vg = bt_pattern_get_voice_group ((BtPattern *) pattern, voice);
+          pg = bt_machine_get_voice_param_group (machine, voice);
+        }
+      }
+      if (vg && ((param = bt_parameter_group_get_param_index (pg,
+                      param_name)) != -1) &&
+          !strcmp (type_name,
+              g_type_name (bt_parameter_group_get_param_type (pg, param)))) {
+        bt_value_group_unpack_column (vg, param, data, size);
+      } else if (BT_IS_PATTERN (pattern)) {
+        GST_WARNING ("skipping pattern data for '%s:%s', param '%s'", id, name,
+            param_name);
+      }
+      data += size;
+      g_free (param_name);
+      g_free (type_name);
+    }
+
+    if (pattern)
+      g_object_unref (pattern);
+    if (machine)
+      g_object_unref (machine);
+    g_free (id);
+    g_free (name);
+  }
+  g_object_unref (setup);
+}
+
+static gboolean
+bt_song_io_native_bzt_write_bytes (GsfOutfile * outfile, const gchar * name,
+    const guint8 * data, gsize len)
+{
+  GsfOutput *output;
+  gboolean res = FALSE;
+
+  if ((output = gsf_outfile_new_child (outfile, name, FALSE))) {
+    res = gsf_output_write (output, len, data);
+    gsf_output_close (output);
+    g_object_unref (output);
+  }
+  return res;
+}
+
+static gint
+bt_song_io_native_bzt_open_member (BtSongIONativeBZTMember * member)
+{
+  gint fd = member->fd;
+
+  if (member->src_file_name) {
+    if ((fd = g_open (member->src_file_name, O_RDONLY, 0)) == -1) {
+      GST_ERROR ("error reading data \"%s\" : %s", member->src_file_name,
+          g_strerror (errno));
+    }
+  }
+  return fd;
+}
+
+static gboolean
+bt_song_io_native_bzt_write_member (GsfOutfile * outfile,
+    BtSongIONativeBZTMember * member)
+{
+  GsfOutput *output;
+  gboolean res = FALSE;
+  gint fd;
+
+  if ((fd = bt_song_io_native_bzt_open_member (member)) == -1)
+    return FALSE;
+  if ((output = gsf_outfile_new_child (outfile, member->file_name, FALSE))) {
+    guint8 *buf = g_malloc (MEMBER_BLOCK_SIZE);
+    gssize bytes;
+    off_t pos = 0;
+
+    // use pread(), the fd shares the file offset with the wave
+    res = TRUE;
+    while (res && (bytes = pread (fd, buf, MEMBER_BLOCK_SIZE, pos)) > 0) {
+      res = gsf_output_write (output, bytes, buf);
+      pos += bytes;
+    }
+    if (bytes < 0) {
+      GST_WARNING ("error reading data \"%s\" : %s", member->file_name,
+          g_strerror (errno));
+      res = FALSE;
+    }
+    GST_INFO ("wrote %" G_GINT64_FORMAT " bytes to \"%s\"", (gint64) pos,
+        member->file_name);
+    g_free (buf);
+    gsf_output_close (output);
+    g_object_unref (output);
+  }
+  if (member->src_file_name)
+    close (fd);
+  return res;
+}
+
+/* Helpers to write the external files of a song. libgsf can neither copy
+ * compressed data nor take data that has been compressed elsewhere, so the
+ * song file is written with the song.xml and the pattern data first. Then the
+ * unchanged members are copied from the previous file as they are, the other
+ * members are compressed in parallel and a new central directory is written.
+ * Only plain zip files are handled (no zip64, no multiple disks), otherwise
+ * all members are written with libgsf.
+ */
+#define ZIP_LOCAL_HEADER_SIG 0x04034b50
+#define ZIP_LOCAL_HEADER_LEN 30
+#define ZIP_DATA_DESCRIPTOR_SIG 0x08074b50
+#define ZIP_DIR_ENTRY_SIG 0x02014b50
+#define ZIP_DIR_ENTRY_LEN 46
+#define ZIP_DIR_END_SIG 0x06054b50
+#define ZIP_DIR_END_LEN 22
+#define ZIP64_DIR_END_LOCATOR_SIG 0x07064b50
+#define ZIP64_DIR_END_LOCATOR_LEN 20
+#define ZIP_MAX_COMMENT_LEN 0xffff
+#define ZIP_VERSION 20
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATED 8
+#define ZIP_FLAG_UTF8 0x0800
+
+/* a member that is compressed on a worker thread, the writer takes the
+ * compressed blocks from the queue, both are guarded by the packer lock */
+typedef struct
+{
+  BtSongIONativeBZTMember *member;
+  gboolean done, res;
+  guint32 crc, size;
+  GQueue blocks;                // each entry points to a GByteArray
+} BtSongIONativeBZTPackJob;
+
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  /* set when the writer gives up, so that the workers stop waiting */
+  gboolean cancelled;
+} BtSongIONativeBZTPacker;
+
+static guint16
+get_le16 (const guint8 * data)
+{
+  return (guint16) (data[0] | (data[1] << 8));
+}
+
+static guint32
+get_le32 (const guint8 * data)
+{
+  return (guint32) data[0] | ((guint32) data[1] << 8) |
+      ((guint32) data[2] << 16) | ((guint32) data[3] << 24);
+}
+
+static void
+set_le16 (guint8 * data, guint16 val)
+{
+  data[0] = val & 0xff;
+  data[1] = (val >> 8) & 0xff;
+}
+
+static void
+set_le32 (guint8 * data, guint32 val)
+{
+  data[0] = val & 0xff;
+  data[1] = (val >> 8) & 0xff;
+  data[2] = (val >> 16) & 0xff;
+  data[3] = (val >> 24) & 0xff;
+}
+
+static gboolean
+read_fully (gint fd, guint8 * buf, gsize len, off_t pos)
+{
+  gssize bytes;
+
+  while (len > 0) {
+    if ((bytes = pread (fd, buf, len, pos)) <= 0) {
+      if (bytes < 0 && errno == EINTR)
+        continue;
+      return FALSE;
+    }
+    buf += bytes;
+    len -= bytes;
+    pos += bytes;
+  }
+  return TRUE;
+}
+
+static gboolean
+write_fully (gint fd, const guint8 * buf, gsize len, off_t pos)
+{
+  gssize bytes;
+
+  while (len > 0) {
+    if ((bytes = pwrite (fd, buf, len, pos)) <= 0) {
+      if (bytes < 0 && errno == EINTR)
+        continue;
+      return FALSE;
+    }
+    buf += bytes;
+    len -= bytes;
+    pos += bytes;
+  }
+  return TRUE;
+}
+
+static void
+bt_song_io_native_bzt_zip_entry_free (BtSongIONativeBZTZipEntry * entry)
+{
+  g_free (entry->record);
+  g_free (entry->file_name);
+  g_slice_free (BtSongIONativeBZTZipEntry, entry);
+}
+
+/* read the central directory of the zip file in @fd, returns the entries in
+ * the order of the directory and the offset of the directory */
+static GPtrArray *
+bt_song_io_native_bzt_read_zip_dir (gint fd, guint32 * dir_offset)
+{
+  GPtrArray *entries = NULL;
+  struct stat st;
+  guint8 *buf = NULL, *end, *dir = NULL, *p;
+  gsize len;
+  guint32 dir_size, dir_pos;
+  guint16 num_entries, i;
+
+  if (fstat (fd, &st) || st.st_size < ZIP_DIR_END_LEN ||
+      st.st_size >= G_MAXUINT32)
+    return NULL;
+
+  // the end record is at the end, followed by a comment
+  len = MIN (st.st_size, ZIP_DIR_END_LEN + ZIP_MAX_COMMENT_LEN);
+  buf = g_malloc (len);
+  if (!read_fully (fd, buf, len, st.st_size - len))
+    goto Error;
+  for (end = buf + len - ZIP_DIR_END_LEN; end >= buf; end--) {
+    if (get_le32 (end) == ZIP_DIR_END_SIG)
+      break;
+  }
+  if (end < buf)
+    goto Error;
+  if ((end - buf >= ZIP64_DIR_END_LOCATOR_LEN) &&
+      (get_le32 (end - ZIP64_DIR_END_LOCATOR_LEN) ==
+          ZIP64_DIR_END_LOCATOR_SIG)) {
+    GST_INFO ("zip64 files are not supported");
+    goto Error;
+  }
+  num_entries = get_le16 (end + 10);
+  dir_size = get_le32 (end + 12);
+  dir_pos = get_le32 (end + 16);
+  if (get_le16 (end + 4) != 0 || get_le16 (end + 6) != 0 ||
+      get_le16 (end + 8) != num_entries || num_entries == G_MAXUINT16 ||
+      (guint64) dir_pos + dir_size > (guint64) st.st_size)
+    goto Error;
+
+  dir = g_malloc (dir_size);
+  if (!read_fully (fd, dir, dir_size, dir_pos))
+    goto Error;
+
+  entries = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      bt_song_io_native_bzt_zip_entry_free);
+  for (p = dir, i = 0; i < num_entries; i++) {
+    BtSongIONativeBZTZipEntry *entry;
+    gsize name_len, record_len;
+
+    if ((p + ZIP_DIR_ENTRY_LEN > dir + dir_size) ||
+        (get_le32 (p) != ZIP_DIR_ENTRY_SIG))
+      goto Error;
+    name_len = get_le16 (p + 28);
+    record_len =
+        ZIP_DIR_ENTRY_LEN + name_len + get_le16 (p + 30) + get_le16 (p + 32);
+    if (p + record_len > dir + dir_size)
+      goto Error;
+
+    entry = g_slice_new (BtSongIONativeBZTZipEntry);
+    entry->record = g_memdup (p, record_len);
+    entry->record_len = record_len;
+    entry->file_name = g_strndup ((gchar *) p + ZIP_DIR_ENTRY_LEN, name_len);
+    entry->flags = get_le16 (p + 8);
+    entry->method = get_le16 (p + 10);
+    entry->crc = get_le32 (p + 16);
+    entry->compressed_size = get_le32 (p + 20);
+    entry->size = get_le32 (p + 24);
+    entry->offset = get_le32 (p + 42);
+    g_ptr_array_add (entries, entry);
+    p += record_len;
+  }
+  if (dir_offset)
+    *dir_offset = dir_pos;
+  g_free (dir);
+  g_free (buf);
+  return entries;
+Error:
+  GST_INFO ("can't read zip directory");
+  if (entries)
+    g_ptr_array_free (entries, TRUE);
+  g_free (dir);
+  g_free (buf);
+  return NULL;
+}
+
+/* open the previous version of the song file and read its zip directory */
+static gint
+bt_song_io_native_bzt_open_previous (const gchar * file_name,
+    GPtrArray ** entries)
+{
+  gchar *bak_file_name = g_strconcat (file_name, ".bak", NULL);
+  gint fd;
+
+  // the editor moves the song file out of the way before saving
+  if ((fd = g_open (file_name, O_RDONLY, 0)) == -1) {
+    fd = g_open (bak_file_name, O_RDONLY, 0);
+  }
+  g_free (bak_file_name);
+  if (fd != -1) {
+    if (!(*entries = bt_song_io_native_bzt_read_zip_dir (fd, NULL))) {
+      close (fd);
+      fd = -1;
+    }
+  }
+  return fd;
+}
+
+/* check if the source of @member has the same content as @entry */
+static gboolean
+bt_song_io_native_bzt_member_unchanged (BtSongIONativeBZTMember * member,
+    const BtSongIONativeBZTZipEntry * entry)
+{
+  struct stat st;
+  gboolean res = FALSE;
+  gint fd;
+
+  // skip entries that would need zip64 and entries we don't understand
+  if (entry->size == G_MAXUINT32 || entry->compressed_size == G_MAXUINT32 ||
+      entry->offset == G_MAXUINT32 || (entry->flags & 0x1))
+    return FALSE;
+
+  if ((fd = bt_song_io_native_bzt_open_member (member)) == -1)
+    return FALSE;
+  if (!fstat (fd, &st) && st.st_size == entry->size) {
+    guint8 *buf = g_malloc (MEMBER_BLOCK_SIZE);
+    uLong crc = crc32 (0L, Z_NULL, 0);
+    gssize bytes;
+    off_t pos = 0;
+
+    while ((bytes = pread (fd, buf, MEMBER_BLOCK_SIZE, pos)) > 0) {
+      crc = crc32 (crc, buf, bytes);
+      pos += bytes;
+    }
+    res = (bytes == 0 && pos == entry->size && crc == entry->crc);
+    g_free (buf);
+  }
+  if (member->src_file_name)
+    close (fd);
+  GST_INFO ("\"%s\" is %s", member->file_name, res ? "unchanged" : "changed");
+  return res;
+}
+
+/* get the size of the local header, data and data descriptor of @entry */
+static gboolean
+bt_song_io_native_bzt_get_zip_entry_span (gint fd,
+    const BtSongIONativeBZTZipEntry * entry, guint32 * span)
+{
+  guint8 header[ZIP_LOCAL_HEADER_LEN];
+  guint64 len;
+
+  if (!read_fully (fd, header, ZIP_LOCAL_HEADER_LEN, entry->offset) ||
+      get_le32 (header) != ZIP_LOCAL_HEADER_SIG)
+    return FALSE;
+  len = ZIP_LOCAL_HEADER_LEN + get_le16 (header + 26) +
+      get_le16 (header + 28) + (guint64) entry->compressed_size;
+  if (entry->flags & 0x8) {
+    guint8 sig[4];
+
+    // the data descriptor has an optional signature
+    if (!read_fully (fd, sig, 4, entry->offset + len))
+      return FALSE;
+    len += (get_le32 (sig) == ZIP_DATA_DESCRIPTOR_SIG) ? 16 : 12;
+  }
+  if (len >= G_MAXUINT32)
+    return FALSE;
+  *span = (guint32) len;
+  return TRUE;
+}
+
+/* audio formats that don't get smaller when deflating them */
+static gboolean
+bt_song_io_native_bzt_is_compressed (const gchar * file_name)
+{
+  static const gchar *exts[] = {
+    ".flac", ".ogg", ".oga", ".opus", ".mp3", ".m4a", ".wv", NULL
+  };
+  gchar *name = g_ascii_strdown (file_name, -1);
+  gboolean res = FALSE;
+  gint i;
+
+  for (i = 0; exts[i] && !res; i++) {
+    res = g_str_has_suffix (name, exts[i]);
+  }
+  g_free (name);
+  return res;
+}
+
+/* hand a compressed block to the writer, waits while the queue is full */
+static gboolean
+bt_song_io_native_bzt_push_block (BtSongIONativeBZTPacker * packer,
+    BtSongIONativeBZTPackJob * job, const guint8 * data, gsize len)
+{
+  gboolean res;
+
+  g_mutex_lock (&packer->lock);
+  while (!packer->cancelled && job->blocks.length >= MEMBER_QUEUE_LEN) {
+    g_cond_wait (&packer->cond, &packer->lock);
+  }
+  if ((res = !packer->cancelled)) {
+    GByteArray *block = g_byte_array_sized_new (len);
+
+    g_byte_array_append (block, data, len);
+    g_queue_push_tail (&job->blocks, block);
+    g_cond_broadcast (&packer->cond);
+  }
+  g_mutex_unlock (&packer->lock);
+  return res;
+}
+
+static gboolean
+bt_song_io_native_bzt_deflate_member (BtSongIONativeBZTPacker * packer,
+    BtSongIONativeBZTPackJob * job)
+{
+  BtSongIONativeBZTMember *member = job->member;
+  z_stream z = { 0, };
+  struct stat st;
+  uLong crc = crc32 (0L, Z_NULL, 0);
+  guint8 *in, *out;
+  gssize bytes;
+  off_t pos = 0;
+  gint fd, flush, zres = Z_OK;
+  gboolean res = FALSE, pushed = TRUE;
+
+  if ((fd = bt_song_io_native_bzt_open_member (member)) == -1)
+    return FALSE;
+  if (fstat (fd, &st) || st.st_size >= G_MAXUINT32 ||
+      deflateInit2 (&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+          Z_DEFAULT_STRATEGY) != Z_OK) {
+    if (member->src_file_name)
+      close (fd);
+    return FALSE;
+  }
+
+  in = g_malloc (MEMBER_BLOCK_SIZE);
+  out = g_malloc (MEMBER_BLOCK_SIZE);
+  do {
+    if ((bytes = pread (fd, in, MEMBER_BLOCK_SIZE, pos)) < 0) {
+      GST_WARNING ("error reading data \"%s\" : %s", member->file_name,
+          g_strerror (errno));
+      break;
+    }
+    crc = crc32 (crc, in, bytes);
+    pos += bytes;
+    flush = bytes ? Z_NO_FLUSH : Z_FINISH;
+    z.next_in = in;
+    z.avail_in = bytes;
+    do {
+      z.next_out = out;
+      z.avail_out = MEMBER_BLOCK_SIZE;
+      zres = deflate (&z, flush);
+      if (z.avail_out < MEMBER_BLOCK_SIZE) {
+        pushed = bt_song_io_native_bzt_push_block (packer, job, out,
+            MEMBER_BLOCK_SIZE - z.avail_out);
+      }
+    } while (pushed && z.avail_out == 0);
+  } while (pushed && flush != Z_FINISH);
+  deflateEnd (&z);
+
+  if (zres == Z_STREAM_END && pos < G_MAXUINT32) {
+    job->crc = crc;
+    job->size = pos;
+    res = TRUE;
+  }
+  GST_INFO ("deflated \"%s\": %" G_GINT64_FORMAT " bytes, %s",
+      member->file_name, (gint64) pos, res ? "ok" : "failed");
+  g_free (in);
+  g_free (out);
+  if (member->src_file_name)
+    close (fd);
+  return res;
+}
+
+static void
+bt_song_io_native_bzt_pack_member (gpointer data, gpointer user_data)
+{
+  BtSongIONativeBZTPackJob *job = (BtSongIONativeBZTPackJob *) data;
+  BtSongIONativeBZTPacker *packer = (BtSongIONativeBZTPacker *) user_data;
+  gboolean res = bt_song_io_native_bzt_deflate_member (packer, job);
+
+  g_mutex_lock (&packer->lock);
+  job->res = res;
+  job->done = TRUE;
+  g_cond_broadcast (&packer->cond);
+  g_mutex_unlock (&packer->lock);
+}
+
+/* write the compressed blocks of @job to @fd at @pos as they arrive, returns
+ * the number of bytes in @size */
+static gboolean
+bt_song_io_native_bzt_write_deflated (gint fd, guint64 pos,
+    BtSongIONativeBZTPacker * packer, BtSongIONativeBZTPackJob * job,
+    guint64 * size)
+{
+  GByteArray *block;
+  gboolean res;
+
+  *size = 0;
+  for (;;) {
+    g_mutex_lock (&packer->lock);
+    while (!job->done && g_queue_is_empty (&job->blocks)) {
+      g_cond_wait (&packer->cond, &packer->lock);
+    }
+    if ((block = g_queue_pop_head (&job->blocks))) {
+      g_cond_broadcast (&packer->cond);
+    } else {
+      res = job->res;
+    }
+    g_mutex_unlock (&packer->lock);
+    if (!block)
+      break;
+
+    res = (pos + *size + block->len < G_MAXUINT32) &&
+        write_fully (fd, block->data, block->len, pos + *size);
+    *size += block->len;
+    g_byte_array_free (block, TRUE);
+    if (!res)
+      break;
+  }
+  return res;
+}
+
+/* copy the source of @member to @fd at @pos without compressing it */
+static gboolean
+bt_song_io_native_bzt_store_member (gint fd, guint64 pos,
+    BtSongIONativeBZTMember * member, guint8 * buf,
+    BtSongIONativeBZTZipEntry * entry)
+{
+  uLong crc = crc32 (0L, Z_NULL, 0);
+  guint64 size = 0;
+  gssize bytes;
+  gboolean res = TRUE;
+  gint src_fd;
+
+  if ((src_fd = bt_song_io_native_bzt_open_member (member)) == -1)
+    return FALSE;
+  while (res && (bytes = pread (src_fd, buf, MEMBER_BLOCK_SIZE, size)) > 0) {
+    crc = crc32 (crc, buf, bytes);
+    res = write_fully (fd, buf, bytes, pos + size);
+    size += bytes;
+  }
+  if (bytes < 0 || pos + size >= G_MAXUINT32)
+    res = FALSE;
+  if (member->src_file_name)
+    close (src_fd);
+
+  entry->method = ZIP_METHOD_STORED;
+  entry->crc = crc;
+  entry->compressed_size = entry->size = (guint32) size;
+  return res;
+}
+
+/* write the local header of the new @entry to @fd and add its directory
+ * record to @dir */
+static gboolean
+bt_song_io_native_bzt_put_zip_entry (gint fd,
+    const BtSongIONativeBZTZipEntry * entry, guint32 dos_date_time,
+    GByteArray * dir)
+{
+  gsize name_len = strlen (entry->file_name);
+  guint8 header[ZIP_LOCAL_HEADER_LEN], record[ZIP_DIR_ENTRY_LEN];
+  guint16 flags = g_str_is_ascii (entry->file_name) ? 0 : ZIP_FLAG_UTF8;
+
+  memset (header, 0, ZIP_LOCAL_HEADER_LEN);
+  set_le32 (header, ZIP_LOCAL_HEADER_SIG);
+  set_le16 (header + 4, ZIP_VERSION);
+  set_le16 (header + 6, flags);
+  set_le16 (header + 8, entry->method);
+  set_le32 (header + 10, dos_date_time);
+  set_le32 (header + 14, entry->crc);
+  set_le32 (header + 18, entry->compressed_size);
+  set_le32 (header + 22, entry->size);
+  set_le16 (header + 26, (guint16) name_len);
+  if (!write_fully (fd, header, ZIP_LOCAL_HEADER_LEN, entry->offset) ||
+      !write_fully (fd, (const guint8 *) entry->file_name, name_len,
+          entry->offset + ZIP_LOCAL_HEADER_LEN))
+    return FALSE;
+
+  memset (record, 0, ZIP_DIR_ENTRY_LEN);
+  set_le32 (record, ZIP_DIR_ENTRY_SIG);
+  set_le16 (record + 4, ZIP_VERSION);
+  set_le16 (record + 6, ZIP_VERSION);
+  set_le16 (record + 8, flags);
+  set_le16 (record + 10, entry->method);
+  set_le32 (record + 12, dos_date_time);
+  set_le32 (record + 16, entry->crc);
+  set_le32 (record + 20, entry->compressed_size);
+  set_le32 (record + 24, entry->size);
+  set_le16 (record + 28, (guint16) name_len);
+  set_le32 (record + 42, entry->offset);
+  g_byte_array_append (dir, record, ZIP_DIR_ENTRY_LEN);
+  g_byte_array_append (dir, (const guint8 *) entry->file_name, name_len);
+  return TRUE;
+}
+
+static guint32
+get_dos_date_time (void)
+{
+  GDateTime *now = g_date_time_new_now_local ();
+  guint32 res = ((guint32) (g_date_time_get_year (now) - 1980) << 25) |
+      (g_date_time_get_month (now) << 21) |
+      (g_date_time_get_day_of_month (now) << 16) |
+      (g_date_time_get_hour (now) << 11) |
+      (g_date_time_get_minute (now) << 5) |
+      (g_date_time_get_second (now) / 2);
+
+  g_date_time_unref (now);
+  return res;
+}
+
+/* append the @members to the song file and write a new zip directory. Reused
+ * members are copied from the previous song file in @old_fd, the others are
+ * compressed on a pool of worker threads */
+static gboolean
+bt_song_io_native_bzt_append_members (const gchar * file_name, gint old_fd,
+    GList * members)
+{
+  BtSongIONativeBZTPacker packer;
+  BtSongIONativeBZTPackJob *jobs;
+  GThreadPool *pool;
+  GPtrArray *entries;
+  GByteArray *dir;
+  GList *node;
+  guint8 *buf, dir_end[ZIP_DIR_END_LEN];
+  guint64 pos;
+  guint32 dir_offset, span, dos_date_time = get_dos_date_time ();
+  guint i, num_entries, num_jobs = 0, next_job = 0, done_jobs = 0, window;
+  gboolean res = FALSE;
+  gint fd;
+
+  if ((fd = g_open (file_name, O_RDWR, 0)) == -1)
+    return FALSE;
+  if (!(entries = bt_song_io_native_bzt_read_zip_dir (fd, &dir_offset))) {
+    close (fd);
+    return FALSE;
+  }
+
+  // keep the directory records of the members we have written
+  dir = g_byte_array_new ();
+  for (i = 0; i < entries->len; i++) {
+    BtSongIONativeBZTZipEntry *entry = g_ptr_array_index (entries, i);
+    g_byte_array_append (dir, entry->record, entry->record_len);
+  }
+  num_entries = entries->len;
+
+  // compress the members that can't be reused in parallel, only 'window'
+  // members are compressed at a time and each of them only keeps a few
+  // compressed blocks in memory until they are written
+  jobs = g_new0 (BtSongIONativeBZTPackJob, g_list_length (members));
+  for (node = members; node; node = g_list_next (node)) {
+    BtSongIONativeBZTMember *member = (BtSongIONativeBZTMember *) node->data;
+
+    if (!member->reuse &&
+        !bt_song_io_native_bzt_is_compressed (member->file_name)) {
+      jobs[num_jobs++].member = member;
+    }
+  }
+  g_mutex_init (&packer.lock);
+  g_cond_init (&packer.cond);
+  packer.cancelled = FALSE;
+  window = g_get_num_processors ();
+  pool = g_thread_pool_new (bt_song_io_native_bzt_pack_member, &packer,
+      (gint) window, FALSE, NULL);
+  for (; next_job < MIN (window, num_jobs); next_job++) {
+    g_thread_pool_push (pool, &jobs[next_job], NULL);
+  }
+
+  // write the members in order, over the old directory
+  buf = g_malloc (MEMBER_BLOCK_SIZE);
+  pos = dir_offset;
+  for (node = members; node; node = g_list_next (node)) {
+    BtSongIONativeBZTMember *member = (BtSongIONativeBZTMember *) node->data;
+    const BtSongIONativeBZTZipEntry *old_entry = member->reuse;
+
+    if (old_entry) {
+      guint8 *record;
+      guint32 done = 0, block;
+
+      if (!bt_song_io_native_bzt_get_zip_entry_span (old_fd, old_entry, &span)
+          || pos + span >= G_MAXUINT32)
+        goto Error;
+      while (done < span) {
+        block = MIN (span - done, MEMBER_BLOCK_SIZE);
+        if (!read_fully (old_fd, buf, block, old_entry->offset + done) ||
+            !write_fully (fd, buf, block, pos + done))
+          goto Error;
+        done += block;
+      }
+      record = g_memdup (old_entry->record, old_entry->record_len);
+      set_le32 (record + 42, (guint32) pos);
+      g_byte_array_append (dir, record, old_entry->record_len);
+      g_free (record);
+      GST_INFO ("reused %u bytes for \"%s\"", span, member->file_name);
+    } else {
+      BtSongIONativeBZTZipEntry entry = { 0, };
+      guint64 data_pos = pos + ZIP_LOCAL_HEADER_LEN +
+          strlen (member->file_name);
+
+      entry.file_name = member->file_name;
+      entry.offset = (guint32) pos;
+      entry.method = ZIP_METHOD_STORED;
+      if (done_jobs < num_jobs && jobs[done_jobs].member == member) {
+        BtSongIONativeBZTPackJob *job = &jobs[done_jobs++];
+        guint64 size;
+        gboolean written;
+
+        written = bt_song_io_native_bzt_write_deflated (fd, data_pos, &packer,
+            job, &size);
+        if (next_job < num_jobs) {
+          g_thread_pool_push (pool, &jobs[next_job++], NULL);
+        }
+        if (!written)
+          goto Error;
+        // store data that does not get smaller, this overwrites the blocks
+        if (size < job->size) {
+          entry.method = ZIP_METHOD_DEFLATED;
+          entry.crc = job->crc;
+          entry.size = job->size;
+          entry.compressed_size = (guint32) size;
+        }
+      }
+      if (entry.method == ZIP_METHOD_STORED &&
+          !bt_song_io_native_bzt_store_member (fd, data_pos, member, buf,
+              &entry))
+        goto Error;
+      if (!bt_song_io_native_bzt_put_zip_entry (fd, &entry, dos_date_time,
+              dir))
+        goto Error;
+      span = (guint32) (data_pos - pos) + entry.compressed_size;
+      GST_INFO ("wrote %u bytes for \"%s\"", span, member->file_name);
+    }
+    pos += span;
+    num_entries++;
+  }
+  if (num_entries >= G_MAXUINT16 || pos + dir->len >= G_MAXUINT32)
+    goto Error;
+
+  // write the new directory
+  memset (dir_end, 0, ZIP_DIR_END_LEN);
+  set_le32 (dir_end, ZIP_DIR_END_SIG);
+  set_le16 (dir_end + 8, num_entries);
+  set_le16 (dir_end + 10, num_entries);
+  set_le32 (dir_end + 12, dir->len);
+  set_le32 (dir_end + 16, (guint32) pos);
+  if (write_fully (fd, dir->data, dir->len, pos) &&
+      write_fully (fd, dir_end, ZIP_DIR_END_LEN, pos + dir->len) &&
+      !ftruncate (fd, pos + dir->len + ZIP_DIR_END_LEN)) {
+    res = TRUE;
+  }
+Error:
+  // drop the jobs that have not been started and wait for the running ones
+  g_mutex_lock (&packer.lock);
+  packer.cancelled = TRUE;
+  g_cond_broadcast (&packer.cond);
+  g_mutex_unlock (&packer.lock);
+  g_thread_pool_free (pool, TRUE, TRUE);
+  for (i = 0; i < num_jobs; i++) {
+    g_queue_foreach (&jobs[i].blocks, (GFunc) g_byte_array_unref, NULL);
+    g_queue_clear (&jobs[i].blocks);
+  }
+  g_free (jobs);
+  g_mutex_clear (&packer.lock);
+  g_cond_clear (&packer.cond);
+  if (close (fd))
+    res = FALSE;
+  g_free (buf);
+  g_byte_array_free (dir, TRUE);
+  g_ptr_array_free (entries, TRUE);
+  return res;
+}
+#endif
+
 //-- public methods
 
 /**
@@ -162,7 +1302,10 @@ bt_song_io_native_bzt_copy_to_fd (const BtSongIONativeBZT * const self,
  * @file_name: the path to the file inside the song
  * @uri: location of the source file
  *
- * Copies the file specified by @uri to @file_name into the song file.
+ * Copies the file specified by @uri to @file_name into the song file. The data
+ * is copied when the song file is written, which can happen in the background.
+ * Thus the source must not change until then. For "fd://" uris the file
+ * descriptor is duplicated.
  *
  * This is a helper for #BtSong persistence.
  *
@@ -173,67 +1316,36 @@ gboolean
 bt_song_io_native_bzt_copy_from_uri (const BtSongIONativeBZT * const self,
     const gchar * file_name, const gchar * uri)
 {
-  gboolean res = FALSE;
-#ifdef USE_GSF
-  GsfOutput *data;
-
-  if ((data = gsf_outfile_new_child (self->priv->outfile, file_name, FALSE))) {
-    GError *err = NULL;
-    gchar *src_file_name;
-    gchar *bytes;
-    gsize size;
-    gboolean have_data = FALSE;
-
-    GST_INFO ("src uri : %s", uri);
-
-    // IDEA(ensonic): what about using gio here
-    src_file_name = g_filename_from_uri (uri, NULL, NULL);
-    if (src_file_name) {
-      if (g_file_get_contents (src_file_name, &bytes, &size, &err)) {
-        have_data = TRUE;
-      } else {
-        GST_ERROR ("error reading data \"%s\" : %s", file_name, err->message);
-        g_error_free (err);
-      }
-    } else {
-      if (g_str_has_prefix (uri, "fd://")) {
-        struct stat buf;
-        gint fd;
-
-        sscanf (uri, "fd://%d", &fd);
-        GST_INFO ("read data from file-deskriptor: fd=%d", fd);
-
-        if (!(fstat (fd, &buf))) {
-          if (lseek (fd, 0, SEEK_SET) == 0) {
-            if ((bytes = g_try_malloc (buf.st_size))) {
-              size = read (fd, bytes, buf.st_size);
-              if (size != buf.st_size) {
-                GST_WARNING ("did not write all data");
-              }
-              have_data = TRUE;
-            }
-          } else {
-            GST_WARNING ("can't seek in filedeskriptor");
-          }
-        }
-      }
-    }
+  BtSongIONativeBZTMember *member;
+  gchar *src_file_name;
+  gint fd = -1;
 
-    if (have_data) {
-      GST_INFO ("write %" G_GSIZE_FORMAT " bytes to sample file", size);
-      if (gsf_output_write (data, (size_t) size, (guint8 const *) bytes)) {
-        res = TRUE;
-      } else {
-        GST_ERROR ("error writing data \"%s\"", file_name);
+  GST_INFO ("src uri : %s", uri);
+
+  // IDEA(ensonic): what about using gio here
+  if (!(src_file_name = g_filename_from_uri (uri, NULL, NULL))) {
+    if (g_str_has_prefix (uri, "fd://")) {
+      gint src_fd;
+
+      sscanf (uri, "fd://%d", &src_fd);
+      GST_INFO ("read data from file-deskriptor: fd=%d", src_fd);
+      if ((fd = dup (src_fd)) == -1) {
+        GST_WARNING ("can't dup file-deskriptor: %s", g_strerror (errno));
+        return FALSE;
       }
-      g_free (bytes);
+    } else {
+      GST_WARNING ("unsupported uri \"%s\"", uri);
+      return FALSE;
     }
-    g_free (src_file_name);
-    gsf_output_close (data);
-    g_object_unref (data);
   }
-#endif
-  return res;
+
+  member = g_slice_new (BtSongIONativeBZTMember);
+  member->file_name = g_strdup (file_name);
+  member->src_file_name = src_file_name;
+  member->fd = fd;
+  member->reuse = NULL;
+  self->priv->members = g_list_prepend (self->priv->members, member);
+  return TRUE;
 }
 
 //-- methods
@@ -245,20 +1357,12 @@ bt_song_io_native_bzt_load (gconstpointer const _self,
   gboolean result = FALSE;
 #ifdef USE_GSF
   const BtSongIONativeBZT *const self = BT_SONG_IO_NATIVE_BZT (_self);
-  xmlDocPtr song_doc = NULL;
+  xmlTextReaderPtr reader = NULL;
   GError *e = NULL;
   gchar *const file_name;
   guint len;
   gpointer data;
 
-  xmlParserCtxtPtr const ctxt = xmlNewParserCtxt ();
-  if (!ctxt) {
-    GST_WARNING ("failed to create parser context");
-    g_set_error (err, G_IO_ERROR, G_IO_ERROR_FAILED,
-        "Failed to create parser context.");
-    return FALSE;
-  }
-
   g_object_get ((gpointer) self, "file-name", &file_name, "data", &data,
       "data-len", &len, NULL);
   GST_INFO ("native io bzt will now load song from \"%s\"",
@@ -274,13 +1378,33 @@ bt_song_io_native_bzt_load (gconstpointer const _self,
   if (self->priv->input) {
     // create an gsf input file
     if ((self->priv->infile = gsf_infile_zip_new (self->priv->input, &e))) {
-      GsfInput *data;
+      GsfInput *data, *pattern_data;
+      GHashTable *pattern_lengths = NULL;
+      const guint8 *pattern_bytes = NULL;
+      size_t pattern_len = 0;
 
       GST_INFO ("'%s' size: %" GSF_OFF_T_FORMAT ", files: %d",
           gsf_input_name (self->priv->input),
           gsf_input_size (self->priv->input),
           gsf_infile_num_children (self->priv->infile));
 
+      // prefer the binary pattern data, if we can read it
+      if ((pattern_data =
+              gsf_infile_child_by_name (self->priv->infile,
+                  PATTERN_DATA_FILE))) {
+        pattern_len = (size_t) gsf_input_size (pattern_data);
+        pattern_lengths =
+            g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        if (!(pattern_bytes = gsf_input_read (pattern_data, pattern_len, NULL))
+            || !bt_song_io_native_bzt_check_patterns (pattern_bytes,
+                pattern_len, pattern_lengths)) {
+          GST_WARNING ("'%s': ignoring pattern data",
+              (file_name ? file_name : "data"));
+          pattern_bytes = NULL;
+          g_hash_table_destroy (pattern_lengths);
+          pattern_lengths = NULL;
+        }
+      }
       // get file from zip
       if ((data = gsf_infile_child_by_name (self->priv->infile, "song.xml"))) {
         const guint8 *bytes;
@@ -289,15 +1413,30 @@ bt_song_io_native_bzt_load (gconstpointer const _self,
         GST_INFO ("'%s' size: %" G_GSIZE_FORMAT, gsf_input_name (data), len);
 
         if ((bytes = gsf_input_read (data, len, NULL))) {
-          song_doc =
-              xmlCtxtReadMemory (ctxt, (const char *) bytes, len,
-              "http://www.buzztrax.org", NULL, 0L);
+          // the bytes are owned by data, load the song while we have it
+          if ((reader =
+                  xmlReaderForMemory ((const char *) bytes, len,
+                      "http://www.buzztrax.org", NULL, 0L))) {
+            result =
+                bt_song_io_native_load (reader, song, pattern_lengths, err);
+            xmlFreeTextReader (reader);
+            if (result && pattern_bytes) {
+              bt_song_io_native_bzt_unpack_patterns (song, pattern_bytes,
+                  pattern_len);
+            }
+          }
         } else {
           GST_WARNING ("'%s': error reading data",
               (file_name ? file_name : "data"));
         }
         g_object_unref (data);
       }
+      if (pattern_data) {
+        g_object_unref (pattern_data);
+      }
+      if (pattern_lengths) {
+        g_hash_table_destroy (pattern_lengths);
+      }
     } else {
       GST_WARNING ("'%s' is not a zip file: %s",
           (file_name ? file_name : "data"), e->message);
@@ -315,11 +1454,8 @@ bt_song_io_native_bzt_load (gconstpointer const _self,
     }
   }
 
-  if (song_doc) {
-    result = bt_song_io_native_load (song_doc, song, err);
-    xmlFreeDoc (song_doc);
-  } else {
-    bt_song_io_native_load_set_error (ctxt, file_name, err);
+  if (!reader) {
+    bt_song_io_native_load_set_error (file_name, err);
   }
 
   if (self->priv->infile) {
@@ -331,102 +1467,137 @@ bt_song_io_native_bzt_load (gconstpointer const _self,
     self->priv->input = NULL;
   }
   g_free (file_name);
-  xmlFreeParserCtxt (ctxt);
 #endif
   return result;
 }
 
-static gboolean
-bt_song_io_native_bzt_save (gconstpointer const _self,
+static gpointer
+bt_song_io_native_bzt_snapshot (gconstpointer const _self,
     const BtSong * const song, GError ** err)
 {
-  gboolean result = FALSE;
+  BtSongIONativeBZTSnapshot *snapshot = NULL;
 #ifdef USE_GSF
   const BtSongIONativeBZT *const self = BT_SONG_IO_NATIVE_BZT (_self);
-  gchar *const file_name;
+  gboolean xml_pattern_data;
+  BtSettings *settings = bt_settings_make ();
+
+  g_object_get (settings, "xml-pattern-data", &xml_pattern_data, NULL);
+  g_object_unref (settings);
+
+  xmlDocPtr const song_doc = xmlNewDoc (XML_CHAR_PTR ("1.0"));
+  if (!song_doc) {
+    g_set_error (err, G_IO_ERROR, G_IO_ERROR_FAILED,
+        "Failed to create XML doc.");
+    return NULL;
+  }
+  // the pattern events go to patterns.bin, waves are collected as members
+  xmlNodePtr const root_node =
+      bt_persistence_save (BT_PERSISTENCE (song), NULL,
+      xml_pattern_data ? NULL : "no-pattern-data");
+  if (root_node) {
+    xmlDocSetRootElement (song_doc, root_node);
+
+    snapshot = g_slice_new0 (BtSongIONativeBZTSnapshot);
+    g_object_get ((gpointer) self, "file-name", &snapshot->file_name, NULL);
+    snapshot->song_doc = song_doc;
+    snapshot->patterns = bt_song_io_native_bzt_pack_patterns (song);
+    snapshot->members = g_list_reverse (self->priv->members);
+  } else {
+    g_set_error (err, G_IO_ERROR, G_IO_ERROR_FAILED,
+        "Failed to serialize XML doc.");
+    g_list_free_full (self->priv->members,
+        (GDestroyNotify) bt_song_io_native_bzt_member_free);
+    xmlFreeDoc (song_doc);
+  }
+  self->priv->members = NULL;
+#endif
+  return snapshot;
+}
+
+#ifdef USE_GSF
+/* write the song file, the members are only written if @with_members is set,
+ * otherwise they are appended afterwards */
+static gboolean
+bt_song_io_native_bzt_write_zip (const BtSongIONativeBZT * const self,
+    BtSongIONativeBZTSnapshot * snapshot, gboolean with_members, GError ** err)
+{
+  gboolean result = FALSE;
+  const gchar *file_name = snapshot->file_name;
+  GError *e = NULL;
+  GList *node;
+  xmlChar *bytes;
+  gint size;
 
-  g_object_get ((gpointer) self, "file-name", &file_name, NULL);
   GST_INFO ("native io bzt will now save song to \"%s\"",
       file_name ? file_name : "data");
 
-  xmlDocPtr const song_doc = xmlNewDoc (XML_CHAR_PTR ("1.0"));
-  if (song_doc) {
-    GError *e = NULL;
-
-    if (file_name) {
-      // open the file from the file_name argument
-      if (!(self->priv->output = gsf_output_stdio_new (file_name, &e))) {
-        GST_WARNING ("failed to write song file \"%s\" : %s", file_name,
-            e->message);
-        g_propagate_error (err, e);
-        goto Error;
-      }
-    } else {
-      if (!(self->priv->output = gsf_output_memory_new ())) {
-        GST_WARNING ("failed to create song buffer");
-        g_set_error (err, G_IO_ERROR, G_IO_ERROR_FAILED,
-            "Failed to create song buffer.");
-        goto Error;
-      }
-    }
-    // create an gsf output file
-    if (!(self->priv->outfile = gsf_outfile_zip_new (self->priv->output, &e))) {
-      GST_WARNING ("failed to create zip song file \"%s\" : %s", file_name,
+  if (file_name) {
+    // open the file from the file_name argument
+    if (!(self->priv->output = gsf_output_stdio_new (file_name, &e))) {
+      GST_WARNING ("failed to write song file \"%s\" : %s", file_name,
           e->message);
       g_propagate_error (err, e);
       goto Error;
     }
-
-    xmlNodePtr const root_node =
-        bt_persistence_save (BT_PERSISTENCE (song), NULL, NULL);
-    if (root_node) {
-      GsfOutput *data;
-
-      xmlDocSetRootElement (song_doc, root_node);
-
-      // create file in zip
-      if ((data =
-              gsf_outfile_new_child (self->priv->outfile, "song.xml", FALSE))) {
-        xmlChar *bytes;
-        gint size;
-
-        xmlDocDumpMemory (song_doc, &bytes, &size);
-        if (gsf_output_write (data, (size_t) size, (guint8 const *) bytes)) {
-          if (!file_name) {
-            gsf_off_t len = gsf_output_size (self->priv->output);
-            const guint8 *mem = gsf_output_memory_get_bytes (
-                (GsfOutputMemory *) self->priv->output);
-            gpointer data = g_memdup (mem, (guint) len);
-            g_object_set ((gpointer) self, "data", data, "data-len",
-                (guint) len, NULL);
-          }
-          result = TRUE;
-          GST_INFO ("bzt saved okay");
-        } else {
-          GST_WARNING ("failed to write song file \"%s\"", file_name);
-          g_set_error_literal (err, G_IO_ERROR, g_io_error_from_errno (errno),
-              g_strerror (errno));
-        }
-        xmlFree (bytes);
-        gsf_output_close (data);
-        g_object_unref (data);
-      } else {
-        g_set_error (err, G_IO_ERROR, G_IO_ERROR_FAILED,
-            "Failed to create child object in output file.");
-      }
-    } else {
+  } else {
+    if (!(self->priv->output = gsf_output_memory_new ())) {
+      GST_WARNING ("failed to create song buffer");
       g_set_error (err, G_IO_ERROR, G_IO_ERROR_FAILED,
-          "Failed to serialize XML doc.");
+          "Failed to create song buffer.");
+      goto Error;
     }
-    xmlFreeDoc (song_doc);
-  } else {
+  }
+  // create an gsf output file
+  if (!(self->priv->outfile = gsf_outfile_zip_new (self->priv->output, &e))) {
+    GST_WARNING ("failed to create zip song file \"%s\" : %s", file_name,
+        e->message);
+    g_propagate_error (err, e);
+    goto Error;
+  }
+  // create files in zip
+  for (node = with_members ? snapshot->members : NULL; node;
+      node = g_list_next (node)) {
+    if (!bt_song_io_native_bzt_write_member (self->priv->outfile, node->data)) {
+      GST_WARNING ("failed to write \"%s\"",
+          ((BtSongIONativeBZTMember *) node->data)->file_name);
+    }
+  }
+  if (!bt_song_io_native_bzt_write_bytes (self->priv->outfile,
+          PATTERN_DATA_FILE, snapshot->patterns->data,
+          snapshot->patterns->len)) {
+    GST_WARNING ("failed to write pattern data");
     g_set_error (err, G_IO_ERROR, G_IO_ERROR_FAILED,
-        "Failed to create XML doc.");
+        "Failed to write pattern data.");
+    goto Error;
   }
+  xmlDocDumpMemory (snapshot->song_doc, &bytes, &size);
+  if (bt_song_io_native_bzt_write_bytes (self->priv->outfile, "song.xml",
+          (const guint8 *) bytes, (gsize) size)) {
+    if (!file_name) {
+      gsf_off_t len = gsf_output_size (self->priv->output);
+      const guint8 *mem =
+          gsf_output_memory_get_bytes ((GsfOutputMemory *) self->priv->output);
+      gpointer data = g_memdup (mem, (guint) len);
+      g_object_set ((gpointer) self, "data", data, "data-len", (guint) len,
+          NULL);
+    }
+    result = TRUE;
+    GST_INFO ("bzt saved okay");
+  } else {
+    GST_WARNING ("failed to write song file \"%s\"", file_name);
+    g_set_error_literal (err, G_IO_ERROR, g_io_error_from_errno (errno),
+        g_strerror (errno));
+  }
+  xmlFree (bytes);
 
 Error:
   if (self->priv->outfile) {
-    gsf_output_close (GSF_OUTPUT (self->priv->outfile));
+    if (!gsf_output_close (GSF_OUTPUT (self->priv->outfile)) && result) {
+      GST_WARNING ("failed to finish song file \"%s\"", file_name);
+      g_set_error (err, G_IO_ERROR, G_IO_ERROR_FAILED,
+          "Failed to finish the song file.");
+      result = FALSE;
+    }
     g_object_unref (self->priv->outfile);
     self->priv->outfile = NULL;
   }
@@ -435,12 +1606,103 @@ Error:
     g_object_unref (self->priv->output);
     self->priv->output = NULL;
   }
+  return result;
+}
+#endif
 
-  g_free (file_name);
+static gboolean
+bt_song_io_native_bzt_write (gconstpointer const _self, gpointer _snapshot,
+    GError ** err)
+{
+  gboolean result = FALSE;
+#ifdef USE_GSF
+  const BtSongIONativeBZT *const self = BT_SONG_IO_NATIVE_BZT (_self);
+  BtSongIONativeBZTSnapshot *snapshot = _snapshot;
+  GPtrArray *old_entries = NULL;
+  gint old_fd = -1;
+  GList *node;
+
+  // look for unchanged members in the previous song file
+  if (snapshot->file_name && snapshot->members &&
+      (old_fd = bt_song_io_native_bzt_open_previous (snapshot->file_name,
+              &old_entries)) != -1) {
+    GHashTable *entries = g_hash_table_new (g_str_hash, g_str_equal);
+    guint i;
+
+    for (i = 0; i < old_entries->len; i++) {
+      BtSongIONativeBZTZipEntry *entry = g_ptr_array_index (old_entries, i);
+      g_hash_table_insert (entries, entry->file_name, entry);
+    }
+    for (node = snapshot->members; node; node = g_list_next (node)) {
+      BtSongIONativeBZTMember *member = (BtSongIONativeBZTMember *) node->data;
+      BtSongIONativeBZTZipEntry *entry =
+          g_hash_table_lookup (entries, member->file_name);
+
+      if (entry && bt_song_io_native_bzt_member_unchanged (member, entry)) {
+        member->reuse = entry;
+      }
+    }
+    g_hash_table_destroy (entries);
+  }
+
+  if (!snapshot->file_name || !snapshot->members) {
+    result = bt_song_io_native_bzt_write_zip (self, snapshot, TRUE, err);
+  } else if ((result =
+          bt_song_io_native_bzt_write_zip (self, snapshot, FALSE, err))) {
+    // the output renames the new file over the old one on close, old_fd still
+    // refers to the previous file
+    if (!bt_song_io_native_bzt_append_members (snapshot->file_name, old_fd,
+            snapshot->members)) {
+      GST_WARNING ("failed to append the external files, writing them again");
+      for (node = snapshot->members; node; node = g_list_next (node)) {
+        ((BtSongIONativeBZTMember *) node->data)->reuse = NULL;
+      }
+      result = bt_song_io_native_bzt_write_zip (self, snapshot, TRUE, err);
+    }
+  }
+
+  self->priv->reused_members = 0;
+  if (result) {
+    for (node = snapshot->members; node; node = g_list_next (node)) {
+      if (((BtSongIONativeBZTMember *) node->data)->reuse)
+        self->priv->reused_members++;
+    }
+  }
+  if (old_fd != -1) {
+    close (old_fd);
+    g_ptr_array_free (old_entries, TRUE);
+  }
+  bt_song_io_native_bzt_snapshot_free (snapshot);
 #endif
   return result;
 }
 
+static gboolean
+bt_song_io_native_bzt_save (gconstpointer const _self,
+    const BtSong * const song, GError ** err)
+{
+  gpointer snapshot;
+
+  if (!(snapshot = bt_song_io_native_bzt_snapshot (_self, song, err)))
+    return FALSE;
+  return bt_song_io_native_bzt_write (_self, snapshot, err);
+}
+
+/*
+ * bt_song_io_native_bzt_get_reused_members:
+ * @self: the song-plugin
+ *
+ * Get the number of external files that the last save copied from the
+ * previous song file instead of compressing them again. Used in the tests.
+ *
+ * Returns: the number of reused members
+ */
+guint
+bt_song_io_native_bzt_get_reused_members (const BtSongIONativeBZT * const self)
+{
+  return self->priv->reused_members;
+}
+
 //-- wrapper
 
 //-- class internals
@@ -454,6 +1716,8 @@ bt_song_io_native_bzt_dispose (GObject * const object)
   self->priv->dispose_has_run = TRUE;
 
   GST_DEBUG ("!!!! self=%p", self);
+  g_list_free_full (self->priv->members,
+      (GDestroyNotify) bt_song_io_native_bzt_member_free);
   G_OBJECT_CLASS (bt_song_io_native_bzt_parent_class)->dispose (object);
 }
 
@@ -475,4 +1739,6 @@ bt_song_io_native_bzt_class_init (BtSongIONativeBZTClass * const klass)
 
   btsongio_class->load = bt_song_io_native_bzt_load;
   btsongio_class->save = bt_song_io_native_bzt_save;
+  btsongio_class->snapshot = bt_song_io_native_bzt_snapshot;
+  btsongio_class->write = bt_song_io_native_bzt_write;
 }
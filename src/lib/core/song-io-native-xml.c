@@ -28,13 +28,14 @@
 #include "core_private.h"
 #include "song-io-native-xml.h"
 #include <glib/gprintf.h>
+#include <libxml/xmlreader.h>
 
 //-- common helpers
 
-gboolean bt_song_io_native_load (xmlDocPtr song_doc, const BtSong * const song,
+gboolean bt_song_io_native_load (xmlTextReaderPtr reader,
+    const BtSong * const song, GHashTable * packed_lengths,
     GError ** err);
-void bt_song_io_native_load_set_error (xmlParserCtxtPtr const ctxt,
-    gchar * const file_name, GError ** err);
+void bt_song_io_native_load_set_error (gchar * const file_name, GError ** err);
 
 static GQuark error_domain = 0;
 
@@ -50,20 +51,12 @@ bt_song_io_native_xml_load (gconstpointer const _self,
     const BtSong * const song, GError ** err)
 {
   const BtSongIONativeXML *const self = BT_SONG_IO_NATIVE_XML (_self);
-  xmlDocPtr song_doc;
+  xmlTextReaderPtr reader;
   gchar *const file_name;
   guint len;
   gpointer data;
   gboolean result = FALSE;
 
-  xmlParserCtxtPtr const ctxt = xmlNewParserCtxt ();
-  if (!ctxt) {
-    GST_WARNING ("failed to create parser context");
-    g_set_error (err, G_IO_ERROR, G_IO_ERROR_FAILED,
-        "Failed to create parser context.");
-    return FALSE;
-  }
-
   g_object_get ((gpointer) self, "file-name", &file_name, "data", &data,
       "data-len", &len, NULL);
   GST_INFO ("native io xml will now load song from \"%s\"",
@@ -71,35 +64,36 @@ bt_song_io_native_xml_load (gconstpointer const _self,
 
   if (data && len) {
     // parse the file from the memory block
-    song_doc = xmlCtxtReadMemory (ctxt, data, len, NULL, NULL, 0L);
+    reader = xmlReaderForMemory (data, len, NULL, NULL, 0L);
   } else {
     // open the file from the file_name argument
-    song_doc = xmlCtxtReadFile (ctxt, file_name, NULL, 0L);
+    reader = xmlReaderForFile (file_name, NULL, 0L);
   }
 
-  if (song_doc) {
-    result = bt_song_io_native_load (song_doc, song, err);
-    xmlFreeDoc (song_doc);
+  if (reader) {
+    result = bt_song_io_native_load (reader, song, NULL, err);
+    xmlFreeTextReader (reader);
   } else {
-    bt_song_io_native_load_set_error (ctxt, file_name, err);
+    bt_song_io_native_load_set_error (file_name, err);
   }
 
   g_free (file_name);
-  xmlFreeParserCtxt (ctxt);
   return result;
 }
 
-static gboolean
-bt_song_io_native_xml_save (gconstpointer const _self,
+/* everything that is needed to write the song file without the song */
+typedef struct
+{
+  gchar *file_name;
+  xmlDocPtr song_doc;
+} BtSongIONativeXMLSnapshot;
+
+static gpointer
+bt_song_io_native_xml_snapshot (gconstpointer const _self,
     const BtSong * const song, GError ** err)
 {
   const BtSongIONativeXML *const self = BT_SONG_IO_NATIVE_XML (_self);
-  gboolean result = FALSE;
-  gchar *const file_name;
-
-  g_object_get ((gpointer) self, "file-name", &file_name, NULL);
-  GST_INFO ("native io xml will now save song to \"%s\"",
-      file_name ? file_name : "data");
+  BtSongIONativeXMLSnapshot *snapshot = NULL;
 
   xmlDocPtr const song_doc = xmlNewDoc (XML_CHAR_PTR ("1.0"));
   if (song_doc) {
@@ -107,40 +101,70 @@ bt_song_io_native_xml_save (gconstpointer const _self,
         bt_persistence_save (BT_PERSISTENCE (song), NULL, NULL);
     if (root_node) {
       xmlDocSetRootElement (song_doc, root_node);
-      if (file_name) {
-        if (xmlSaveFormatFile (file_name, song_doc, 1) != -1) {
-          result = TRUE;
-          GST_INFO ("xml saved okay");
-        } else {
-          GST_WARNING ("failed to write song file \"%s\"", file_name);
-          g_set_error_literal (err, G_IO_ERROR, g_io_error_from_errno (errno),
-              g_strerror (errno));
-        }
-      } else {
-        xmlChar *mem;
-        guint len;
-        gpointer data;
-
-        xmlDocDumpMemory (song_doc, &mem, (int *) &len);
-        data = g_memdup2 (mem, len);
-        xmlFree (mem);
-        g_object_set ((gpointer) self, "data", data, "data-len", len, NULL);
-      }
+      snapshot = g_slice_new (BtSongIONativeXMLSnapshot);
+      g_object_get ((gpointer) self, "file-name", &snapshot->file_name, NULL);
+      snapshot->song_doc = song_doc;
     } else {
       g_set_error (err, G_IO_ERROR, G_IO_ERROR_FAILED,
           "Failed to serialize XML doc.");
+      xmlFreeDoc (song_doc);
     }
-
-    xmlFreeDoc (song_doc);
   } else {
     g_set_error (err, G_IO_ERROR, G_IO_ERROR_FAILED,
         "Failed to create XML doc.");
   }
+  return snapshot;
+}
 
-  g_free (file_name);
+static gboolean
+bt_song_io_native_xml_write (gconstpointer const _self, gpointer _snapshot,
+    GError ** err)
+{
+  const BtSongIONativeXML *const self = BT_SONG_IO_NATIVE_XML (_self);
+  BtSongIONativeXMLSnapshot *snapshot = _snapshot;
+  const gchar *file_name = snapshot->file_name;
+  gboolean result = FALSE;
+
+  GST_INFO ("native io xml will now save song to \"%s\"",
+      file_name ? file_name : "data");
+
+  if (file_name) {
+    if (xmlSaveFormatFile (file_name, snapshot->song_doc, 1) != -1) {
+      result = TRUE;
+      GST_INFO ("xml saved okay");
+    } else {
+      GST_WARNING ("failed to write song file \"%s\"", file_name);
+      g_set_error_literal (err, G_IO_ERROR, g_io_error_from_errno (errno),
+          g_strerror (errno));
+    }
+  } else {
+    xmlChar *mem;
+    guint len;
+    gpointer data;
+
+    xmlDocDumpMemory (snapshot->song_doc, &mem, (int *) &len);
+    data = g_memdup2 (mem, len);
+    xmlFree (mem);
+    g_object_set ((gpointer) self, "data", data, "data-len", len, NULL);
+  }
+
+  xmlFreeDoc (snapshot->song_doc);
+  g_free (snapshot->file_name);
+  g_slice_free (BtSongIONativeXMLSnapshot, snapshot);
   return result;
 }
 
+static gboolean
+bt_song_io_native_xml_save (gconstpointer const _self,
+    const BtSong * const song, GError ** err)
+{
+  gpointer snapshot;
+
+  if (!(snapshot = bt_song_io_native_xml_snapshot (_self, song, err)))
+    return FALSE;
+  return bt_song_io_native_xml_write (_self, snapshot, err);
+}
+
 //-- wrapper
 
 //-- class internals
@@ -160,4 +184,6 @@ bt_song_io_native_xml_class_init (BtSongIONativeXMLClass * klass)
 
   btsongio_class->load = bt_song_io_native_xml_load;
   btsongio_class->save = bt_song_io_native_xml_save;
+  btsongio_class->snapshot = bt_song_io_native_xml_snapshot;
+  btsongio_class->write = bt_song_io_native_xml_write;
 }
@@ -22,6 +22,10 @@
  * implements loading and saving of this format.
  * The format is an archive, that contains an XML file and optionally binary
  * data, such as audio samples.
+ *
+ * The XML is read as a stream. Pattern data is stored into the patterns while
+ * it is parsed, so that the memory use while loading does not grow with the
+ * size of the song's patterns.
  */
 
 #define BT_CORE
@@ -31,6 +35,7 @@
 #include "song-io-native-bzt.h"
 #include "song-io-native-xml.h"
 #include "song-io-native.h"
+#include <libxml/xmlreader.h>
 
 //-- the class
 
@@ -83,56 +88,377 @@ bt_song_io_init (void)
 
 //-- common helpers
 
+/* The loader streams through the document with an xmlTextReader instead of
+ * building a DOM of the whole song. Small sections (meta, wires, sequence,
+ * wavetable, machine parameters) are expanded one at a time and handed to the
+ * BtPersistence implementations, while the pattern data, which makes up the
+ * bulk of a song, is written into the patterns as the elements arrive.
+ */
+
+/* Moves the reader to the next child element of the element at @depth. The
+ * reader must be on the parent element or somewhere within it. If it is on a
+ * child element, the subtree of that child is skipped.
+ * Returns 1 if the reader is on a child element, 0 if all children have been
+ * read and -1 on parse errors.
+ */
+static gint
+bt_song_io_native_next_child (xmlTextReaderPtr reader, const gint depth)
+{
+  gint res, d = xmlTextReaderDepth (reader);
+  gint type = xmlTextReaderNodeType (reader);
+
+  if (d == depth && xmlTextReaderIsEmptyElement (reader))
+    return 0;
+
+  if (d == depth + 1 && type == XML_READER_TYPE_ELEMENT) {
+    res = xmlTextReaderNext (reader);
+  } else {
+    res = xmlTextReaderRead (reader);
+  }
+  while (res == 1) {
+    d = xmlTextReaderDepth (reader);
+    type = xmlTextReaderNodeType (reader);
+    if (d <= depth)
+      return 0;
+    if (d == depth + 1 && type == XML_READER_TYPE_ELEMENT)
+      return 1;
+    res = xmlTextReaderRead (reader);
+  }
+  return res;
+}
+
+static gboolean
+bt_song_io_native_is_element (xmlTextReaderPtr reader, const gchar * name)
+{
+  return !strcmp ((gchar *) xmlTextReaderConstLocalName (reader), name);
+}
+
+static void
+bt_song_io_native_load_machine_children (BtMachine * machine,
+    xmlNodePtr node, ...)
+{
+  BtPersistenceInterface *const iface =
+      g_type_interface_peek (g_type_class_peek (BT_TYPE_MACHINE),
+      BT_TYPE_PERSISTENCE);
+  va_list var_args;
+
+  // only load the children, the machine is already constructed
+  va_start (var_args, node);
+  iface->load (BT_TYPE_MACHINE, BT_PERSISTENCE (machine), node, NULL,
+      var_args);
+  va_end (var_args);
+}
+
+gchar *
+bt_song_io_native_get_pattern_key (const gchar * machine_id,
+    const gchar * pattern_name)
+{
+  // neither ids nor names contain line breaks
+  return g_strconcat (machine_id, "\n", pattern_name, NULL);
+}
+
+static gint
+bt_song_io_native_load_pattern (xmlTextReaderPtr reader,
+    const BtSong * const song, BtMachine * machine, GHashTable * packed_lengths)
+{
+  const gint depth = xmlTextReaderDepth (reader);
+  BtPattern *pattern;
+  xmlChar *id, *name, *length_str, *tick_str, *value, *voice_str;
+  glong tick, voice;
+  gulong length;
+  gboolean packed = FALSE;
+  gint res;
+
+  id = xmlTextReaderGetAttribute (reader, XML_CHAR_PTR ("id"));
+  name = xmlTextReaderGetAttribute (reader, XML_CHAR_PTR ("name"));
+  length_str = xmlTextReaderGetAttribute (reader, XML_CHAR_PTR ("length"));
+  length = length_str ? atol ((char *) length_str) : 0;
+
+  pattern = bt_pattern_new (song, (gchar *) name, length, machine);
+  if (id) {
+    GST_INFO ("have legacy pattern id '%s'", id);
+    g_object_set_data_full ((GObject *) pattern, "BtPattern::id", id,
+        (GDestroyNotify) xmlFree);
+  }
+  if (packed_lengths && name) {
+    gchar *machine_id, *key;
+    gpointer packed_length;
+
+    g_object_get (machine, "id", &machine_id, NULL);
+    key = bt_song_io_native_get_pattern_key (machine_id, (gchar *) name);
+    packed = g_hash_table_lookup_extended (packed_lengths, key, NULL,
+        &packed_length) && GPOINTER_TO_UINT (packed_length) == length;
+    if (!packed) {
+      GST_INFO ("no packed events for pattern '%s', loading the ticks", key);
+    }
+    g_free (key);
+    g_free (machine_id);
+  }
+  xmlFree (name);
+  xmlFree (length_str);
+
+  if (packed) {
+    // the events are loaded from a separate source
+    g_object_unref (pattern);
+    return 0;
+  }
+
+  while ((res = bt_song_io_native_next_child (reader, depth)) == 1) {
+    if (!bt_song_io_native_is_element (reader, "tick"))
+      continue;
+
+    tick_str = xmlTextReaderGetAttribute (reader, XML_CHAR_PTR ("time"));
+    tick = tick_str ? atol ((char *) tick_str) : 0;
+    xmlFree (tick_str);
+
+    while ((res = bt_song_io_native_next_child (reader, depth + 1)) == 1) {
+      name = xmlTextReaderGetAttribute (reader, XML_CHAR_PTR ("name"));
+      value = xmlTextReaderGetAttribute (reader, XML_CHAR_PTR ("value"));
+      if (bt_song_io_native_is_element (reader, "globaldata")) {
+        bt_pattern_load_event (pattern, tick, -1, (gchar *) name,
+            (gchar *) value);
+      } else if (bt_song_io_native_is_element (reader, "voicedata")) {
+        voice_str = xmlTextReaderGetAttribute (reader, XML_CHAR_PTR ("voice"));
+        voice = voice_str ? atol ((char *) voice_str) : 0;
+        bt_pattern_load_event (pattern, tick, voice, (gchar *) name,
+            (gchar *) value);
+        xmlFree (voice_str);
+      }
+      xmlFree (name);
+      xmlFree (value);
+    }
+    if (res == -1)
+      break;
+  }
+  g_object_unref (pattern);
+  return res;
+}
+
+static gint
+bt_song_io_native_load_patterns (xmlTextReaderPtr reader,
+    const BtSong * const song, BtMachine * machine, GHashTable * packed_lengths)
+{
+  const gint depth = xmlTextReaderDepth (reader);
+  gint res;
+
+  while ((res = bt_song_io_native_next_child (reader, depth)) == 1) {
+    if (bt_song_io_native_is_element (reader, "pattern")) {
+      if ((res = bt_song_io_native_load_pattern (reader, song, machine,
+                  packed_lengths)) == -1)
+        break;
+    }
+  }
+  return res;
+}
+
+static BtMachine *
+bt_song_io_native_load_machine_node (BtSetup * setup, xmlNodePtr setup_node,
+    const gchar * id)
+{
+  bt_persistence_load (BT_TYPE_SETUP, BT_PERSISTENCE (setup), setup_node,
+      NULL, NULL);
+  // the setup drops machines that failed to load
+  return id ? bt_setup_get_machine_by_id (setup, id) : NULL;
+}
+
+static gint
+bt_song_io_native_load_machine (xmlTextReaderPtr reader,
+    const BtSong * const song, BtSetup * setup, GHashTable * packed_lengths)
+{
+  const gint depth = xmlTextReaderDepth (reader);
+  BtMachine *machine = NULL;
+  xmlNodePtr setup_node, machine_node, rest_node, node;
+  xmlChar *id;
+  gint res;
+
+  /* Collect everything but the patterns into a small setup document, so that
+   * the setup can create the machine. Children that come after the patterns
+   * are applied to the machine afterwards. */
+  setup_node = xmlNewNode (NULL, XML_CHAR_PTR ("setup"));
+  machine_node = xmlNewChild (xmlNewChild (setup_node, NULL,
+          XML_CHAR_PTR ("machines"), NULL), NULL, XML_CHAR_PTR ("machine"),
+      NULL);
+  rest_node = xmlNewNode (NULL, XML_CHAR_PTR ("machine"));
+  while (xmlTextReaderMoveToNextAttribute (reader) == 1) {
+    xmlNewProp (machine_node, xmlTextReaderConstName (reader),
+        xmlTextReaderConstValue (reader));
+  }
+  xmlTextReaderMoveToElement (reader);
+  id = xmlGetProp (machine_node, XML_CHAR_PTR ("id"));
+
+  while ((res = bt_song_io_native_next_child (reader, depth)) == 1) {
+    if (bt_song_io_native_is_element (reader, "patterns")) {
+      if (!machine) {
+        machine =
+            bt_song_io_native_load_machine_node (setup, setup_node,
+            (gchar *) id);
+      }
+      if (machine) {
+        if ((res =
+                bt_song_io_native_load_patterns (reader, song, machine,
+                    packed_lengths)) == -1)
+          break;
+      }
+    } else if ((node = xmlTextReaderExpand (reader))) {
+      xmlAddChild (machine ? rest_node : machine_node,
+          xmlDocCopyNode (node, NULL, 1));
+    } else {
+      res = -1;
+      break;
+    }
+  }
+  if (res != -1) {
+    if (!machine) {
+      // a machine without patterns
+      machine =
+          bt_song_io_native_load_machine_node (setup, setup_node,
+          (gchar *) id);
+    } else if (rest_node->children) {
+      bt_song_io_native_load_machine_children (machine, rest_node, NULL);
+    }
+  }
+
+  if (machine)
+    g_object_unref (machine);
+  xmlFree (id);
+  xmlFreeNode (rest_node);
+  xmlFreeNode (setup_node);
+  return res;
+}
+
+static gint
+bt_song_io_native_load_machines (xmlTextReaderPtr reader,
+    const BtSong * const song, BtSetup * setup, GHashTable * packed_lengths)
+{
+  const gint depth = xmlTextReaderDepth (reader);
+  gint res;
+
+  while ((res = bt_song_io_native_next_child (reader, depth)) == 1) {
+    if (bt_song_io_native_is_element (reader, "machine")) {
+      if ((res = bt_song_io_native_load_machine (reader, song, setup,
+                  packed_lengths)) == -1)
+        break;
+    }
+  }
+  return res;
+}
+
+static gint
+bt_song_io_native_load_setup (xmlTextReaderPtr reader,
+    const BtSong * const song, BtSetup * setup, GHashTable * packed_lengths)
+{
+  const gint depth = xmlTextReaderDepth (reader);
+  xmlNodePtr setup_node, node;
+  gint res;
+
+  while ((res = bt_song_io_native_next_child (reader, depth)) == 1) {
+    if (bt_song_io_native_is_element (reader, "machines")) {
+      if ((res = bt_song_io_native_load_machines (reader, song, setup,
+                  packed_lengths)) == -1)
+        break;
+    } else if ((node = xmlTextReaderExpand (reader))) {
+      // wires and properties
+      setup_node = xmlNewNode (NULL, XML_CHAR_PTR ("setup"));
+      xmlAddChild (setup_node, xmlDocCopyNode (node, NULL, 1));
+      bt_persistence_load (BT_TYPE_SETUP, BT_PERSISTENCE (setup), setup_node,
+          NULL, NULL);
+      xmlFreeNode (setup_node);
+    } else {
+      res = -1;
+      break;
+    }
+  }
+  return res;
+}
+
+static gint
+bt_song_io_native_load_song (xmlTextReaderPtr reader,
+    const BtSong * const song, GHashTable * packed_lengths)
+{
+  BtSongInfo *song_info;
+  BtSetup *setup;
+  BtSequence *sequence;
+  BtWavetable *wavetable;
+  BtPersistence *part;
+  GType type;
+  xmlNodePtr node;
+  gint res;
+
+  g_object_get ((gpointer) song, "song-info", &song_info, "setup", &setup,
+      "sequence", &sequence, "wavetable", &wavetable, NULL);
+
+  while ((res = bt_song_io_native_next_child (reader, 0)) == 1) {
+    if (bt_song_io_native_is_element (reader, "setup")) {
+      if ((res = bt_song_io_native_load_setup (reader, song, setup,
+                  packed_lengths)) == -1)
+        break;
+      continue;
+    } else if (bt_song_io_native_is_element (reader, "meta")) {
+      type = BT_TYPE_SONG_INFO;
+      part = BT_PERSISTENCE (song_info);
+    } else if (bt_song_io_native_is_element (reader, "sequence")) {
+      type = BT_TYPE_SEQUENCE;
+      part = BT_PERSISTENCE (sequence);
+    } else if (bt_song_io_native_is_element (reader, "wavetable")) {
+      type = BT_TYPE_WAVETABLE;
+      part = BT_PERSISTENCE (wavetable);
+    } else {
+      continue;
+    }
+    if (!(node = xmlTextReaderExpand (reader))) {
+      res = -1;
+      break;
+    }
+    if (!bt_persistence_load (type, part, node, NULL, NULL)) {
+      GST_WARNING ("failed to load %s", (gchar *) node->name);
+    }
+  }
+
+  g_object_unref (song_info);
+  g_object_unref (setup);
+  g_object_unref (sequence);
+  g_object_unref (wavetable);
+  return res;
+}
+
 gboolean
-bt_song_io_native_load (xmlDocPtr song_doc, const BtSong * const song,
-    GError ** err)
+bt_song_io_native_load (xmlTextReaderPtr reader, const BtSong * const song,
+    GHashTable * packed_lengths, GError ** err)
 {
-  xmlNodePtr const root_node = xmlDocGetRootElement (song_doc);
+  gint res;
 
-  if (root_node == NULL) {
-    // this cannot really happen, since a missing root tag would fail the
-    // validity checks
+  // find the root element
+  while ((res = xmlTextReaderRead (reader)) == 1 &&
+      xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT);
+
+  if (res == 0) {
     GST_WARNING ("XML document is empty");
     g_set_error (err, BT_SONG_IO_ERROR, BT_SONG_IO_ERROR_INVALID_FORMAT,
         _("XML document is empty."));
-  } else if (xmlStrcmp (root_node->name, (const xmlChar *) "buzztrax") &&
-      xmlStrcmp (root_node->name, (const xmlChar *) "buzztard")) {
+  } else if (res == 1 && !bt_song_io_native_is_element (reader, "buzztrax") &&
+      !bt_song_io_native_is_element (reader, "buzztard")) {
     GST_WARNING ("wrong XML document root");
     g_set_error (err, BT_SONG_IO_ERROR, BT_SONG_IO_ERROR_INVALID_FORMAT,
         _("Wrong XML document root."));
+  } else if (res == 1
+      && bt_song_io_native_load_song (reader, song, packed_lengths) != -1) {
+    return TRUE;
   } else {
-    GError *e = NULL;
-    bt_persistence_load (BT_TYPE_SONG, BT_PERSISTENCE (song), root_node,
-        &e, NULL);
-    if (e != NULL) {
-      GST_WARNING ("deserialisation failed: %s", e->message);
-      g_propagate_error (err, e);
-    } else {
-      return TRUE;
-    }
+    // parse errors can show up after parts of the song have been loaded
+    GST_WARNING ("is not a wellformed XML document");
+    g_set_error (err, BT_SONG_IO_ERROR, BT_SONG_IO_ERROR_INVALID_FORMAT,
+        _("Is not a wellformed XML document."));
   }
   return FALSE;
 }
 
 void
-bt_song_io_native_load_set_error (xmlParserCtxtPtr const ctxt,
-    gchar * const file_name, GError ** err)
-{
-  /* other things that can be checked:
-   * ctxt->valid: DTD validation issue, we don't use a DTD anymore, also
-   *              set if !wellFormed
-   * ctxt->nsWellFormed:Namespace issue
-   */
-  if (!ctxt->wellFormed) {
-    GST_WARNING ("is not a wellformed XML document");
-    g_set_error (err, BT_SONG_IO_ERROR, BT_SONG_IO_ERROR_INVALID_FORMAT,
-        _("Is not a wellformed XML document."));
-  } else {
-    GST_WARNING ("failed to read song file '%s'",
-        (file_name ? file_name : "data"));
-    g_set_error_literal (err, G_IO_ERROR, g_io_error_from_errno (errno),
-        g_strerror (errno));
-  }
+bt_song_io_native_load_set_error (gchar * const file_name, GError ** err)
+{
+  GST_WARNING ("failed to read song file '%s'",
+      (file_name ? file_name : "data"));
+  g_set_error_literal (err, G_IO_ERROR, g_io_error_from_errno (errno),
+      g_strerror (errno));
 }
 
 //-- methods
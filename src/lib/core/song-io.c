@@ -25,7 +25,12 @@
  * should return its #GType if it can handle the format or %NULL else.
  *
  * Such a module should overwrite the bt_song_io_load() and/or bt_song_io_save()
- * default implementations.
+ * default implementations. To support saving in the background with
+ * bt_song_io_save_async(), a module also implements the snapshot and write
+ * methods.
+ *
+ * Applications that only inspect songs can turn off the #BtSongIO:wave-data
+ * property before loading. The loaders then skip decoding the sample data.
  *
  * There is an internal subclass of this called #BtSongIONative.
  *
@@ -49,7 +54,8 @@ enum
   SONG_IO_FILE_NAME = 1,
   SONG_IO_DATA,
   SONG_IO_DATA_LEN,
-  SONG_IO_STATUS
+  SONG_IO_STATUS,
+  SONG_IO_WAVE_DATA
 };
 
 struct _BtSongIOPrivate
@@ -64,6 +70,9 @@ struct _BtSongIOPrivate
 
   /* informs about the progress of the loader */
   gchar *status;
+
+  /* if FALSE, the loader can skip the sample data of the waves */
+  gboolean wave_data;
 };
 
 /* list of registered io-classes, each entry points to a BtSongIOModuleInfo
@@ -289,6 +298,103 @@ bt_song_io_update_filename (const BtSongIO * const self,
   }
 }
 
+static void
+bt_song_io_set_saving_status (const BtSongIO * const self)
+{
+  gchar *status;
+  const gchar *const msg = _("Saving file '%s'");
+
+  if (self->priv->file_name) {
+    status = g_alloca (1 + strlen (msg) + strlen (self->priv->file_name));
+    g_sprintf (status, msg, self->priv->file_name);
+    GST_INFO ("saving song [%s]", self->priv->file_name);
+  } else {
+    gint len = 1 + strlen (msg) + 4;
+    status = g_alloca (len);
+    g_snprintf (status, len, msg, "data");
+    GST_INFO ("saving song [<data>]");
+  }
+  g_object_set ((gpointer) self, "status", status, NULL);
+}
+
+/* data for saving in the background */
+typedef struct
+{
+  BtSong *song;
+  gpointer snapshot;
+} BtSongIOSaveData;
+
+static void
+bt_song_io_save_data_free (BtSongIOSaveData * data)
+{
+  g_object_unref (data->song);
+  g_slice_free (BtSongIOSaveData, data);
+}
+
+static void
+bt_song_io_save_thread (GTask * task, gpointer source_object,
+    gpointer task_data, GCancellable * cancellable)
+{
+  const BtSongIO *const self = BT_SONG_IO (source_object);
+  BtSongIOSaveData *data = (BtSongIOSaveData *) task_data;
+  gpointer snapshot = data->snapshot;
+  GError *err = NULL;
+
+  // the write method takes the snapshot
+  data->snapshot = NULL;
+  if (BT_SONG_IO_GET_CLASS (self)->write (self, snapshot, &err)) {
+    g_task_return_boolean (task, TRUE);
+  } else {
+    if (!err) {
+      g_set_error (&err, G_IO_ERROR, G_IO_ERROR_FAILED,
+          "Failed to write the song file.");
+    }
+    g_task_return_error (task, err);
+  }
+}
+
+/*
+ * bt_song_io_finish_loading_waves:
+ *
+ * The loaders decode the sample data of the waves in the background while the
+ * rest of the song is built. Wait for all decoders, report the progress in the
+ * status property and collect the waves that failed to load.
+ */
+static void
+bt_song_io_finish_loading_waves (const BtSongIO * const self,
+    const BtSong * const song)
+{
+  BtWavetable *wavetable;
+  GList *waves, *node;
+  guint i = 0, n;
+  const gchar *const msg = _("Loading waves (%u/%u)");
+
+  g_object_get ((gpointer) song, "wavetable", &wavetable, NULL);
+  g_object_get (wavetable, "waves", &waves, NULL);
+  n = g_list_length (waves);
+  for (node = waves; node; node = g_list_next (node)) {
+    BtWave *const wave = BT_WAVE (node->data);
+    GError *err = NULL;
+    gchar *status = g_strdup_printf (msg, ++i, n);
+
+    g_object_set ((gpointer) self, "status", status, NULL);
+    g_free (status);
+    if (!bt_wave_finish_loading (wave, &err)) {
+      gchar *name, *uri;
+
+      g_object_get (wave, "name", &name, "uri", &uri, NULL);
+      bt_wavetable_remember_missing_wave (wavetable,
+          g_strdup_printf ("%s: %s", name, uri));
+      g_free (name);
+      g_free (uri);
+      GST_WARNING ("Can't load wave: %s", err->message);
+      g_error_free (err);
+    }
+  }
+  g_list_free (waves);
+  g_object_unref (wavetable);
+}
+
 //-- constructor methods
 
 /**
@@ -427,7 +533,10 @@ bt_song_io_load (BtSongIO const *self, const BtSong * const song, GError ** err)
   g_object_set ((gpointer) self, "status", status, NULL);
 
   g_object_set ((gpointer) song, "song-io", self, NULL);
-  if ((result = load (self, song, err))) {
+  result = load (self, song, err);
+  // join the wave decoders before anyone can start the song
+  bt_song_io_finish_loading_waves (self, song);
+  if (result) {
     bt_song_io_update_filename (BT_SONG_IO (self), song);
     GST_INFO ("loading done");
     //DEBUG
@@ -473,7 +582,6 @@ gboolean
 bt_song_io_save (BtSongIO const *self, const BtSong * const song, GError ** err)
 {
   gboolean result;
-  gchar *status;
   bt_song_io_virtual_save save;
 
   g_return_val_if_fail (BT_IS_SONG_IO (self), FALSE);
@@ -487,18 +595,7 @@ bt_song_io_save (BtSongIO const *self, const BtSong * const song, GError ** err)
     return FALSE;
   }
 
-  const gchar *const msg = _("Saving file '%s'");
-  if (self->priv->file_name) {
-    status = g_alloca (1 + strlen (msg) + strlen (self->priv->file_name));
-    g_sprintf (status, msg, self->priv->file_name);
-    GST_INFO ("saving song [%s]", self->priv->file_name);
-  } else {
-    gint len = 1 + strlen (msg) + 4;
-    status = g_alloca (len);
-    g_snprintf (status, len, msg, "data");
-    GST_INFO ("saving song [<data>]");
-  }
-  g_object_set ((gpointer) self, "status", status, NULL);
+  bt_song_io_set_saving_status (self);
 
   g_object_set ((gpointer) song, "song-io", self, NULL);
   if ((result = save (self, song, err))) {
@@ -512,6 +609,111 @@ bt_song_io_save (BtSongIO const *self, const BtSong * const song, GError ** err)
   return result;
 }
 
+/**
+ * bt_song_io_save_async:
+ * @self: the #BtSongIO instance to use
+ * @song: the #BtSong instance that should stored
+ * @callback: called when the song has been saved
+ * @user_data: data for the @callback
+ *
+ * Save the song to a file in the background. This takes a snapshot of the song
+ * and returns, the song file is then written and compressed in a worker
+ * thread, so that the song can be edited meanwhile. Call
+ * bt_song_io_save_finish() from the @callback to get the result.
+ *
+ * If the module does not support saving in the background or if the song is
+ * saved to memory, the song is saved right away.
+ *
+ * Since: 0.12
+ */
+void
+bt_song_io_save_async (BtSongIO * self, const BtSong * const song,
+    GAsyncReadyCallback callback, gpointer user_data)
+{
+  const BtSongIOClass *klass;
+  BtSongIOSaveData *data;
+  GTask *task;
+  GError *err = NULL;
+  gpointer snapshot;
+
+  g_return_if_fail (BT_IS_SONG_IO (self));
+  g_return_if_fail (BT_IS_SONG (song));
+
+  task = g_task_new (self, NULL, callback, user_data);
+  g_task_set_source_tag (task, bt_song_io_save_async);
+
+  klass = BT_SONG_IO_GET_CLASS (self);
+  if (!klass->snapshot || !klass->write || !self->priv->file_name) {
+    if (bt_song_io_save (self, song, &err)) {
+      g_task_return_boolean (task, TRUE);
+    } else {
+      if (!err) {
+        g_set_error (&err, G_IO_ERROR, G_IO_ERROR_FAILED,
+            "Failed to save the song.");
+      }
+      g_task_return_error (task, err);
+    }
+    g_object_unref (task);
+    return;
+  }
+
+  bt_song_io_set_saving_status (self);
+
+  g_object_set ((gpointer) song, "song-io", self, NULL);
+  snapshot = klass->snapshot (self, song, &err);
+  g_object_set ((gpointer) song, "song-io", NULL, NULL);
+
+  if (snapshot) {
+    data = g_slice_new (BtSongIOSaveData);
+    data->song = g_object_ref ((gpointer) song);
+    data->snapshot = snapshot;
+    g_task_set_task_data (task, data,
+        (GDestroyNotify) bt_song_io_save_data_free);
+    g_task_run_in_thread (task, bt_song_io_save_thread);
+  } else {
+    g_object_set ((gpointer) self, "status", NULL, NULL);
+    if (!err) {
+      g_set_error (&err, G_IO_ERROR, G_IO_ERROR_FAILED,
+          "Failed to take a snapshot of the song.");
+    }
+    g_task_return_error (task, err);
+  }
+  g_object_unref (task);
+}
+
+/**
+ * bt_song_io_save_finish:
+ * @self: the #BtSongIO instance to use
+ * @result: the #GAsyncResult passed to the callback
+ * @err: where to store the error message in case of an error, or %NULL
+ *
+ * Finishes saving a song that has been started with bt_song_io_save_async().
+ * The file-name of the song is only updated if the file has been written.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 0.12
+ */
+gboolean
+bt_song_io_save_finish (BtSongIO * self, GAsyncResult * result, GError ** err)
+{
+  BtSongIOSaveData *data;
+  gboolean res;
+
+  g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+
+  if ((res = g_task_propagate_boolean (G_TASK (result), err))) {
+    // the song has been saved in the background
+    if ((data = g_task_get_task_data (G_TASK (result)))) {
+      bt_song_io_update_filename (self, data->song);
+    }
+  }
+  g_object_set ((gpointer) self, "status", NULL, NULL);
+  GST_INFO ("saved song [%s] = %d",
+      self->priv->file_name ? self->priv->file_name : "data", res);
+  return res;
+}
+
 //-- class internals
 
 static void
@@ -533,6 +735,9 @@ bt_song_io_get_property (GObject * const object, const guint property_id,
     case SONG_IO_STATUS:
       g_value_set_string (value, self->priv->status);
       break;
+    case SONG_IO_WAVE_DATA:
+      g_value_set_boolean (value, self->priv->wave_data);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -557,6 +762,9 @@ bt_song_io_set_property (GObject * const object, const guint property_id,
       self->priv->status = g_value_dup_string (value);
       GST_DEBUG ("set the status for song_io: %s", self->priv->status);
       break;
+    case SONG_IO_WAVE_DATA:
+      self->priv->wave_data = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -592,6 +800,7 @@ static void
 bt_song_io_init (BtSongIO * self)
 {
   self->priv = bt_song_io_get_instance_private(self);
+  self->priv->wave_data = TRUE;
 }
 
 static void
@@ -625,4 +834,9 @@ bt_song_io_class_init (BtSongIOClass * const klass)
       g_param_spec_string ("status", "status prop",
           "status of load/save operations", NULL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, SONG_IO_WAVE_DATA,
+      g_param_spec_boolean ("wave-data", "wave-data prop",
+          "load the sample data of the waves", TRUE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
@@ -20,6 +20,7 @@
 
 #include <glib.h>
 #include <glib-object.h>
+#include <gio/gio.h>
 
 #include "song.h"
 
@@ -100,12 +101,43 @@ typedef gboolean (*bt_song_io_virtual_load)(gconstpointer self, const BtSong * c
  * Returns: %TRUE for success
  */
 typedef gboolean (*bt_song_io_virtual_save)(gconstpointer const self, const BtSong * const song, GError **err);
+/**
+ * bt_song_io_virtual_snapshot:
+ * @self: song-io instance
+ * @song: song object to save
+ * @err: where to store the error message in case of an error, or %NULL
+ *
+ * Subclasses can override this method together with #bt_song_io_virtual_write
+ * to support saving in the background. It is called on the main thread and
+ * collects everything that is needed to write the song file.
+ *
+ * Returns: the snapshot or %NULL in case of an error
+ *
+ * Since: 0.12
+ */
+typedef gpointer (*bt_song_io_virtual_snapshot)(gconstpointer const self, const BtSong * const song, GError **err);
+/**
+ * bt_song_io_virtual_write:
+ * @self: song-io instance
+ * @snapshot: (transfer full): the snapshot from #bt_song_io_virtual_snapshot
+ * @err: where to store the error message in case of an error, or %NULL
+ *
+ * Writes the @snapshot to the file. This is called from a worker thread and
+ * must not access the song. The method frees the @snapshot.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 0.12
+ */
+typedef gboolean (*bt_song_io_virtual_write)(gconstpointer const self, gpointer snapshot, GError **err);
 
 /**
  * BtSongIOClass:
  * @parent: parent class type
  * @load: virtual method for loading a song
  * @save: virtual method for saving a song
+ * @snapshot: optional virtual method for taking a snapshot of a song for saving
+ * @write: optional virtual method for writing a snapshot
  *
  * Base class for song input and output plugins
  */
@@ -115,6 +147,8 @@ struct _BtSongIOClass {
   /* class methods */
   bt_song_io_virtual_load load;
   bt_song_io_virtual_save save;
+  bt_song_io_virtual_snapshot snapshot;
+  bt_song_io_virtual_write write;
 };
 
 /**
@@ -180,5 +214,7 @@ const GList *bt_song_io_get_module_info_list(void);
 
 gboolean bt_song_io_load(BtSongIO const *self, const BtSong * const song, GError **err);
 gboolean bt_song_io_save(BtSongIO const *self, const BtSong * const song, GError **err);
+void bt_song_io_save_async(BtSongIO *self, const BtSong * const song, GAsyncReadyCallback callback, gpointer user_data);
+gboolean bt_song_io_save_finish(BtSongIO *self, GAsyncResult *result, GError **err);
 
 #endif // BT_SONG_IO_H
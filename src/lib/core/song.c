@@ -222,8 +222,6 @@ struct _BtSongPrivate
   /* the element that has the clock */
   BtSinkMachine *master;
 
-  /* the query is used in update_playback_position */
-  GstQuery *position_query;
   /* seek events */
   GstEvent *play_seek_event;
   GstEvent *loop_seek_event;
@@ -334,6 +332,7 @@ bt_song_seek_to_play_pos (const BtSong * const self)
   if (!p->is_playing)
     return;
 
+  BT_TRACE_BEGIN ("song", "seek-to-play-pos");
   g_object_get (p->sequence, "loop", &loop, "loop-end", &loop_end,
       "length", &length, NULL);
   g_object_get (p->song_info, "tick-duration", &tick_duration, NULL);
@@ -352,6 +351,7 @@ bt_song_seek_to_play_pos (const BtSong * const self)
   if (!(gst_element_send_event (GST_ELEMENT (p->master_bin), event))) {
     GST_WARNING ("element failed to seek to play_pos event");
   }
+  BT_TRACE_END ("song", "seek-to-play-pos");
 }
 
 static void
@@ -442,11 +442,12 @@ bt_song_send_audio_context (const BtSong * const self)
   BtSettings *settings = bt_settings_make ();
   GstContext *ctx;
   gulong bpm, tpb;
-  guint latency;
+  guint latency, buffer_size;
   glong stpb = 0;
 
   g_object_get (p->song_info, "bpm", &bpm, "tpb", &tpb, NULL);
-  g_object_get (settings, "latency", &latency, NULL);
+  g_object_get (settings, "latency", &latency, "buffer-size", &buffer_size,
+      NULL);
   g_object_unref (settings);
 
   stpb = (glong) ((GST_SECOND * 60) / (bpm * tpb * latency * GST_MSECOND));
@@ -455,6 +456,7 @@ bt_song_send_audio_context (const BtSong * const self)
       tpb, latency);
 
   ctx = gstbt_audio_tempo_context_new (bpm, tpb, stpb);
+  gstbt_audio_tempo_context_set_buffer_frames (ctx, buffer_size);
   gst_element_set_context ((GstElement *) p->bin, ctx);
   gst_context_unref (ctx);
 }
@@ -634,6 +636,7 @@ on_song_segment_done (const GstBus * const bus,
   if (self->priv->is_playing || self->priv->is_idle_active) {
     GstEvent *event;
 
+    BT_TRACE_INSTANT ("song", "loop", self->priv->play_beg);
     if (self->priv->is_playing) {
       event = gst_event_copy (self->priv->loop_seek_event);
     } else {
@@ -1188,44 +1191,36 @@ bt_song_continue (const BtSong * const self)
  * @self: the song that should update its playback-pos counter
  *
  * Updates the playback-position counter to fire all #BtSong:play-pos notify
- * handlers.
+ * handlers. The position is the one that the master published for the last
+ * buffer, the pipeline is not queried. Thus this can be called for each frame
+ * in a user interface, the handlers only run if the tick has changed.
  *
  * Returns: %FALSE if the song is not playing
  */
 gboolean
 bt_song_update_playback_position (const BtSong * const self)
 {
+  gulong play_pos;
+
   g_return_val_if_fail (BT_IS_SONG (self), FALSE);
-  g_assert (GST_IS_BIN (self->priv->master_bin));
-  g_assert (GST_IS_QUERY (self->priv->position_query));
-  //GST_INFO("query playback-pos");
+  g_assert (BT_IS_SINK_BIN (self->priv->master_bin));
 
   if (G_UNLIKELY (!self->priv->is_playing)) {
     GST_WARNING ("not playing");
     return FALSE;
   }
-  // query playback position and update self->priv->play-pos;
-  if (gst_element_query (GST_ELEMENT (self->priv->master_bin),
-          self->priv->position_query)) {
-    gint64 pos_cur;
-    gst_query_parse_position (self->priv->position_query, NULL, &pos_cur);
-    if (GST_CLOCK_TIME_IS_VALID (pos_cur)) {
-      // calculate new play-pos (in ticks)
-      const gulong play_pos = bt_song_info_time_to_tick (self->priv->song_info,
-          pos_cur);
-      if (play_pos != self->priv->play_pos) {
-        GST_INFO ("query playback-pos: cur=%" G_GINT64_FORMAT ", tick=%lu",
-            pos_cur, play_pos);
-        self->priv->play_pos = play_pos;
-        g_object_notify (G_OBJECT (self), "play-pos");
-      }
-    } else {
-      GST_WARNING ("query playback-pos: invalid pos");
+  // get the playback position and update self->priv->play-pos;
+  if (bt_sink_bin_get_playback_position ((BtSinkBin *) self->priv->master_bin,
+          NULL, &play_pos)) {
+    if (play_pos != self->priv->play_pos) {
+      GST_INFO ("playback-pos: tick=%lu", play_pos);
+      self->priv->play_pos = play_pos;
+      g_object_notify (G_OBJECT (self), "play-pos");
     }
   } else {
-    GST_WARNING ("query playback-pos: failed");
+    GST_DEBUG ("playback-pos: no buffer since last seek");
   }
-  // don't return FALSE in the WARNING case above, we use the return value to
+  // don't return FALSE in the DEBUG case above, we use the return value to
   // return from time-out handlers (e.g. toolbar)
   return TRUE;
 }
@@ -1423,7 +1418,7 @@ bt_song_persistence_save (const BtPersistence * const persistence,
         XML_CHAR_PTR ("buzztrax.xsd"));
 
     bt_persistence_save (BT_PERSISTENCE (self->priv->song_info), node, NULL);
-    bt_persistence_save (BT_PERSISTENCE (self->priv->setup), node, NULL);
+    bt_persistence_save (BT_PERSISTENCE (self->priv->setup), node, userdata);
     bt_persistence_save (BT_PERSISTENCE (self->priv->sequence), node, NULL);
     bt_persistence_save (BT_PERSISTENCE (self->priv->wavetable), node, NULL);
   }
@@ -1552,6 +1547,8 @@ bt_song_constructed (GObject * object)
   GST_DEBUG ("  song-info-signals connected");
   g_signal_connect_object (settings, "notify::latency",
       G_CALLBACK (bt_song_on_latency_changed), (gpointer) self, 0);
+  g_signal_connect_object (settings, "notify::buffer-size",
+      G_CALLBACK (bt_song_on_latency_changed), (gpointer) self, 0);
   g_object_unref (settings);
 
   bt_song_send_audio_context (self);
@@ -1729,7 +1726,6 @@ bt_song_dispose (GObject * const object)
     g_object_unref (self->priv->wavetable);
   }
 
-  gst_query_unref (self->priv->position_query);
   if (self->priv->play_seek_event)
     gst_event_unref (self->priv->play_seek_event);
   if (self->priv->loop_seek_event)
@@ -1774,7 +1770,6 @@ bt_song_init (BtSong * self)
 
   self->priv = bt_song_get_instance_private(self);
 
-  self->priv->position_query = gst_query_new_position (GST_FORMAT_TIME);
   self->priv->play_rate = 1.0;
 
   s = (GstClockTime) (G_MAXINT64 - (11 * GST_SECOND));
@@ -140,121 +140,103 @@ typedef struct
   guint16 *temp;
 } CompressionValues;
 
-#define MAXPACKEDBUFFER 2048
-
+/* The compressed wave data is a little endian bit stream, the bits of each
+ * byte are used starting with the lowest bit. We read it directly from the
+ * song data, loading 64 bits at a time. */
 typedef struct
 {
-  guint8 packed_buf[MAXPACKEDBUFFER];
-  guint32 cur_index;
-  guint32 cur_bit;
-
-  guint32 bytes_in_buffer;
-  guint32 max_bytes;
-  guint32 bytes_in_file_remain;
+  const guint8 *data;
+  gsize size;
+  /* read position in bits */
+  guint64 pos;
 
   gboolean error;
-
-  const BtSongIOBuzz *self;
 } CompressionCtx;
 
-static CompressionCtx ctxt = { {0,}, 0 };
-
-static guint32
-unpack_bits (guint32 amount)
+static inline guint
+count_trailing_zeros (guint64 word)
 {
-  guint32 ret = 0, shift = 0;
-  guint32 size, mask, val;
-  guint32 amount_needed, amount_got;
-  guint32 max_bits = 8;
+#ifdef __GNUC__
+  return (guint) __builtin_ctzll (word);
+#else
+  guint count = 0;
 
-  GST_LOG ("unpack_bits(%d)", amount);
-
-  if ((ctxt.bytes_in_file_remain == 0) && (ctxt.cur_index == MAXPACKEDBUFFER)) {
-    GST_WARNING ("unpack_bits().1 = 0 : eof");
-    ctxt.error = TRUE;
-    return 0;
+  while (!(word & 1)) {
+    word >>= 1;
+    count++;
   }
+  return count;
+#endif
+}
 
-  while (amount > 0) {
-    //check to see if we need to update buffer and/or index
-    if ((ctxt.cur_bit == max_bits) || (ctxt.bytes_in_buffer == 0)) {
-      ctxt.cur_bit = 0;
-      ctxt.cur_index++;
-      if (ctxt.cur_index >= ctxt.bytes_in_buffer) {
-        //run out of buffer... read more file into buffer
-        amount_needed =
-            (ctxt.bytes_in_file_remain >
-            ctxt.max_bytes) ? ctxt.max_bytes : ctxt.bytes_in_file_remain;
-
-        amount_got = mem_read (ctxt.self, ctxt.packed_buf, 1, amount_needed);
-        GST_LOG ("reading %u bytes at pos %ld and got %u bytes",
-            amount_needed, ctxt.self->priv->data_pos, amount_got);
-
-        ctxt.bytes_in_file_remain -= amount_got;
-        ctxt.bytes_in_buffer = amount_got;
-        ctxt.cur_index = 0;
-
-        //if we didnt read anything then exit now
-        if (amount_got == 0) {
-          //make sure nothing else is read
-          ctxt.bytes_in_file_remain = 0;
-          ctxt.cur_index = MAXPACKEDBUFFER;
-          ctxt.error = TRUE;
-          if (amount_needed == 0) {
-            GST_WARNING
-                ("got 0 bytes, wanted 0 bytes, %u bytes in file remain, fpos %ld",
-                ctxt.bytes_in_file_remain, ctxt.self->priv->data_pos);
-          } else {
-            GST_WARNING ("got 0 bytes, wanted %u bytes", amount_needed);
-          }
-          return 0;
-        }
-      }
+/* get the next bits from the stream, at most 64 bits are valid, the number of
+ * valid bits is stored in @valid */
+static inline guint64
+peek_bits (const CompressionCtx * ctx, guint * valid)
+{
+  gsize ix = (gsize) (ctx->pos >> 3);
+  guint shift = (guint) (ctx->pos & 7);
+  guint64 word = 0;
+
+  if (ix + sizeof (word) <= ctx->size) {
+    memcpy (&word, &ctx->data[ix], sizeof (word));
+    word = GUINT64_FROM_LE (word);
+    *valid = 64 - shift;
+  } else if (ix < ctx->size) {
+    gsize i, avail = ctx->size - ix;
+
+    for (i = 0; i < avail; i++) {
+      word |= ((guint64) ctx->data[ix + i]) << (i * 8);
     }
-    //calculate size to read from current guint32
-    size =
-        ((amount + ctxt.cur_bit) > max_bits) ? max_bits - ctxt.cur_bit : amount;
-
-    //calculate bitmask
-    mask = (1 << size) - 1;
-
-    //Read value from buffer
-    val = ctxt.packed_buf[ctxt.cur_index];
-    val = val >> ctxt.cur_bit;
-
-    //apply mask to value
-    val &= mask;
-
-    //shift value to correct position
-    val = val << shift;
+    *valid = (guint) (avail * 8) - shift;
+  } else {
+    *valid = 0;
+  }
+  return word >> shift;
+}
 
-    //update return value
-    ret |= val;
+static inline guint32
+unpack_bits (CompressionCtx * ctx, guint32 amount)
+{
+  guint valid;
+  guint64 word = peek_bits (ctx, &valid);
 
-    //update info
-    ctxt.cur_bit += size;
-    shift += size;
-    amount -= size;
+  if (G_UNLIKELY (valid < amount)) {
+    GST_WARNING ("unpack_bits(%u) = 0 : eof", amount);
+    ctx->pos += valid;
+    ctx->error = TRUE;
+    return 0;
   }
-  GST_LOG ("unpack_bits() = %d", ret);
-  return ret;
+  ctx->pos += amount;
+  return (guint32) (word & ((G_GUINT64_CONSTANT (1) << amount) - 1));
 }
 
-static guint32
-count_zero_bits (void)
+/* count and skip the zero bits up to the next one bit, the one bit is
+ * consumed as well */
+static inline guint32
+count_zero_bits (CompressionCtx * ctx)
 {
-  guint32 bit;
   guint32 count = 0;
-
-  GST_LOG ("count_zero_bits()");
-
-  bit = unpack_bits (1);
-  while ((bit == 0) && (!ctxt.error)) {
-    count++;
-    bit = unpack_bits (1);
+  guint valid, zeros;
+  guint64 word;
+
+  for (;;) {
+    word = peek_bits (ctx, &valid);
+    if (G_UNLIKELY (!valid)) {
+      GST_WARNING ("count_zero_bits() = %u : eof", count);
+      ctx->error = TRUE;
+      return count;
+    }
+    if (valid < 64)
+      word &= (G_GUINT64_CONSTANT (1) << valid) - 1;
+    if (G_LIKELY (word)) {
+      zeros = count_trailing_zeros (word);
+      ctx->pos += zeros + 1;
+      return count + zeros;
+    }
+    count += valid;
+    ctx->pos += valid;
   }
-  GST_LOG ("count_zero_bits() = %u", count);
-  return count;
 }
 
 static void
@@ -281,8 +263,8 @@ free_compression_values (CompressionValues * cv)
 }
 
 static gboolean
-decompress_samples (CompressionValues * cv, guint16 * outbuf,
-    guint32 block_size)
+decompress_samples (CompressionCtx * ctx, CompressionValues * cv,
+    guint16 * outbuf, guint32 block_size)
 {
   guint32 switch_value, bits, size, zero_count;
   guint32 val;
@@ -293,18 +275,18 @@ decompress_samples (CompressionValues * cv, guint16 * outbuf,
     return FALSE;
 
   //Get compression method
-  switch_value = unpack_bits (2);
+  switch_value = unpack_bits (ctx, 2);
 
   //read size (in bits) of compressed values
-  bits = unpack_bits (4);
+  bits = unpack_bits (ctx, 4);
 
   size = block_size;
-  while ((size > 0) && (!ctxt.error)) {
+  while ((size > 0) && (!ctx->error)) {
     //read compressed value
-    val = (guint16) unpack_bits (bits);
+    val = (guint16) unpack_bits (ctx, bits);
 
     //count zeros
-    zero_count = count_zero_bits ();
+    zero_count = count_zero_bits (ctx);
 
     //construct
     val = (guint16) ((zero_count << bits) | val);
@@ -350,12 +332,13 @@ decompress_samples (CompressionValues * cv, guint16 * outbuf,
     *outbuf++ = cv->result;
     size--;
   }
-  GST_LOG ("decompress_samples() = %d", !ctxt.error);
-  return !ctxt.error;
+  GST_LOG ("decompress_samples() = %d", !ctx->error);
+  return !ctx->error;
 }
 
 static gboolean
-decompress_wave (guint16 * outbuf, guint32 num_samples, guint channels)
+decompress_wave (CompressionCtx * ctx, guint16 * outbuf, guint32 num_samples,
+    guint channels)
 {
   guint32 zero_count, shift, block_size, last_block_size, num_blocks;
   guint32 result_shift, count, i, j;
@@ -367,13 +350,13 @@ decompress_wave (guint16 * outbuf, guint32 num_samples, guint channels)
   if (!outbuf)
     return FALSE;
 
-  zero_count = count_zero_bits ();
+  zero_count = count_zero_bits (ctx);
   if (zero_count) {
     GST_WARNING ("Unknown wave data compression %d\n", zero_count);
     return FALSE;
   }
   //get size shifter
-  shift = unpack_bits (4);
+  shift = unpack_bits (ctx, 4);
 
   //get size of compressed blocks
   block_size = 1 << shift;
@@ -385,7 +368,7 @@ decompress_wave (guint16 * outbuf, guint32 num_samples, guint channels)
   last_block_size = (block_size - 1) & num_samples;
 
   //get result shifter value (used to shift data after decompression)
-  result_shift = unpack_bits (4);
+  result_shift = unpack_bits (ctx, 4);
 
   GST_DEBUG ("before decomp loop: "
       " shift = %u"
@@ -408,7 +391,7 @@ decompress_wave (guint16 * outbuf, guint32 num_samples, guint channels)
         block_size = last_block_size;
       }
 
-      if (!decompress_samples (&cv1, outbuf, block_size)) {
+      if (!decompress_samples (ctx, &cv1, outbuf, block_size)) {
         GST_WARNING ("abort with %d remaining blocks", count);
         return FALSE;
       }
@@ -425,7 +408,7 @@ decompress_wave (guint16 * outbuf, guint32 num_samples, guint channels)
     }
   } else {                      // stereo handling
     //read "channel sum" flag
-    sum_channels = (guint8) unpack_bits (1);
+    sum_channels = (guint8) unpack_bits (ctx, 1);
 
     //zero internal compression values and alloc some temporary space
     init_compression_values (&cv1, block_size);
@@ -440,9 +423,12 @@ decompress_wave (guint16 * outbuf, guint32 num_samples, guint channels)
         block_size = last_block_size;
       }
       //decompress both channels into temporary area
-      if ((!decompress_samples (&cv1, cv1.temp, block_size)) ||
-          (!decompress_samples (&cv2, cv2.temp, block_size)))
+      if ((!decompress_samples (ctx, &cv1, cv1.temp, block_size)) ||
+          (!decompress_samples (ctx, &cv2, cv2.temp, block_size))) {
+        free_compression_values (&cv1);
+        free_compression_values (&cv2);
         return FALSE;
+      }
 
       for (i = 0; i < block_size; i++) {
         //store channel 1 and apply result shift
@@ -2013,6 +1999,7 @@ read_cwav_section (const BtSongIOBuzz * self, const BtSong * song)
   GList *list, *node;
   gulong bytes, length, remain;
   guint channels;
+  CompressionCtx ctx = { NULL, };
 
   // this section is optional
   if (!entry)
@@ -2029,8 +2016,6 @@ read_cwav_section (const BtSongIOBuzz * self, const BtSong * song)
   GST_INFO ("  number of waves: %u", number_of_waves);
 
   remain = entry->size - 2;
-  // decompression context
-  ctxt.self = self;
 
   for (i = 0; i < number_of_waves; i++) {
     // reader header
@@ -2100,15 +2085,11 @@ read_cwav_section (const BtSongIOBuzz * self, const BtSong * song)
       (void) read_dword (self);
       remain -= 4;
     } else {
-      // decompression context
-      ctxt.max_bytes = MAXPACKEDBUFFER;
-      ctxt.bytes_in_file_remain = remain;
-      ctxt.cur_bit = 0;
-      // set up so that call to unpack_bits() will force an immediate read from file
-      ctxt.cur_index = MAXPACKEDBUFFER;
-      ctxt.bytes_in_buffer = 0;
-      // needed so the unpack_bits() can signal an error
-      ctxt.error = FALSE;
+      // decompression context, reads the bits straight from the song data
+      ctx.data = (const guint8 *) &self->priv->data[self->priv->data_pos];
+      ctx.size = MIN (remain, self->priv->data_length - self->priv->data_pos);
+      ctx.pos = 0;
+      ctx.error = FALSE;
     }
 
     // get wave
@@ -2132,7 +2113,7 @@ read_cwav_section (const BtSongIOBuzz * self, const BtSong * song)
             }
             remain -= bytes;
           } else {
-            decompress_wave ((guint16 *) data, length, channels);
+            decompress_wave (&ctx, (guint16 *) data, length, channels);
           }
           g_object_set (wavelevel, "data", data, NULL);
           // DEBUG
@@ -2145,25 +2126,15 @@ read_cwav_section (const BtSongIOBuzz * self, const BtSong * song)
         }
       }
       if (format == 1) {
-        /* assume
-           we read 100 bytes (bytes_in_buffer)
-           we used  20 bytes (cur_index)
-           we need to seek back 80 (padding)
-           whats the +1?
-         */
-        gint32 padding =
-            (gint32) (ctxt.cur_index + 1) - (gint32) ctxt.bytes_in_buffer;
-        if (padding) {
-          GST_DEBUG ("seek back remaining %d bytes = (%u+1)-%u", padding,
-              ctxt.cur_index, ctxt.bytes_in_buffer);
-          GST_DEBUG ("file position : > 0x%lx", self->priv->data_pos);
-          ctxt.bytes_in_file_remain -= padding;
-          if ((mem_seek (self, padding, SEEK_CUR)) == -1) {
-            GST_WARNING ("failed to seek: %s", strerror (errno));
-          }
-          GST_DEBUG ("file position : < 0x%lx", self->priv->data_pos);
+        /* the next wave starts at the byte after the last bit we used, the
+         * unused bits of that byte are padding */
+        gulong used = (gulong) ((ctx.pos + 7) >> 3);
+
+        GST_DEBUG ("used %lu bytes of compressed data", used);
+        if ((mem_seek (self, used, SEEK_CUR)) == -1) {
+          GST_WARNING ("failed to seek: %s", strerror (errno));
         }
-        remain = ctxt.bytes_in_file_remain;
+        remain -= MIN (used, remain);
       }
       g_list_free (list);
       g_object_unref (wave);
@@ -2327,15 +2298,22 @@ bt_song_io_buzz_load (gconstpointer const _self, const BtSong * const song,
   gchar *const file_name;
   guint len;
   gpointer data;
+  gboolean wave_data;
+  GMappedFile *mapped_file = NULL;
 
   g_object_get ((gpointer) self, "file-name", &file_name, "data", &data,
-      "data-len", &len, NULL);
+      "data-len", &len, "wave-data", &wave_data, NULL);
   GST_INFO ("buzz loader will now load song from \"%s\"", file_name);
 
+  self->priv->data = NULL;
+  self->priv->data_length = 0;
   if (file_name) {
     GError *e = NULL;
-    if (!g_file_get_contents (file_name, &self->priv->data,
-            &self->priv->data_length, &e)) {
+    // map the file, the wave data is decoded straight from the mapping
+    if ((mapped_file = g_mapped_file_new (file_name, FALSE, &e))) {
+      self->priv->data = g_mapped_file_get_contents (mapped_file);
+      self->priv->data_length = g_mapped_file_get_length (mapped_file);
+    } else {
       GST_WARNING ("failed to read song file \"%s\" : %s", file_name,
           e->message);
       g_propagate_error (err, e);
@@ -2366,7 +2344,7 @@ bt_song_io_buzz_load (gconstpointer const _self, const BtSong * const song,
           read_patt_section (self, song) &&
           read_sequ_section (self, song) &&
           read_wavt_section (self, song) &&
-          read_cwav_section (self, song) &&
+          (!wave_data || read_cwav_section (self, song)) &&
           read_blah_section (self, song) &&
           read_pdlg_section (self, song) && read_midi_section (self, song)
           ) {
@@ -2400,10 +2378,11 @@ bt_song_io_buzz_load (gconstpointer const _self, const BtSong * const song,
           _("Is not a buzz file."));
     }
   }
-  if (file_name) {
-    g_free (self->priv->data);
-    g_free (file_name);
+  if (mapped_file) {
+    g_mapped_file_unref (mapped_file);
   }
+  self->priv->data = NULL;
+  g_free (file_name);
   return result;
 }
 
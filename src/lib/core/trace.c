@@ -0,0 +1,248 @@
+/* Buzztrax
+ * Copyright (C) 2017 Buzztrax team <buzztrax-devel@buzztrax.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * SECTION:bttrace
+ * @short_description: timeline tracer for engine activity
+ *
+ * When enabled through the `--bt-trace=<file>` option or the `BT_TRACE`
+ * environment variable, the core library records begin/end events for machine
+ * processing, control-source syncs, tick boundaries, seeks and setup graph
+ * updates. The events go into a fixed size ring buffer that is filled without
+ * taking locks, so that it can be used from the streaming threads. When the
+ * library is deinitialized, the events are written as a chrome trace file that
+ * can be loaded into chrome://tracing or https://ui.perfetto.dev/.
+ *
+ * If the ring buffer overflows, the oldest events are overwritten.
+ *
+ * The ring buffer is never freed once allocated. Streaming threads that are
+ * still running while the library is deinitialized can be in the middle of
+ * recording an event, they must not write into freed memory.
+ */
+
+#define BT_CORE
+#define BT_TRACE_C
+
+#include "core_private.h"
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+// 2^18 events, ~10 MB
+#define RING_SIZE (1 << 18)
+#define RING_MASK (RING_SIZE - 1)
+
+typedef struct
+{
+  GstClockTime ts;
+  gpointer thread;
+  const gchar *cat;
+  const gchar *name;
+  gint64 value;
+  BtTracePhase phase;
+} BtTraceEvent;
+
+/**
+ * bt_trace_enabled:
+ *
+ * %TRUE if tracing is active. Checked by the BT_TRACE_* macros.
+ */
+gboolean bt_trace_enabled = FALSE;
+
+static BtTraceEvent *ring = NULL;
+static gint ring_pos = 0;
+static gchar *trace_file_name = NULL;
+static GstClockTime trace_start = 0;
+
+//-- helper methods
+
+static void
+write_json_string (FILE * out, const gchar * str)
+{
+  const gchar *p;
+
+  fputc ('"', out);
+  for (p = str ? str : ""; *p; p++) {
+    switch (*p) {
+      case '"':
+      case '\\':
+        fputc ('\\', out);
+        fputc (*p, out);
+        break;
+      default:
+        if ((guchar) * p < 0x20) {
+          fprintf (out, "\\u%04x", (guint) * p);
+        } else {
+          fputc (*p, out);
+        }
+        break;
+    }
+  }
+  fputc ('"', out);
+}
+
+static gint
+get_thread_id (GHashTable * threads, FILE * out, gint pid, gpointer thread)
+{
+  gint tid = GPOINTER_TO_INT (g_hash_table_lookup (threads, thread));
+
+  if (!tid) {
+    gchar name[32];
+
+    tid = g_hash_table_size (threads) + 1;
+    g_hash_table_insert (threads, thread, GINT_TO_POINTER (tid));
+    // use the same thread naming as the GST_DEBUG log
+    g_snprintf (name, sizeof (name), "%p", thread);
+    fprintf (out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+        "\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n", pid, tid, name);
+  }
+  return tid;
+}
+
+static void
+bt_trace_write (const gchar * file_name)
+{
+  FILE *out;
+  GHashTable *threads;
+  guint i, beg, end;
+  gint pid = (gint) getpid ();
+  gboolean first = TRUE;
+
+  if (!(out = fopen (file_name, "w"))) {
+    GST_WARNING ("can't write trace to '%s': %s", file_name,
+        g_strerror (errno));
+    return;
+  }
+
+  end = (guint) g_atomic_int_get (&ring_pos);
+  beg = (end > RING_SIZE) ? end - RING_SIZE : 0;
+  GST_INFO ("writing %u trace events to '%s'", end - beg, file_name);
+
+  threads = g_hash_table_new (NULL, NULL);
+  fputs ("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", out);
+  for (i = beg; i < end; i++) {
+    BtTraceEvent *e = &ring[i & RING_MASK];
+    gint tid;
+
+    // skip slots that have been reserved but not filled
+    if (!e->name)
+      continue;
+    tid = get_thread_id (threads, out, pid, e->thread);
+    if (!first)
+      fputs (",\n", out);
+    first = FALSE;
+
+    fputs ("{\"name\":", out);
+    write_json_string (out, e->name);
+    fputs (",\"cat\":", out);
+    write_json_string (out, e->cat);
+    // chrome traces use micro seconds
+    fprintf (out, ",\"ph\":\"%c\",\"ts\":%.3lf,\"pid\":%d,\"tid\":%d",
+        (gchar) e->phase, (gdouble) (e->ts - trace_start) / 1000.0, pid, tid);
+    switch (e->phase) {
+      case BT_TRACE_PHASE_INSTANT:
+        fprintf (out, ",\"s\":\"t\",\"args\":{\"value\":%" G_GINT64_FORMAT
+            "}", e->value);
+        break;
+      case BT_TRACE_PHASE_COUNTER:
+        fprintf (out, ",\"args\":{\"value\":%" G_GINT64_FORMAT "}", e->value);
+        break;
+      default:
+        break;
+    }
+    fputc ('}', out);
+  }
+  fputs ("\n]}\n", out);
+  fclose (out);
+  g_hash_table_destroy (threads);
+}
+
+//-- public methods
+
+/**
+ * bt_trace_init:
+ * @file_name: where to write the trace to when the library is deinitialized
+ *
+ * Allocate the event buffer and start recording events.
+ */
+void
+bt_trace_init (const gchar * file_name)
+{
+  if (g_atomic_int_get (&bt_trace_enabled)) {
+    GST_INFO ("tracing already enabled");
+    return;
+  }
+  GST_INFO ("tracing to '%s'", file_name);
+  // the ring is kept from a previous run, see bt_trace_deinit()
+  if (!ring)
+    ring = g_new0 (BtTraceEvent, RING_SIZE);
+  else
+    memset (ring, 0, RING_SIZE * sizeof (BtTraceEvent));
+  g_atomic_int_set (&ring_pos, 0);
+  trace_file_name = g_strdup (file_name);
+  trace_start = gst_util_get_timestamp ();
+  g_atomic_int_set (&bt_trace_enabled, TRUE);
+}
+
+/**
+ * bt_trace_deinit:
+ *
+ * Stop recording and write the chrome trace. Does nothing if tracing is not
+ * enabled. The event buffer is not freed, as threads that have checked
+ * #bt_trace_enabled before it was cleared can still write to it.
+ */
+void
+bt_trace_deinit (void)
+{
+  if (!g_atomic_int_get (&bt_trace_enabled))
+    return;
+
+  g_atomic_int_set (&bt_trace_enabled, FALSE);
+  bt_trace_write (trace_file_name);
+  g_free (trace_file_name);
+  trace_file_name = NULL;
+}
+
+/**
+ * bt_trace_event:
+ * @phase: the event type
+ * @cat: the category as a static string
+ * @name: the event name, a static or interned string
+ * @value: a number for instant and counter events
+ *
+ * Records an event for the calling thread. This function is lock-free and
+ * can be called from real-time threads. Use the BT_TRACE_* macros instead of
+ * calling this directly.
+ */
+void
+bt_trace_event (BtTracePhase phase, const gchar * cat, const gchar * name,
+    gint64 value)
+{
+  BtTraceEvent *e;
+  guint ix;
+
+  if (G_UNLIKELY (!g_atomic_int_get (&bt_trace_enabled)))
+    return;
+
+  ix = (guint) g_atomic_int_add (&ring_pos, 1);
+  e = &ring[ix & RING_MASK];
+  e->ts = gst_util_get_timestamp ();
+  e->thread = g_thread_self ();
+  e->cat = cat;
+  e->value = value;
+  e->phase = phase;
+  e->name = name;
+}
@@ -0,0 +1,96 @@
+/* Buzztrax
+ * Copyright (C) 2017 Buzztrax team <buzztrax-devel@buzztrax.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BT_TRACE_H
+#define BT_TRACE_H
+
+#include <glib.h>
+
+/**
+ * BtTracePhase:
+ * @BT_TRACE_PHASE_BEGIN: start of a duration event
+ * @BT_TRACE_PHASE_END: end of a duration event
+ * @BT_TRACE_PHASE_INSTANT: a single point in time
+ * @BT_TRACE_PHASE_COUNTER: a value sample
+ *
+ * Event types, the values match the 'ph' field of the chrome trace format.
+ */
+typedef enum {
+  BT_TRACE_PHASE_BEGIN = 'B',
+  BT_TRACE_PHASE_END = 'E',
+  BT_TRACE_PHASE_INSTANT = 'i',
+  BT_TRACE_PHASE_COUNTER = 'C'
+} BtTracePhase;
+
+extern gboolean bt_trace_enabled;
+
+void bt_trace_init(const gchar *file_name);
+void bt_trace_deinit(void);
+void bt_trace_event(BtTracePhase phase, const gchar *cat, const gchar *name, gint64 value);
+
+/**
+ * BT_TRACE_BEGIN:
+ * @cat: the category as a static string
+ * @name: the event name, a static or interned string
+ *
+ * Records the start of an activity in the calling thread. Does nothing unless
+ * tracing has been enabled.
+ */
+#define BT_TRACE_BEGIN(cat,name) G_STMT_START { \
+  if (G_UNLIKELY (bt_trace_enabled))            \
+    bt_trace_event (BT_TRACE_PHASE_BEGIN, cat, name, 0); \
+} G_STMT_END
+
+/**
+ * BT_TRACE_END:
+ * @cat: the category as a static string
+ * @name: the event name, a static or interned string
+ *
+ * Records the end of an activity in the calling thread.
+ */
+#define BT_TRACE_END(cat,name) G_STMT_START { \
+  if (G_UNLIKELY (bt_trace_enabled))          \
+    bt_trace_event (BT_TRACE_PHASE_END, cat, name, 0); \
+} G_STMT_END
+
+/**
+ * BT_TRACE_INSTANT:
+ * @cat: the category as a static string
+ * @name: the event name, a static or interned string
+ * @value: a number to attach to the event
+ *
+ * Records a point in time in the calling thread.
+ */
+#define BT_TRACE_INSTANT(cat,name,value) G_STMT_START { \
+  if (G_UNLIKELY (bt_trace_enabled))                    \
+    bt_trace_event (BT_TRACE_PHASE_INSTANT, cat, name, value); \
+} G_STMT_END
+
+/**
+ * BT_TRACE_COUNTER:
+ * @cat: the category as a static string
+ * @name: the event name, a static or interned string
+ * @value: the current value
+ *
+ * Records a value that is shown as a graph in the trace viewer.
+ */
+#define BT_TRACE_COUNTER(cat,name,value) G_STMT_START { \
+  if (G_UNLIKELY (bt_trace_enabled))                    \
+    bt_trace_event (BT_TRACE_PHASE_COUNTER, cat, name, value); \
+} G_STMT_END
+
+#endif // BT_TRACE_H
@@ -230,31 +230,14 @@ bt_value_group_get_event_data (const BtValueGroup * const self,
   return bt_value_group_get_event_data_unchecked (self, tick, param);
 }
 
-/**
- * bt_value_group_set_event:
- * @self: the pattern the cell belongs to
- * @tick: the tick (time) position starting with 0
- * @param: the number of the  parameter starting with 0
- * @value: the string representation of the value to store
- *
- * Stores the supplied value into the specified pattern cell.
- *
- * Returns: %TRUE for success
- *
- * Since: 0.7
- */
-gboolean
-bt_value_group_set_event (const BtValueGroup * const self, const gulong tick,
+static gboolean
+bt_value_group_store_event (const BtValueGroup * const self, const gulong tick,
     const gulong param, const gchar * const value)
 {
   gboolean res = FALSE;
   GValue *event;
   GType type;
 
-  g_return_val_if_fail (BT_IS_VALUE_GROUP (self), FALSE);
-  g_return_val_if_fail (tick < self->priv->length, FALSE);
-  g_return_val_if_fail (param < self->priv->params, FALSE);
-
   type = bt_value_group_get_param_type (self, param);
   // plain value
   if (G_TYPE_IS_ENUM (type)) {
@@ -301,7 +284,33 @@ bt_value_group_set_event (const BtValueGroup * const self, const gulong tick,
     }
     res = TRUE;
   }
-  if (res) {
+  return res;
+}
+
+/**
+ * bt_value_group_set_event:
+ * @self: the pattern the cell belongs to
+ * @tick: the tick (time) position starting with 0
+ * @param: the number of the  parameter starting with 0
+ * @value: the string representation of the value to store
+ *
+ * Stores the supplied value into the specified pattern cell.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 0.7
+ */
+gboolean
+bt_value_group_set_event (const BtValueGroup * const self, const gulong tick,
+    const gulong param, const gchar * const value)
+{
+  gboolean res;
+
+  g_return_val_if_fail (BT_IS_VALUE_GROUP (self), FALSE);
+  g_return_val_if_fail (tick < self->priv->length, FALSE);
+  g_return_val_if_fail (param < self->priv->params, FALSE);
+
+  if ((res = bt_value_group_store_event (self, tick, param, value))) {
     // notify others that the data has been changed
     g_signal_emit ((gpointer) self, signals[PARAM_CHANGED_EVENT], 0,
         self->priv->param_group, tick, param);
@@ -309,6 +318,29 @@ bt_value_group_set_event (const BtValueGroup * const self, const gulong tick,
   return res;
 }
 
+/*
+ * bt_value_group_load_event:
+ * @self: the pattern the cell belongs to
+ * @tick: the tick (time) position starting with 0
+ * @param: the number of the  parameter starting with 0
+ * @value: the string representation of the value to store
+ *
+ * Parses the value from a song file straight into the cell storage. Unlike
+ * bt_value_group_set_event() this does not emit #BtValueGroup::param-changed,
+ * nobody is watching a value-group that is being loaded.
+ *
+ * Returns: %TRUE for success
+ */
+gboolean
+bt_value_group_load_event (const BtValueGroup * const self, const gulong tick,
+    const gulong param, const gchar * const value)
+{
+  if (G_UNLIKELY (tick >= self->priv->length || param >= self->priv->params))
+    return FALSE;
+
+  return bt_value_group_store_event (self, tick, param, value);
+}
+
 /**
  * bt_value_group_get_event:
  * @self: the pattern the cell belongs to
@@ -1222,6 +1254,7 @@ bt_value_group_serialize_columns (const BtValueGroup * const self,
  * @data: the source data
  *
  * Deserializes values to @start_tick to @end_tick for @param from @data.
+ * Emits #BtValueGroup::group-changed on success.
  *
  * Returns: %TRUE for success, %FALSE e.g. to indicate incompatible GType values
  * for the column specified by @param and the @data.
@@ -1267,6 +1300,8 @@ bt_value_group_deserialize_column (const BtValueGroup * const self,
       beg += params;
       i++;
     }
+    g_signal_emit ((gpointer) self, signals[GROUP_CHANGED_EVENT], 0,
+        self->priv->param_group, FALSE);
   } else {
     GST_INFO ("types don't match in %s <-> %s", fields[0], g_type_name (dtype));
     ret = FALSE;
@@ -1275,6 +1310,570 @@ bt_value_group_deserialize_column (const BtValueGroup * const self,
   return ret;
 }
 
+/* binary column packing helpers */
+
+static void
+_pack_varint (GByteArray * data, guint64 val)
+{
+  guint8 b;
+
+  do {
+    b = val & 0x7f;
+    val >>= 7;
+    if (val)
+      b |= 0x80;
+    g_byte_array_append (data, &b, 1);
+  } while (val);
+}
+
+static gboolean
+_unpack_varint (const guint8 ** data, const guint8 * end, guint64 * val)
+{
+  guint shift = 0;
+  guint8 b;
+
+  *val = 0;
+  while ((*data < end) && (shift < 64)) {
+    b = *(*data)++;
+    *val |= ((guint64) (b & 0x7f)) << shift;
+    if (!(b & 0x80))
+      return TRUE;
+    shift += 7;
+  }
+  return FALSE;
+}
+
+static gint64
+_get_int_value (const GValue * value, const GType base_type)
+{
+  switch (base_type) {
+    case G_TYPE_BOOLEAN:
+      return g_value_get_boolean (value);
+    case G_TYPE_ENUM:
+      return g_value_get_enum (value);
+    case G_TYPE_INT:
+      return g_value_get_int (value);
+    case G_TYPE_UINT:
+      return g_value_get_uint (value);
+    case G_TYPE_LONG:
+      return g_value_get_long (value);
+    case G_TYPE_ULONG:
+      return (gint64) g_value_get_ulong (value);
+    case G_TYPE_INT64:
+      return g_value_get_int64 (value);
+    case G_TYPE_UINT64:
+      return (gint64) g_value_get_uint64 (value);
+    default:
+      return 0;
+  }
+}
+
+static void
+_set_int_value (GValue * value, const GType base_type, const gint64 val)
+{
+  switch (base_type) {
+    case G_TYPE_BOOLEAN:
+      g_value_set_boolean (value, (gboolean) val);
+      break;
+    case G_TYPE_ENUM:
+      g_value_set_enum (value, (gint) val);
+      break;
+    case G_TYPE_INT:
+      g_value_set_int (value, (gint) val);
+      break;
+    case G_TYPE_UINT:
+      g_value_set_uint (value, (guint) val);
+      break;
+    case G_TYPE_LONG:
+      g_value_set_long (value, (glong) val);
+      break;
+    case G_TYPE_ULONG:
+      g_value_set_ulong (value, (gulong) val);
+      break;
+    case G_TYPE_INT64:
+      g_value_set_int64 (value, val);
+      break;
+    case G_TYPE_UINT64:
+      g_value_set_uint64 (value, (guint64) val);
+      break;
+    default:
+      break;
+  }
+}
+
+static void
+_pack_int (GByteArray * data, const gint64 val, gint64 * prev)
+{
+  // integers are stored as zig-zag encoded deltas to the previous value
+  const guint64 delta = (guint64) val - (guint64) * prev;
+
+  _pack_varint (data, (delta << 1) ^ (guint64) ((gint64) delta >> 63));
+  *prev = val;
+}
+
+static void
+_pack_value (GByteArray * data, const GValue * value, const GType base_type,
+    gint64 * prev)
+{
+  switch (base_type) {
+    case G_TYPE_DOUBLE:{
+      union
+      {
+        gdouble d;
+        guint64 i;
+      } v;
+      v.d = g_value_get_double (value);
+      v.i = GUINT64_TO_LE (v.i);
+      g_byte_array_append (data, (guint8 *) & v.i, sizeof (v.i));
+    } break;
+    case G_TYPE_FLOAT:{
+      union
+      {
+        gfloat f;
+        guint32 i;
+      } v;
+      v.f = g_value_get_float (value);
+      v.i = GUINT32_TO_LE (v.i);
+      g_byte_array_append (data, (guint8 *) & v.i, sizeof (v.i));
+    } break;
+    case G_TYPE_STRING:{
+      const gchar *str = g_value_get_string (value);
+      const gsize len = str ? strlen (str) : 0;
+      _pack_varint (data, len);
+      g_byte_array_append (data, (guint8 *) str, len);
+    } break;
+    default:
+      _pack_int (data, _get_int_value (value, base_type), prev);
+      break;
+  }
+}
+
+static gboolean
+_unpack_value (const guint8 ** data, const guint8 * end, GValue * value,
+    const GType base_type, gint64 * prev)
+{
+  guint64 val;
+
+  switch (base_type) {
+    case G_TYPE_DOUBLE:{
+      union
+      {
+        gdouble d;
+        guint64 i;
+      } v;
+      if ((gsize) (end - *data) < sizeof (v.i))
+        return FALSE;
+      memcpy (&v.i, *data, sizeof (v.i));
+      *data += sizeof (v.i);
+      v.i = GUINT64_FROM_LE (v.i);
+      g_value_set_double (value, v.d);
+    } break;
+    case G_TYPE_FLOAT:{
+      union
+      {
+        gfloat f;
+        guint32 i;
+      } v;
+      if ((gsize) (end - *data) < sizeof (v.i))
+        return FALSE;
+      memcpy (&v.i, *data, sizeof (v.i));
+      *data += sizeof (v.i);
+      v.i = GUINT32_FROM_LE (v.i);
+      g_value_set_float (value, v.f);
+    } break;
+    case G_TYPE_STRING:
+      if (!_unpack_varint (data, end, &val) || ((guint64) (end - *data) < val))
+        return FALSE;
+      g_value_take_string (value, g_strndup ((const gchar *) *data, val));
+      *data += val;
+      break;
+    default:
+      if (!_unpack_varint (data, end, &val))
+        return FALSE;
+      *prev = (gint64) ((guint64) * prev + ((val >> 1) ^ (~(val & 1) + 1)));
+      _set_int_value (value, base_type, *prev);
+      break;
+  }
+  return TRUE;
+}
+
+/* A packed column starts with one of these, followed by runs of: number of
+ * empty cells, number of cells, (for enums: 1 if the value is valid,) value */
+enum
+{
+  PACK_KIND_INT = 0,
+  PACK_KIND_ENUM,
+  PACK_KIND_DOUBLE,
+  PACK_KIND_FLOAT,
+  PACK_KIND_STRING,
+  PACK_KIND_COUNT
+};
+
+/* the types used to walk through the values when only checking the data */
+static const GType *
+_get_pack_kind_types (void)
+{
+  static GType types[PACK_KIND_COUNT] = { 0, };
+
+  if (G_UNLIKELY (!types[PACK_KIND_INT])) {
+    types[PACK_KIND_INT] = G_TYPE_INT64;
+    types[PACK_KIND_ENUM] = G_TYPE_INT64;
+    types[PACK_KIND_DOUBLE] = G_TYPE_DOUBLE;
+    types[PACK_KIND_FLOAT] = G_TYPE_FLOAT;
+    types[PACK_KIND_STRING] = G_TYPE_STRING;
+  }
+  return types;
+}
+
+static guint8
+_get_pack_kind (const GType type)
+{
+  if (G_TYPE_IS_ENUM (type))
+    return PACK_KIND_ENUM;
+  switch (bt_g_type_get_base_type (type)) {
+    case G_TYPE_DOUBLE:
+      return PACK_KIND_DOUBLE;
+    case G_TYPE_FLOAT:
+      return PACK_KIND_FLOAT;
+    case G_TYPE_STRING:
+      return PACK_KIND_STRING;
+    default:
+      return PACK_KIND_INT;
+  }
+}
+
+/* enum cells have a validated and a plain value, the plain value is kept
+ * for values that are not valid (yet), e.g. when a machine changed */
+static gboolean
+_get_enum_cell (const GValue * cell, const GValue * plain, guint64 * valid,
+    gint64 * val)
+{
+  if (BT_IS_GVALUE (cell)) {
+    *valid = 1;
+    *val = g_value_get_enum (cell);
+    return TRUE;
+  }
+  if (BT_IS_GVALUE (plain)) {
+    *valid = 0;
+    *val = g_value_get_int (plain);
+    return TRUE;
+  }
+  return FALSE;
+}
+
+static void
+_pack_enum_column (const BtValueGroup * const self, const gulong start_tick,
+    const gulong ticks, const gulong param, GByteArray * data)
+{
+  const gulong columns = self->priv->columns;
+  GValue *cells = &self->priv->data[start_tick * columns + param];
+  GValue *plains =
+      &self->priv->data[start_tick * columns + self->priv->params + param];
+  gulong tick = 0, gap = 0, run, ix;
+  guint64 valid, next_valid;
+  gint64 val, next_val, prev = 0;
+
+  while (tick < ticks) {
+    ix = tick * columns;
+    if (!_get_enum_cell (&cells[ix], &plains[ix], &valid, &val)) {
+      gap++;
+      tick++;
+      continue;
+    }
+    for (run = 1; tick + run < ticks; run++) {
+      ix = (tick + run) * columns;
+      if (!_get_enum_cell (&cells[ix], &plains[ix], &next_valid, &next_val)
+          || next_valid != valid || next_val != val)
+        break;
+    }
+    _pack_varint (data, gap);
+    _pack_varint (data, run);
+    _pack_varint (data, valid);
+    _pack_int (data, val, &prev);
+    tick += run;
+    gap = 0;
+  }
+}
+
+/*
+ * bt_value_group_check_packed_column:
+ * @data: the source data
+ * @size: the size of @data in bytes
+ * @length: the number of ticks the data has to fit in
+ *
+ * Walks through data from bt_value_group_pack_column() without storing it.
+ * This allows to check all pattern data of a song before anything is changed.
+ *
+ * Returns: %TRUE if the data is complete and fits into @length ticks.
+ */
+gboolean
+bt_value_group_check_packed_column (const guint8 * data, const gsize size,
+    const gulong length)
+{
+  const guint8 *end = data + size;
+  GValue value = { 0, };
+  guint64 gap, run, valid;
+  gulong tick = 0;
+  gint64 prev = 0;
+  guint8 kind;
+  gboolean res = FALSE;
+
+  // empty columns are not stored at all
+  if (!size)
+    return TRUE;
+  if ((kind = *data++) >= PACK_KIND_COUNT)
+    return FALSE;
+
+  g_value_init (&value, _get_pack_kind_types ()[kind]);
+  while (data < end) {
+    if (!_unpack_varint (&data, end, &gap) || !_unpack_varint (&data, end,
+            &run))
+      goto Error;
+    if (!run || (gap > length - tick) || (run > length - tick - gap))
+      goto Error;
+    if (kind == PACK_KIND_ENUM && (!_unpack_varint (&data, end, &valid)
+            || valid > 1))
+      goto Error;
+    if (!_unpack_value (&data, end, &value, G_VALUE_TYPE (&value), &prev))
+      goto Error;
+    tick += gap + run;
+  }
+  res = TRUE;
+Error:
+  g_value_unset (&value);
+  return res;
+}
+
+static void
+_pack_range (const BtValueGroup * const self, const gulong start_tick,
+    const gulong ticks, const gulong param, GByteArray * data)
+{
+  const gulong columns = self->priv->columns;
+  const GType type = bt_value_group_get_param_type (self, param);
+  const GType base_type = bt_g_type_get_base_type (type);
+  const guint8 kind = _get_pack_kind (type);
+  const guint start = data->len;
+  GValue *cells = &self->priv->data[start_tick * columns + param];
+  gulong tick = 0, gap = 0, run;
+  gint64 prev = 0;
+
+  g_byte_array_append (data, &kind, 1);
+  if (kind == PACK_KIND_ENUM) {
+    _pack_enum_column (self, start_tick, ticks, param, data);
+    tick = ticks;
+  }
+  while (tick < ticks) {
+    GValue *value = &cells[tick * columns];
+
+    if (!BT_IS_GVALUE (value)) {
+      gap++;
+      tick++;
+      continue;
+    }
+    for (run = 1; tick + run < ticks; run++) {
+      GValue *next = &cells[(tick + run) * columns];
+      if (!BT_IS_GVALUE (next)
+          || gst_value_compare (value, next) != GST_VALUE_EQUAL)
+        break;
+    }
+    _pack_varint (data, gap);
+    _pack_varint (data, run);
+    _pack_value (data, value, base_type, &prev);
+    tick += run;
+    gap = 0;
+  }
+  if (data->len == start + 1) {
+    g_byte_array_set_size (data, start);
+  }
+}
+
+static gboolean
+_unpack_range (const BtValueGroup * const self, const gulong start_tick,
+    const gulong ticks, const gulong param, const guint8 * data,
+    const gsize size)
+{
+  const guint8 *end = data + size;
+  const gulong columns = self->priv->columns;
+  const GType type = bt_value_group_get_param_type (self, param);
+  const GType base_type = bt_g_type_get_base_type (type);
+  const guint8 kind = _get_pack_kind (type);
+  GEnumClass *enum_class =
+      (kind == PACK_KIND_ENUM) ? g_type_class_peek_static (type) : NULL;
+  GValue value = { 0, };
+  GValue *cell;
+  guint64 gap, run, valid = 1;
+  gulong tick, i;
+  gint64 prev = 0;
+  gboolean is_valid;
+
+  if ((size && data[0] != kind)
+      || !bt_value_group_check_packed_column (data, size, ticks)) {
+    GST_WARNING_OBJECT (self, "packed data for param %lu is corrupt", param);
+    return FALSE;
+  }
+  // the data is fine, clear the range and restore the events
+  for (tick = start_tick; tick < start_tick + ticks; tick++) {
+    cell = &self->priv->data[tick * columns + param];
+    if (BT_IS_GVALUE (cell))
+      g_value_unset (cell);
+    if (enum_class) {
+      cell = &self->priv->data[tick * columns + self->priv->params + param];
+      if (BT_IS_GVALUE (cell))
+        g_value_unset (cell);
+    }
+  }
+  if (size)
+    data++;
+
+  g_value_init (&value, type);
+  tick = start_tick;
+  while (data < end) {
+    _unpack_varint (&data, end, &gap);
+    _unpack_varint (&data, end, &run);
+    if (enum_class)
+      _unpack_varint (&data, end, &valid);
+    _unpack_value (&data, end, &value, base_type, &prev);
+    tick += gap;
+
+    is_valid = valid && !bt_parameter_group_is_param_no_value
+        (self->priv->param_group, param, &value);
+    if (enum_class && !g_enum_get_value (enum_class, g_value_get_enum (&value)))
+      is_valid = FALSE;
+    for (i = 0; i < run; i++, tick++) {
+      if (enum_class) {
+        // restore the plain value
+        cell = &self->priv->data[tick * columns + self->priv->params + param];
+        g_value_init (cell, G_TYPE_INT);
+        g_value_set_int (cell, g_value_get_enum (&value));
+      }
+      if (is_valid) {
+        cell = &self->priv->data[tick * columns + param];
+        g_value_init (cell, type);
+        g_value_copy (&value, cell);
+      }
+    }
+  }
+  g_value_unset (&value);
+  g_signal_emit ((gpointer) self, signals[GROUP_CHANGED_EVENT], 0,
+      self->priv->param_group, FALSE);
+  return TRUE;
+}
+
+/**
+ * bt_value_group_pack_column:
+ * @self: the value group
+ * @param: the parameter
+ * @data: the target
+ *
+ * Appends the values of @param in a compact binary form to @data. Empty
+ * cells and repeated values are run-length encoded and integer values are
+ * stored as deltas. Enums keep the values that are not valid for the
+ * parameter. Nothing is appended for an empty column. Use
+ * bt_value_group_unpack_column() to restore them.
+ *
+ * Since: 0.12
+ */
+void
+bt_value_group_pack_column (const BtValueGroup * const self,
+    const gulong param, GByteArray * data)
+{
+  g_return_if_fail (BT_IS_VALUE_GROUP (self));
+  g_return_if_fail (param < self->priv->params);
+  g_return_if_fail (data);
+
+  _pack_range (self, 0, self->priv->length, param, data);
+}
+
+/**
+ * bt_value_group_pack_column_range:
+ * @self: the value group
+ * @start_tick: the start position for the range
+ * @end_tick: the end position for the range
+ * @param: the parameter
+ * @data: the target
+ *
+ * Like bt_value_group_pack_column(), but only packs the values from
+ * @start_tick to @end_tick. Use bt_value_group_unpack_column_range() with the
+ * same range to restore them.
+ *
+ * Since: 0.12
+ */
+void
+bt_value_group_pack_column_range (const BtValueGroup * const self,
+    const gulong start_tick, const gulong end_tick, const gulong param,
+    GByteArray * data)
+{
+  g_return_if_fail (BT_IS_VALUE_GROUP (self));
+  g_return_if_fail (start_tick <= end_tick);
+  g_return_if_fail (end_tick < self->priv->length);
+  g_return_if_fail (param < self->priv->params);
+  g_return_if_fail (data);
+
+  _pack_range (self, start_tick, (end_tick + 1) - start_tick, param, data);
+}
+
+/**
+ * bt_value_group_unpack_column:
+ * @self: the value group
+ * @param: the parameter
+ * @data: the source data
+ * @size: the size of @data in bytes
+ *
+ * Replaces the values of @param with @data, that has been created with
+ * bt_value_group_pack_column(). The values are not parsed from strings, which
+ * makes this a lot faster than bt_value_group_set_event() when loading songs.
+ * The data is checked completely before anything is changed, cells without
+ * an event in @data are cleared.
+ *
+ * Returns: %TRUE for success, %FALSE if @data is truncated, has been packed
+ * for another type or does not fit the length of the group.
+ *
+ * Since: 0.12
+ */
+gboolean
+bt_value_group_unpack_column (const BtValueGroup * const self,
+    const gulong param, const guint8 * data, const gsize size)
+{
+  g_return_val_if_fail (BT_IS_VALUE_GROUP (self), FALSE);
+  g_return_val_if_fail (param < self->priv->params, FALSE);
+  g_return_val_if_fail (data || !size, FALSE);
+
+  return _unpack_range (self, 0, self->priv->length, param, data, size);
+}
+
+/**
+ * bt_value_group_unpack_column_range:
+ * @self: the value group
+ * @start_tick: the start position for the range
+ * @end_tick: the end position for the range
+ * @param: the parameter
+ * @data: the source data
+ * @size: the size of @data in bytes
+ *
+ * Replaces the values of @param from @start_tick to @end_tick with @data, that
+ * has been created with bt_value_group_pack_column_range(). Values outside of
+ * the range are not changed.
+ *
+ * Returns: %TRUE for success, %FALSE if @data is truncated, has been packed
+ * for another type or does not fit the range.
+ *
+ * Since: 0.12
+ */
+gboolean
+bt_value_group_unpack_column_range (const BtValueGroup * const self,
+    const gulong start_tick, const gulong end_tick, const gulong param,
+    const guint8 * data, const gsize size)
+{
+  g_return_val_if_fail (BT_IS_VALUE_GROUP (self), FALSE);
+  g_return_val_if_fail (start_tick <= end_tick, FALSE);
+  g_return_val_if_fail (end_tick < self->priv->length, FALSE);
+  g_return_val_if_fail (param < self->priv->params, FALSE);
+  g_return_val_if_fail (data || !size, FALSE);
+
+  return _unpack_range (self, start_tick, (end_tick + 1) - start_tick, param,
+      data, size);
+}
+
 //-- g_object overrides
 
 static void
@@ -111,6 +111,11 @@ void bt_value_group_serialize_column(const BtValueGroup * const self, const gulo
 void bt_value_group_serialize_columns(const BtValueGroup * const self, const gulong start_tick, const gulong end_tick, GString *data);
 gboolean bt_value_group_deserialize_column(const BtValueGroup * const self, const gulong start_tick, const gulong end_tick, const gulong param, const gchar *data);
 
+void bt_value_group_pack_column(const BtValueGroup * const self, const gulong param, GByteArray *data);
+void bt_value_group_pack_column_range(const BtValueGroup * const self, const gulong start_tick, const gulong end_tick, const gulong param, GByteArray *data);
+gboolean bt_value_group_unpack_column(const BtValueGroup * const self, const gulong param, const guint8 *data, const gsize size);
+gboolean bt_value_group_unpack_column_range(const BtValueGroup * const self, const gulong start_tick, const gulong end_tick, const gulong param, const guint8 *data, const gsize size);
+
 GType bt_value_group_get_type(void) G_GNUC_CONST;
 
 #endif // BT_VALUE_GROUP_H
@@ -19,6 +19,19 @@
  * @short_description: one #BtWavetable entry that keeps a list of #BtWavelevels
  *
  * Represents one instrument. Contains one or more #BtWavelevels.
+ *
+ * The sample data is decoded once into a cache in the user cache dir, keyed by
+ * a hash of the source file. The #BtWavelevels map the cached data, thus
+ * reopening a song or using a sample in several songs does not decode again.
+ * Local files are first looked up by their path, size and modification time,
+ * the source is only hashed if that fails. The cache is kept below the size
+ * given by the #BtSettings property "wave-cache-size" by removing the least
+ * recently used entries.
+ *
+ * As the data is mapped, it is only read from disk when it is used. The
+ * #BtWavetable calls bt_wave_prefetch() when a wave gets used and
+ * bt_wave_evict() to release the memory of waves that have not been used for a
+ * while.
  */
 /* TODO(ensonic): save sample file length and/or md5sum in file:
  * - if we miss files, we can do a xsesame search and use the details to verify
@@ -56,11 +69,15 @@
 #define BT_CORE
 #define BT_WAVE_C
 
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include "core_private.h"
+#include <glib/gstdio.h>
 #include "song-io-native-bzt.h"
 #include "song-io-native.h"
 #include <gst/audio/audio.h>
@@ -79,6 +96,50 @@ enum
   WAVE_CHANNELS
 };
 
+/* decoded sample cache entries: this header followed by the samples as
+ * interleaved native endian S16. The entries are named after the hash of the
+ * source data plus ".raw". Local files get a symlink named after the hash of
+ * their path, size and mtime plus ".lnk" that points to the entry. */
+#define WAVE_CACHE_MAGIC "BTWC"
+#define WAVE_CACHE_VERSION 1
+#define WAVE_CACHE_BLOCK_SIZE (64 * 1024)
+
+typedef struct
+{
+  gchar magic[4];
+  guint32 version;
+  guint32 channels;
+  guint32 rate;
+  guint32 root_note;
+  guint32 reserved;
+  guint64 length;
+} BtWaveCacheHeader;
+
+/* the state of one wave decoder, the decoder only touches this and thus can
+ * run in a worker thread */
+typedef struct
+{
+  gchar *uri;
+  /* copy of the xml node of the wave to apply the wavelevel settings */
+  xmlNodePtr node;
+
+  /* the decoded data */
+  gboolean res;
+  GMappedFile *mapping;
+  /* the cache file of the mapping, NULL if it is not in the cache */
+  gchar *file;
+  /* the maximum size of the cache in bytes, 0 for no limit */
+  guint64 cache_size;
+  GstBtNote root_note;
+  gint channels, rate;
+  guint64 length;
+
+  /* signals the end of the decoding */
+  GMutex lock;
+  GCond cond;
+  gboolean done;
+} BtWaveLoader;
+
 struct _BtWavePrivate
 {
   /* used to validate if dispose has run */
@@ -100,11 +161,23 @@ struct _BtWavePrivate
   GList *wavelevels;            // each entry points to a BtWavelevel
 
   /* wave loader */
-  gint fd, ext_fd;
+  gint ext_fd;
+  /* pending background decode, see bt_wave_finish_loading() */
+  BtWaveLoader *loader;
+  /* if the mapped sample data has been paged in, see bt_wave_prefetch(); all
+   * users of the data touch the wave first and the wavetable does not evict
+   * waves that are in use, so the data is not paged in behind our back */
+  volatile gint resident;
+  /* if the sample data may have been changed in memory, see
+   * bt_wave_mark_modified() */
+  volatile gint modified;
 };
 
 static GQuark error_domain = 0;
 
+/* shared by all waves, bounded to the number of cpus */
+static GThreadPool *decode_pool = NULL;
+
 //-- the class
 
 static void bt_wave_persistence_interface_init (gpointer const g_iface,
@@ -143,10 +216,281 @@ wave_io_free (const BtWave * self)
     close (self->priv->ext_fd);
     self->priv->ext_fd = -1;
   }
-  if (self->priv->fd != -1) {
-    close (self->priv->fd);
-    self->priv->fd = -1;
+}
+
+static BtWaveLoader *
+bt_wave_loader_new (const gchar * const uri, xmlNodePtr node)
+{
+  BtWaveLoader *loader = g_slice_new0 (BtWaveLoader);
+  BtSettings *settings = bt_settings_make ();
+  guint cache_size;
+
+  // the decoders run in worker threads, read the settings here
+  g_object_get (settings, "wave-cache-size", &cache_size, NULL);
+  g_object_unref (settings);
+  loader->cache_size = (guint64) cache_size * 1024 * 1024;
+  loader->uri = g_strdup (uri);
+  loader->node = node;
+  loader->root_note = BT_WAVELEVEL_DEFAULT_ROOT_NOTE;
+  loader->channels = 1;
+  loader->rate = GST_AUDIO_DEF_RATE;
+  g_mutex_init (&loader->lock);
+  g_cond_init (&loader->cond);
+  return loader;
+}
+
+static void
+bt_wave_loader_free (BtWaveLoader * loader)
+{
+  if (loader->mapping)
+    g_mapped_file_unref (loader->mapping);
+  if (loader->node)
+    xmlFreeNode (loader->node);
+  g_mutex_clear (&loader->lock);
+  g_cond_clear (&loader->cond);
+  g_free (loader->file);
+  g_free (loader->uri);
+  g_slice_free (BtWaveLoader, loader);
+}
+
+static void
+bt_wave_loader_wait (BtWaveLoader * loader)
+{
+  g_mutex_lock (&loader->lock);
+  while (!loader->done)
+    g_cond_wait (&loader->cond, &loader->lock);
+  g_mutex_unlock (&loader->lock);
+}
+
+/* the decoded sample cache lives in the user cache dir, which is on a local
+ * disk, therefore we can map the files without worrying about removable
+ * drives */
+static const gchar *
+bt_wave_cache_get_dir (void)
+{
+  static gsize init = 0;
+  static gchar *cache_dir = NULL;
+
+  if (g_once_init_enter (&init)) {
+    gchar *dir = g_build_filename (g_get_user_cache_dir (), PACKAGE, "waves",
+        NULL);
+
+    if (g_mkdir_with_parents (dir, S_IRUSR | S_IWUSR | S_IXUSR) == -1) {
+      GST_WARNING ("Can't create wave cache dir: '%s': %s", dir,
+          g_strerror (errno));
+      g_free (dir);
+    } else {
+      cache_dir = dir;
+    }
+    g_once_init_leave (&init, 1);
+  }
+  return cache_dir;
+}
+
+/* hash the path, size and modification time of a local source file, returns
+ * %NULL for other sources */
+static gchar *
+bt_wave_cache_make_stat_key (const gchar * const uri)
+{
+  GChecksum *csum;
+  GStatBuf buf;
+  gchar *path, *key = NULL;
+  guint32 version = WAVE_CACHE_VERSION;
+  gint64 vals[5];
+
+  if (!g_str_has_prefix (uri, "file://"))
+    return NULL;
+  if (!(path = g_filename_from_uri (uri, NULL, NULL)))
+    return NULL;
+  if (!g_stat (path, &buf)) {
+    vals[0] = buf.st_dev;
+    vals[1] = buf.st_ino;
+    vals[2] = buf.st_size;
+    vals[3] = buf.st_mtim.tv_sec;
+    vals[4] = buf.st_mtim.tv_nsec;
+
+    csum = g_checksum_new (G_CHECKSUM_SHA256);
+    g_checksum_update (csum, (const guchar *) WAVE_CACHE_MAGIC, 4);
+    g_checksum_update (csum, (const guchar *) &version, sizeof (version));
+    g_checksum_update (csum, (const guchar *) path, strlen (path));
+    g_checksum_update (csum, (const guchar *) vals, sizeof (vals));
+    key = g_strdup (g_checksum_get_string (csum));
+    g_checksum_free (csum);
+  }
+  g_free (path);
+  return key;
+}
+
+typedef struct
+{
+  gchar *path;
+  guint64 size;
+  gint64 mtime;
+} BtWaveCacheEntry;
+
+static gint
+bt_wave_cache_entry_cmp (gconstpointer a, gconstpointer b)
+{
+  const BtWaveCacheEntry *ea = a, *eb = b;
+
+  return (ea->mtime > eb->mtime) - (ea->mtime < eb->mtime);
+}
+
+static void
+bt_wave_cache_entry_clear (gpointer data)
+{
+  g_free (((BtWaveCacheEntry *) data)->path);
+}
+
+/* remove the least recently used entries until the cache is below @max_size,
+ * hits update the mtime of the entries, see bt_wave_decode() */
+static void
+bt_wave_cache_trim (const gchar * const cache_dir, guint64 max_size,
+    const gchar * const keep)
+{
+  static GMutex lock;
+  GDir *dir;
+  GArray *entries;
+  const gchar *name;
+  GStatBuf buf;
+  guint64 size = 0;
+  guint i;
+
+  if (!max_size || !(dir = g_dir_open (cache_dir, 0, NULL)))
+    return;
+
+  g_mutex_lock (&lock);
+  entries = g_array_new (FALSE, FALSE, sizeof (BtWaveCacheEntry));
+  g_array_set_clear_func (entries, bt_wave_cache_entry_clear);
+  while ((name = g_dir_read_name (dir))) {
+    if (g_str_has_suffix (name, ".raw")) {
+      BtWaveCacheEntry entry;
+
+      entry.path = g_build_filename (cache_dir, name, NULL);
+      if (g_stat (entry.path, &buf)) {
+        g_free (entry.path);
+        continue;
+      }
+      entry.size = buf.st_size;
+      entry.mtime = buf.st_mtime;
+      size += entry.size;
+      g_array_append_val (entries, entry);
+    }
+  }
+  if (size > max_size) {
+    g_array_sort (entries, bt_wave_cache_entry_cmp);
+    for (i = 0; i < entries->len && size > max_size; i++) {
+      BtWaveCacheEntry *entry = &g_array_index (entries, BtWaveCacheEntry, i);
+
+      if (keep && !strcmp (entry->path, keep))
+        continue;
+      // waves that use the entry keep their mapping
+      if (!g_unlink (entry->path)) {
+        GST_INFO ("removed %s from the wave cache", entry->path);
+        size -= entry->size;
+      }
+    }
+    // drop the links to removed entries
+    g_dir_rewind (dir);
+    while ((name = g_dir_read_name (dir))) {
+      if (g_str_has_suffix (name, ".lnk")) {
+        gchar *path = g_build_filename (cache_dir, name, NULL);
+
+        if (g_stat (path, &buf))
+          g_unlink (path);
+        g_free (path);
+      }
+    }
+  }
+  g_array_free (entries, TRUE);
+  g_mutex_unlock (&lock);
+  g_dir_close (dir);
+}
+
+/* hash the encoded source data, returns %NULL if we can't read the source
+ * directly */
+static gchar *
+bt_wave_cache_make_key (const gchar * const uri)
+{
+  GChecksum *csum;
+  gchar *key = NULL;
+  guint8 *buf;
+  gint fd = -1;
+  gboolean own_fd = FALSE;
+  gssize bytes;
+  off_t pos = 0;
+  guint32 version = WAVE_CACHE_VERSION;
+
+  if (g_str_has_prefix (uri, "fd://")) {
+    fd = atoi (&uri[5]);
+  } else if (g_str_has_prefix (uri, "file://")) {
+    gchar *path = g_filename_from_uri (uri, NULL, NULL);
+
+    if (path) {
+      fd = open (path, O_RDONLY);
+      own_fd = TRUE;
+      g_free (path);
+    }
+  }
+  if (fd == -1)
+    return NULL;
+
+  csum = g_checksum_new (G_CHECKSUM_SHA256);
+  // the format of the cache entries is part of the key
+  g_checksum_update (csum, (const guchar *) WAVE_CACHE_MAGIC, 4);
+  g_checksum_update (csum, (const guchar *) &version, sizeof (version));
+  buf = g_malloc (WAVE_CACHE_BLOCK_SIZE);
+  // use pread() to not move the file offset of the fd:// sources
+  while ((bytes = pread (fd, buf, WAVE_CACHE_BLOCK_SIZE, pos)) > 0) {
+    g_checksum_update (csum, buf, bytes);
+    pos += bytes;
+  }
+  if (bytes == 0) {
+    key = g_strdup (g_checksum_get_string (csum));
+  } else {
+    GST_WARNING ("can't read %s: %s", uri, g_strerror (errno));
+  }
+  g_free (buf);
+  g_checksum_free (csum);
+  if (own_fd)
+    close (fd);
+  return key;
+}
+
+/* map a cache entry and read the sample format from its header */
+static gboolean
+bt_wave_cache_map (BtWaveLoader * loader, gint fd)
+{
+  GMappedFile *mapping;
+  const BtWaveCacheHeader *header;
+  gsize size;
+  GError *err = NULL;
+
+  // writable gives us a private copy-on-write mapping
+  if (!(mapping = g_mapped_file_new_from_fd (fd, TRUE, &err))) {
+    GST_WARNING ("can't map decoded sample: %s", err->message);
+    g_error_free (err);
+    return FALSE;
+  }
+  size = g_mapped_file_get_length (mapping);
+  header = (const BtWaveCacheHeader *) g_mapped_file_get_contents (mapping);
+  if (size < sizeof (BtWaveCacheHeader)
+      || memcmp (header->magic, WAVE_CACHE_MAGIC, 4)
+      || header->version != WAVE_CACHE_VERSION
+      || header->channels < 1 || header->channels > 2 || !header->rate
+      || !header->length
+      || header->length > (size - sizeof (BtWaveCacheHeader)) /
+      (header->channels * sizeof (gint16))) {
+    GST_WARNING ("invalid decoded sample (%" G_GSIZE_FORMAT " bytes)", size);
+    g_mapped_file_unref (mapping);
+    return FALSE;
   }
+  loader->channels = header->channels;
+  loader->rate = header->rate;
+  loader->root_note = header->root_note;
+  loader->length = header->length;
+  loader->mapping = mapping;
+  return TRUE;
 }
 
 static void
@@ -159,16 +503,16 @@ on_wave_loader_new_pad (GstElement * bin, GstPad * pad, gpointer user_data)
 }
 
 /*
- * bt_wave_load_from_uri:
- * @self: the wave to load
- * @uri: the location to load from
+ * bt_wave_decode_to_fd:
+ * @loader: the loader to fill
+ * @fd: the file to write the header and the raw samples to
  *
- * Load the wavedata from the @uri.
+ * Run the decoder pipeline for the uri of the @loader.
  *
- * Returns: %TRUE if the wavedata could be loaded
+ * Returns: %TRUE if the wavedata could be decoded
  */
 static gboolean
-bt_wave_load_from_uri (const BtWave * const self, const gchar * const uri)
+bt_wave_decode_to_fd (BtWaveLoader * loader, gint fd)
 {
   gboolean res = TRUE, done = FALSE;
   GstElement *pipeline;
@@ -176,18 +520,20 @@ bt_wave_load_from_uri (const BtWave * const self, const gchar * const uri)
   GstBus *bus = NULL;
   GstCaps *caps;
   GstMessage *msg;
-  GstBtNote root_note = BT_WAVELEVEL_DEFAULT_ROOT_NOTE;
+  BtWaveCacheHeader header = { WAVE_CACHE_MAGIC, WAVE_CACHE_VERSION, };
 
-  GST_INFO ("about to load sample %s / %s", self->priv->uri, uri);
-  // this leaks!
-  //GST_INFO("current dir is %s", g_get_current_dir());
+  // reserve space for the header, fdsink appends to the current position
+  if (write (fd, &header, sizeof (header)) != sizeof (header)) {
+    GST_WARNING ("Can't write to tempfile: %s", g_strerror (errno));
+    return FALSE;
+  }
 
   // check if the url is valid
   // if(!uri) goto invalid_uri;
 
   // create loader pipeline
   pipeline = gst_pipeline_new ("wave-loader");
-  src = gst_element_make_from_uri (GST_URI_SRC, uri, NULL, NULL);
+  src = gst_element_make_from_uri (GST_URI_SRC, loader->uri, NULL, NULL);
   dec = gst_element_factory_make ("decodebin", NULL);
   conv = gst_element_factory_make ("audioconvert", NULL);
   fmt = gst_element_factory_make ("capsfilter", NULL);
@@ -201,13 +547,7 @@ bt_wave_load_from_uri (const BtWave * const self, const gchar * const uri)
       "channels", GST_TYPE_INT_RANGE, 1, 2, NULL);
   g_object_set (fmt, "caps", caps, NULL);
   gst_caps_unref (caps);
-
-  if ((self->priv->fd = g_file_open_tmp (NULL, NULL, NULL)) == -1) {
-    res = FALSE;
-    GST_WARNING ("Can't create tempfile.");
-    goto Error;
-  }
-  g_object_set (sink, "fd", self->priv->fd, "sync", FALSE, NULL);
+  g_object_set (sink, "fd", fd, "sync", FALSE, NULL);
 
   // add and link
   gst_bin_add_many (GST_BIN (pipeline), src, dec, conv, fmt, sink, NULL);
@@ -227,7 +567,6 @@ bt_wave_load_from_uri (const BtWave * const self, const gchar * const uri)
       (gpointer) conv);
 
   /* TODO(ensonic): during loading wave-data (into wavelevels)
-   * - use statusbar for loader progress ("status" property like in song_io)
    * - should we do some size checks to avoid unpacking the audio track of a full
    *   video on a machine with low memory
    *   - if so, how to get real/virtual memory sizes?
@@ -240,8 +579,7 @@ bt_wave_load_from_uri (const BtWave * const self, const gchar * const uri)
   if (gst_element_set_state (pipeline,
           GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
     GST_WARNING_OBJECT (pipeline,
-        "Can't set wave loader pipeline for %s / %s to playing",
-        self->priv->uri, uri);
+        "Can't set wave loader pipeline for %s to playing", loader->uri);
     gst_element_set_state (pipeline, GST_STATE_NULL);
     res = FALSE;
     goto Error;
@@ -249,8 +587,8 @@ bt_wave_load_from_uri (const BtWave * const self, const gchar * const uri)
     GST_INFO_OBJECT (pipeline, "loading sample ...");
   }
 
-  /* load wave in sync mode, loading them async causes troubles in the
-   * persistence code and makes testing complicated */
+  /* the decoding itself is sync, the song loader runs several decoders in
+   * parallel on the decode_pool */
   while (!done) {
     msg = gst_bus_poll (bus,
         GST_MESSAGE_EOS | GST_MESSAGE_ERROR | GST_MESSAGE_TAG,
@@ -280,10 +618,10 @@ bt_wave_load_from_uri (const BtWave * const self, const gchar * const uri)
           gint octave = base_note / 12;
           gint tone = base_note - (octave * 12);
 
-          root_note = GSTBT_NOTE_C_0 + (octave * 16) + tone;
+          loader->root_note = GSTBT_NOTE_C_0 + (octave * 16) + tone;
           GST_INFO_OBJECT (GST_MESSAGE_SRC (msg),
-              "root_note: %d (base_note: %u = oct: %d + tone: %d", root_note,
-              base_note, octave, tone);
+              "root_note: %d (base_note: %u = oct: %d + tone: %d",
+              loader->root_note, base_note, octave, tone);
         }
 #endif
         gst_tag_list_unref (tags);
@@ -297,28 +635,19 @@ bt_wave_load_from_uri (const BtWave * const self, const gchar * const uri)
 
   if (res) {
     GstPad *pad;
-    gint64 duration;
-    guint64 length = 0;
-    gint channels = 1, rate = GST_AUDIO_DEF_RATE;
-    gpointer data = NULL;
     struct stat buf;
 
     res = FALSE;
     GST_INFO ("sample loaded");
 
-    // query length and convert to samples
-    if (!gst_element_query_duration (pipeline, GST_FORMAT_TIME, &duration)) {
-      GST_WARNING ("getting sample duration failed");
-    }
     // get caps for sample rate and channels
     if ((pad = gst_element_get_static_pad (fmt, "src"))) {
       GstCaps *caps = gst_pad_get_current_caps (pad);
       if (caps && GST_CAPS_IS_SIMPLE (caps)) {
         GstStructure *structure = gst_caps_get_structure (caps, 0);
 
-        gst_structure_get_int (structure, "channels", &channels);
-        gst_structure_get_int (structure, "rate", &rate);
-        length = gst_util_uint64_scale (duration, (guint64) rate, GST_SECOND);
+        gst_structure_get_int (structure, "channels", &loader->channels);
+        gst_structure_get_int (structure, "rate", &loader->rate);
       } else {
         GST_WARNING ("No caps or format has not been fixed.");
       }
@@ -327,34 +656,19 @@ bt_wave_load_from_uri (const BtWave * const self, const gchar * const uri)
       gst_object_unref (pad);
     }
 
-    GST_INFO ("sample decoded: channels=%d, rate=%d, length=%" GST_TIME_FORMAT,
-        channels, rate, GST_TIME_ARGS (duration));
-
-    if (!(fstat (self->priv->fd, &buf))) {
-      if (lseek (self->priv->fd, 0, SEEK_SET) == 0) {
-        if ((data = g_try_malloc (buf.st_size))) {
-          /* mmap is unsave for removable drives :(
-           * gpointer data=mmap(void *start, buf->st_size, PROT_READ, MAP_SHARED, self->priv->fd, 0);
-           */
-          BtWavelevel *wavelevel;
-          ssize_t bytes = read (self->priv->fd, data, buf.st_size);
-
-          self->priv->channels = channels;
-          g_object_notify (G_OBJECT (self), "channels");
-
-          wavelevel = bt_wavelevel_new (self->priv->song, self, root_note,
-              (gulong) length, 0, length, rate, (gconstpointer) data);
-          g_object_unref (wavelevel);
-          GST_INFO ("sample loaded (%" G_GSSIZE_FORMAT "/%ld bytes)", bytes,
-              buf.st_size);
-          res = TRUE;
-        } else {
-          GST_WARNING
-              ("sample is too long or empty (%ld bytes), not trying to load",
-              buf.st_size);
-        }
+    // the length in samples follows from the size of the decoded data
+    if (!(fstat (fd, &buf))) {
+      header.channels = loader->channels;
+      header.rate = loader->rate;
+      header.root_note = loader->root_note;
+      header.length = (buf.st_size - sizeof (header)) /
+          (loader->channels * sizeof (gint16));
+      GST_INFO ("sample decoded: channels=%d, rate=%d, length=%"
+          G_GUINT64_FORMAT, loader->channels, loader->rate, header.length);
+      if (pwrite (fd, &header, sizeof (header), 0) == sizeof (header)) {
+        res = TRUE;
       } else {
-        GST_WARNING ("can't seek to start of sample data");
+        GST_WARNING ("can't write header of sample data");
       }
     } else {
       GST_WARNING ("can't stat() sample");
@@ -368,11 +682,263 @@ Error:
     gst_element_set_state (pipeline, GST_STATE_NULL);
     gst_object_unref (pipeline);
   }
+  return res;
+}
+
+/*
+ * bt_wave_decode:
+ * @loader: the loader to fill
+ *
+ * Decode the wavedata from the uri of the @loader into the decoded sample
+ * cache and map it. If the cache already has the sample, this only maps the
+ * file. Sources that we can't hash are decoded into an unlinked tempfile. This
+ * only touches the @loader and thus can run in a worker thread.
+ *
+ * Returns: %TRUE if the wavedata could be decoded
+ */
+static gboolean
+bt_wave_decode (BtWaveLoader * loader)
+{
+  const gchar *cache_dir = bt_wave_cache_get_dir ();
+  gchar *stat_key = NULL, *key = NULL;
+  gchar *link_path = NULL, *path = NULL, *tmp_path = NULL;
+  gint fd = -1;
+
+  GST_INFO ("about to decode sample %s", loader->uri);
+
+  if (cache_dir && (stat_key = bt_wave_cache_make_stat_key (loader->uri))) {
+    gchar *name = g_strconcat (stat_key, ".lnk", NULL);
+    gchar *target;
+
+    link_path = g_build_filename (cache_dir, name, NULL);
+    g_free (name);
+    // unchanged local files are found without reading them
+    if ((target = g_file_read_link (link_path, NULL))) {
+      path = g_build_filename (cache_dir, target, NULL);
+      g_free (target);
+      if ((fd = open (path, O_RDWR)) != -1) {
+        loader->res = bt_wave_cache_map (loader, fd);
+        close (fd);
+        fd = -1;
+      }
+      if (loader->res) {
+        GST_INFO ("sample %s is cached as %s", loader->uri, path);
+        g_utime (path, NULL);
+        loader->file = path;
+        path = NULL;
+        goto Done;
+      }
+      g_unlink (link_path);
+      g_free (path);
+      path = NULL;
+    }
+  }
+
+  if (cache_dir && (key = bt_wave_cache_make_key (loader->uri))) {
+    gchar *name = g_strconcat (key, ".raw", NULL);
+
+    path = g_build_filename (cache_dir, name, NULL);
+    g_free (name);
+    if ((fd = open (path, O_RDWR)) != -1) {
+      loader->res = bt_wave_cache_map (loader, fd);
+      close (fd);
+      fd = -1;
+      if (loader->res) {
+        GST_INFO ("sample %s is cached as %s", loader->uri, key);
+        g_utime (path, NULL);
+        loader->file = path;
+        path = NULL;
+        goto Link;
+      }
+      unlink (path);
+    }
+    tmp_path = g_strconcat (path, ".XXXXXX", NULL);
+    fd = g_mkstemp (tmp_path);
+  } else {
+    fd = g_file_open_tmp (NULL, &tmp_path, NULL);
+  }
+  if (fd == -1) {
+    GST_WARNING ("Can't create tempfile.");
+    goto Done;
+  }
+
+  if ((loader->res = bt_wave_decode_to_fd (loader, fd))) {
+    loader->res = bt_wave_cache_map (loader, fd);
+  }
+  close (fd);
+  // the content addressed name makes the rename safe against other writers
+  if (!loader->res || !path || rename (tmp_path, path)) {
+    unlink (tmp_path);
+  } else {
+    loader->file = path;
+    path = NULL;
+    bt_wave_cache_trim (cache_dir, loader->cache_size, loader->file);
+  }
+
+Link:
+  if (loader->file && link_path) {
+    gchar *target = g_path_get_basename (loader->file);
+
+    g_unlink (link_path);
+    if (symlink (target, link_path)) {
+      GST_INFO ("can't link %s: %s", link_path, g_strerror (errno));
+    }
+    g_free (target);
+  }
+
+Done:
+  g_free (tmp_path);
+  g_free (path);
+  g_free (link_path);
+  g_free (key);
+  g_free (stat_key);
+  return loader->res;
+}
+
+static void
+bt_wave_decode_func (gpointer data, gpointer user_data)
+{
+  BtWaveLoader *loader = (BtWaveLoader *) data;
+
+  bt_wave_decode (loader);
+
+  g_mutex_lock (&loader->lock);
+  loader->done = TRUE;
+  g_cond_signal (&loader->cond);
+  g_mutex_unlock (&loader->lock);
+}
+
+/*
+ * bt_wave_apply_decoded:
+ * @self: the wave to load
+ * @loader: the decoded wavedata
+ *
+ * Take over the decoded data from the @loader and create the wavelevel. Needs
+ * to run in the main thread.
+ *
+ * Returns: %TRUE if the wavedata could be decoded
+ */
+static gboolean
+bt_wave_apply_decoded (const BtWave * const self, BtWaveLoader * loader)
+{
+  BtWavelevel *wavelevel;
+  const gchar *data;
+
+  if (!loader->res)
+    return FALSE;
+
+  self->priv->channels = loader->channels;
+  g_object_notify (G_OBJECT (self), "channels");
+
+  // the wavelevel keeps the mapping alive
+  data = g_mapped_file_get_contents (loader->mapping);
+  wavelevel = bt_wavelevel_new (self->priv->song, self, loader->root_note,
+      (gulong) loader->length, 0, loader->length, loader->rate, NULL);
+  g_object_set (wavelevel, "mapped-file", loader->mapping,
+      "data-file", loader->file,
+      "data", (gpointer) (data + sizeof (BtWaveCacheHeader)), NULL);
+  g_object_unref (wavelevel);
+  return TRUE;
+}
+
+/*
+ * bt_wave_load_from_uri:
+ * @self: the wave to load
+ * @uri: the location to load from
+ *
+ * Load the wavedata from the @uri.
+ *
+ * Returns: %TRUE if the wavedata could be loaded
+ */
+static gboolean
+bt_wave_load_from_uri (const BtWave * const self, const gchar * const uri)
+{
+  BtWaveLoader *loader = bt_wave_loader_new (uri, NULL);
+  gboolean res;
+
+  GST_INFO ("about to load sample %s / %s", self->priv->uri, uri);
+
+  bt_wave_decode (loader);
+  res = bt_wave_apply_decoded (self, loader);
+  bt_wave_loader_free (loader);
   if (!res)
     wave_io_free (self);
   return res;
 }
 
+/*
+ * bt_wave_load_from_uri_async:
+ * @self: the wave to load
+ * @uri: the location to load from
+ * @node: a copy of the xml node of the wave, will be freed
+ *
+ * Start decoding the wavedata from the @uri on the decode_pool. The data is
+ * applied in bt_wave_finish_loading().
+ *
+ * Returns: %TRUE if the decoder could be started
+ */
+static gboolean
+bt_wave_load_from_uri_async (const BtWave * const self,
+    const gchar * const uri, xmlNodePtr node)
+{
+  BtWaveLoader *loader;
+
+  if (!decode_pool) {
+    GError *err = NULL;
+
+    // the pool is only created and used from the main thread
+    if (!(decode_pool = g_thread_pool_new (bt_wave_decode_func, NULL,
+                g_get_num_processors (), FALSE, &err))) {
+      GST_WARNING ("Can't create wave decoder pool: %s", err->message);
+      g_error_free (err);
+      xmlFreeNode (node);
+      return FALSE;
+    }
+  }
+
+  GST_INFO ("about to queue sample %s / %s", self->priv->uri, uri);
+  loader = bt_wave_loader_new (uri, node);
+  if (!g_thread_pool_push (decode_pool, loader, NULL)) {
+    bt_wave_loader_free (loader);
+    return FALSE;
+  }
+  self->priv->loader = loader;
+  return TRUE;
+}
+
+
+static void
+bt_wave_load_wavelevels (const BtWave * const self, xmlNodePtr node)
+{
+  GList *lnode = self->priv->wavelevels;
+  xmlNodePtr child_node;
+
+  GST_INFO ("loading wavelevels : %p", lnode);
+
+  for (node = node->children; node; node = node->next) {
+    if ((!xmlNodeIsText (node))
+        && (!strncmp ((gchar *) node->name, "wavelevels\0", 11))) {
+      for (child_node = node->children; child_node;
+          child_node = child_node->next) {
+        if ((!xmlNodeIsText (child_node))
+            && (!strncmp ((gchar *) child_node->name, "wavelevel\0", 10))) {
+          /* loading the wave might have already created wave-levels,
+           * here we just want to override e.g. loop, sampling-rate
+           */
+          if (lnode) {
+            BtWavelevel *const wave_level = BT_WAVELEVEL (lnode->data);
+
+            bt_persistence_load (BT_TYPE_WAVELEVEL,
+                BT_PERSISTENCE (wave_level), child_node, NULL, NULL);
+            lnode = g_list_next (lnode);
+          } else {
+            GST_WARNING ("no wavelevel");
+          }
+        }
+      }
+    }
+  }
+}
 
 /* bt_wave_save_to_fd:
  *
@@ -527,6 +1093,37 @@ bt_wave_save_from_fd (const BtWave * const self, BtSongIONative * song_io,
 }
 
 
+/* call madvise() on the mapped sample data of all wavelevels, returns the size
+ * of the mapped data */
+static guint64
+bt_wave_advise_mapped_data (const BtWave * const self, const gint advice)
+{
+  const GList *node;
+  const guintptr page_mask = (guintptr) sysconf (_SC_PAGESIZE) - 1;
+  guint64 size = 0;
+
+  for (node = self->priv->wavelevels; node; node = g_list_next (node)) {
+    GMappedFile *mapping;
+    guint8 *data, *start;
+    gulong length;
+    gsize len;
+
+    g_object_get (node->data, "mapped-file", &mapping, "data", &data,
+        "length", &length, NULL);
+    if (!mapping)
+      continue;
+
+    len = self->priv->channels * length * sizeof (gint16);
+    start = (guint8 *) ((guintptr) data & ~page_mask);
+    if (len && madvise (start, len + (data - start), advice)) {
+      GST_WARNING ("madvise failed: %s", g_strerror (errno));
+    }
+    size += len;
+    g_mapped_file_unref (mapping);
+  }
+  return size;
+}
+
 //-- constructor methods
 
 /**
@@ -611,6 +1208,164 @@ bt_wave_get_level_by_index (const BtWave * const self, const gulong index)
   return NULL;
 }
 
+/**
+ * bt_wave_finish_loading:
+ * @self: the wave
+ * @err: where to store the error message in case of an error, or %NULL
+ *
+ * When loading a song, the sample data of the waves is decoded in the
+ * background. This waits for the decoder of this wave and creates the
+ * wavelevels. Does nothing if the wave has no pending decoder.
+ * bt_song_io_load() calls this for all waves of the song.
+ *
+ * Returns: %TRUE for success, %FALSE if the sample data could not be loaded
+ *
+ * Since: 0.12
+ */
+gboolean
+bt_wave_finish_loading (const BtWave * const self, GError ** err)
+{
+  BtWaveLoader *loader;
+  gboolean res;
+
+  g_return_val_if_fail (BT_IS_WAVE (self), FALSE);
+
+  if (!(loader = self->priv->loader))
+    return TRUE;
+  self->priv->loader = NULL;
+
+  bt_wave_loader_wait (loader);
+  if ((res = bt_wave_apply_decoded (self, loader))) {
+    bt_wave_load_wavelevels (self, loader->node);
+  } else {
+    wave_io_free (self);
+    GST_WARNING ("Failed to load wave %lu, uri='%s'", self->priv->index,
+        loader->uri);
+    if (err) {
+      g_set_error (err, error_domain, /* errorcode= */ 0,
+          "Failed to load wave %lu, uri='%s'", self->priv->index, loader->uri);
+    }
+  }
+  bt_wave_loader_free (loader);
+  return res;
+}
+
+/**
+ * bt_wave_get_memory_usage:
+ * @self: the wave
+ * @resident: (out) (optional): location for the size of the sample data in
+ * memory or %NULL
+ * @on_disk: (out) (optional): location for the size of the sample data that is
+ * mapped from the sample cache or %NULL
+ *
+ * Get the size of the sample data of all wavelevels in bytes. Data that is not
+ * mapped from the sample cache is always resident.
+ *
+ * Since: 0.12
+ */
+void
+bt_wave_get_memory_usage (const BtWave * const self, guint64 * resident,
+    guint64 * on_disk)
+{
+  const GList *node;
+  guint64 mem_size = 0, disk_size = 0;
+  gboolean is_resident;
+
+  g_return_if_fail (BT_IS_WAVE (self));
+
+  is_resident = g_atomic_int_get (&self->priv->resident);
+  for (node = self->priv->wavelevels; node; node = g_list_next (node)) {
+    GMappedFile *mapping;
+    gulong length;
+    guint64 size;
+
+    g_object_get (node->data, "mapped-file", &mapping, "length", &length,
+        NULL);
+    size = self->priv->channels * length * sizeof (gint16);
+    if (mapping) {
+      disk_size += size;
+      if (is_resident)
+        mem_size += size;
+      g_mapped_file_unref (mapping);
+    } else {
+      mem_size += size;
+    }
+  }
+  if (resident)
+    *resident = mem_size;
+  if (on_disk)
+    *on_disk = disk_size;
+}
+
+/**
+ * bt_wave_prefetch:
+ * @self: the wave
+ *
+ * Start reading the mapped sample data from the sample cache, so that it is in
+ * memory when a player needs it. Does nothing if the data is resident already.
+ * This is safe to call from any thread.
+ *
+ * Since: 0.12
+ */
+void
+bt_wave_prefetch (const BtWave * const self)
+{
+  g_return_if_fail (BT_IS_WAVE (self));
+
+  if (g_atomic_int_compare_and_exchange (&self->priv->resident, FALSE, TRUE)) {
+    GST_DEBUG ("prefetch wave %lu", self->priv->index);
+    bt_wave_advise_mapped_data (self, MADV_WILLNEED);
+  }
+}
+
+/**
+ * bt_wave_mark_modified:
+ * @self: the wave
+ *
+ * Tell the wave that a writable pointer to its sample data has been handed
+ * out. The mapped sample data is a private copy of the sample cache, thus
+ * evicting it would revert the changes. Such waves are never evicted.
+ * This is safe to call from any thread.
+ *
+ * Since: 0.12
+ */
+void
+bt_wave_mark_modified (const BtWave * const self)
+{
+  g_return_if_fail (BT_IS_WAVE (self));
+
+  g_atomic_int_set (&self->priv->modified, TRUE);
+}
+
+/**
+ * bt_wave_evict:
+ * @self: the wave
+ *
+ * Release the memory of the mapped sample data. The data stays accessible, it
+ * is read again from the sample cache when it is used the next time. Only data
+ * that has not been changed in memory can be evicted (see
+ * bt_wave_mark_modified()).
+ *
+ * Returns: the number of bytes that have been released
+ *
+ * Since: 0.12
+ */
+guint64
+bt_wave_evict (const BtWave * const self)
+{
+  g_return_val_if_fail (BT_IS_WAVE (self), 0);
+
+  if (g_atomic_int_get (&self->priv->modified)) {
+    GST_DEBUG ("not evicting modified wave %lu", self->priv->index);
+    return 0;
+  }
+  if (g_atomic_int_compare_and_exchange (&self->priv->resident, TRUE, FALSE)) {
+    GST_DEBUG ("evict wave %lu", self->priv->index);
+    return bt_wave_advise_mapped_data (self, MADV_DONTNEED);
+  }
+  return 0;
+}
+
 //-- io interface
 
 static xmlNodePtr
@@ -674,6 +1429,7 @@ bt_wave_persistence_load (const GType type,
   BtPersistence *result;
   BtSongIONative *song_io;
   gchar *uri = NULL;
+  gboolean defer = FALSE;
 
   GST_DEBUG ("PERSISTENCE::wave");
   g_assert (node);
@@ -729,7 +1485,27 @@ bt_wave_persistence_load (const GType type,
   // check if we need to load external data
   g_object_get (self->priv->song, "song-io", &song_io, NULL);
   if (song_io) {
-    gboolean unpack_failed = FALSE;
+    gboolean unpack_failed = FALSE, wave_data = TRUE;
+
+    g_object_get (song_io, "wave-data", &wave_data, NULL);
+    if (!wave_data) {
+      gboolean exists = TRUE;
+
+      // skip decoding, but still report external files that are missing
+      if (!BT_IS_SONG_IO_NATIVE_BZT (song_io)) {
+        GFile *file = g_file_new_for_uri ((gchar *) uri_str);
+
+        exists = g_file_query_exists (file, NULL);
+        g_object_unref (file);
+      }
+      g_object_unref (song_io);
+      if (!exists) {
+        uri = g_strdup ((gchar *) uri_str);
+        goto WaveLoadingError;
+      }
+      GST_INFO ("skipping wave data for wave %lu", index);
+      goto Done;
+    }
     if (BT_IS_SONG_IO_NATIVE_BZT (song_io)) {
       gchar *fn, *fp;
 
@@ -760,6 +1536,8 @@ bt_wave_persistence_load (const GType type,
       uri = g_strdup ((gchar *) uri_str);
     }
     g_object_unref (song_io);
+    // bt_song_io_load() joins the decoders when it is done with the song
+    defer = TRUE;
     if (unpack_failed) {
       goto WaveUnpackError;
     }
@@ -768,37 +1546,13 @@ bt_wave_persistence_load (const GType type,
   }
 
   // try to load wavedata
-  if (!bt_wave_load_from_uri (self, uri)) {
+  if (defer
+      && bt_wave_load_from_uri_async (self, uri, xmlCopyNode (node, 1))) {
+    GST_INFO ("decoding wave %lu in the background", index);
+  } else if (!bt_wave_load_from_uri (self, uri)) {
     goto WaveLoadingError;
   } else {
-    GList *lnode = self->priv->wavelevels;
-    xmlNodePtr child_node;
-
-    GST_INFO ("loading wavelevels : %p", lnode);
-
-    for (node = node->children; node; node = node->next) {
-      if ((!xmlNodeIsText (node))
-          && (!strncmp ((gchar *) node->name, "wavelevels\0", 11))) {
-        for (child_node = node->children; child_node;
-            child_node = child_node->next) {
-          if ((!xmlNodeIsText (child_node))
-              && (!strncmp ((gchar *) child_node->name, "wavelevel\0", 10))) {
-            /* loading the wave might have already created wave-levels,
-             * here we just want to override e.g. loop, sampling-rate
-             */
-            if (lnode) {
-              BtWavelevel *const wave_level = BT_WAVELEVEL (lnode->data);
-
-              bt_persistence_load (BT_TYPE_WAVELEVEL,
-                  BT_PERSISTENCE (wave_level), child_node, NULL, NULL);
-              lnode = g_list_next (lnode);
-            } else {
-              GST_WARNING ("no wavelevel");
-            }
-          }
-        }
-      }
-    }
+    bt_wave_load_wavelevels (self, node);
   }
 
 Done:
@@ -962,6 +1716,12 @@ bt_wave_dispose (GObject * const object)
     g_object_try_unref (node->data);
     node->data = NULL;
   }
+  // a song that failed to load might have left a decoder running
+  if (self->priv->loader) {
+    bt_wave_loader_wait (self->priv->loader);
+    bt_wave_loader_free (self->priv->loader);
+    self->priv->loader = NULL;
+  }
   wave_io_free (self);
 
   G_OBJECT_CLASS (bt_wave_parent_class)->dispose (object);
@@ -992,7 +1752,6 @@ bt_wave_init (BtWave * self)
 {
   self->priv = bt_wave_get_instance_private(self);
   self->priv->volume = 1.0;
-  self->priv->fd = -1;
   self->priv->ext_fd = -1;
 }
 
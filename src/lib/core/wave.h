@@ -77,6 +77,11 @@ BtWave *bt_wave_new(const BtSong * const song, const gchar * const name, const g
 
 gboolean bt_wave_add_wavelevel(const BtWave * const self, const BtWavelevel * const wavelevel);
 BtWavelevel *bt_wave_get_level_by_index(const BtWave * const self,const gulong index);
+gboolean bt_wave_finish_loading(const BtWave * const self, GError **err);
+void bt_wave_get_memory_usage(const BtWave * const self, guint64 *resident, guint64 *on_disk);
+void bt_wave_prefetch(const BtWave * const self);
+guint64 bt_wave_evict(const BtWave * const self);
+void bt_wave_mark_modified(const BtWave * const self);
 
 
 #endif // BT_WAVE_H
@@ -37,7 +37,9 @@ enum
   WAVELEVEL_LOOP_START,
   WAVELEVEL_LOOP_END,
   WAVELEVEL_RATE,
-  WAVELEVEL_DATA
+  WAVELEVEL_DATA,
+  WAVELEVEL_MAPPED_FILE,
+  WAVELEVEL_DATA_FILE
 };
 
 struct _BtWavelevelPrivate
@@ -63,6 +65,9 @@ struct _BtWavelevelPrivate
   // data format
 
   gconstpointer *sample;        // sample data
+  GMappedFile *mapping;         // if set, sample points into it
+  GMappedFile *old_mapping;     // replaced mapping, sample may point into it
+  gchar *data_file;             // the file of the mapping, if any
 };
 
 //-- the class
@@ -105,6 +110,63 @@ bt_wavelevel_new (const BtSong * const song, const BtWave * const wave,
 
 //-- private methods
 
+static gboolean
+bt_wavelevel_is_mapped (GMappedFile * mapping, gconstpointer data)
+{
+  const gchar *start;
+
+  if (!mapping || !data)
+    return FALSE;
+  start = g_mapped_file_get_contents (mapping);
+  return ((const gchar *) data >= start) &&
+      ((const gchar *) data < start + g_mapped_file_get_length (mapping));
+}
+
+static void
+bt_wavelevel_free_sample (const BtWavelevel * const self)
+{
+  if (self->priv->old_mapping) {
+    g_mapped_file_unref (self->priv->old_mapping);
+    self->priv->old_mapping = NULL;
+  }
+  if (!self->priv->sample)
+    return;
+
+  if (self->priv->mapping) {
+    g_mapped_file_unref (self->priv->mapping);
+    self->priv->mapping = NULL;
+  } else {
+    g_free (self->priv->sample);
+  }
+  self->priv->sample = NULL;
+}
+
+/* Players can still read the old data, thus the new data is set first and
+ * the old data is released afterwards. */
+static void
+bt_wavelevel_set_sample (const BtWavelevel * const self, gpointer sample)
+{
+  gpointer old_sample = self->priv->sample;
+  GMappedFile *old_mapping = self->priv->old_mapping;
+
+  self->priv->sample = sample;
+  self->priv->old_mapping = NULL;
+  if (self->priv->mapping
+      && !bt_wavelevel_is_mapped (self->priv->mapping, sample)) {
+    // the new data is not from the file, we don't need the mapping anymore
+    if (old_mapping)
+      g_mapped_file_unref (old_mapping);
+    old_mapping = self->priv->mapping;
+    self->priv->mapping = NULL;
+  }
+  if (old_mapping) {
+    g_mapped_file_unref (old_mapping);
+  } else if (old_sample && old_sample != sample
+      && !bt_wavelevel_is_mapped (self->priv->mapping, old_sample)) {
+    g_free (old_sample);
+  }
+}
+
 //-- public methods
 
 
@@ -230,6 +292,12 @@ bt_wavelevel_get_property (GObject * const object, const guint property_id,
     case WAVELEVEL_DATA:
       g_value_set_pointer (value, self->priv->sample);
       break;
+    case WAVELEVEL_MAPPED_FILE:
+      g_value_set_boxed (value, self->priv->mapping);
+      break;
+    case WAVELEVEL_DATA_FILE:
+      g_value_set_string (value, self->priv->data_file);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -308,10 +376,30 @@ bt_wavelevel_set_property (GObject * const object, const guint property_id,
       GST_DEBUG ("set the rate for wavelevel: %lu", self->priv->rate);
       break;
     case WAVELEVEL_DATA:
-      g_free (self->priv->sample);
-      self->priv->sample = g_value_get_pointer (value);
+      bt_wavelevel_set_sample (self, g_value_get_pointer (value));
       GST_DEBUG ("set the data-pointer for wavelevel: %p", self->priv->sample);
       break;
+    case WAVELEVEL_MAPPED_FILE:{
+      GMappedFile *old_mapping = self->priv->mapping;
+
+      self->priv->mapping = g_value_dup_boxed (value);
+      if (old_mapping) {
+        if (bt_wavelevel_is_mapped (old_mapping, self->priv->sample)) {
+          // keep it until "data" has been changed
+          if (self->priv->old_mapping)
+            g_mapped_file_unref (self->priv->old_mapping);
+          self->priv->old_mapping = old_mapping;
+        } else {
+          g_mapped_file_unref (old_mapping);
+        }
+      }
+      GST_DEBUG ("set the mapping for wavelevel: %p", self->priv->mapping);
+    } break;
+    case WAVELEVEL_DATA_FILE:
+      g_free (self->priv->data_file);
+      self->priv->data_file = g_value_dup_string (value);
+      GST_DEBUG ("set the data-file for wavelevel: %s", self->priv->data_file);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -341,7 +429,10 @@ bt_wavelevel_finalize (GObject * const object)
 
   GST_DEBUG ("!!!! self=%p", self);
 
-  g_free (self->priv->sample);
+  bt_wavelevel_free_sample (self);
+  if (self->priv->mapping)
+    g_mapped_file_unref (self->priv->mapping);
+  g_free (self->priv->data_file);
 
   G_OBJECT_CLASS (bt_wavelevel_parent_class)->finalize (object);
 }
@@ -404,4 +495,16 @@ bt_wavelevel_class_init (BtWavelevelClass * const klass)
   g_object_class_install_property (gobject_class, WAVELEVEL_DATA,
       g_param_spec_pointer ("data", "data prop", "the sample data",
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  // if set, "data" points into the mapping, set it before "data"
+  g_object_class_install_property (gobject_class, WAVELEVEL_MAPPED_FILE,
+      g_param_spec_boxed ("mapped-file", "mapped-file prop",
+          "the file mapping that holds the sample data", G_TYPE_MAPPED_FILE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  // players can stream long waves from this file instead of the mapping
+  g_object_class_install_property (gobject_class, WAVELEVEL_DATA_FILE,
+      g_param_spec_string ("data-file", "data-file prop",
+          "the file that holds the sample data, if any", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
@@ -23,6 +23,12 @@
  *
  * The first entry starts at index pos 1. Index 0 is used in a #BtPattern to
  * indicate that no (new) wave is referenced.
+ *
+ * The sample data of the waves is only read into memory when a wave is used
+ * (see bt_wavetable_touch_wave()). If the resident data exceeds the memory
+ * budget from #BtSettings:wavetable-memory-budget, the least recently used
+ * waves that are not held by a player (see bt_wavetable_use_wave()) and that
+ * have not been changed in memory are evicted.
  */
 /* TODO(ensonic): defer freeing waves if playing
  * - buzzmachines don't ref waves, machines are supposed to check the wave ptr
@@ -53,9 +59,20 @@ enum
 {
   WAVETABLE_SONG = 1,
   WAVETABLE_WAVES,
-  WAVETABLE_MISSING_WAVES
+  WAVETABLE_MISSING_WAVES,
+  WAVETABLE_MEMORY_BUDGET,
+  WAVETABLE_RESIDENT_SIZE
 };
 
+/* usage stats of a wave, guarded by the wavetable lock */
+typedef struct
+{
+  /* number of wave buffers handed out to players */
+  gint users;
+  /* monotonic time of the last use */
+  gint64 last_used;
+} BtWaveUsage;
+
 struct _BtWavetablePrivate
 {
   /* used to validate if dispose has run */
@@ -69,6 +86,15 @@ struct _BtWavetablePrivate
    */
   GList *waves;                 // each entry points to a BtWave
   GList *missing_waves;         // each entry points to a gchar*
+
+  /* memory budget for the wave data in bytes, 0 for no limit */
+  guint64 memory_budget;
+  guint64 resident_size;
+  BtSettings *settings;
+
+  GMutex lock;
+  GHashTable *usage;            // BtWave* -> BtWaveUsage*
+  guint budget_check_id;
 };
 
 static guint signals[LAST_SIGNAL] = { 0, };
@@ -102,6 +128,89 @@ bt_wavetable_new (const BtSong * const song)
 
 //-- private methods
 
+static gint
+compare_last_used (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  const BtWavetable *self = BT_WAVETABLE (user_data);
+  const BtWaveUsage *ua = g_hash_table_lookup (self->priv->usage, a);
+  const BtWaveUsage *ub = g_hash_table_lookup (self->priv->usage, b);
+
+  return (ua->last_used > ub->last_used) - (ua->last_used < ub->last_used);
+}
+
+static gboolean
+bt_wavetable_check_memory_budget (gpointer user_data)
+{
+  BtWavetable *self = BT_WAVETABLE (user_data);
+  GList *node, *candidates = NULL;
+  guint64 resident, total = 0;
+
+  g_mutex_lock (&self->priv->lock);
+  self->priv->budget_check_id = 0;
+  for (node = self->priv->waves; node; node = g_list_next (node)) {
+    BtWave *wave = BT_WAVE (node->data);
+    BtWaveUsage *usage = g_hash_table_lookup (self->priv->usage, wave);
+
+    bt_wave_get_memory_usage (wave, &resident, NULL);
+    total += resident;
+    if (resident && usage && !usage->users) {
+      candidates = g_list_prepend (candidates, wave);
+    }
+  }
+
+  if (self->priv->memory_budget && total > self->priv->memory_budget) {
+    candidates = g_list_sort_with_data (candidates, compare_last_used, self);
+    for (node = candidates; node && total > self->priv->memory_budget;
+        node = g_list_next (node)) {
+      total -= bt_wave_evict (BT_WAVE (node->data));
+    }
+  }
+  g_mutex_unlock (&self->priv->lock);
+  g_list_free (candidates);
+
+  GST_DEBUG ("wave data: %" G_GUINT64_FORMAT " bytes resident, budget: %"
+      G_GUINT64_FORMAT, total, self->priv->memory_budget);
+  if (total != self->priv->resident_size) {
+    self->priv->resident_size = total;
+    g_object_notify ((GObject *) self, "resident-size");
+  }
+  return G_SOURCE_REMOVE;
+}
+
+/* can be called from any thread */
+static void
+bt_wavetable_queue_memory_budget_check (const BtWavetable * const self)
+{
+  g_mutex_lock (&self->priv->lock);
+  if (!self->priv->budget_check_id && !self->priv->dispose_has_run) {
+    self->priv->budget_check_id =
+        g_idle_add_full (G_PRIORITY_LOW, bt_wavetable_check_memory_budget,
+        (gpointer) self, NULL);
+  }
+  g_mutex_unlock (&self->priv->lock);
+}
+
+typedef struct
+{
+  GWeakRef wavetable;
+  BtWave *wave;
+} BtWaveBufferUser;
+
+static void
+bt_wavetable_release_wave_buffer (gpointer user_data)
+{
+  BtWaveBufferUser *user = (BtWaveBufferUser *) user_data;
+  BtWavetable *self;
+
+  if ((self = g_weak_ref_get (&user->wavetable))) {
+    bt_wavetable_release_wave (self, user->wave);
+    g_object_unref (self);
+  }
+  g_weak_ref_clear (&user->wavetable);
+  g_object_unref (user->wave);
+  g_slice_free (BtWaveBufferUser, user);
+}
+
 static void
 update_wave_index_enum (gulong index, gchar * new_name)
 {
@@ -122,6 +231,19 @@ update_wave_index_enum (gulong index, gchar * new_name)
   g_type_class_unref (enum_class);
 }
 
+//-- event handler
+
+static void
+on_memory_budget_changed (const BtSettings * const settings,
+    GParamSpec * const arg, gpointer const user_data)
+{
+  BtWavetable *self = BT_WAVETABLE (user_data);
+  guint budget;
+
+  g_object_get ((gpointer) settings, "wavetable-memory-budget", &budget, NULL);
+  g_object_set (self, "memory-budget", (guint64) budget * 1024 * 1024, NULL);
+}
+
 //-- public methods
 
 /**
@@ -153,6 +275,9 @@ bt_wavetable_add_wave (const BtWavetable * const self,
     if ((other_wave = bt_wavetable_get_wave_by_index (self, index))) {
       GST_DEBUG ("replacing old wave with same id");
       self->priv->waves = g_list_remove (self->priv->waves, other_wave);
+      g_mutex_lock (&self->priv->lock);
+      g_hash_table_remove (self->priv->usage, other_wave);
+      g_mutex_unlock (&self->priv->lock);
       //g_signal_emit((gpointer)self,signals[WAVE_REMOVED_EVENT], 0, wave);
       /* TODO(ensonic): if song::is-playing==TRUE add this to a  self->priv->old_waves
        * and wait for song::is-playing==FALSE and free then */
@@ -161,7 +286,12 @@ bt_wavetable_add_wave (const BtWavetable * const self,
 
     self->priv->waves =
         g_list_append (self->priv->waves, g_object_ref ((gpointer) wave));
+    g_mutex_lock (&self->priv->lock);
+    g_hash_table_insert (self->priv->usage, (gpointer) wave,
+        g_new0 (BtWaveUsage, 1));
+    g_mutex_unlock (&self->priv->lock);
     g_signal_emit ((gpointer) self, signals[WAVE_ADDED_EVENT], 0, wave);
+    bt_wavetable_queue_memory_budget_check (self);
 
     update_wave_index_enum (index, name);
     ret = TRUE;
@@ -196,7 +326,11 @@ bt_wavetable_remove_wave (const BtWavetable * const self,
     update_wave_index_enum (index, g_strdup ("---"));
 
     self->priv->waves = g_list_remove (self->priv->waves, wave);
+    g_mutex_lock (&self->priv->lock);
+    g_hash_table_remove (self->priv->usage, wave);
+    g_mutex_unlock (&self->priv->lock);
     g_signal_emit ((gpointer) self, signals[WAVE_REMOVED_EVENT], 0, wave);
+    bt_wavetable_queue_memory_budget_check (self);
     g_object_unref ((gpointer) wave);
     ret = TRUE;
   } else {
@@ -254,6 +388,99 @@ bt_wavetable_remember_missing_wave (const BtWavetable * const self,
       g_list_prepend (self->priv->missing_waves, (gpointer) str);
 }
 
+/**
+ * bt_wavetable_touch_wave:
+ * @self: the wavetable
+ * @wave: the wave that is being used
+ *
+ * Mark the @wave as recently used and start reading its sample data if it is
+ * not in memory. This is called when a player requests the wave and should be
+ * called by the front-end when it e.g. previews the wave. It is safe to call
+ * this from any thread.
+ *
+ * Since: 0.12
+ */
+void
+bt_wavetable_touch_wave (const BtWavetable * const self,
+    const BtWave * const wave)
+{
+  BtWaveUsage *usage;
+
+  g_return_if_fail (BT_IS_WAVETABLE (self));
+  g_return_if_fail (BT_IS_WAVE (wave));
+
+  g_mutex_lock (&self->priv->lock);
+  if ((usage = g_hash_table_lookup (self->priv->usage, wave))) {
+    usage->last_used = g_get_monotonic_time ();
+  }
+  g_mutex_unlock (&self->priv->lock);
+
+  bt_wave_prefetch (wave);
+  bt_wavetable_queue_memory_budget_check (self);
+}
+
+/**
+ * bt_wavetable_use_wave:
+ * @self: the wavetable
+ * @wave: the wave whose sample data is handed out
+ *
+ * Like bt_wavetable_touch_wave(), but also keeps the sample data of the @wave
+ * in memory until bt_wavetable_release_wave() is called. Call this for as long
+ * as a pointer to the sample data is used, e.g. while a wave is previewed.
+ * Data that is evicted is only read again when it is used, this would happen
+ * e.g. in the realtime thread otherwise. It is safe to call this from any
+ * thread.
+ *
+ * Since: 0.12
+ */
+void
+bt_wavetable_use_wave (const BtWavetable * const self,
+    const BtWave * const wave)
+{
+  BtWaveUsage *usage;
+
+  g_return_if_fail (BT_IS_WAVETABLE (self));
+  g_return_if_fail (BT_IS_WAVE (wave));
+
+  g_mutex_lock (&self->priv->lock);
+  if ((usage = g_hash_table_lookup (self->priv->usage, wave))) {
+    usage->users++;
+  }
+  g_mutex_unlock (&self->priv->lock);
+
+  bt_wavetable_touch_wave (self, wave);
+}
+
+/**
+ * bt_wavetable_release_wave:
+ * @self: the wavetable
+ * @wave: the wave whose sample data is no longer used
+ *
+ * Release the use of the @wave that has been started with
+ * bt_wavetable_use_wave(). Once no one uses the wave anymore, its sample data
+ * can be evicted again. It is safe to call this from any thread.
+ *
+ * Since: 0.12
+ */
+void
+bt_wavetable_release_wave (const BtWavetable * const self,
+    const BtWave * const wave)
+{
+  BtWaveUsage *usage;
+
+  g_return_if_fail (BT_IS_WAVETABLE (self));
+  g_return_if_fail (BT_IS_WAVE (wave));
+
+  g_mutex_lock (&self->priv->lock);
+  if ((usage = g_hash_table_lookup (self->priv->usage, wave))) {
+    if (usage->users > 0)
+      usage->users--;
+    usage->last_used = g_get_monotonic_time ();
+  }
+  g_mutex_unlock (&self->priv->lock);
+  bt_wavetable_queue_memory_budget_check (self);
+}
+
 //-- io interface
 
 static xmlNodePtr
@@ -339,6 +566,12 @@ bt_wavetable_get_property (GObject * const object, const guint property_id,
     case WAVETABLE_MISSING_WAVES:
       g_value_set_pointer (value, self->priv->missing_waves);
       break;
+    case WAVETABLE_MEMORY_BUDGET:
+      g_value_set_uint64 (value, self->priv->memory_budget);
+      break;
+    case WAVETABLE_RESIDENT_SIZE:
+      g_value_set_uint64 (value, self->priv->resident_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -357,6 +590,12 @@ bt_wavetable_set_property (GObject * const object, const guint property_id,
       g_object_try_weak_ref (self->priv->song);
       //GST_DEBUG("set the song for wavetable: %p",self->priv->song);
       break;
+    case WAVETABLE_MEMORY_BUDGET:
+      self->priv->memory_budget = g_value_get_uint64 (value);
+      GST_INFO ("set the memory budget to %" G_GUINT64_FORMAT " bytes",
+          self->priv->memory_budget);
+      bt_wavetable_queue_memory_budget_check (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -375,6 +614,13 @@ bt_wavetable_dispose (GObject * const object)
   GST_DEBUG ("!!!! self=%p", self);
 
   g_object_try_weak_unref (self->priv->song);
+  g_object_unref (self->priv->settings);
+  g_mutex_lock (&self->priv->lock);
+  if (self->priv->budget_check_id) {
+    g_source_remove (self->priv->budget_check_id);
+    self->priv->budget_check_id = 0;
+  }
+  g_mutex_unlock (&self->priv->lock);
   // unref list of waves
   if (self->priv->waves) {
     for (node = self->priv->waves; node; node = g_list_next (node)) {
@@ -400,6 +646,8 @@ bt_wavetable_finalize (GObject * const object)
     g_list_free (self->priv->waves);
     self->priv->waves = NULL;
   }
+  g_hash_table_destroy (self->priv->usage);
+  g_mutex_clear (&self->priv->lock);
   // free list of missing_waves
   if (self->priv->missing_waves) {
     const GList *node;
@@ -418,7 +666,21 @@ bt_wavetable_finalize (GObject * const object)
 static void
 bt_wavetable_init (BtWavetable * self)
 {
+  guint budget;
+
   self->priv = bt_wavetable_get_instance_private(self);
+
+  g_mutex_init (&self->priv->lock);
+  self->priv->usage =
+      g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_free);
+
+  self->priv->settings = bt_settings_make ();
+  g_object_get (self->priv->settings, "wavetable-memory-budget", &budget,
+      NULL);
+  self->priv->memory_budget = (guint64) budget * 1024 * 1024;
+  g_signal_connect_object (self->priv->settings,
+      "notify::wavetable-memory-budget",
+      G_CALLBACK (on_memory_budget_changed), (gpointer) self, 0);
 }
 
 static void
@@ -471,10 +733,25 @@ bt_wavetable_class_init (BtWavetableClass * const klass)
           "missing-waves list prop",
           "The list of missing waves, don't change",
           G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, WAVETABLE_MEMORY_BUDGET,
+      g_param_spec_uint64 ("memory-budget",
+          "memory-budget prop",
+          "Memory for wave data in bytes (0 for no limit)",
+          0, G_MAXUINT64, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, WAVETABLE_RESIDENT_SIZE,
+      g_param_spec_uint64 ("resident-size",
+          "resident-size prop",
+          "Size of the wave data in memory in bytes",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 //-- wavetable callback hack
 
+/* waves that are larger are streamed from disk by the players */
+#define WAVE_STREAM_MIN_SIZE (8 * 1024 * 1024)
+
 static GstStructure *
 get_wave_buffer (BtWavetable * self, guint wave_ix, guint wave_level_ix)
 {
@@ -490,15 +767,22 @@ get_wave_buffer (BtWavetable * self, guint wave_ix, guint wave_level_ix)
       guint channels;
       GstBtNote root_note;
       gsize size;
+      BtWaveBufferUser *user;
 
       g_object_get (wave, "channels", &channels, NULL);
       g_object_get (wavelevel, "data", &data, "length", &length, "root-note",
           &root_note, NULL);
 
+      // count the players that use the wave, until they release the buffer
+      bt_wavetable_use_wave (self, wave);
+      user = g_slice_new (BtWaveBufferUser);
+      g_weak_ref_init (&user->wavetable, self);
+      user->wave = g_object_ref (wave);
+
       size = channels * length * sizeof (gint16);
       buffer =
           gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY, data, size, 0,
-          size, NULL, NULL);
+          size, user, bt_wavetable_release_wave_buffer);
 
       s = gst_structure_new ("audio/x-raw",     // unused
           "format", G_TYPE_STRING, GST_AUDIO_NE (S16),  // unused
@@ -507,6 +791,26 @@ get_wave_buffer (BtWavetable * self, guint wave_ix, guint wave_level_ix)
           "channels", G_TYPE_INT, channels,
           "root-note", GSTBT_TYPE_NOTE, (guint) root_note,
           "buffer", GST_TYPE_BUFFER, buffer, NULL);
+      gst_buffer_unref (buffer);
+
+      // let the player stream long waves from the decoded sample cache
+      if (size >= WAVE_STREAM_MIN_SIZE) {
+        GMappedFile *mapping;
+        gchar *file;
+
+        g_object_get (wavelevel, "mapped-file", &mapping, "data-file", &file,
+            NULL);
+        if (mapping && file) {
+          guint64 offset =
+              (const gchar *) data - g_mapped_file_get_contents (mapping);
+
+          gst_structure_set (s, "file", G_TYPE_STRING, file,
+              "offset", G_TYPE_UINT64, offset, NULL);
+        }
+        if (mapping)
+          g_mapped_file_unref (mapping);
+        g_free (file);
+      }
 
       g_object_unref (wavelevel);
     }
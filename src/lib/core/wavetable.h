@@ -63,5 +63,8 @@ gboolean bt_wavetable_remove_wave(const BtWavetable * const self, const BtWave *
 BtWave *bt_wavetable_get_wave_by_index(const BtWavetable * const self, const gulong index);
 
 void bt_wavetable_remember_missing_wave(const BtWavetable * const self, const gchar * const str);
+void bt_wavetable_touch_wave(const BtWavetable * const self, const BtWave * const wave);
+void bt_wavetable_use_wave(const BtWavetable * const self, const BtWave * const wave);
+void bt_wavetable_release_wave(const BtWavetable * const self, const BtWave * const wave);
 
 #endif // BT_WAVETABLE_H
@@ -34,11 +34,18 @@
  * seeking. It can be used to e.g. cut off playing notes.
  * Finally the process method is where the audio generation is going to be
  * implemented.
+ *
+ * By default each buffer covers one subtick. If the tempo context specifies a
+ * fixed buffer size (see gstbt_audio_tempo_context_set_buffer_frames()), the
+ * buffer is split at the subtick boundaries and the process method is called
+ * for each part. The buffer timestamp and the mapped data then refer to the
+ * part being rendered.
  */
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <gst/audio/audio.h>
@@ -50,6 +57,9 @@
 #define GST_CAT_DEFAULT audiosynth_debug
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
+/* number of buffers we preallocate in the pool */
+#define GSTBT_AUDIO_SYNTH_MIN_BUFFERS 4
+
 enum
 {
   // tempo interface
@@ -81,6 +91,15 @@ gstbt_audio_synth_calculate_buffer_size (GstBtAudioSynth * self)
   return self->info.bpf * self->generate_samples_per_buffer;
 }
 
+/* the size of the pooled buffers, big enough for any subtick buffer at the
+ * current tempo, the rounding error compensation can add one frame */
+static guint
+gstbt_audio_synth_calculate_max_buffer_size (GstBtAudioSynth * self)
+{
+  return self->info.bpf * MAX (self->buffer_frames,
+      (guint) ceil (self->samples_per_buffer) + 1);
+}
+
 static void
 gstbt_audio_synth_calculate_buffer_frames (GstBtAudioSynth * self)
 {
@@ -95,8 +114,11 @@ gstbt_audio_synth_calculate_buffer_frames (GstBtAudioSynth * self)
   self->samples_per_buffer = ((self->info.rate * div) / ticks_per_minute);
   GST_DEBUG ("samples_per_buffer=%lf", self->samples_per_buffer);
   self->generate_samples_per_buffer = (guint) (0.5 + self->samples_per_buffer);
-  gst_base_src_set_blocksize (GST_BASE_SRC (self),
+  gst_base_src_set_blocksize (GST_BASE_SRC (self), self->buffer_frames ?
+      self->info.bpf * self->buffer_frames :
       gstbt_audio_synth_calculate_buffer_size (self));
+  // renegotiate the buffer pool for the new buffer size
+  gst_pad_mark_reconfigure (GST_BASE_SRC_PAD (self));
   // the sequence is quantized to ticks and not subticks
   // we need to compensate for the rounding errors :/
   self->ticktime_err =
@@ -112,17 +134,20 @@ static void
 gstbt_audio_synth_set_context (GstElement * element, GstContext * context)
 {
   GstBtAudioSynth *self = GSTBT_AUDIO_SYNTH (element);
-  guint bpm, tpb, stpb;
+  guint bpm, tpb, stpb, frames = 0;
 
   if (gstbt_audio_tempo_context_get_tempo (context, &bpm, &tpb, &stpb)) {
+    gstbt_audio_tempo_context_get_buffer_frames (context, &frames);
     if (self->beats_per_minute != bpm ||
-        self->ticks_per_beat != tpb || self->subticks_per_beat != stpb) {
+        self->ticks_per_beat != tpb || self->subticks_per_beat != stpb ||
+        self->buffer_frames != frames) {
       self->beats_per_minute = bpm;
       self->ticks_per_beat = tpb;
       self->subticks_per_beat = stpb;
+      self->buffer_frames = frames;
 
-      GST_INFO_OBJECT (self, "audio tempo context: bmp=%u, tpb=%u, stpb=%u",
-          bpm, tpb, stpb);
+      GST_INFO_OBJECT (self, "audio tempo context: bmp=%u, tpb=%u, stpb=%u, "
+          "buffer-frames=%u", bpm, tpb, stpb, frames);
 
       gstbt_audio_synth_calculate_buffer_frames (self);
     }
@@ -196,6 +221,35 @@ gstbt_audio_synth_set_caps (GstBaseSrc * basesrc, GstCaps * caps)
   return ret;
 }
 
+static gboolean
+gstbt_audio_synth_decide_allocation (GstBaseSrc * basesrc, GstQuery * query)
+{
+  GstBtAudioSynth *self = GSTBT_AUDIO_SYNTH (basesrc);
+  GstBufferPool *pool = NULL;
+  guint size = gstbt_audio_synth_calculate_max_buffer_size (self);
+  guint pool_size, min, max;
+
+  /* make sure we always get a pool, so that create() does not need to allocate
+   * memory while we're playing, the base class creates a default pool for us
+   * if the downstream elements did not propose one */
+  if (gst_query_get_n_allocation_pools (query) > 0) {
+    gst_query_parse_nth_allocation_pool (query, 0, &pool, &pool_size, &min,
+        &max);
+    pool_size = MAX (pool_size, size);
+    min = MAX (min, GSTBT_AUDIO_SYNTH_MIN_BUFFERS);
+    gst_query_set_nth_allocation_pool (query, 0, pool, pool_size, min, max);
+    if (pool)
+      gst_object_unref (pool);
+  } else {
+    gst_query_add_allocation_pool (query, NULL, size,
+        GSTBT_AUDIO_SYNTH_MIN_BUFFERS, 0);
+  }
+  GST_INFO_OBJECT (self, "buffer pool: size=%u", size);
+
+  return GST_BASE_SRC_CLASS (gstbt_audio_synth_parent_class)->decide_allocation
+      (basesrc, query);
+}
+
 static gboolean
 gstbt_audio_synth_query (GstBaseSrc * basesrc, GstQuery * query)
 {
@@ -234,6 +288,7 @@ gstbt_audio_synth_do_seek (GstBaseSrc * basesrc, GstSegment * segment)
   src->reverse = (segment->rate < 0.0);
   src->running_time = time;
   src->ticktime_err_accum = 0.0;
+  src->subtick_frames_left = 0;
   /* Assume that seeks in < PAUSED configure the playback segment. Don't
    * generate disconts on them as there is nothing to reset.
    * Doing needless resets breaks comamndline usage, where we'd reset the
@@ -300,11 +355,155 @@ gstbt_audio_synth_start (GstBaseSrc * basesrc)
   src->n_samples = G_GINT64_CONSTANT (0);
   src->running_time = G_GUINT64_CONSTANT (0);
   src->ticktime_err_accum = 0.0;
+  src->subtick_frames_left = 0;
   src->discont = FALSE;
 
   return TRUE;
 }
 
+static GstFlowReturn
+gstbt_audio_synth_alloc (GstBtAudioSynth * src, guint size, GstBuffer ** buffer)
+{
+  GstBaseSrc *basesrc = (GstBaseSrc *) src;
+  GstFlowReturn res;
+  gsize maxsize;
+
+  res = GST_BASE_SRC_GET_CLASS (basesrc)->alloc (basesrc, src->n_samples,
+      size, buffer);
+  if (G_UNLIKELY (res != GST_FLOW_OK)) {
+    return res;
+  }
+  /* pooled buffers have the max size, a tempo change can make them too small
+   * until the pool has been renegotiated */
+  gst_buffer_get_sizes (*buffer, NULL, &maxsize);
+  if (G_LIKELY (maxsize >= size)) {
+    gst_buffer_set_size (*buffer, size);
+  } else {
+    GST_DEBUG_OBJECT (src, "pool buffer too small: %" G_GSIZE_FORMAT " < %u",
+        maxsize, size);
+    gst_buffer_unref (*buffer);
+    *buffer = gst_buffer_new_allocate (NULL, size, NULL);
+  }
+  return GST_FLOW_OK;
+}
+
+/* Render a buffer of buffer_frames and split the processing at the subtick
+ * boundaries. Control changes are applied at the start of each subtick, as if
+ * we would render one buffer per subtick. The parts are rendered with
+ * process_segment(), so that subclasses can tell whether a part continues a
+ * subtick. */
+static GstFlowReturn
+gstbt_audio_synth_create_block (GstBtAudioSynth * src, GstBuffer ** buffer)
+{
+  GstBtAudioSynthClass *klass = GSTBT_AUDIO_SYNTH_GET_CLASS (src);
+  GstFlowReturn res;
+  GstBuffer *buf;
+  GstMapInfo info, seg_info;
+  GstClockTime ts, subtick_ts;
+  const gint rate = src->info.rate;
+  const guint bpf = src->info.bpf;
+  guint frames = src->buffer_frames, pos = 0, seg_frames;
+  gdouble samples_done, subtick_frames;
+  gboolean has_data = FALSE;
+
+  /* check for eos */
+  if (src->check_eos) {
+    if (src->n_samples_stop <= src->n_samples) {
+      GST_WARNING_OBJECT (src, "0 samples left -> EOS reached");
+      src->eos_reached = TRUE;
+      return GST_FLOW_EOS;
+    }
+    if (src->n_samples_stop - src->n_samples <= frames) {
+      frames = (guint) (src->n_samples_stop - src->n_samples);
+      src->eos_reached = TRUE;
+      GST_INFO_OBJECT (src, "partial buffer: %u", frames);
+    }
+  }
+
+  res = gstbt_audio_synth_alloc (src, frames * bpf, &buf);
+  if (G_UNLIKELY (res != GST_FLOW_OK)) {
+    return res;
+  }
+
+  ts = gst_util_uint64_scale_int (src->n_samples, GST_SECOND, rate);
+  GST_BUFFER_TIMESTAMP (buf) = ts;
+  GST_BUFFER_DURATION (buf) =
+      gst_util_uint64_scale_int (src->n_samples + frames, GST_SECOND,
+      rate) - ts;
+  GST_BUFFER_OFFSET (buf) = src->n_samples;
+  GST_BUFFER_OFFSET_END (buf) = src->n_samples + frames;
+
+  if (src->discont) {
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+    if (klass->reset) {
+      klass->reset (src);
+    }
+    src->discont = FALSE;
+  }
+
+  GST_DEBUG_OBJECT (src, "generate_frames %6u, offset %12" G_GUINT64_FORMAT
+      " timestamp %" GST_TIME_FORMAT ", duration %" GST_TIME_FORMAT, frames,
+      GST_BUFFER_OFFSET (buf), GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buf)),
+      GST_TIME_ARGS (GST_BUFFER_DURATION (buf)));
+
+  if (!gst_buffer_map (buf, &info, GST_MAP_WRITE)) {
+    GST_WARNING_OBJECT (src, "unable to map buffer for write");
+    src->n_samples += frames;
+    *buffer = buf;
+    return GST_FLOW_OK;
+  }
+  seg_info = info;
+  while (pos < frames) {
+    if (!src->subtick_frames_left) {
+      /* start the next subtick, the length handles rounding errors like
+       * gstbt_audio_synth_create() */
+      samples_done =
+          (gdouble) src->running_time * (gdouble) rate / (gdouble) GST_SECOND;
+      subtick_frames = src->samples_per_buffer +
+          (samples_done - (gdouble) (src->n_samples + pos));
+      /* clamp before the cast, the rounding error can make this negative */
+      src->subtick_frames_left =
+          (subtick_frames < 1.0) ? 1 : (guint) subtick_frames;
+      src->subtick_frames = src->subtick_frames_left;
+      subtick_ts = src->running_time + (GstClockTime) src->ticktime_err_accum;
+      src->running_time += src->ticktime;
+      src->ticktime_err_accum += src->ticktime_err;
+      if (src->subtick_count >= src->subticks_per_beat) {
+        src->subtick_count = 1;
+      } else {
+        src->subtick_count++;
+      }
+      gst_object_sync_values (GST_OBJECT (src), subtick_ts);
+    }
+    seg_frames = MIN (src->subtick_frames_left, frames - pos);
+
+    /* let process() see the segment as if it was the whole buffer */
+    seg_info.data = info.data + pos * bpf;
+    seg_info.size = seg_frames * bpf;
+    src->generate_samples_per_buffer = seg_frames;
+    GST_BUFFER_TIMESTAMP (buf) =
+        ts + gst_util_uint64_scale_int (pos, GST_SECOND, rate);
+    if (klass->process_segment (src, buf, &seg_info,
+            src->subtick_frames - src->subtick_frames_left)) {
+      has_data = TRUE;
+    } else {
+      memset (seg_info.data, 0, seg_info.size);
+    }
+    pos += seg_frames;
+    src->subtick_frames_left -= seg_frames;
+  }
+  GST_BUFFER_TIMESTAMP (buf) = ts;
+  if (!has_data) {
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_GAP);
+  }
+  gst_buffer_unmap (buf, &info);
+
+  src->n_samples += frames;
+  *buffer = buf;
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gstbt_audio_synth_create (GstBaseSrc * basesrc, guint64 offset,
     guint length, GstBuffer ** buffer)
@@ -324,6 +523,9 @@ gstbt_audio_synth_create (GstBaseSrc * basesrc, guint64 offset,
     GST_WARNING_OBJECT (src, "EOS reached");
     return GST_FLOW_EOS;
   }
+  if (src->buffer_frames && !src->reverse && klass->process_segment) {
+    return gstbt_audio_synth_create_block (src, buffer);
+  }
   // the amount of samples to produce (handle rounding errors by collecting left over fractions)
   samples_done =
       (gdouble) src->running_time * (gdouble) src->info.rate /
@@ -390,7 +592,7 @@ gstbt_audio_synth_create (GstBaseSrc * basesrc, guint64 offset,
       src->ticktime_err_accum +
       (src->reverse ? (-src->ticktime_err) : src->ticktime_err);
 
-  res = GST_BASE_SRC_GET_CLASS (basesrc)->alloc (basesrc, src->n_samples,
+  res = gstbt_audio_synth_alloc (src,
       gstbt_audio_synth_calculate_buffer_size (src), &buf);
   if (G_UNLIKELY (res != GST_FLOW_OK)) {
     return res;
@@ -496,6 +698,8 @@ gstbt_audio_synth_class_init (GstBtAudioSynthClass * klass)
       GST_DEBUG_FUNCPTR (gstbt_audio_synth_is_seekable);
   gstbasesrc_class->do_seek = GST_DEBUG_FUNCPTR (gstbt_audio_synth_do_seek);
   gstbasesrc_class->query = GST_DEBUG_FUNCPTR (gstbt_audio_synth_query);
+  gstbasesrc_class->decide_allocation =
+      GST_DEBUG_FUNCPTR (gstbt_audio_synth_decide_allocation);
   gstbasesrc_class->start = GST_DEBUG_FUNCPTR (gstbt_audio_synth_start);
   gstbasesrc_class->create = GST_DEBUG_FUNCPTR (gstbt_audio_synth_create);
   gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gstbt_audio_synth_stop);
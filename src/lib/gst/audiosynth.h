@@ -66,6 +66,11 @@ struct _GstBtAudioSynth
   gulong subtick_count;
   GstClockTime ticktime;
   gdouble ticktime_err, ticktime_err_accum;
+
+  /* fixed buffer size, 0 to render one subtick per buffer */
+  guint buffer_frames;
+  guint subtick_frames_left;         /* of the subtick that spans buffers */
+  guint subtick_frames;              /* length of that subtick */
 };
 
 /**
@@ -73,6 +78,10 @@ struct _GstBtAudioSynth
  * @parent_class: parent type
  * @process: vmethod for generating a block of audio, return false to indicate
  * that a GAP buffer should be sent
+ * @process_segment: optional vmethod for generating a part of a subtick, the
+ * last parameter is the frame offset of the part within the subtick. Only
+ * subclasses that implement this render fixed size buffers, for the others
+ * @process is called once per subtick.
  * @reset: vmethod call on stream discontinuities
  * @negotiate: vmethod for format negotiation
  * @setup: vmethod for initial processign setup
@@ -85,6 +94,7 @@ struct _GstBtAudioSynthClass
 
   /* virtual functions */
   gboolean (*process) (GstBtAudioSynth * src, GstBuffer * data, GstMapInfo *info);
+  gboolean (*process_segment) (GstBtAudioSynth * src, GstBuffer * data, GstMapInfo *info, guint offset);
   void (*reset) (GstBtAudioSynth * src);
   void (*negotiate) (GstBtAudioSynth * src, GstCaps * caps);
   void (*setup) (GstBtAudioSynth * src, GstAudioInfo * info);
@@ -23,15 +23,24 @@
  * @short_description: wavetable oscillator
  *
  * An audio waveform generator that read from the applications wave-table.
+ *
+ * Long waves are streamed from disk if the wave-table provides a file for
+ * them.
  */
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#include <errno.h>
+#include <fcntl.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
 
 #include "osc-wave.h"
 
@@ -189,6 +198,318 @@ gstbt_osc_wave_create_stereo_resampled (GstBtOscWave * self, guint64 off,
   return TRUE;
 }
 
+//-- disk streaming
+
+/* Long waves are not read from the mapped buffer, but streamed from the file
+ * that backs it. Each oscillator keeps the start of the wave resident and a
+ * read-ahead ring that a shared low priority io thread fills. The process
+ * function never blocks, if the data is not there yet, it renders silence and
+ * asks the io thread to reposition the ring. The start of the wave is copied
+ * from the wave buffer when the stream is created, so that notes start right
+ * away. The io thread opens the file and allocates the ring on its first pass,
+ * this keeps the setup that happens on the streaming thread cheap.
+ *
+ * The stream lock only guards the list of streams. The io thread takes a
+ * reference on each stream and reads from the files without holding the lock,
+ * the last reference frees the stream.
+ *
+ * The ring holds the frames [start, end). Only the io thread changes start,
+ * end and gen. Before it overwrites old frames, it advances start. When it
+ * repositions the ring it makes gen odd while changing start and end. The
+ * process function checks gen and start after copying, like a seqlock.
+ */
+#define STREAM_HEAD_FRAMES (1 << 16)
+#define STREAM_RING_FRAMES (1 << 18)
+#define STREAM_RING_MASK (STREAM_RING_FRAMES - 1)
+#define STREAM_CHUNK_FRAMES (1 << 14)
+
+struct _GstBtOscWaveStream
+{
+  gchar *file;
+  gint fd;
+  guint64 offset;               /* byte offset of the samples in the file */
+  gint channels;
+  gint length;                  /* in frames */
+
+  volatile gint ref_count;
+
+  /* preloaded start of the wave, always resident */
+  gint16 *head;
+  gint head_frames;
+  /* read-ahead ring, allocated and filled by the io thread */
+  gint16 *ring;
+  gboolean broken;
+  volatile gint start, end, gen;
+  /* written by the process function */
+  volatile gint read_pos, request;
+};
+
+static GMutex stream_lock;
+static GCond stream_cond;
+static GList *streams = NULL;
+static gboolean stream_thread_running = FALSE;
+
+/* read frames from the file, fill the rest with silence on short reads */
+static void
+gstbt_osc_wave_stream_pread (GstBtOscWaveStream * st, gint16 * dst,
+    gint first, gint n)
+{
+  const gsize fs = st->channels * sizeof (gint16);
+  gsize size = n * fs, done = 0;
+  gssize bytes;
+
+  while (done < size) {
+    bytes = pread (st->fd, &((guint8 *) dst)[done], size - done,
+        st->offset + first * fs + done);
+    if (bytes <= 0) {
+      GST_WARNING ("short read on %s: %s", st->file,
+          bytes ? g_strerror (errno) : "eof");
+      memset (&((guint8 *) dst)[done], 0, size - done);
+      break;
+    }
+    done += bytes;
+  }
+}
+
+static GstBtOscWaveStream *
+gstbt_osc_wave_stream_ref (GstBtOscWaveStream * st)
+{
+  g_atomic_int_inc (&st->ref_count);
+  return st;
+}
+
+static void
+gstbt_osc_wave_stream_unref (GstBtOscWaveStream * st)
+{
+  if (!g_atomic_int_dec_and_test (&st->ref_count))
+    return;
+
+  if (st->fd != -1)
+    close (st->fd);
+  g_free (st->head);
+  g_free (st->ring);
+  g_free (st->file);
+  g_slice_free (GstBtOscWaveStream, st);
+}
+
+/* called from the io thread, returns TRUE if it did some work */
+static gboolean
+gstbt_osc_wave_stream_fill (GstBtOscWaveStream * st)
+{
+  gint req = g_atomic_int_get (&st->request);
+  gint start = g_atomic_int_get (&st->start);
+  gint end = g_atomic_int_get (&st->end);
+  gint limit, n, n1, slot;
+
+  if (st->fd == -1) {
+    if (st->broken)
+      return FALSE;
+    if ((st->fd = open (st->file, O_RDONLY)) == -1) {
+      GST_WARNING ("can't open %s: %s", st->file, g_strerror (errno));
+      st->broken = TRUE;
+      return FALSE;
+    }
+    st->ring = g_new (gint16, STREAM_RING_FRAMES * st->channels);
+  }
+
+  if (req != -1 && g_atomic_int_compare_and_exchange (&st->request, req, -1)) {
+    if (req < start || req > end) {
+      GST_DEBUG ("reposition %s: [%d,%d) -> %d", st->file, start, end, req);
+      g_atomic_int_inc (&st->gen);
+      g_atomic_int_set (&st->start, req);
+      g_atomic_int_set (&st->end, req);
+      g_atomic_int_inc (&st->gen);
+      start = end = req;
+    }
+  }
+
+  limit = MIN (st->length,
+      MAX (g_atomic_int_get (&st->read_pos), start) + STREAM_RING_FRAMES);
+  if ((n = MIN (STREAM_CHUNK_FRAMES, limit - end)) <= 0)
+    return FALSE;
+
+  // we're about to overwrite the oldest frames
+  if (end + n - STREAM_RING_FRAMES > start)
+    g_atomic_int_set (&st->start, end + n - STREAM_RING_FRAMES);
+
+  slot = end & STREAM_RING_MASK;
+  n1 = MIN (n, STREAM_RING_FRAMES - slot);
+  gstbt_osc_wave_stream_pread (st, &st->ring[slot * st->channels], end, n1);
+  if (n > n1)
+    gstbt_osc_wave_stream_pread (st, st->ring, end + n1, n - n1);
+  g_atomic_int_set (&st->end, end + n);
+  return TRUE;
+}
+
+static gpointer
+gstbt_osc_wave_stream_thread (gpointer data)
+{
+  GList *list, *node;
+  gboolean busy;
+
+#ifdef __linux__
+  // nice values are per thread on linux
+  if (setpriority (PRIO_PROCESS, 0, 10) < 0) {
+    GST_INFO ("can't lower priority of the io thread: %s", g_strerror (errno));
+  }
+#endif
+
+  g_mutex_lock (&stream_lock);
+  while (streams) {
+    // don't block the process functions that add or remove streams
+    list = g_list_copy_deep (streams, (GCopyFunc) gstbt_osc_wave_stream_ref,
+        NULL);
+    g_mutex_unlock (&stream_lock);
+
+    busy = FALSE;
+    for (node = list; node; node = g_list_next (node)) {
+      busy |= gstbt_osc_wave_stream_fill ((GstBtOscWaveStream *) node->data);
+    }
+    g_list_free_full (list, (GDestroyNotify) gstbt_osc_wave_stream_unref);
+
+    g_mutex_lock (&stream_lock);
+    if (!busy && streams) {
+      g_cond_wait_until (&stream_cond, &stream_lock,
+          g_get_monotonic_time () + 10 * G_TIME_SPAN_MILLISECOND);
+    }
+  }
+  stream_thread_running = FALSE;
+  g_mutex_unlock (&stream_lock);
+  GST_INFO ("io thread done");
+  return NULL;
+}
+
+static GstBtOscWaveStream *
+gstbt_osc_wave_stream_new (const gchar * file, guint64 offset, gint channels,
+    GstBuffer * data)
+{
+  GstBtOscWaveStream *st;
+  const gsize fs = channels * sizeof (gint16);
+  guint64 length = gst_buffer_get_size (data) / fs;
+
+  if (length >= G_MAXINT - STREAM_RING_FRAMES) {
+    GST_WARNING ("wave is too long for streaming: %" G_GUINT64_FORMAT, length);
+    return NULL;
+  }
+
+  st = g_slice_new0 (GstBtOscWaveStream);
+  st->file = g_strdup (file);
+  st->ref_count = 1;
+  st->fd = -1;
+  st->offset = offset;
+  st->channels = channels;
+  st->length = (gint) length;
+  st->head_frames = MIN (st->length, STREAM_HEAD_FRAMES);
+  st->head = g_new (gint16, st->head_frames * channels);
+  gst_buffer_extract (data, 0, st->head, st->head_frames * fs);
+  st->start = st->end = st->head_frames;
+  st->request = -1;
+
+  g_mutex_lock (&stream_lock);
+  streams = g_list_prepend (streams, st);
+  if (!stream_thread_running) {
+    GError *err = NULL;
+    GThread *thread;
+
+    if ((thread = g_thread_try_new ("osc-wave-io",
+                gstbt_osc_wave_stream_thread, NULL, &err))) {
+      stream_thread_running = TRUE;
+      g_thread_unref (thread);
+    } else {
+      GST_WARNING ("can't start io thread: %s", err->message);
+      g_error_free (err);
+    }
+  }
+  g_cond_signal (&stream_cond);
+  g_mutex_unlock (&stream_lock);
+
+  GST_INFO ("streaming %d frames from %s", st->length, file);
+  return st;
+}
+
+static void
+gstbt_osc_wave_stream_free (GstBtOscWaveStream * st)
+{
+  g_mutex_lock (&stream_lock);
+  streams = g_list_remove (streams, st);
+  g_mutex_unlock (&stream_lock);
+
+  // the io thread might still be reading, it frees the stream then
+  gstbt_osc_wave_stream_unref (st);
+}
+
+static inline const gint16 *
+gstbt_osc_wave_stream_frame (GstBtOscWaveStream * st, gint f)
+{
+  if (f < st->head_frames)
+    return &st->head[f * st->channels];
+  return &st->ring[(f & STREAM_RING_MASK) * st->channels];
+}
+
+static gboolean
+gstbt_osc_wave_create_streamed (GstBtOscWave * self, guint64 off, guint ct,
+    gint16 * dst)
+{
+  GstBtOscWaveStream *st = self->stream;
+  const gint ch = st->channels;
+  gdouble rate = self->rate;
+  guint64 first = off * rate, last = (off + ct) * rate + 1;
+  gint lo, gen = 0;
+  guint64 s, d;
+  gint c;
+
+  if (first >= st->length) {
+    memset (dst, 0, ct * ch * sizeof (gint16));
+    GST_DEBUG ("beyond size");
+    return FALSE;
+  }
+  last = MIN (last, st->length);
+
+  lo = MAX ((gint) first, st->head_frames);
+  if ((gint) last > st->head_frames) {
+    gint start, end;
+
+    gen = g_atomic_int_get (&st->gen);
+    start = g_atomic_int_get (&st->start);
+    end = g_atomic_int_get (&st->end);
+    if ((gen & 1) || lo < start || (gint) last > end) {
+      // underrun, output silence and let the io thread catch up
+      if (!(gen & 1) && (lo < start || lo > end)) {
+        g_atomic_int_set (&st->request, lo);
+      }
+      g_atomic_int_set (&st->read_pos, lo);
+      g_cond_signal (&stream_cond);
+      GST_DEBUG ("underrun at %d, have [%d,%d)", lo, start, end);
+      memset (dst, 0, ct * ch * sizeof (gint16));
+      return FALSE;
+    }
+  }
+
+  for (d = 0; d < ct; d++) {
+    s = (off + d) * rate;
+    if (s < last) {
+      const gint16 *src = gstbt_osc_wave_stream_frame (st, (gint) s);
+      for (c = 0; c < ch; c++)
+        dst[d * ch + c] = src[c];
+    } else {
+      for (c = 0; c < ch; c++)
+        dst[d * ch + c] = 0;
+    }
+  }
+
+  if ((gint) last > st->head_frames) {
+    // check that the io thread did not touch the frames while we copied
+    if (g_atomic_int_get (&st->gen) != gen
+        || g_atomic_int_get (&st->start) > lo) {
+      GST_DEBUG ("frames got overwritten at %d", lo);
+      memset (dst, 0, ct * ch * sizeof (gint16));
+      return FALSE;
+    }
+    g_atomic_int_set (&st->read_pos, lo);
+  }
+  return TRUE;
+}
+
 /**
  * gstbt_osc_wave_setup:
  * @self: the oscillator
@@ -203,23 +524,28 @@ gstbt_osc_wave_setup (GstBtOscWave * self)
   GstStructure *(*get_wave_buffer) (gpointer, guint, guint);
   GstStructure *s;
   GstBtNote root_note;
+  const gchar *file;
+  guint64 offset = 0;
+  gsize size;
 
   if (self->data) {
-    gst_buffer_unmap (self->data, &self->map_info);
+    if (self->map_info.data)
+      gst_buffer_unmap (self->data, &self->map_info);
     gst_buffer_unref (self->data);
     self->data = NULL;
   }
+  memset (&self->map_info, 0, sizeof (GstMapInfo));
   self->process = NULL;
   if (!cb) {
     GST_WARNING_OBJECT (self, "no callbacks set");
-    return;
+    goto Error;
   }
 
   get_wave_buffer = cb[1];
   if (!(s = get_wave_buffer (cb[0], self->wave, self->wave_level))) {
     GST_WARNING_OBJECT (self, "no wave for index=%d, level=%d", self->wave,
         self->wave_level);
-    return;
+    goto Error;
   }
 
   gst_structure_get (s,
@@ -227,14 +553,36 @@ gstbt_osc_wave_setup (GstBtOscWave * self)
       "root-note", GSTBT_TYPE_NOTE, &root_note,
       "buffer", GST_TYPE_BUFFER, &self->data, NULL);
 
-  gst_structure_free (s);
-
   if (!self->data) {
     GST_WARNING_OBJECT (self, "missing buffer");
-    return;
+    gst_structure_free (s);
+    goto Error;
+  }
+  size = gst_buffer_get_size (self->data);
+
+  // long waves come with a file to stream from
+  if ((file = gst_structure_get_string (s, "file")) &&
+      gst_structure_get_uint64 (s, "offset", &offset) &&
+      self->channels > 0 && self->channels <= 2) {
+    // keep the stream when only the frequency changed
+    if (self->stream && (strcmp (self->stream->file, file)
+            || self->stream->offset != offset
+            || self->stream->channels != self->channels)) {
+      gstbt_osc_wave_stream_free (self->stream);
+      self->stream = NULL;
+    }
+    if (!self->stream) {
+      self->stream = gstbt_osc_wave_stream_new (file, offset, self->channels,
+          self->data);
+    }
+  } else if (self->stream) {
+    gstbt_osc_wave_stream_free (self->stream);
+    self->stream = NULL;
   }
+  gst_structure_free (s);
 
-  if (!gst_buffer_map (self->data, &self->map_info, GST_MAP_READ)) {
+  if (!self->stream
+      && !gst_buffer_map (self->data, &self->map_info, GST_MAP_READ)) {
     GST_WARNING_OBJECT (self, "unable to map buffer for read");
     return;
   }
@@ -249,11 +597,13 @@ gstbt_osc_wave_setup (GstBtOscWave * self)
 
   GST_INFO_OBJECT (self, "got wave with %d channels", self->channels);
 
-  self->duration = self->map_info.size / (self->rate * sizeof (gint16));
+  self->duration = size / (self->rate * sizeof (gint16));
 
   switch (self->channels) {
     case 1:
-      if (self->rate == 1.0) {
+      if (self->stream) {
+        self->process = gstbt_osc_wave_create_streamed;
+      } else if (self->rate == 1.0) {
         self->process = gstbt_osc_wave_create_mono;
       } else {
         self->process = gstbt_osc_wave_create_mono_resampled;
@@ -261,7 +611,9 @@ gstbt_osc_wave_setup (GstBtOscWave * self)
       break;
     case 2:
       self->duration >>= 1;
-      if (self->rate == 1.0) {
+      if (self->stream) {
+        self->process = gstbt_osc_wave_create_streamed;
+      } else if (self->rate == 1.0) {
         self->process = gstbt_osc_wave_create_stereo;
       } else {
         self->process = gstbt_osc_wave_create_stereo_resampled;
@@ -275,6 +627,12 @@ gstbt_osc_wave_setup (GstBtOscWave * self)
 
   GST_INFO_OBJECT (self, "duration at rate %lf is %" G_GUINT64_FORMAT,
       self->rate, self->duration);
+  return;
+Error:
+  if (self->stream) {
+    gstbt_osc_wave_stream_free (self->stream);
+    self->stream = NULL;
+  }
 }
 
 //-- public methods
@@ -347,9 +705,12 @@ gstbt_osc_wave_dispose (GObject * object)
   if (self->n2f)
     g_object_unref (self->n2f);
   if (self->data) {
-    gst_buffer_unmap (self->data, &self->map_info);
+    if (self->map_info.data)
+      gst_buffer_unmap (self->data, &self->map_info);
     gst_buffer_unref (self->data);
   }
+  if (self->stream)
+    gstbt_osc_wave_stream_free (self->stream);
 
   G_OBJECT_CLASS (gstbt_osc_wave_parent_class)->dispose (object);
 }
@@ -34,6 +34,7 @@ G_BEGIN_DECLS
 
 typedef struct _GstBtOscWave GstBtOscWave;
 typedef struct _GstBtOscWaveClass GstBtOscWaveClass;
+typedef struct _GstBtOscWaveStream GstBtOscWaveStream;
 
 /**
  * GstBtOscWave:
@@ -57,6 +58,7 @@ struct _GstBtOscWave {
   gint channels;
   gdouble rate;
   guint64 duration;
+  GstBtOscWaveStream *stream;
 
   /* < private > */
   gboolean (*process) (GstBtOscWave *, guint64, guint, gint16 *);  
@@ -114,6 +114,47 @@ gstbt_audio_tempo_context_get_tempo (GstContext * ctx, guint * bpm, guint * tpb,
   return res;
 }
 
+/**
+ * gstbt_audio_tempo_context_set_buffer_frames:
+ * @ctx: a writable context
+ * @frames: the buffer size in frames, 0 to render one sub-tick per buffer
+ *
+ * Sources render one sub-tick per buffer by default. At high tempos this makes
+ * the buffers tiny and the per buffer overhead dominates. Setting a fixed
+ * buffer size makes sources render @frames sized buffers and split the
+ * processing at the sub-tick boundaries internally.
+ */
+void
+gstbt_audio_tempo_context_set_buffer_frames (GstContext * ctx, guint frames)
+{
+  GstStructure *s = gst_context_writable_structure (ctx);
+
+  gst_structure_set (s, "buffer-frames", G_TYPE_UINT, frames, NULL);
+}
+
+/**
+ * gstbt_audio_tempo_context_get_buffer_frames:
+ * @ctx: the context
+ * @frames: the buffer size in frames
+ *
+ * Get the buffer size from the audio-tempo context. See
+ * gstbt_audio_tempo_context_set_buffer_frames().
+ *
+ * Returns: %FALSE if the context if of the wrong type or has no buffer size.
+ */
+gboolean
+gstbt_audio_tempo_context_get_buffer_frames (GstContext * ctx, guint * frames)
+{
+  if (!ctx)
+    return FALSE;
+
+  if (!gst_context_has_context_type (ctx, GSTBT_AUDIO_TEMPO_TYPE))
+    return FALSE;
+
+  return gst_structure_get_uint (gst_context_get_structure (ctx),
+      "buffer-frames", frames);
+}
+
 #if 0
 // extra value calculated in the app from latency in ms
 guint stpb = (glong) ((GST_SECOND * 60) / (bpm * tpb * latency * GST_MSECOND));
@@ -29,6 +29,8 @@ G_BEGIN_DECLS
 
 GstContext *gstbt_audio_tempo_context_new (guint bpm, guint tpb, guint stpb);
 gboolean gstbt_audio_tempo_context_get_tempo (GstContext *ctx, guint *bpm, guint *tpb, guint *stpb);
+void gstbt_audio_tempo_context_set_buffer_frames (GstContext *ctx, guint frames);
+gboolean gstbt_audio_tempo_context_get_buffer_frames (GstContext *ctx, guint *frames);
 
 G_END_DECLS
 
@@ -425,6 +425,8 @@ bt_cmd_application_info (const BtCmdApplication * self,
         input_file_name, err->message);
     goto Error;
   }
+  // we only print the wave meta data, don't decode the samples
+  g_object_set (loader, "wave-data", FALSE, NULL);
 
   if (!bt_song_io_load (loader, song, &err)) {
     g_fprintf (stderr, "could not load song \"%s\": %s\n", input_file_name,
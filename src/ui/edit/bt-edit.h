@@ -86,6 +86,7 @@
 #include "main-statusbar.h"
 #include "main-toolbar.h"
 #include "main-window.h"
+#include "meter-hub.h"
 #include "missing-framework-elements-dialog.h"
 #include "missing-song-elements-dialog.h"
 #include "object-list-model.h"
@@ -26,7 +26,23 @@
  * recovery. Groups are logged atomically, when they are closed (to have a
  * recoverable log).
  *
+ * The log is a binary journal of length prefixed and checksummed records. A
+ * writer thread appends the records in batches and syncs the file at most
+ * once a second. When the journal grew a lot since the last
+ * save (e.g. from undoing and redoing large edits), it is rewritten with only
+ * the changes that are still applied.
+ *
  * Logs are reset when saving a song. The log is removed when a song is closed.
+ * Text logs written by older versions can still be recovered.
+ *
+ * Changes of a single value group column can be added with
+ * bt_change_log_add_column(). Those pass the packed column to the owner on
+ * undo and redo, so that it does not need to parse the values.
+ *
+ * The memory used by the undo history is limited by
+ * #BtSettings:undo-memory-budget. When it is exceeded, the data of the oldest
+ * changes is compressed and if that is not enough, the oldest changes are
+ * dropped.
  *
  * #BtEditApplication checks for left-over logs at startup and uses
  * #BtCrashRecoverDialog to offer a list of recoverable songs to the user.
@@ -157,7 +173,26 @@
  * - groups could be hierarchical, but are applied only as a whole
  * - bt_change_log_undo/redo would need to check for groups and in that case loop
  *   over the group
- * - the log-file serialisation can ignore the groups
+ * - the log-file serialisation writes each top-level group as one record
+ */
+/* design: the journal file
+ * - the file starts with JOURNAL_MAGIC, followed by records
+ * - a record is: guint32 size, guint32 checksum (both little endian) and
+ *   size bytes payload, the payload starts with a JournalRecordType byte
+ *   - JOURNAL_RECORD_SONG: the song file name, empty for unsaved songs
+ *   - JOURNAL_RECORD_OWNER: guint8 owner id, owner type name
+ *   - JOURNAL_RECORD_CHANGES: a list of: guint8 owner id, guint32 size,
+ *     size bytes redo data (including the terminating '\0'), one record is one
+ *     ungrouped change or one top-level group
+ *   - JOURNAL_RECORD_COMMENT: text for debugging, ignored on replay
+ * - a short record or a record with a wrong checksum ends the journal, this
+ *   happens if the application died while writing it
+ * - owner ids are assigned per journal, as owners are logged the first time
+ * - records are queued from the main thread in journal_commit() and appended
+ *   to the file by journal_writer_func() in one write() per batch
+ * - when the journal grew above journal_compact_size, journal_compact() builds
+ *   a new journal from the applied changes and the writer thread replaces the
+ *   file
  */
 
 #define BT_EDIT
@@ -166,6 +201,8 @@
 #include "bt-edit.h"
 #include <glib/gstdio.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 //-- property ids
 
@@ -173,7 +210,8 @@ enum
 {
   CHANGE_LOG_CAN_UNDO = 1,
   CHANGE_LOG_CAN_REDO,
-  CHANGE_LOG_CRASH_LOGS
+  CHANGE_LOG_CRASH_LOGS,
+  CHANGE_LOG_SERIAL
 };
 
 //-- structs
@@ -189,14 +227,36 @@ typedef struct
   BtChangeLogEntryType type;
 } BtChangeLogEntry;
 
+/* undo or redo data, shared if the undo and redo data of a change or the redo
+ * data of a change and the undo data of the next one are the same */
+typedef struct
+{
+  gint ref_count;
+  /* size of the string including the '\0' */
+  gsize size;
+  /* the string or the compressed string */
+  gchar *str;
+  GBytes *packed;
+  /* the value group column, see bt_value_group_pack_column_range() */
+  GBytes *column;
+} BtChangeLogData;
+
 typedef struct
 {
   BtChangeLogEntryType type;
   BtChangeLogger *owner;
-  gchar *undo_data;
-  gchar *redo_data;
+  BtChangeLogData *undo_data;
+  BtChangeLogData *redo_data;
 } BtChangeLogEntrySingle;
 
+typedef enum
+{
+  JOURNAL_RECORD_SONG = 0,
+  JOURNAL_RECORD_OWNER,
+  JOURNAL_RECORD_CHANGES,
+  JOURNAL_RECORD_COMMENT
+} JournalRecordType;
+
 typedef struct _BtChangeLogEntryGroup BtChangeLogEntryGroup;
 struct _BtChangeLogEntryGroup
 {
@@ -217,11 +277,28 @@ struct _BtChangeLogPrivate
    * replaying and undo/redo action */
   gboolean is_active;
 
-  /* log file */
-  FILE *log_file;
+  /* log file, owned by the writer thread while it runs */
+  gint log_fd;
   gchar *log_file_name;
   gchar *cache_dir;
 
+  /* journal writer, the lock protects the pending data, the replacement, the
+   * quit flag and the log_file_name */
+  GThread *journal_writer;
+  GMutex journal_lock;
+  GCond journal_cond;
+  GByteArray *journal_pending;
+  GByteArray *journal_replace;
+  gboolean journal_quit;
+  /* records of the next commit, only used from the main thread */
+  GHashTable *journal_owners;
+  GByteArray *journal_owner_records, *journal_changes, *journal_comments;
+  /* the journal header and changes copied from a recovered journal, each
+   * compacted journal starts with it */
+  GByteArray *journal_base;
+  /* size of the journal and size at which to compact it */
+  gsize journal_size, journal_compact_size;
+
   /* known ChangeLoggers */
   GHashTable *loggers;
 
@@ -232,6 +309,18 @@ struct _BtChangeLogPrivate
   gint next_undo;               // -1 for none, or just have pointers?
   gint item_ct;                 // same as changed->len, but also accesible when changes=NULL
   BtChangeLogEntryGroup *cur_group;
+  /* incremented for each change, undo and redo */
+  guint serial;
+
+  /* memory used for undo/redo data and the limit for it (0 for none) */
+  BtSettings *settings;
+  guint64 history_size, history_budget;
+  /* changes before this index have been compressed */
+  guint history_packed;
+  /* the oldest changes have been dropped, the journal can't be rebuilt */
+  gboolean history_trimmed;
+  /* the last change that was added, to share data with the next one */
+  BtChangeLogEntrySingle *last_single;
 
   /* crash log entries */
   GList *crash_logs;
@@ -245,6 +334,16 @@ struct _BtChangeLogPrivate
 static BtChangeLog *singleton = NULL;
 
 #define BT_CHANGE_LOG_MAX_HEADER_LINE_LEN 200
+#define JOURNAL_MAGIC "BTJOURNAL1"
+#define JOURNAL_RECORD_HEADER_SIZE (2 * sizeof (guint32))
+// size of a change in a JOURNAL_RECORD_CHANGES record, without the data
+#define JOURNAL_CHANGE_HEADER_SIZE (1 + sizeof (guint32))
+// max. time between writing to the journal and syncing it to disk
+#define JOURNAL_SYNC_INTERVAL G_USEC_PER_SEC
+// journal size from which on we compact the journal
+#define JOURNAL_COMPACT_SIZE (1024 * 1024)
+// don't compress undo/redo data that is smaller
+#define HISTORY_PACK_MIN_SIZE 256
 // date time stamp format YYYY-MM-DDThh:mm:ssZ
 #define DTS_LEN 20
 
@@ -255,14 +354,135 @@ G_DEFINE_TYPE_WITH_CODE (BtChangeLog, bt_change_log, G_TYPE_OBJECT,
 
 //-- helper
 
+static BtChangeLogData *
+change_log_data_new (BtChangeLog * self, gchar * str, GBytes * column)
+{
+  BtChangeLogData *data = g_slice_new0 (BtChangeLogData);
+
+  data->ref_count = 1;
+  data->size = strlen (str) + 1;
+  data->str = str;
+  self->priv->history_size += data->size;
+  if (column) {
+    data->column = column;
+    self->priv->history_size += g_bytes_get_size (column);
+  }
+  return data;
+}
+
+static BtChangeLogData *
+change_log_data_ref (BtChangeLogData * data)
+{
+  data->ref_count++;
+  return data;
+}
+
+static void
+change_log_data_unref (BtChangeLog * self, BtChangeLogData * data)
+{
+  if (--data->ref_count)
+    return;
+
+  if (data->packed) {
+    self->priv->history_size -= g_bytes_get_size (data->packed);
+    g_bytes_unref (data->packed);
+  } else {
+    self->priv->history_size -= data->size;
+    g_free (data->str);
+  }
+  if (data->column) {
+    self->priv->history_size -= g_bytes_get_size (data->column);
+    g_bytes_unref (data->column);
+  }
+  g_slice_free (BtChangeLogData, data);
+}
+
+/* check if the data has the given string and column, compressed data is never
+ * equal */
+static gboolean
+change_log_data_equal (BtChangeLogData * data, const gchar * str,
+    GBytes * column)
+{
+  if (!data->str || strcmp (str, data->str))
+    return FALSE;
+  if (column && data->column)
+    return g_bytes_equal (column, data->column);
+  return column == data->column;
+}
+
+/* get the string, compressed data is unpacked to *tmp which needs to be freed
+ * after use */
+static const gchar *
+change_log_data_get (BtChangeLogData * data, gchar ** tmp)
+{
+  GConverter *conv;
+  gconstpointer packed;
+  gsize packed_size, bytes_read, bytes_written;
+
+  *tmp = NULL;
+  if (!data->packed)
+    return data->str;
+
+  packed = g_bytes_get_data (data->packed, &packed_size);
+  conv = (GConverter *)
+      g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW);
+  *tmp = g_malloc (data->size);
+  if (g_converter_convert (conv, packed, packed_size, *tmp, data->size,
+          G_CONVERTER_INPUT_AT_END, &bytes_read, &bytes_written,
+          NULL) != G_CONVERTER_FINISHED || bytes_written != data->size) {
+    GST_WARNING ("failed to unpack undo/redo data");
+    (*tmp)[0] = '\0';
+  }
+  g_object_unref (conv);
+  return *tmp;
+}
+
 static void
-free_change_log_entry (BtChangeLogEntry * cle)
+change_log_data_pack (BtChangeLog * self, BtChangeLogData * data)
+{
+  GConverter *conv;
+  gsize bytes_read, bytes_written, size;
+  guint8 *packed;
+
+  if (data->packed || data->size < HISTORY_PACK_MIN_SIZE)
+    return;
+
+  // enough room for data that does not compress
+  size = data->size + data->size / 1000 + 64;
+  packed = g_malloc (size);
+  conv = (GConverter *) g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW,
+      1);
+  if (g_converter_convert (conv, data->str, data->size, packed, size,
+          G_CONVERTER_INPUT_AT_END, &bytes_read, &bytes_written,
+          NULL) == G_CONVERTER_FINISHED && bytes_written < data->size) {
+    data->packed = g_bytes_new_take (g_realloc (packed, bytes_written),
+        bytes_written);
+    self->priv->history_size -= data->size - bytes_written;
+    g_free (data->str);
+    data->str = NULL;
+  } else {
+    g_free (packed);
+  }
+  g_object_unref (conv);
+}
+
+static void
+clear_change_log_entry_single (BtChangeLog * self,
+    BtChangeLogEntrySingle * cles)
+{
+  change_log_data_unref (self, cles->undo_data);
+  change_log_data_unref (self, cles->redo_data);
+  if (self->priv->last_single == cles)
+    self->priv->last_single = NULL;
+}
+
+static void
+free_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle)
 {
   switch (cle->type) {
     case CHANGE_LOG_ENTRY_SINGLE:{
       BtChangeLogEntrySingle *cles = (BtChangeLogEntrySingle *) cle;
-      g_free (cles->undo_data);
-      g_free (cles->redo_data);
+      clear_change_log_entry_single (self, cles);
       g_slice_free (BtChangeLogEntrySingle, cles);
       break;
     }
@@ -272,7 +492,7 @@ free_change_log_entry (BtChangeLogEntry * cle)
 
       // recurse
       for (i = 0; i < cleg->changes->len; i++) {
-        free_change_log_entry (g_ptr_array_index (cleg->changes, i));
+        free_change_log_entry (self, g_ptr_array_index (cleg->changes, i));
       }
       g_ptr_array_free (cleg->changes, TRUE);
       g_slice_free (BtChangeLogEntryGroup, cleg);
@@ -282,45 +502,181 @@ free_change_log_entry (BtChangeLogEntry * cle)
 }
 
 static void
-log_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle)
+pack_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle)
 {
-  if (!self->priv->log_file)
+  switch (cle->type) {
+    case CHANGE_LOG_ENTRY_SINGLE:{
+      BtChangeLogEntrySingle *cles = (BtChangeLogEntrySingle *) cle;
+      change_log_data_pack (self, cles->undo_data);
+      change_log_data_pack (self, cles->redo_data);
+      break;
+    }
+    case CHANGE_LOG_ENTRY_GROUP:{
+      BtChangeLogEntryGroup *cleg = (BtChangeLogEntryGroup *) cle;
+      guint i;
+
+      for (i = 0; i < cleg->changes->len; i++) {
+        pack_change_log_entry (self, g_ptr_array_index (cleg->changes, i));
+      }
+      break;
+    }
+  }
+}
+
+/* keep the undo history within the memory budget, by compressing the oldest
+ * changes first and then dropping the oldest changes that can be undone */
+static void
+trim_history (BtChangeLog * self)
+{
+  BtChangeLogPrivate *p = self->priv;
+  guint i;
+  gint n;
+
+  if (!p->history_budget || p->cur_group
+      || p->history_size <= p->history_budget)
     return;
 
+  // compress all but the latest change
+  for (i = p->history_packed; (i + 1) < p->changes->len
+      && p->history_size > p->history_budget; i++) {
+    pack_change_log_entry (self, g_ptr_array_index (p->changes, i));
+  }
+  p->history_packed = i;
+
+  // drop the oldest changes, but keep the one we would undo next
+  for (n = 0; n < p->next_undo && p->history_size > p->history_budget; n++) {
+    free_change_log_entry (self, g_ptr_array_index (p->changes, n));
+  }
+  if (n) {
+    GST_INFO ("dropped %d changes from the undo history", n);
+    g_ptr_array_remove_range (p->changes, 0, n);
+    p->next_undo -= n;
+    p->next_redo -= n;
+    p->item_ct -= n;
+    p->history_packed -= MIN (p->history_packed, n);
+    p->history_trimmed = TRUE;
+  }
+}
+
+static guint32
+journal_checksum (guint8 type, const guint8 * data, gsize size)
+{
+  // FNV-1a
+  guint32 hash = (2166136261U ^ type) * 16777619U;
+  gsize i;
+
+  for (i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * 16777619U;
+  }
+  return hash;
+}
+
+static void
+journal_put_record (GByteArray * dst, guint8 type, const guint8 * data,
+    gsize size)
+{
+  guint32 header[2];
+
+  header[0] = GUINT32_TO_LE (size + 1);
+  header[1] = GUINT32_TO_LE (journal_checksum (type, data, size));
+  g_byte_array_append (dst, (const guint8 *) header, sizeof (header));
+  g_byte_array_append (dst, &type, 1);
+  g_byte_array_append (dst, data, size);
+}
+
+static void
+journal_add_change (BtChangeLog * self, const gchar * owner_name,
+    const gchar * data)
+{
+  BtChangeLogPrivate *p = self->priv;
+  gpointer id;
+  guint8 owner_id;
+  guint32 size = GUINT32_TO_LE (strlen (data) + 1);
+
+  // owner_name is the static type name of a logger
+  if (!(id = g_hash_table_lookup (p->journal_owners, owner_name))) {
+    guint n = g_hash_table_size (p->journal_owners);
+    gsize len = strlen (owner_name);
+    guint8 *rec;
+
+    g_return_if_fail (n <= G_MAXUINT8);
+    owner_id = (guint8) n;
+    g_hash_table_insert (p->journal_owners, (gpointer) owner_name,
+        GUINT_TO_POINTER (n + 1));
+
+    rec = g_malloc (len + 1);
+    rec[0] = owner_id;
+    memcpy (&rec[1], owner_name, len);
+    journal_put_record (p->journal_owner_records, JOURNAL_RECORD_OWNER, rec,
+        len + 1);
+    g_free (rec);
+  } else {
+    owner_id = (guint8) (GPOINTER_TO_UINT (id) - 1);
+  }
+  g_byte_array_append (p->journal_changes, &owner_id, 1);
+  g_byte_array_append (p->journal_changes, (const guint8 *) &size,
+      sizeof (size));
+  g_byte_array_append (p->journal_changes, (const guint8 *) data,
+      GUINT32_FROM_LE (size));
+}
+
+#ifdef USE_DEBUG
+static void
+journal_add_comment (BtChangeLog * self, const gchar * format, ...)
+{
+  gchar *text;
+  va_list args;
+
+  va_start (args, format);
+  text = g_strdup_vprintf (format, args);
+  va_end (args);
+  journal_put_record (self->priv->journal_comments, JOURNAL_RECORD_COMMENT,
+      (const guint8 *) text, strlen (text));
+  g_free (text);
+}
+#endif
+
+/* add the redo or undo data of the entry to the next journal record */
+static void
+journal_add_entry (BtChangeLog * self, BtChangeLogEntry * cle, gboolean redo)
+{
   switch (cle->type) {
     case CHANGE_LOG_ENTRY_SINGLE:{
       BtChangeLogEntrySingle *cles = (BtChangeLogEntrySingle *) cle;
+      gchar *tmp;
 
-      GST_DEBUG ("logging change %p", cle);
       // owners are the editor objects where the change was made
-      fprintf (self->priv->log_file, "%s::%s\n",
-          G_OBJECT_TYPE_NAME (cles->owner), cles->redo_data);
+      journal_add_change (self, G_OBJECT_TYPE_NAME (cles->owner),
+          change_log_data_get (redo ? cles->redo_data : cles->undo_data,
+              &tmp));
+      g_free (tmp);
 #ifdef USE_DEBUG
       if (self->priv->debug_mode) {
-        fprintf (self->priv->log_file, "# undo: %s\n", cles->undo_data);
+        journal_add_comment (self, "undo: %s",
+            change_log_data_get (redo ? cles->undo_data : cles->redo_data,
+                &tmp));
+        g_free (tmp);
       }
 #endif
-      // IDEA(ensonic): should we fdatasync(fileno(self->priv->log_file)); from
-      // time to time
       break;
     }
     case CHANGE_LOG_ENTRY_GROUP:{
       BtChangeLogEntryGroup *cleg = (BtChangeLogEntryGroup *) cle;
-      gint i;
+      gint i, l = cleg->changes->len;
 
-      GST_DEBUG ("logging group %p", cle);
 #ifdef USE_DEBUG
       if (self->priv->debug_mode) {
-        fprintf (self->priv->log_file, "# {\n");
+        journal_add_comment (self, "{");
       }
 #endif
-      // recurse, apply from end to start of group
-      for (i = cleg->changes->len - 1; i >= 0; i--) {
-        log_change_log_entry (self, g_ptr_array_index (cleg->changes, i));
+      // recurse, in the order the changes get applied
+      for (i = 0; i < l; i++) {
+        journal_add_entry (self, g_ptr_array_index (cleg->changes,
+                redo ? i : (l - 1) - i), redo);
       }
 #ifdef USE_DEBUG
       if (self->priv->debug_mode) {
-        fprintf (self->priv->log_file, "# }\n");
+        journal_add_comment (self, "}");
       }
 #endif
       break;
@@ -330,6 +686,218 @@ log_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle)
   }
 }
 
+/* move the collected changes as one record to dst */
+static void
+journal_flush (BtChangeLog * self, GByteArray * dst)
+{
+  BtChangeLogPrivate *p = self->priv;
+
+  if (p->journal_changes->len) {
+    g_byte_array_append (dst, p->journal_owner_records->data,
+        p->journal_owner_records->len);
+    journal_put_record (dst, JOURNAL_RECORD_CHANGES, p->journal_changes->data,
+        p->journal_changes->len);
+    g_byte_array_append (dst, p->journal_comments->data,
+        p->journal_comments->len);
+  }
+  g_byte_array_set_size (p->journal_owner_records, 0);
+  g_byte_array_set_size (p->journal_changes, 0);
+  g_byte_array_set_size (p->journal_comments, 0);
+}
+
+/* hand the collected changes to the writer thread, changes replayed from a
+ * recovered journal are kept, as they are not in the undo stack */
+static void
+journal_commit (BtChangeLog * self, gboolean keep)
+{
+  BtChangeLogPrivate *p = self->priv;
+  guint len;
+
+  g_mutex_lock (&p->journal_lock);
+  len = p->journal_pending->len;
+  journal_flush (self, p->journal_pending);
+  if (keep) {
+    g_byte_array_append (p->journal_base, &p->journal_pending->data[len],
+        p->journal_pending->len - len);
+  }
+  p->journal_size += p->journal_pending->len - len;
+  g_cond_signal (&p->journal_cond);
+  g_mutex_unlock (&p->journal_lock);
+}
+
+/* replace the journal by one with only the applied changes, once it got too
+ * big (e.g. by undoing and redoing large edits) */
+static void
+journal_compact (BtChangeLog * self)
+{
+  BtChangeLogPrivate *p = self->priv;
+  GByteArray *journal;
+  gint i;
+
+  if (!p->journal_writer || p->cur_group || p->history_trimmed
+      || p->journal_size < p->journal_compact_size)
+    return;
+
+  journal = g_byte_array_sized_new (p->journal_size / 2);
+  g_byte_array_append (journal, p->journal_base->data, p->journal_base->len);
+  g_hash_table_remove_all (p->journal_owners);
+  for (i = 0; i < p->next_redo; i++) {
+    journal_add_entry (self, g_ptr_array_index (p->changes, i), TRUE);
+    journal_flush (self, journal);
+  }
+  GST_INFO ("compacting journal: %" G_GSIZE_FORMAT " -> %u bytes",
+      p->journal_size, journal->len);
+
+  g_mutex_lock (&p->journal_lock);
+  // the new journal already contains all pending changes
+  g_byte_array_set_size (p->journal_pending, 0);
+  if (p->journal_replace)
+    g_byte_array_unref (p->journal_replace);
+  p->journal_replace = journal;
+  p->journal_size = journal->len;
+  g_cond_signal (&p->journal_cond);
+  g_mutex_unlock (&p->journal_lock);
+
+  p->journal_compact_size = MAX (JOURNAL_COMPACT_SIZE, 2 * p->journal_size);
+}
+
+static void
+log_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle,
+    gboolean redo)
+{
+  if (!self->priv->journal_writer)
+    return;
+
+  GST_DEBUG ("logging change %p", cle);
+  journal_add_entry (self, cle, redo);
+  journal_commit (self, FALSE);
+}
+
+static gboolean
+journal_write (gint fd, const guint8 * data, gsize size)
+{
+  while (size) {
+    gssize written = write (fd, data, size);
+
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      GST_WARNING ("failed writing the journal: %s", g_strerror (errno));
+      return FALSE;
+    }
+    data += written;
+    size -= written;
+  }
+  return TRUE;
+}
+
+static void
+journal_sync (gint fd)
+{
+#ifdef HAVE_FDATASYNC
+  fdatasync (fd);
+#else
+  fsync (fd);
+#endif
+}
+
+/* write the compacted journal and swap it with the log file, runs in the
+ * writer thread */
+static void
+journal_replace_file (BtChangeLog * self, GByteArray * journal)
+{
+  BtChangeLogPrivate *p = self->priv;
+  gchar *tmp_file_name;
+  gint fd;
+
+  g_mutex_lock (&p->journal_lock);
+  tmp_file_name = g_strconcat (p->log_file_name, ".tmp", NULL);
+  g_mutex_unlock (&p->journal_lock);
+
+  if ((fd = g_open (tmp_file_name, O_WRONLY | O_CREAT | O_TRUNC,
+              S_IRUSR | S_IWUSR)) == -1) {
+    GST_WARNING ("can't open log file '%s' : %d : %s", tmp_file_name, errno,
+        g_strerror (errno));
+    g_free (tmp_file_name);
+    return;
+  }
+  if (journal_write (fd, journal->data, journal->len)) {
+    journal_sync (fd);
+    // the log might have been renamed in the meantime
+    g_mutex_lock (&p->journal_lock);
+    if (!g_rename (tmp_file_name, p->log_file_name)) {
+      close (p->log_fd);
+      p->log_fd = fd;
+      fd = -1;
+    } else {
+      GST_WARNING ("failed renaming '%s' to '%s': %s", tmp_file_name,
+          p->log_file_name, g_strerror (errno));
+    }
+    g_mutex_unlock (&p->journal_lock);
+  }
+  if (fd != -1) {
+    close (fd);
+    g_unlink (tmp_file_name);
+  }
+  g_free (tmp_file_name);
+}
+
+/* append the pending records to the log file, multiple commits are written
+ * together and synced at most every JOURNAL_SYNC_INTERVAL */
+static gpointer
+journal_writer_func (gpointer user_data)
+{
+  BtChangeLog *self = BT_CHANGE_LOG (user_data);
+  BtChangeLogPrivate *p = self->priv;
+  GByteArray *data = g_byte_array_new (), *journal, *tmp;
+  gint64 last_sync = 0;
+  gboolean dirty = FALSE, quit;
+
+  g_mutex_lock (&p->journal_lock);
+  for (;;) {
+    while (!p->journal_pending->len && !p->journal_replace
+        && !p->journal_quit) {
+      if (!dirty) {
+        g_cond_wait (&p->journal_cond, &p->journal_lock);
+      } else if (!g_cond_wait_until (&p->journal_cond, &p->journal_lock,
+              last_sync + JOURNAL_SYNC_INTERVAL)) {
+        break;
+      }
+    }
+    quit = p->journal_quit;
+    journal = p->journal_replace;
+    p->journal_replace = NULL;
+    tmp = p->journal_pending;
+    p->journal_pending = data;
+    data = tmp;
+    g_mutex_unlock (&p->journal_lock);
+
+    if (journal) {
+      journal_replace_file (self, journal);
+      g_byte_array_unref (journal);
+      last_sync = g_get_monotonic_time ();
+      dirty = FALSE;
+    }
+    if (data->len) {
+      journal_write (p->log_fd, data->data, data->len);
+      g_byte_array_set_size (data, 0);
+      dirty = TRUE;
+    }
+    if (quit)
+      break;
+    // the log is removed when closing, so we only need to sync while running
+    if (dirty
+        && (g_get_monotonic_time () - last_sync) >= JOURNAL_SYNC_INTERVAL) {
+      journal_sync (p->log_fd);
+      last_sync = g_get_monotonic_time ();
+      dirty = FALSE;
+    }
+    g_mutex_lock (&p->journal_lock);
+  }
+  g_byte_array_unref (data);
+  return NULL;
+}
+
 static void
 add_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle)
 {
@@ -342,10 +910,12 @@ add_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle)
 
       GST_WARNING ("trunc %d<%d", self->priv->next_redo, self->priv->item_ct);
       for (i = self->priv->item_ct - 1; i >= self->priv->next_redo; i--) {
-        free_change_log_entry (g_ptr_array_remove_index (self->priv->changes,
-                i));
+        free_change_log_entry (self,
+            g_ptr_array_remove_index (self->priv->changes, i));
         self->priv->item_ct--;
       }
+      self->priv->history_packed =
+          MIN (self->priv->history_packed, self->priv->item_ct);
     }
     /*else {
        GST_INFO("don't trunc %d>=%d",self->priv->next_redo,self->priv->item_ct);
@@ -357,6 +927,7 @@ add_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle)
     // update undo undo/redo pointers
     self->priv->next_undo++;
     self->priv->next_redo++;
+    self->priv->serial++;
     GST_INFO ("add %d, %d", self->priv->next_undo, self->priv->next_redo);
     //GST_INFO("add %d[%s], %d[%s]",self->priv->next_undo,undo_data,self->priv->next_redo,redo_data);
     if (self->priv->next_undo == 0) {
@@ -368,6 +939,21 @@ add_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle)
   }
 }
 
+/* apply the data, with the packed column if we have it */
+static void
+apply_change_log_data (BtChangeLogger * owner, BtChangeLogData * data)
+{
+  gchar *tmp;
+  const gchar *str = change_log_data_get (data, &tmp);
+
+  if (data->column) {
+    bt_change_logger_change_column (owner, str, data->column);
+  } else {
+    bt_change_logger_change (owner, str);
+  }
+  g_free (tmp);
+}
+
 static void
 undo_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle)
 {
@@ -375,16 +961,7 @@ undo_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle)
     case CHANGE_LOG_ENTRY_SINGLE:{
       BtChangeLogEntrySingle *cles = (BtChangeLogEntrySingle *) cle;
 
-      bt_change_logger_change (cles->owner, cles->undo_data);
-      if (self->priv->log_file) {
-        fprintf (self->priv->log_file, "%s::%s\n",
-            G_OBJECT_TYPE_NAME (cles->owner), cles->undo_data);
-#ifdef USE_DEBUG
-        if (self->priv->debug_mode) {
-          fprintf (self->priv->log_file, "# undo: %s\n", cles->redo_data);
-        }
-#endif
-      }
+      apply_change_log_data (cles->owner, cles->undo_data);
       break;
     }
     case CHANGE_LOG_ENTRY_GROUP:{
@@ -392,20 +969,10 @@ undo_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle)
       gint i;
 
       GST_DEBUG ("undo group %p", cle);
-#ifdef USE_DEBUG
-      if (self->priv->debug_mode) {
-        fprintf (self->priv->log_file, "# {\n");
-      }
-#endif
       // recurse, apply from end to start of group
       for (i = cleg->changes->len - 1; i >= 0; i--) {
         undo_change_log_entry (self, g_ptr_array_index (cleg->changes, i));
       }
-#ifdef USE_DEBUG
-      if (self->priv->debug_mode) {
-        fprintf (self->priv->log_file, "# }\n");
-      }
-#endif
       break;
     }
     default:
@@ -419,16 +986,8 @@ redo_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle)
   switch (cle->type) {
     case CHANGE_LOG_ENTRY_SINGLE:{
       BtChangeLogEntrySingle *cles = (BtChangeLogEntrySingle *) cle;
-      bt_change_logger_change (cles->owner, cles->redo_data);
-      if (self->priv->log_file) {
-        fprintf (self->priv->log_file, "%s::%s\n",
-            G_OBJECT_TYPE_NAME (cles->owner), cles->redo_data);
-#ifdef USE_DEBUG
-        if (self->priv->debug_mode) {
-          fprintf (self->priv->log_file, "# undo: %s\n", cles->undo_data);
-        }
-#endif
-      }
+
+      apply_change_log_data (cles->owner, cles->redo_data);
       break;
     }
     case CHANGE_LOG_ENTRY_GROUP:{
@@ -436,20 +995,10 @@ redo_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle)
       gint i;
 
       GST_DEBUG ("redo group %p", cle);
-#ifdef USE_DEBUG
-      if (self->priv->debug_mode) {
-        fprintf (self->priv->log_file, "# {\n");
-      }
-#endif
       // recurse, apply from start to end of group
       for (i = 0; i < cleg->changes->len; i++) {
         redo_change_log_entry (self, g_ptr_array_index (cleg->changes, i));
       }
-#ifdef USE_DEBUG
-      if (self->priv->debug_mode) {
-        fprintf (self->priv->log_file, "# }\n");
-      }
-#endif
       break;
     }
     default:
@@ -457,30 +1006,89 @@ redo_change_log_entry (BtChangeLog * self, BtChangeLogEntry * cle)
   }
 }
 
+/* set the data of a new change, shared with the redo data or the previous
+ * change if possible, takes ownership of the data */
 static void
-close_and_free_log (BtChangeLog * self)
+change_log_entry_single_init (BtChangeLog * self,
+    BtChangeLogEntrySingle * cle, BtChangeLogger * owner, gchar * undo_data,
+    gchar * redo_data, GBytes * undo_column, GBytes * redo_column)
 {
-  self->priv->is_active = FALSE;
+  BtChangeLogEntrySingle *last = self->priv->last_single;
+
+  cle->owner = owner;
+  GST_INFO ("add %d[%s], %d[%s]", self->priv->next_undo, undo_data,
+      self->priv->next_redo, redo_data);
+  cle->redo_data = change_log_data_new (self, redo_data, redo_column);
+  if (change_log_data_equal (cle->redo_data, undo_data, undo_column)) {
+    cle->undo_data = change_log_data_ref (cle->redo_data);
+  } else if (last && last->owner == owner
+      && change_log_data_equal (last->redo_data, undo_data, undo_column)) {
+    cle->undo_data = change_log_data_ref (last->redo_data);
+  } else {
+    cle->undo_data = change_log_data_new (self, undo_data, undo_column);
+    undo_data = NULL;
+    undo_column = NULL;
+  }
+  g_free (undo_data);
+  if (undo_column)
+    g_bytes_unref (undo_column);
+  self->priv->last_single = cle;
+}
 
-  if (self->priv->log_file) {
-    fclose (self->priv->log_file);
-    self->priv->log_file = NULL;
+static void
+change_log_entry_single_add (BtChangeLog * self, BtChangeLogEntrySingle * cle)
+{
+  add_change_log_entry (self, (BtChangeLogEntry *) cle);
+  if (self->priv->cur_group == NULL) {
+    // log ungrouped changes immediately
+    log_change_log_entry (self, (BtChangeLogEntry *) cle, TRUE);
+    trim_history (self);
+    journal_compact (self);
   }
-  if (self->priv->log_file_name) {
-    g_unlink (self->priv->log_file_name);
-    g_free (self->priv->log_file_name);
-    self->priv->log_file_name = NULL;
+}
+
+static void
+close_and_free_log (BtChangeLog * self)
+{
+  BtChangeLogPrivate *p = self->priv;
+
+  p->is_active = FALSE;
+
+  if (p->journal_writer) {
+    g_mutex_lock (&p->journal_lock);
+    p->journal_quit = TRUE;
+    g_cond_signal (&p->journal_cond);
+    g_mutex_unlock (&p->journal_lock);
+    g_thread_join (p->journal_writer);
+    p->journal_writer = NULL;
+
+    close (p->log_fd);
+    p->log_fd = -1;
+    g_byte_array_set_size (p->journal_pending, 0);
+    if (p->journal_replace) {
+      g_byte_array_unref (p->journal_replace);
+      p->journal_replace = NULL;
+    }
+    g_byte_array_set_size (p->journal_base, 0);
+    g_hash_table_remove_all (p->journal_owners);
   }
-  if (self->priv->changes) {
-    guint i, l = self->priv->changes->len;
+  if (p->log_file_name) {
+    g_unlink (p->log_file_name);
+    g_free (p->log_file_name);
+    p->log_file_name = NULL;
+  }
+  if (p->changes) {
+    guint i, l = p->changes->len;
 
     for (i = 0; i < l; i++)
-      free_change_log_entry (g_ptr_array_index (self->priv->changes, i));
-    g_ptr_array_free (self->priv->changes, TRUE);
-    self->priv->changes = NULL;
-    self->priv->next_undo = -1;
-    self->priv->next_redo = 0;
-    self->priv->item_ct = 0;
+      free_change_log_entry (self, g_ptr_array_index (p->changes, i));
+    g_ptr_array_free (p->changes, TRUE);
+    p->changes = NULL;
+    p->next_undo = -1;
+    p->next_redo = 0;
+    p->item_ct = 0;
+    p->history_packed = 0;
+    p->history_trimmed = FALSE;
   }
 }
 
@@ -506,32 +1114,39 @@ make_log_file_name (BtChangeLog * self, BtSongInfo * song_info)
 static void
 open_and_init_log (BtChangeLog * self, BtSongInfo * song_info)
 {
-  if (!(self->priv->log_file = fopen (self->priv->log_file_name, "wt"))) {
+  BtChangeLogPrivate *p = self->priv;
+
+  if ((p->log_fd = g_open (p->log_file_name, O_WRONLY | O_CREAT | O_TRUNC,
+              S_IRUSR | S_IWUSR)) == -1) {
     GST_WARNING ("can't open log file '%s' : %d : %s",
-        self->priv->log_file_name, errno, g_strerror (errno));
-    g_free (self->priv->log_file_name);
-    self->priv->log_file_name = NULL;
+        p->log_file_name, errno, g_strerror (errno));
+    g_free (p->log_file_name);
+    p->log_file_name = NULL;
   } else {
     gchar *file_name;
 
-    self->priv->changes = g_ptr_array_new ();
-    self->priv->next_undo = -1;
-    self->priv->next_redo = 0;
-    self->priv->cur_group = NULL;
-    self->priv->item_ct = 0;
-
-    setvbuf (self->priv->log_file, (char *) NULL, _IOLBF, 0);
+    p->changes = g_ptr_array_new ();
+    p->next_undo = -1;
+    p->next_redo = 0;
+    p->cur_group = NULL;
+    p->item_ct = 0;
 
     g_object_get (song_info, "file-name", &file_name, NULL);
-    fputs (PACKAGE " edit journal : " PACKAGE_VERSION "\n",
-        self->priv->log_file);
-    if (file_name) {
-      fputs (file_name, self->priv->log_file);
-      g_free (file_name);
-    }
-    fputs ("\n", self->priv->log_file);
-
-    self->priv->is_active = TRUE;
+    g_byte_array_append (p->journal_base, (const guint8 *) JOURNAL_MAGIC,
+        sizeof (JOURNAL_MAGIC));
+    journal_put_record (p->journal_base, JOURNAL_RECORD_SONG,
+        (const guint8 *) file_name, file_name ? strlen (file_name) : 0);
+    g_free (file_name);
+
+    g_byte_array_append (p->journal_pending, p->journal_base->data,
+        p->journal_base->len);
+    p->journal_size = p->journal_base->len;
+    p->journal_compact_size = JOURNAL_COMPACT_SIZE;
+    p->journal_quit = FALSE;
+    p->journal_writer = g_thread_new ("bt-change-log", journal_writer_func,
+        self);
+
+    p->is_active = TRUE;
   }
 }
 
@@ -550,6 +1165,30 @@ free_crash_log_file (BtChangeLogFile * crash_entry)
   g_slice_free (BtChangeLogFile, crash_entry);
 }
 
+/* read the song file name from the first record of a binary journal */
+static gchar *
+journal_read_song_file_name (FILE * log_file)
+{
+  guint32 header[2], size;
+  guint8 *payload;
+  gchar *song_file_name = NULL;
+
+  if (fread (header, sizeof (header), 1, log_file) != 1)
+    return NULL;
+  size = GUINT32_FROM_LE (header[0]);
+  if (!size || size > FILENAME_MAX)
+    return NULL;
+  payload = g_malloc (size);
+  if (fread (payload, size, 1, log_file) == 1
+      && payload[0] == JOURNAL_RECORD_SONG
+      && journal_checksum (payload[0], &payload[1], size - 1) ==
+      GUINT32_FROM_LE (header[1])) {
+    song_file_name = g_strndup ((const gchar *) &payload[1], size - 1);
+  }
+  g_free (payload);
+  return song_file_name;
+}
+
 /*
  * bt_change_log_crash_check:
  * @self: the changelog
@@ -599,28 +1238,44 @@ bt_change_log_crash_check (BtChangeLog * self)
        *   - otherwise auto-clean
        */
       valid_log = auto_clean = FALSE;
-      if ((log_file = fopen (log_path, "rt"))) {
+      if ((log_file = fopen (log_path, "rb"))) {
         gchar linebuf[BT_CHANGE_LOG_MAX_HEADER_LINE_LEN];
-        gchar song_file_name[BT_CHANGE_LOG_MAX_HEADER_LINE_LEN];
+        gchar *song_file_name = NULL;
+        gboolean has_changes;
         BtChangeLogFile *crash_log;
         struct stat fileinfo;
 
-        if (!(fgets (linebuf, BT_CHANGE_LOG_MAX_HEADER_LINE_LEN, log_file))) {
-          GST_INFO ("    '%s' is not a change log, eof too early", log_name);
-          goto done;
-        }
-        if (!g_str_has_prefix (linebuf, PACKAGE " edit journal : ")) {
-          GST_INFO ("    '%s' is not a change log, wrong header", log_name);
-          goto done;
-        }
-        // from now one, we know its a log, if its useless we can kill it
-        if (!(fgets (song_file_name, BT_CHANGE_LOG_MAX_HEADER_LINE_LEN,
-                    log_file))) {
-          GST_INFO ("    '%s' is not a change log, eof too early", log_name);
-          auto_clean = TRUE;
-          goto done;
+        if (fread (linebuf, sizeof (JOURNAL_MAGIC), 1, log_file) == 1 &&
+            !memcmp (linebuf, JOURNAL_MAGIC, sizeof (JOURNAL_MAGIC))) {
+          // from now one, we know its a log, if its useless we can kill it
+          if (!(song_file_name = journal_read_song_file_name (log_file))) {
+            GST_INFO ("    '%s' is not a change log, eof too early", log_name);
+            auto_clean = TRUE;
+            goto done;
+          }
+          has_changes = (fgetc (log_file) != EOF);
+        } else {
+          // check for a text log from older versions
+          rewind (log_file);
+          if (!(fgets (linebuf, BT_CHANGE_LOG_MAX_HEADER_LINE_LEN, log_file))) {
+            GST_INFO ("    '%s' is not a change log, eof too early", log_name);
+            goto done;
+          }
+          if (!g_str_has_prefix (linebuf, PACKAGE " edit journal : ")) {
+            GST_INFO ("    '%s' is not a change log, wrong header", log_name);
+            goto done;
+          }
+          // from now one, we know its a log, if its useless we can kill it
+          if (!(fgets (linebuf, BT_CHANGE_LOG_MAX_HEADER_LINE_LEN, log_file))) {
+            GST_INFO ("    '%s' is not a change log, eof too early", log_name);
+            auto_clean = TRUE;
+            goto done;
+          }
+          song_file_name = g_strdup (g_strchomp (linebuf));
+          has_changes =
+              (fgets (linebuf, BT_CHANGE_LOG_MAX_HEADER_LINE_LEN,
+                  log_file) != NULL);
         }
-        g_strchomp (song_file_name);
         if (*song_file_name
             && !g_file_test (song_file_name,
                 G_FILE_TEST_IS_REGULAR | G_FILE_TEST_EXISTS)) {
@@ -630,7 +1285,7 @@ bt_change_log_crash_check (BtChangeLog * self)
           auto_clean = TRUE;
           goto done;
         }
-        if (!(fgets (linebuf, BT_CHANGE_LOG_MAX_HEADER_LINE_LEN, log_file))) {
+        if (!has_changes) {
           GST_INFO ("    '%s' is an empty change log", log_name);
           auto_clean = TRUE;
           goto done;
@@ -653,6 +1308,7 @@ bt_change_log_crash_check (BtChangeLog * self)
         crash_log->mtime = fileinfo.st_mtime;
         crash_logs = g_list_prepend (crash_logs, crash_log);
       done:
+        g_free (song_file_name);
         fclose (log_file);
       }
       if (!valid_log) {
@@ -676,8 +1332,235 @@ bt_change_log_crash_check (BtChangeLog * self)
   self->priv->crash_logs = g_list_sort (crash_logs, sort_by_mtime);
 }
 
+/* load the song the log was written for, returns %FALSE if that fails, sets
+ * copy if the log was for an unsaved song */
+static gboolean
+recover_song (BtChangeLog * self, const gchar * song_file_name,
+    gboolean * copy)
+{
+  *copy = FALSE;
+  /* load the song pointed to by entry or replay the new song
+   * no filename = never saved -> new file
+   */
+  if (*song_file_name) {
+    GError *err = NULL;
+    /* this creates a new song object and thus triggers
+     * on_song_changed() where we setup a new logfile */
+    if (!bt_edit_application_load_song (self->priv->app, song_file_name,
+            &err)) {
+      GST_WARNING ("    song '%s' failed to load: %s", song_file_name,
+          err->message);
+      // TODO(ensonic): propagate GError, bt_change_log_recover() neeeds GError arg
+      g_error_free (err);
+      return FALSE;
+    }
+  } else {
+    /* the changes are made to the current song, we copy them to the new log,
+     * otherwise we loose them */
+    *copy = (self->priv->journal_writer != NULL);
+  }
+  return TRUE;
+}
+
+static gboolean
+replay_change (BtChangeLog * self, BtChangeLogger * logger,
+    const gchar * redo_data, gboolean copy)
+{
+  /* we don't add those to the undo stack, as we have no undo-data. Thus we
+   * cannot restore the change-stack fully.
+   */
+  gboolean is_active = self->priv->is_active, res;
+
+  if (copy) {
+    journal_add_change (self, G_OBJECT_TYPE_NAME (logger), redo_data);
+    // don't log the change twice
+    self->priv->is_active = FALSE;
+  }
+  res = bt_change_logger_change (logger, redo_data);
+  self->priv->is_active = is_active;
+  if (!res) {
+    GST_WARNING ("failed to replay '%s::%s'", G_OBJECT_TYPE_NAME (logger),
+        redo_data);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* replay a binary journal, the redo data is used in place */
+static gboolean
+recover_journal (BtChangeLog * self, const guint8 * data, gsize size)
+{
+  BtChangeLogger *owners[G_MAXUINT8 + 1] = { NULL, };
+  gsize pos = sizeof (JOURNAL_MAGIC);
+  guint changes = 0, changes_ok = 0;
+  gboolean has_song = FALSE, copy = FALSE, complete = TRUE;
+
+  while (pos < size) {
+    const guint8 *payload = &data[pos + JOURNAL_RECORD_HEADER_SIZE];
+    guint32 header[2], rec_size, body_size;
+
+    if (size - pos < JOURNAL_RECORD_HEADER_SIZE) {
+      complete = FALSE;
+      break;
+    }
+    memcpy (header, &data[pos], sizeof (header));
+    rec_size = GUINT32_FROM_LE (header[0]);
+    if (!rec_size || rec_size > size - pos - JOURNAL_RECORD_HEADER_SIZE
+        || journal_checksum (payload[0], &payload[1], rec_size - 1) !=
+        GUINT32_FROM_LE (header[1])) {
+      complete = FALSE;
+      break;
+    }
+    pos += JOURNAL_RECORD_HEADER_SIZE + rec_size;
+    body_size = rec_size - 1;
+
+    if (!has_song && payload[0] != JOURNAL_RECORD_SONG) {
+      GST_WARNING ("journal does not start with the song record");
+      return FALSE;
+    }
+    switch (payload[0]) {
+      case JOURNAL_RECORD_SONG:{
+        gchar *song_file_name =
+            g_strndup ((const gchar *) &payload[1], body_size);
+        gboolean res = recover_song (self, song_file_name, &copy);
+
+        g_free (song_file_name);
+        if (!res)
+          return FALSE;
+        has_song = TRUE;
+        break;
+      }
+      case JOURNAL_RECORD_OWNER:{
+        gchar *owner_name;
+
+        if (body_size < 2)
+          break;
+        owner_name = g_strndup ((const gchar *) &payload[2], body_size - 1);
+        if (!(owners[payload[1]] =
+                g_hash_table_lookup (self->priv->loggers, owner_name))) {
+          GST_WARNING ("no changelogger for '%s'", owner_name);
+        }
+        g_free (owner_name);
+        break;
+      }
+      case JOURNAL_RECORD_CHANGES:{
+        const guint8 *change = &payload[1], *end = &payload[rec_size];
+
+        while ((gsize) (end - change) >= JOURNAL_CHANGE_HEADER_SIZE) {
+          BtChangeLogger *logger = owners[change[0]];
+          const gchar *redo_data;
+          guint32 change_size;
+
+          memcpy (&change_size, &change[1], sizeof (change_size));
+          change_size = GUINT32_FROM_LE (change_size);
+          redo_data = (const gchar *) &change[JOURNAL_CHANGE_HEADER_SIZE];
+          change += JOURNAL_CHANGE_HEADER_SIZE;
+          if (!change_size || change_size > (gsize) (end - change)
+              || redo_data[change_size - 1] != '\0') {
+            GST_WARNING ("broken change in journal");
+            complete = FALSE;
+            break;
+          }
+          change += change_size;
+          changes++;
+          GST_DEBUG ("changelog-event: '%s'", redo_data);
+          if (logger) {
+            if (replay_change (self, logger, redo_data, copy))
+              changes_ok++;
+          } else {
+            GST_WARNING ("no changelogger for change '%s'", redo_data);
+          }
+        }
+        if (copy) {
+          journal_commit (self, TRUE);
+        }
+        break;
+      }
+      case JOURNAL_RECORD_COMMENT:
+        GST_LOG ("changelog-comment: '%.*s'", (gint) body_size, &payload[1]);
+        break;
+      default:
+        GST_WARNING ("unknown record type %u", payload[0]);
+        break;
+    }
+  }
+  if (!complete) {
+    GST_WARNING ("journal ends with an incomplete record");
+  }
+  GST_INFO ("%u of %u changes replayed okay", changes_ok, changes);
+  return (has_song && complete && changes_ok == changes);
+}
+
+/* replay a text log as written by older versions */
+static gboolean
+recover_text_log (BtChangeLog * self, gchar * data)
+{
+  gchar *line, *next, *redo_data;
+  BtChangeLogger *logger;
+  guint lines = 0, lines_ok = 0;
+  gboolean copy;
+
+  // skip the header line and read the song file name
+  if (!(line = strchr (data, '\n'))) {
+    GST_INFO ("    not a change log, eof too early");
+    return FALSE;
+  }
+  line++;
+  if ((next = strchr (line, '\n')))
+    *next++ = '\0';
+  if (!recover_song (self, g_strchomp (line), &copy))
+    return FALSE;
+
+  // replay the log
+  for (line = next; line; line = next) {
+    if ((next = strchr (line, '\n')))
+      *next++ = '\0';
+    g_strchomp (line);
+    if (!*line)
+      continue;
+    if (line[0] == '#') {
+      GST_LOG ("changelog-comment: '%s'", &line[1]);
+      continue;
+    }
+    lines++;
+    GST_DEBUG ("changelog-event: '%s'", line);
+    // log event: BtMainPagePatterns::set_global_event "simsyn","simsyn 00",8,0,c-4
+    if ((redo_data = strstr (line, "::"))) {
+      redo_data[0] = '\0';
+      redo_data = &redo_data[2];
+      // determine owner (BtMainPagePatterns)
+      if ((logger = g_hash_table_lookup (self->priv->loggers, line))) {
+        if (replay_change (self, logger, redo_data, copy))
+          lines_ok++;
+        if (copy)
+          journal_commit (self, TRUE);
+      } else {
+        GST_WARNING ("no changelogger for '%s'", line);
+      }
+    } else {
+      GST_WARNING ("missing :: separator in '%s'", line);
+    }
+  }
+  GST_INFO ("%u of %u lines replayed okay", lines_ok, lines);
+  return (lines_ok == lines);
+}
+
 //-- event handler
 
+static void
+on_undo_memory_budget_changed (const BtSettings * const settings,
+    GParamSpec * const arg, gpointer const user_data)
+{
+  BtChangeLog *self = BT_CHANGE_LOG (user_data);
+  guint budget;
+
+  g_object_get ((gpointer) settings, "undo-memory-budget", &budget, NULL);
+  self->priv->history_budget = (guint64) budget * 1024 * 1024;
+  if (self->priv->changes) {
+    trim_history (self);
+  }
+}
+
 static void
 on_song_file_name_changed (const BtSong * song, GParamSpec * arg,
     gpointer user_data)
@@ -689,12 +1572,15 @@ on_song_file_name_changed (const BtSong * song, GParamSpec * arg,
   // move the log
   g_object_get ((GObject *) song, "song-info", &song_info, NULL);
   log_file_name = make_log_file_name (self, song_info);
+  // the writer thread uses the name when compacting the log
+  g_mutex_lock (&self->priv->journal_lock);
   if (g_rename (self->priv->log_file_name, log_file_name)) {
     GST_WARNING ("failed renaming '%s' to '%s': %s", self->priv->log_file_name,
         log_file_name, g_strerror (errno));
   }
   g_free (self->priv->log_file_name);
   self->priv->log_file_name = log_file_name;
+  g_mutex_unlock (&self->priv->journal_lock);
   g_object_unref (song_info);
 }
 
@@ -813,99 +1699,39 @@ bt_change_log_is_active (BtChangeLog * self)
 gboolean
 bt_change_log_recover (BtChangeLog * self, const gchar * log_name)
 {
-  FILE *log_file;
+  gchar *data;
+  gsize size;
   gboolean res = FALSE;
-  gboolean copy = FALSE;
-
-  if ((log_file = fopen (log_name, "rt"))) {
-    gchar linebuf[10000];       /* TODO(ensonic): a line can be a full column */
-    gchar *redo_data;
-    BtChangeLogger *logger;
-    guint lines = 0, lines_ok = 0;
 
-    if (!(fgets (linebuf, BT_CHANGE_LOG_MAX_HEADER_LINE_LEN, log_file))) {
-      GST_INFO ("    '%s' is not a change log, eof too early", log_name);
-      goto done;
-    }
-    if (!(fgets (linebuf, BT_CHANGE_LOG_MAX_HEADER_LINE_LEN, log_file))) {
-      GST_INFO ("    '%s' is not a change log, eof too early", log_name);
-      goto done;
-    }
-    g_strchomp (linebuf);
-    /* load the song pointed to by entry or replay the new song
-     * no filename = never saved -> new file
+  if (!g_file_get_contents (log_name, &data, &size, NULL)) {
+    GST_INFO ("    '%s' can't be read", log_name);
+    return FALSE;
+  }
+  if (size >= sizeof (JOURNAL_MAGIC)
+      && !memcmp (data, JOURNAL_MAGIC, sizeof (JOURNAL_MAGIC))) {
+    res = recover_journal (self, (const guint8 *) data, size);
+  } else if (g_str_has_prefix (data, PACKAGE " edit journal : ")) {
+    res = recover_text_log (self, data);
+  } else {
+    GST_INFO ("    '%s' is not a change log, wrong header", log_name);
+  }
+  g_free (data);
+
+  if (res) {
+    GList *node;
+    /* TODO(ensonic): defer removing the old log to saving the song
+     *   -> on_song_file_unsaved_changed()
+     *   - ev. need to store recovered_log_name in self, so that we can check
+     *     it om _unsaved_changed()
      */
-    if (*linebuf) {
-      GError *err = NULL;
-      /* this creates a new song object and thus triggers
-       * on_song_changed() where we setup a new logfile */
-      if (!bt_edit_application_load_song (self->priv->app, linebuf, &err)) {
-        GST_WARNING ("    song '%s' failed to load: %s", linebuf, err->message);
-        // TODO(ensonic): propagate GError, bt_change_log_recover() neeeds GError arg
-        g_error_free (err);
-        goto done;
-      }
-    } else {
-      /* TODO(ensonic): we need to either copy the log data to the new log or use the
-       * previous log as the current one, otherwise we loose the changes */
-      copy = TRUE;
-    }
-    // replay the log
-    while (!feof (log_file)) {
-      if (fgets (linebuf, BT_CHANGE_LOG_MAX_HEADER_LINE_LEN, log_file)) {
-        if (copy) {
-          fputs (linebuf, self->priv->log_file);
-        }
-        g_strchomp (linebuf);
-        if (linebuf[0] == '#') {
-          GST_LOG ("changelog-comment: '%s'", &linebuf[1]);
-          continue;
-        }
-        lines++;
-        GST_DEBUG ("changelog-event: '%s'", linebuf);
-        // log event: BtMainPagePatterns::set_global_event "simsyn","simsyn 00",8,0,c-4
-        if ((redo_data = strstr (linebuf, "::"))) {
-          redo_data[0] = '\0';
-          redo_data = &redo_data[2];
-          // determine owner (BtMainPagePatterns)
-          if ((logger = g_hash_table_lookup (self->priv->loggers, linebuf))) {
-            if (bt_change_logger_change (logger, redo_data)) {
-              lines_ok++;
-              /* we don't add those to the new log, as we have no undo-data. Thus
-               * we cannot restore the change-stack fully.
-               */
-            } else {
-              GST_WARNING ("failed to replay line: '%s::%s'", linebuf,
-                  redo_data);
-            }
-          } else {
-            GST_WARNING ("no changelogger for '%s'", linebuf);
-          }
-        } else {
-          GST_WARNING ("missing :: separator in '%s'", linebuf);
-        }
-      }
-    }
-    GST_INFO ("%u of %u lines replayed okay", lines_ok, lines);
-    res = (lines_ok == lines);
-  done:
-    fclose (log_file);
-    if (res) {
-      GList *node;
-      /* TODO(ensonic): defer removing the old log to saving the song
-       *   -> on_song_file_unsaved_changed()
-       *   - ev. need to store recovered_log_name in self, so that we can check
-       *     it om _unsaved_changed()
-       */
-      g_unlink (log_name);
-      for (node = self->priv->crash_logs; node; node = g_list_next (node)) {
-        BtChangeLogFile *crash_entry = (BtChangeLogFile *) node->data;
-        if (!strcmp (log_name, crash_entry->log_name)) {
-          self->priv->crash_logs =
-              g_list_delete_link (self->priv->crash_logs, node);
-          free_crash_log_file (crash_entry);
-          break;
-        }
+    g_unlink (log_name);
+    for (node = self->priv->crash_logs; node; node = g_list_next (node)) {
+      BtChangeLogFile *crash_entry = (BtChangeLogFile *) node->data;
+      if (!strcmp (log_name, crash_entry->log_name)) {
+        self->priv->crash_logs =
+            g_list_delete_link (self->priv->crash_logs, node);
+        free_crash_log_file (crash_entry);
+        break;
       }
     }
   }
@@ -945,6 +1771,8 @@ bt_change_log_add (BtChangeLog * self, BtChangeLogger * owner,
 {
   if (!self->priv->changes) {
     GST_WARNING ("change log not initialized?");
+    g_free (undo_data);
+    g_free (redo_data);
     return;
   }
   if (self->priv->is_active) {
@@ -953,21 +1781,56 @@ bt_change_log_add (BtChangeLog * self, BtChangeLogger * owner,
     // make new BtChangeLogEntry from the parameters
     cle = g_slice_new (BtChangeLogEntrySingle);
     cle->type = CHANGE_LOG_ENTRY_SINGLE;
-    cle->owner = owner;
-    cle->undo_data = undo_data;
-    cle->redo_data = redo_data;
-    GST_INFO ("add %d[%s], %d[%s]", self->priv->next_undo, undo_data,
-        self->priv->next_redo, redo_data);
-    add_change_log_entry (self, (BtChangeLogEntry *) cle);
-    if (self->priv->cur_group == NULL) {
-      // log ungrouped changes immediately
-      log_change_log_entry (self, (BtChangeLogEntry *) cle);
-    }
+    change_log_entry_single_init (self, cle, owner, undo_data, redo_data, NULL,
+        NULL);
+    change_log_entry_single_add (self, cle);
   } else {
     GST_INFO ("change log not active");
+    g_free (undo_data);
+    g_free (redo_data);
   }
 }
 
+/**
+ * bt_change_log_add_column:
+ * @self: the change log
+ * @owner: the owner of the change
+ * @undo_data: how to undo the change
+ * @redo_data: how to redo the change
+ * @undo_column: the column range before the change
+ * @redo_column: the column range after the change
+ *
+ * Add a change of one column of a value group to the change log. The column
+ * ranges are packed with bt_value_group_pack_column_range() and are passed to
+ * bt_change_logger_change_column() together with the strings on undo and redo.
+ * Only @undo_data and @redo_data are written to the journal. The change-log
+ * takes ownership of @undo_data, @redo_data, @undo_column and @redo_column.
+ */
+void
+bt_change_log_add_column (BtChangeLog * self, BtChangeLogger * owner,
+    gchar * undo_data, gchar * redo_data, GBytes * undo_column,
+    GBytes * redo_column)
+{
+  if (!self->priv->changes) {
+    GST_WARNING ("change log not initialized?");
+  } else if (self->priv->is_active) {
+    BtChangeLogEntrySingle *cle;
+
+    cle = g_slice_new (BtChangeLogEntrySingle);
+    cle->type = CHANGE_LOG_ENTRY_SINGLE;
+    change_log_entry_single_init (self, cle, owner, undo_data, redo_data,
+        undo_column, redo_column);
+    change_log_entry_single_add (self, cle);
+    return;
+  } else {
+    GST_INFO ("change log not active");
+  }
+  g_free (undo_data);
+  g_free (redo_data);
+  g_bytes_unref (undo_column);
+  g_bytes_unref (redo_column);
+}
+
 /**
  * bt_change_log_start_group:
  * @self: the change log
@@ -1029,9 +1892,11 @@ bt_change_log_end_group (BtChangeLog * self)
       // when we finished a top-level group, log the content to the journal
       if (cle->old_group == NULL) {
         GST_DEBUG ("closing a top-level group %p, logging changes", cle);
-        log_change_log_entry (self, (BtChangeLogEntry *) cle);
+        log_change_log_entry (self, (BtChangeLogEntry *) cle, TRUE);
       }
       self->priv->cur_group = cle->old_group;
+      trim_history (self);
+      journal_compact (self);
     }
   } else {
     GST_INFO ("change log not active");
@@ -1047,17 +1912,21 @@ bt_change_log_end_group (BtChangeLog * self)
 void
 bt_change_log_undo (BtChangeLog * self)
 {
+  BtChangeLogEntry *cle;
+
   if (self->priv->next_undo != -1) {
     gboolean is_active = self->priv->is_active;
     self->priv->is_active = FALSE;
 
     GST_INFO ("before undo %d, %d", self->priv->next_undo,
         self->priv->next_redo);
-    undo_change_log_entry (self, g_ptr_array_index (self->priv->changes,
-            self->priv->next_undo));
+    cle = g_ptr_array_index (self->priv->changes, self->priv->next_undo);
+    undo_change_log_entry (self, cle);
+    log_change_log_entry (self, cle, FALSE);
     // update undo undo/redo pointers
     self->priv->next_redo = self->priv->next_undo;
     self->priv->next_undo--;
+    self->priv->serial++;
     GST_INFO ("after undo %d, %d", self->priv->next_undo,
         self->priv->next_redo);
     if (self->priv->next_undo == -1) {
@@ -1066,6 +1935,7 @@ bt_change_log_undo (BtChangeLog * self)
     if (self->priv->next_redo == (self->priv->item_ct - 1)) {
       g_object_notify ((GObject *) self, "can-redo");
     }
+    journal_compact (self);
 
     self->priv->is_active = is_active;
   } else {
@@ -1084,17 +1954,21 @@ bt_change_log_undo (BtChangeLog * self)
 void
 bt_change_log_redo (BtChangeLog * self)
 {
+  BtChangeLogEntry *cle;
+
   if (self->priv->next_redo != self->priv->item_ct) {
     gboolean is_active = self->priv->is_active;
     self->priv->is_active = FALSE;
 
     GST_INFO ("before redo %d, %d", self->priv->next_undo,
         self->priv->next_redo);
-    redo_change_log_entry (self, g_ptr_array_index (self->priv->changes,
-            self->priv->next_redo));
+    cle = g_ptr_array_index (self->priv->changes, self->priv->next_redo);
+    redo_change_log_entry (self, cle);
+    log_change_log_entry (self, cle, TRUE);
     // update undo undo/redo pointers
     self->priv->next_undo = self->priv->next_redo;
     self->priv->next_redo++;
+    self->priv->serial++;
     GST_INFO ("after redo %d, %d", self->priv->next_undo,
         self->priv->next_redo);
     if (self->priv->next_redo == self->priv->item_ct) {
@@ -1103,6 +1977,7 @@ bt_change_log_redo (BtChangeLog * self)
     if (self->priv->next_undo == 0) {
       g_object_notify ((GObject *) self, "can-undo");
     }
+    journal_compact (self);
 
     self->priv->is_active = is_active;
   } else {
@@ -1139,6 +2014,15 @@ bt_change_log_finalize (GObject * object)
   g_free (self->priv->cache_dir);
 
   g_hash_table_destroy (self->priv->loggers);
+  g_object_unref (self->priv->settings);
+  g_hash_table_destroy (self->priv->journal_owners);
+  g_byte_array_unref (self->priv->journal_pending);
+  g_byte_array_unref (self->priv->journal_owner_records);
+  g_byte_array_unref (self->priv->journal_changes);
+  g_byte_array_unref (self->priv->journal_comments);
+  g_byte_array_unref (self->priv->journal_base);
+  g_mutex_clear (&self->priv->journal_lock);
+  g_cond_clear (&self->priv->journal_cond);
 
   // free cgrash-logs list and entries
   for (node = self->priv->crash_logs; node; node = g_list_next (node)) {
@@ -1184,6 +2068,9 @@ bt_change_log_get_property (GObject * object, guint property_id, GValue * value,
     case CHANGE_LOG_CRASH_LOGS:
       g_value_set_pointer (value, self->priv->crash_logs);
       break;
+    case CHANGE_LOG_SERIAL:
+      g_value_set_uint (value, self->priv->serial);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -1220,6 +2107,22 @@ bt_change_log_init (BtChangeLog * self)
   }
 
   self->priv->loggers = g_hash_table_new (g_str_hash, g_str_equal);
+
+  self->priv->log_fd = -1;
+  g_mutex_init (&self->priv->journal_lock);
+  g_cond_init (&self->priv->journal_cond);
+  self->priv->journal_pending = g_byte_array_new ();
+  self->priv->journal_owners = g_hash_table_new (g_str_hash, g_str_equal);
+  self->priv->journal_owner_records = g_byte_array_new ();
+  self->priv->journal_changes = g_byte_array_new ();
+  self->priv->journal_comments = g_byte_array_new ();
+  self->priv->journal_base = g_byte_array_new ();
+
+  self->priv->settings = bt_settings_make ();
+  on_undo_memory_budget_changed (self->priv->settings, NULL, self);
+  g_signal_connect_object (self->priv->settings, "notify::undo-memory-budget",
+      G_CALLBACK (on_undo_memory_budget_changed), (gpointer) self, 0);
+
   on_song_changed (self->priv->app, NULL, self);
 
   g_signal_connect_object (self->priv->app, "notify::song",
@@ -1253,4 +2156,10 @@ bt_change_log_class_init (BtChangeLogClass * klass)
           "crash logs prop",
           "A list of found crash logs",
           G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, CHANGE_LOG_SERIAL,
+      g_param_spec_uint ("serial",
+          "serial prop",
+          "Counter that changes with each change, undo and redo",
+          0, G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
@@ -70,6 +70,7 @@ void bt_change_log_register(BtChangeLog *self,BtChangeLogger *logger);
 
 gboolean bt_change_log_is_active(BtChangeLog *self);
 void bt_change_log_add(BtChangeLog *self,BtChangeLogger *owner,gchar *undo_data,gchar *redo_data);
+void bt_change_log_add_column(BtChangeLog *self,BtChangeLogger *owner,gchar *undo_data,gchar *redo_data,GBytes *undo_column,GBytes *redo_column);
 void bt_change_log_undo(BtChangeLog *self);
 void bt_change_log_redo(BtChangeLog *self);
 void bt_change_log_start_group(BtChangeLog *self);
@@ -90,6 +90,32 @@ bt_change_logger_change (const BtChangeLogger * self, const gchar * data)
   return BT_CHANGE_LOGGER_GET_INTERFACE (self)->change (self, data);
 }
 
+/**
+ * bt_change_logger_change_column:
+ * @self: an object that implements logging changes
+ * @data: serialised data of the action to apply
+ * @column: the packed value group column range of the action
+ *
+ * Run the editor action pointed to by @data. Implementations can restore the
+ * values from @column instead of parsing them from @data, the others just get
+ * @data.
+ *
+ * Returns: %TRUE for success.
+ */
+gboolean
+bt_change_logger_change_column (const BtChangeLogger * self,
+    const gchar * data, GBytes * column)
+{
+  BtChangeLoggerInterface *iface;
+
+  g_return_val_if_fail (BT_IS_CHANGE_LOGGER (self), FALSE);
+
+  iface = BT_CHANGE_LOGGER_GET_INTERFACE (self);
+  if (iface->change_column)
+    return iface->change_column (self, data, column);
+  return iface->change (self, data);
+}
+
 //-- interface internals
 
 static void
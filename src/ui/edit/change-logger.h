@@ -35,6 +35,7 @@ struct _BtChangeLoggerInterface {
   const GTypeInterface parent;
 
   gboolean (*change)(const BtChangeLogger *owner,const gchar *data);
+  gboolean (*change_column)(const BtChangeLogger *owner,const gchar *data,GBytes *column);
 };
 
 typedef struct _BtChangeLoggerMethods BtChangeLoggerMethods;
@@ -67,5 +68,6 @@ gint bt_change_logger_match_method(BtChangeLoggerMethods *change_logger_methods,
 
 // wrapper
 gboolean bt_change_logger_change(const BtChangeLogger *self,const gchar *data);
+gboolean bt_change_logger_change_column(const BtChangeLogger *self,const gchar *data,GBytes *column);
 
 #endif // BT_CHANGE_LOGGER_H
@@ -66,6 +66,7 @@ struct _BtEditApplicationPrivate
   BtSong *song;
   /* shared ui resources */
   BtUIResources *ui_resources;
+  BtMeterHub *meter_hub;
   /* the top-level window of our app */
   BtMainWindow *main_window;
 
@@ -75,6 +76,10 @@ struct _BtEditApplicationPrivate
   gboolean unsaved;
   gboolean need_dts_reset;
 
+  /* a song is being saved in the background */
+  gboolean saving;
+  gboolean edited_while_saving;
+
   /* remote playback controllers */
   BtPlaybackControllerSocket *pbc_socket;
   BtPlaybackControllerIc *pbc_ic;
@@ -161,17 +166,6 @@ bt_edit_application_check_missing (const BtEditApplication * self)
     missing = TRUE;
   }
   g_list_free (edit_elements);
-  edit_elements = g_list_prepend (NULL, "spectrum");
-  if ((missing_elements = bt_gst_check_elements (edit_elements))) {
-    missing_edit_elements =
-        g_list_concat (missing_edit_elements, g_list_copy (missing_elements));
-    missing_edit_elements =
-        g_list_append (missing_edit_elements,
-        _
-        ("-> You will not see the frequency spectrum in the analyzer window."));
-    missing = TRUE;
-  }
-  g_list_free (edit_elements);
   edit_elements = g_list_prepend (NULL, "playbin");
   if ((missing_elements = bt_gst_check_elements (edit_elements))) {
     missing_edit_elements =
@@ -483,13 +477,99 @@ bt_edit_application_load_song (const BtEditApplication * self,
   return res;
 }
 
+static void
+bt_edit_application_begin_save (const BtEditApplication * self,
+    const gchar * file_name, gchar ** old_file_name, gchar ** bak_file_name)
+{
+  // update the time-stamp
+  bt_child_proxy_set (self->priv->song, "song-info::change-dts", NULL, NULL);
+
+  bt_child_proxy_get (self->priv->song, "song-info::file-name",
+      old_file_name, NULL);
+
+  /* save file saving (bak files)
+   * save
+   *   new file (!old_file_name)
+   *     chosen file-name already exist
+   *       - move to <existing>.bak
+   *       - save newfile
+   *       - if saving failed, move <existing>.bak back
+   *       - if saving worked, delete <existing>.bak
+   *     chosen file-name does not exist
+   *       - save newfile
+   *   existing file
+   *     - move to <existing>.bak
+   *       - save newfile
+   *       - if saving failed, move <existing>.bak back
+   * save-as
+   *   new file (!old_file_name)
+   *     like save of a new-file
+   *   existing file
+   *     chosen file-name already exist
+   *       - like save of an existing file
+   *     chosen file-name does not exist
+   *       - save newfile
+   *
+   * - check how other apps do it (check if inodes change if various scenarios)
+   * - when loading a file, should we keep the file-handle open, so then when
+   *   saving, we can just update it?
+   *   - this can help with the wavetable (only updated changed wavetable slots)
+   *   - if we can't update it, we can use gsf_input_copy() for external files
+   *     (if unchanged)
+   * - if the user deletes the file that is currently open -> user error
+   */
+  *bak_file_name = NULL;
+  if (g_file_test (file_name, G_FILE_TEST_EXISTS)) {
+    *bak_file_name = g_strconcat (file_name, ".bak", NULL);
+    g_rename (file_name, *bak_file_name);
+  }
+}
+
+static void
+bt_edit_application_end_save (const BtEditApplication * self,
+    const gchar * file_name, const gchar * old_file_name,
+    const gchar * bak_file_name, gboolean res)
+{
+  if (res) {
+    if (bak_file_name && (!old_file_name || strcmp (old_file_name, file_name))) {
+      // saving worked, we remove the bak file (if one was present) as
+      // - there was no old_file_name and/or
+      // - user has chosen to overwrite this file
+      g_unlink (bak_file_name);
+    }
+  } else {
+    GST_WARNING ("could not save song \"%s\"", file_name);
+    if (bak_file_name) {
+      // saving failed, so move a file we renamed to .bak back
+      g_rename (bak_file_name, file_name);
+    }
+  }
+}
+
+static void
+bt_edit_application_set_song_saved (const BtEditApplication * self)
+{
+  self->priv->unsaved = FALSE;
+  g_object_notify (G_OBJECT (self), "unsaved");
+  self->priv->need_dts_reset = TRUE;
+}
+
+static void
+bt_edit_application_wait_for_save (const BtEditApplication * self)
+{
+  while (self->priv->saving) {
+    g_main_context_iteration (NULL, TRUE);
+  }
+}
+
 /**
  * bt_edit_application_save_song:
  * @self: the application instance to save a song from
  * @file_name: the song filename to save
  * @err: where to store the error message in case of an error, or %NULL
  *
- * Saves a song.
+ * Saves a song. If a save is running in the background, this waits for it to
+ * finish first.
  *
  * Returns: true for success
  */
@@ -504,6 +584,8 @@ bt_edit_application_save_song (const BtEditApplication * self,
 
   GST_INFO ("song name = %s", file_name);
 
+  bt_edit_application_wait_for_save (self);
+
   if ((saver = bt_song_io_from_file (file_name, err))) {
     gchar *old_file_name = NULL, *bak_file_name = NULL;
 
@@ -511,66 +593,15 @@ bt_edit_application_save_song (const BtEditApplication * self,
     g_signal_connect (saver, "notify::status",
         G_CALLBACK (on_songio_status_changed), (gpointer) self);
 
-    // update the time-stamp
-    bt_child_proxy_set (self->priv->song, "song-info::change-dts", NULL, NULL);
-
-    bt_child_proxy_get (self->priv->song, "song-info::file-name",
-        &old_file_name, NULL);
-
-    /* save file saving (bak files)
-     * save
-     *   new file (!old_file_name)
-     *     chosen file-name already exist
-     *       - move to <existing>.bak
-     *       - save newfile
-     *       - if saving failed, move <existing>.bak back
-     *       - if saving worked, delete <existing>.bak
-     *     chosen file-name does not exist
-     *       - save newfile
-     *   existing file
-     *     - move to <existing>.bak
-     *       - save newfile
-     *       - if saving failed, move <existing>.bak back
-     * save-as
-     *   new file (!old_file_name)
-     *     like save of a new-file
-     *   existing file
-     *     chosen file-name already exist
-     *       - like save of an existing file
-     *     chosen file-name does not exist
-     *       - save newfile
-     *
-     * - check how other apps do it (check if inodes change if various scenarios)
-     * - when loading a file, should we keep the file-handle open, so then when
-     *   saving, we can just update it?
-     *   - this can help with the wavetable (only updated changed wavetable slots)
-     *   - if we can't update it, we can use gsf_input_copy() for external files
-     *     (if unchanged)
-     * - if the user deletes the file that is currently open -> user error
-     */
-    if (g_file_test (file_name, G_FILE_TEST_EXISTS)) {
-      bak_file_name = g_strconcat (file_name, ".bak", NULL);
-      g_rename (file_name, bak_file_name);
-    }
-    if (bt_song_io_save (saver, self->priv->song, err)) {
-      res = TRUE;
-      if (bak_file_name && (!old_file_name || strcmp (old_file_name, file_name))) {
-        // saving worked, we remove the bak file (if one was present) as
-        // - there was no old_file_name and/or
-        // - user has chosen to overwrite this file
-        g_unlink (bak_file_name);
-      }
-    } else {
-      GST_WARNING ("could not save song \"%s\"", file_name);
-      if (bak_file_name) {
-        // saving failed, so move a file we renamed to .bak back
-        g_rename (bak_file_name, file_name);
-      }
-    }
+    bt_edit_application_begin_save (self, file_name, &old_file_name,
+        &bak_file_name);
+    res = bt_song_io_save (saver, self->priv->song, err);
+    bt_edit_application_end_save (self, file_name, old_file_name,
+        bak_file_name, res);
     GST_INFO ("saving done");
-    self->priv->unsaved = FALSE;
-    g_object_notify (G_OBJECT (self), "unsaved");
-    self->priv->need_dts_reset = TRUE;
+    if (res) {
+      bt_edit_application_set_song_saved (self);
+    }
 
     bt_edit_application_ui_unlock (self);
 
@@ -583,6 +614,139 @@ bt_edit_application_save_song (const BtEditApplication * self,
   return res;
 }
 
+/* data for saving in the background */
+typedef struct
+{
+  BtSong *song;
+  gchar *file_name;
+  gchar *old_file_name;
+  gchar *bak_file_name;
+  guint change_serial;
+} BtEditApplicationSaveData;
+
+static void
+bt_edit_application_save_data_free (BtEditApplicationSaveData * data)
+{
+  g_object_unref (data->song);
+  g_free (data->file_name);
+  g_free (data->old_file_name);
+  g_free (data->bak_file_name);
+  g_slice_free (BtEditApplicationSaveData, data);
+}
+
+static void
+on_song_saved (GObject * object, GAsyncResult * result, gpointer user_data)
+{
+  BtSongIO *saver = BT_SONG_IO (object);
+  GTask *task = G_TASK (user_data);
+  BtEditApplication *self = BT_EDIT_APPLICATION (g_task_get_source_object (task));
+  BtEditApplicationSaveData *data = g_task_get_task_data (task);
+  GError *err = NULL;
+  gboolean res;
+
+  g_signal_handlers_disconnect_by_func (saver, on_songio_status_changed,
+      (gpointer) self);
+  res = bt_song_io_save_finish (saver, result, &err);
+  bt_edit_application_end_save (self, data->file_name, data->old_file_name,
+      data->bak_file_name, res);
+  self->priv->saving = FALSE;
+  GST_INFO ("saving done: %d", res);
+
+  if (res) {
+    guint change_serial;
+
+    /* only mark the song as saved if nothing has been changed since we took
+     * the snapshot, otherwise the change-log would drop the new changes */
+    g_object_get (self->priv->change_log, "serial", &change_serial, NULL);
+    if (data->song == self->priv->song && !self->priv->edited_while_saving &&
+        data->change_serial == change_serial) {
+      bt_edit_application_set_song_saved (self);
+    }
+    g_task_return_boolean (task, TRUE);
+  } else {
+    g_task_return_error (task, err);
+  }
+  g_object_unref (task);
+}
+
+/**
+ * bt_edit_application_save_song_async:
+ * @self: the application instance to save a song from
+ * @file_name: the song filename to save
+ * @callback: called when the song has been saved
+ * @user_data: data for the @callback
+ *
+ * Saves a song in the background. The song can be edited while it is being
+ * saved. Call bt_edit_application_save_song_finish() from the @callback to get
+ * the result. If a save is already running, this fails.
+ */
+void
+bt_edit_application_save_song_async (const BtEditApplication * self,
+    const char *file_name, GAsyncReadyCallback callback, gpointer user_data)
+{
+  BtEditApplicationSaveData *data;
+  BtSongIO *saver;
+  GTask *task;
+  GError *err = NULL;
+
+  g_return_if_fail (BT_IS_EDIT_APPLICATION (self));
+
+  GST_INFO ("song name = %s", file_name);
+
+  task = g_task_new ((gpointer) self, NULL, callback, user_data);
+  g_task_set_source_tag (task, bt_edit_application_save_song_async);
+
+  if (self->priv->saving) {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_PENDING,
+        _("The song is already being saved."));
+    g_object_unref (task);
+    return;
+  }
+  if (!(saver = bt_song_io_from_file (file_name, &err))) {
+    GST_WARNING ("Unknown extension \"%s\"", file_name);
+    g_task_return_error (task, err);
+    g_object_unref (task);
+    return;
+  }
+
+  data = g_slice_new0 (BtEditApplicationSaveData);
+  data->song = g_object_ref (self->priv->song);
+  data->file_name = g_strdup (file_name);
+  g_object_get (self->priv->change_log, "serial", &data->change_serial, NULL);
+  g_task_set_task_data (task, data,
+      (GDestroyNotify) bt_edit_application_save_data_free);
+
+  self->priv->saving = TRUE;
+  self->priv->edited_while_saving = FALSE;
+
+  g_signal_connect (saver, "notify::status",
+      G_CALLBACK (on_songio_status_changed), (gpointer) self);
+  bt_edit_application_begin_save (self, file_name, &data->old_file_name,
+      &data->bak_file_name);
+  bt_song_io_save_async (saver, self->priv->song, on_song_saved, task);
+  g_object_unref (saver);
+}
+
+/**
+ * bt_edit_application_save_song_finish:
+ * @self: the application instance
+ * @result: the #GAsyncResult passed to the callback
+ * @err: where to store the error message in case of an error, or %NULL
+ *
+ * Finishes saving a song that has been started with
+ * bt_edit_application_save_song_async().
+ *
+ * Returns: true for success
+ */
+gboolean
+bt_edit_application_save_song_finish (const BtEditApplication * self,
+    GAsyncResult * result, GError ** err)
+{
+  g_return_val_if_fail (g_task_is_valid (result, (gpointer) self), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), err);
+}
+
 /**
  * bt_edit_application_run:
  * @self: the application instance to run
@@ -650,6 +814,7 @@ bt_edit_application_load_and_run (const BtEditApplication * self,
 gboolean
 bt_edit_application_quit (const BtEditApplication * self)
 {
+  bt_edit_application_wait_for_save (self);
   if (bt_main_window_check_quit (self->priv->main_window)) {
     BtSettings *settings;
     gint x, y, w, h;
@@ -825,6 +990,9 @@ bt_edit_application_set_song_unsaved (const BtEditApplication * self)
    g_object_get(self->priv->change_log,"can-undo",&can_undo,NULL);
    if((!self->priv->unsaved) && (!can_undo)) {
    */
+  if (self->priv->saving) {
+    self->priv->edited_while_saving = TRUE;
+  }
   if (!self->priv->unsaved) {
     self->priv->unsaved = TRUE;
     g_object_notify (G_OBJECT (self), "unsaved");
@@ -909,6 +1077,8 @@ bt_edit_application_constructor (GType type, guint n_construct_params,
     GST_INFO ("new edit app instantiated");
     // create or ref the shared ui resources
     singleton->priv->ui_resources = bt_ui_resources_new ();
+    // create the shared receiver for the level meters
+    singleton->priv->meter_hub = bt_meter_hub_new ();
 
     // create the interaction controller registry
     singleton->priv->ic_registry = btic_registry_new ();
@@ -978,6 +1148,7 @@ bt_edit_application_dispose (GObject * object)
 
   GST_DEBUG ("  more unrefs");
   g_object_try_unref (self->priv->ui_resources);
+  g_object_try_unref (self->priv->meter_hub);
   g_object_try_unref (self->priv->pbc_socket);
   g_object_try_unref (self->priv->pbc_ic);
   g_object_try_unref (self->priv->ic_registry);
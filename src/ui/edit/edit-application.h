@@ -59,6 +59,8 @@ BtEditApplication *bt_edit_application_new(void);
 gboolean bt_edit_application_new_song(const BtEditApplication *self);
 gboolean bt_edit_application_load_song(const BtEditApplication *self,const char *file_name, GError **err);
 gboolean bt_edit_application_save_song(const BtEditApplication *self,const char *file_name, GError **err);
+void bt_edit_application_save_song_async(const BtEditApplication *self,const char *file_name, GAsyncReadyCallback callback, gpointer user_data);
+gboolean bt_edit_application_save_song_finish(const BtEditApplication *self, GAsyncResult *result, GError **err);
 
 gboolean bt_edit_application_run(const BtEditApplication *self);
 gboolean bt_edit_application_load_and_run(const BtEditApplication *self, const gchar *input_file_name);
@@ -26,11 +26,6 @@
 
 /* TODO(ensonic): more graphics:
  * - use svg gfx (design/gui/svgcanvas.c )
- *   - need to have prerenderend images for current zoom level
- *     - idealy have them in ui-resources, in order to have them shared
- *     - currently there is a ::zoom property to update the font-size
- *       its set in update_machines_zoom(), there we would need to regenerate
- *       the pixmaps too
  * - state graphics
  *   - have some gfx in the middle
  *     mute: x over o
@@ -123,9 +118,10 @@ struct _BtMachineCanvasItemPrivate
   /* the analysis dialog */
   GtkWidget *analysis_dialog;
 
-  /* the graphical components */
+  /* the graphical components, the image is shared via ui-resources */
   ClutterContent *image;
   ClutterContent *image_custom_gfx;
+  ClutterActor *custom_gfx;
   ClutterActor *label;
   ClutterActor *output_meter, *input_meter;
   GstElement *output_level;
@@ -133,7 +129,8 @@ struct _BtMachineCanvasItemPrivate
   guint skip_input_level;
   guint skip_output_level;
 
-  GstClock *clock;
+  /* receives the level meter values */
+  BtMeterHub *meter_hub;
 
   /* cursor for moving */
   GdkCursor *drag_cursor;
@@ -152,14 +149,10 @@ struct _BtMachineCanvasItemPrivate
   /* custom graphics */
   guint custom_gfx_timer;
   GMutex custom_gfx_lock;
-  
-  /* lock for multithreaded access */
-  GMutex lock;
 };
 
 static guint signals[LAST_SIGNAL] = { 0, };
 
-static GQuark bus_msg_level_quark = 0;
 static GQuark machine_canvas_item_quark = 0;
 
 
@@ -183,21 +176,17 @@ static void on_signal_analysis_dialog_destroy (GtkWidget * widget,
 static void
 update_machine_graphics (BtMachineCanvasItem * self)
 {
-  GdkPixbuf *pixbuf =
-      bt_ui_resources_get_machine_graphics_pixbuf_by_machine (self->
-      priv->machine, self->priv->zoom);
-
-  clutter_image_set_data (CLUTTER_IMAGE (self->priv->image),
-      gdk_pixbuf_get_pixels (pixbuf), gdk_pixbuf_get_has_alpha (pixbuf)
-      ? COGL_PIXEL_FORMAT_RGBA_8888
-      : COGL_PIXEL_FORMAT_RGB_888,
-      gdk_pixbuf_get_width (pixbuf),
-      gdk_pixbuf_get_height (pixbuf), gdk_pixbuf_get_rowstride (pixbuf), NULL);
-
-  GST_INFO ("pixbuf: %dx%d", gdk_pixbuf_get_width (pixbuf),
-      gdk_pixbuf_get_height (pixbuf));
-
-  g_object_unref (pixbuf);
+  ClutterContent *image =
+      bt_ui_resources_get_machine_graphics_by_machine (self->priv->machine,
+      self->priv->zoom);
+
+  if (image != self->priv->image) {
+    clutter_actor_set_content ((ClutterActor *) self, image);
+    g_object_try_unref (self->priv->image);
+    self->priv->image = image;
+  } else {
+    g_object_unref (image);
+  }
 }
 
 static void
@@ -207,10 +196,15 @@ update_custom_graphics (BtMachineCanvasItem * self, guint width, guint height, g
   if (data) {
     clutter_image_set_data (CLUTTER_IMAGE (self->priv->image_custom_gfx),
         (guint8*)data, COGL_PIXEL_FORMAT_RGBA_8888, width, height, width*4, NULL);
+    if (self->priv->custom_gfx)
+      clutter_actor_show (self->priv->custom_gfx);
   } else {
     int32_t zero = 0;
     clutter_image_set_data (CLUTTER_IMAGE (self->priv->image_custom_gfx),
         (guint8*)&zero, COGL_PIXEL_FORMAT_RGBA_8888, 1, 1, 4, NULL);
+    // don't paint an empty layer on top of each machine
+    if (self->priv->custom_gfx)
+      clutter_actor_hide (self->priv->custom_gfx);
   }
 }
 
@@ -349,129 +343,49 @@ on_song_is_playing_notify (const BtSong * song, GParamSpec * arg,
   }
 }
 
-typedef struct
-{
-  BtMachineCanvasItem *self;
-  ClutterActor *meter;
-  gdouble peak;
-} BtUpdateIdleData;
-
-#define MAKE_UPDATE_IDLE_DATA(data,self,meter,peak) G_STMT_START { \
-  data=g_slice_new(BtUpdateIdleData); \
-  data->self=self; \
-  data->meter=meter; \
-  data->peak=peak; \
-  g_mutex_lock(&self->priv->lock); \
-  g_object_add_weak_pointer((GObject *)self,(gpointer *)(&data->self)); \
-  g_mutex_unlock(&self->priv->lock); \
-} G_STMT_END
-
-#define FREE_UPDATE_IDLE_DATA(data) G_STMT_START { \
-  if(data->self) { \
-    g_mutex_lock(&data->self->priv->lock); \
-    g_object_remove_weak_pointer((gpointer)data->self,(gpointer *)(&data->self)); \
-    g_mutex_unlock(&data->self->priv->lock); \
-  } \
-  g_slice_free(BtUpdateIdleData,data); \
-} G_STMT_END
-
-
-static gboolean
-on_delayed_idle_machine_level_change (gpointer user_data)
+static void
+on_machine_level_change (GstElement * level, const BtMeterLevels * levels,
+    gpointer user_data)
 {
-  BtUpdateIdleData *data = (BtUpdateIdleData *) user_data;
-  BtMachineCanvasItem *self = data->self;
-
-  if (self && self->priv->is_playing) {
-    const gdouble h = (MACHINE_METER_HEIGHT * data->peak);
-
-    g_object_set (data->meter, "y", MACHINE_METER_BASE - h, "height", h, NULL);
+  BtMachineCanvasItem *self = BT_MACHINE_CANVAS_ITEM (user_data);
+  ClutterActor *meter = NULL;
+  gdouble peak, h;
+  guint new_skip = 0, old_skip = 0;
+
+  if (!self->priv->is_playing)
+    return;
+
+  // check the value and calculate the average for the channels
+  peak = bt_meter_levels_get_aggregated (levels->peak, levels->channels,
+      LOW_VUMETER_VAL);
+  // check if we are very loud
+  if (peak > 0.0) {
+    new_skip = 2;               // beyond max level
+    peak = 0.0;
+  } else
+    peak = peak / LOW_VUMETER_VAL;
+  // check if we a silent
+  if (peak >= 1.0) {
+    new_skip = 1;               // below min level
+    peak = 1.0;
   }
-  FREE_UPDATE_IDLE_DATA (data);
-  return FALSE;
-}
-
-static gboolean
-on_delayed_machine_level_change (GstClock * clock, GstClockTime time,
-    GstClockID id, gpointer user_data)
-{
-  // the callback is called from a clock thread
-  if (GST_CLOCK_TIME_IS_VALID (time))
-    g_idle_add_full (G_PRIORITY_HIGH, on_delayed_idle_machine_level_change,
-        user_data, NULL);
-  else {
-    BtUpdateIdleData *data = (BtUpdateIdleData *) user_data;
-    FREE_UPDATE_IDLE_DATA (data);
+  peak = 1.0 - peak;            // invert since it was -db
+  // skip *updates* if we are still below LOW_VUMETER_VAL or beyond 0.0
+  if (level == self->priv->output_level) {
+    meter = self->priv->output_meter;
+    old_skip = self->priv->skip_output_level;
+    self->priv->skip_output_level = new_skip;
+  } else if (level == self->priv->input_level) {
+    meter = self->priv->input_meter;
+    old_skip = self->priv->skip_input_level;
+    self->priv->skip_input_level = new_skip;
   }
-  return TRUE;
-}
-
-static void
-on_machine_level_change (GstBus * bus, GstMessage * message, gpointer user_data)
-{
-  const GstStructure *s = gst_message_get_structure (message);
-  const GQuark name_id = gst_structure_get_name_id (s);
-
-  if (name_id == bus_msg_level_quark) {
-    BtMachineCanvasItem *self = BT_MACHINE_CANVAS_ITEM (user_data);
-    GstElement *level = GST_ELEMENT (GST_MESSAGE_SRC (message));
-
-    // check if its our level-meter
-    if ((level == self->priv->output_level) ||
-        (level == self->priv->input_level)) {
-      GstClockTime waittime = bt_gst_analyzer_get_waittime (level, s, TRUE);
-      if (GST_CLOCK_TIME_IS_VALID (waittime)) {
-        ClutterActor *meter = NULL;
-        gdouble peak;
-        gint new_skip = 0, old_skip = 0;
-
-        // check the value and calculate the average for the channels
-        peak =
-            bt_gst_level_message_get_aggregated_field (s, "peak",
-            LOW_VUMETER_VAL);
-        // check if we are very loud
-        if (peak > 0.0) {
-          new_skip = 2;         // beyond max level
-          peak = 0.0;
-        } else
-          peak = peak / LOW_VUMETER_VAL;
-        // check if we a silent
-        if (peak >= 1.0) {
-          new_skip = 1;         // below min level
-          peak = 1.0;
-        }
-        peak = 1.0 - peak;      // invert since it was -db
-        // skip *updates* if we are still below LOW_VUMETER_VAL or beyond 0.0
-        if (level == self->priv->output_level) {
-          meter = self->priv->output_meter;
-          old_skip = self->priv->skip_output_level;
-          self->priv->skip_output_level = new_skip;
-        } else if (level == self->priv->input_level) {
-          meter = self->priv->input_meter;
-          old_skip = self->priv->skip_input_level;
-          self->priv->skip_input_level = new_skip;
-        }
-        if (!old_skip || !new_skip || old_skip != new_skip) {
-          BtUpdateIdleData *data;
-          GstClockID clock_id;
-          GstClockReturn clk_ret;
-
-          waittime += gst_element_get_base_time (level);
-          clock_id = gst_clock_new_single_shot_id (self->priv->clock, waittime);
-          MAKE_UPDATE_IDLE_DATA (data, self, meter, peak);
-          if ((clk_ret = gst_clock_id_wait_async (clock_id,
-                      on_delayed_machine_level_change,
-                      (gpointer) data, NULL)) != GST_CLOCK_OK) {
-            GST_WARNING_OBJECT (level, "clock wait failed: %d", clk_ret);
-            FREE_UPDATE_IDLE_DATA (data);
-          }
-          gst_clock_id_unref (clock_id);
-        }
-        // just for counting
-        //else GST_WARNING_OBJECT(level,"skipping level update");
-      }
-    }
+  if (meter && (!old_skip || !new_skip || old_skip != new_skip)) {
+    h = (MACHINE_METER_HEIGHT * peak);
+    g_object_set (meter, "y", MACHINE_METER_BASE - h, "height", h, NULL);
   }
+  // just for counting
+  //else GST_WARNING_OBJECT(level,"skipping level update");
 }
 
 static void
@@ -1145,7 +1059,6 @@ bt_machine_canvas_item_constructed (GObject * object)
 
   // add machine components
   // the body
-  self->priv->image = clutter_image_new ();
   update_machine_graphics (self);
   clutter_actor_set_content_scaling_filters ((ClutterActor *) self,
       CLUTTER_SCALING_FILTER_TRILINEAR, CLUTTER_SCALING_FILTER_LINEAR);
@@ -1153,7 +1066,6 @@ bt_machine_canvas_item_constructed (GObject * object)
   clutter_actor_set_pivot_point ((ClutterActor *) self, 0.5, 0.5);
   clutter_actor_set_translation ((ClutterActor *) self, (MACHINE_W / -2.0),
       (MACHINE_H / -2.0), 0.0);
-  clutter_actor_set_content ((ClutterActor *) self, self->priv->image);
 
   // a child actor allowing display of additional gfx by the machine element
   ClutterActor *actor_custom_gfx = clutter_actor_new();
@@ -1162,6 +1074,9 @@ bt_machine_canvas_item_constructed (GObject * object)
   clutter_actor_set_size (actor_custom_gfx, MACHINE_W, MACHINE_H);
   clutter_actor_set_content (actor_custom_gfx, self->priv->image_custom_gfx);
   clutter_actor_add_child ((ClutterActor *) self, actor_custom_gfx);
+  // shown once the machine provides graphics
+  clutter_actor_hide (actor_custom_gfx);
+  self->priv->custom_gfx = actor_custom_gfx;
 
   // the name label
   // TODO(ensonic): use MACHINE_LABEL_HEIGHT (7)
@@ -1336,6 +1251,8 @@ bt_machine_canvas_item_set_property (GObject * object, guint property_id,
             g_object_get (self->priv->machine, "output-post-level",
                 &self->priv->output_level, NULL);
             g_object_try_weak_ref (self->priv->output_level);
+            bt_meter_hub_add (self->priv->meter_hub, self->priv->output_level,
+                on_machine_level_change, (gpointer) self);
             gst_object_unref (self->priv->output_level);
           } else {
             GST_INFO ("enabling output level for machine failed");
@@ -1347,6 +1264,8 @@ bt_machine_canvas_item_set_property (GObject * object, guint property_id,
             g_object_get (self->priv->machine, "input-pre-level",
                 &self->priv->input_level, NULL);
             g_object_try_weak_ref (self->priv->input_level);
+            bt_meter_hub_add (self->priv->meter_hub, self->priv->input_level,
+                on_machine_level_change, (gpointer) self);
             gst_object_unref (self->priv->input_level);
           } else {
             GST_INFO ("enabling input level for machine failed");
@@ -1358,7 +1277,7 @@ bt_machine_canvas_item_set_property (GObject * object, guint property_id,
     case MACHINE_CANVAS_ITEM_ZOOM:
       self->priv->zoom = g_value_get_double (value);
       GST_DEBUG ("set the zoom for machine_canvas_item: %f", self->priv->zoom);
-      /* reload the svg icons, we do this to keep them sharp */
+      /* use the icons rendered for this zoom level, to keep them sharp */
       if (self->priv->image) {
         update_machine_graphics (self);
       }
@@ -1390,18 +1309,25 @@ bt_machine_canvas_item_dispose (GObject * object)
     g_object_unref(element_old);
   }
   
-  g_object_unref (self->priv->image);
+  g_object_try_unref (self->priv->image);
   g_object_unref (self->priv->image_custom_gfx);
 
   GST_INFO ("release the machine %" G_OBJECT_REF_COUNT_FMT,
       G_OBJECT_LOG_REF_COUNT (self->priv->machine));
 
+  if (self->priv->output_level) {
+    bt_meter_hub_remove (self->priv->meter_hub, self->priv->output_level,
+        (gpointer) self);
+  }
+  if (self->priv->input_level) {
+    bt_meter_hub_remove (self->priv->meter_hub, self->priv->input_level,
+        (gpointer) self);
+  }
+  g_object_unref (self->priv->meter_hub);
   g_object_try_weak_unref (self->priv->output_level);
   g_object_try_weak_unref (self->priv->input_level);
   g_object_try_unref (self->priv->machine);
   g_object_try_weak_unref (self->priv->main_page_machines);
-  if (self->priv->clock)
-    gst_object_unref (self->priv->clock);
   g_object_unref (self->priv->app);
 
   GST_DEBUG ("  unrefing done");
@@ -1433,7 +1359,6 @@ bt_machine_canvas_item_finalize (GObject * object)
   BtMachineCanvasItem *self = BT_MACHINE_CANVAS_ITEM (object);
 
   GST_DEBUG ("!!!! self=%p", self);
-  g_mutex_clear (&self->priv->lock);
   g_mutex_clear (&self->priv->custom_gfx_lock);
 
   G_OBJECT_CLASS (bt_machine_canvas_item_parent_class)->finalize (object);
@@ -1659,22 +1584,15 @@ static void
 bt_machine_canvas_item_init (BtMachineCanvasItem * self)
 {
   BtSong *song;
-  GstBin *bin;
-  GstBus *bus;
 
   self->priv = bt_machine_canvas_item_get_instance_private(self);
   GST_DEBUG ("!!!! self=%p", self);
   self->priv->app = bt_edit_application_new ();
+  self->priv->meter_hub = bt_meter_hub_new ();
 
-  g_object_get (self->priv->app, "song", &song, "bin", &bin, NULL);
+  g_object_get (self->priv->app, "song", &song, NULL);
   g_signal_connect_object (song, "notify::is-playing",
       G_CALLBACK (on_song_is_playing_notify), (gpointer) self, 0);
-  bus = gst_element_get_bus (GST_ELEMENT (bin));
-  g_signal_connect_object (bus, "sync-message::element",
-      G_CALLBACK (on_machine_level_change), (gpointer) self, 0);
-  gst_object_unref (bus);
-  self->priv->clock = gst_pipeline_get_clock (GST_PIPELINE (bin));
-  gst_object_unref (bin);
   g_object_unref (song);
 
   // generate the context menu
@@ -1687,7 +1605,6 @@ bt_machine_canvas_item_init (BtMachineCanvasItem * self)
 
   self->priv->zoom = 1.0;
 
-  g_mutex_init (&self->priv->lock);
   g_mutex_init (&self->priv->custom_gfx_lock);
 
   self->priv->image_custom_gfx = clutter_image_new ();
@@ -1701,7 +1618,6 @@ bt_machine_canvas_item_class_init (BtMachineCanvasItemClass * klass)
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   ClutterActorClass *citem_class = CLUTTER_ACTOR_CLASS (klass);
 
-  bus_msg_level_quark = g_quark_from_static_string ("level");
   machine_canvas_item_quark =
       g_quark_from_static_string ("machine-canvas-item");
 
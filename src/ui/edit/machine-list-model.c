@@ -41,6 +41,8 @@ struct _BtMachineListModelPrivate
 
   GType param_types[N_COLUMNS];
   GSequence *seq;
+  /* machine -> GSequenceIter, to find rows without comparing ids */
+  GHashTable *iters;
 };
 
 //-- the class
@@ -116,12 +118,16 @@ bt_machine_list_model_add (BtMachineListModel * model, BtMachine * machine)
   GtkTreeIter iter;
   gint position;
 
+  if (g_hash_table_contains (model->priv->iters, machine))
+    return;
+
   GST_INFO_OBJECT (machine, "add machine to model");
 
   // insert new entry
   iter.stamp = model->priv->stamp;
   iter.user_data =
       g_sequence_insert_sorted (seq, machine, model_item_cmp, NULL);
+  g_hash_table_insert (model->priv->iters, machine, iter.user_data);
   position = g_sequence_iter_get_position (iter.user_data);
 
   g_signal_connect_object (machine, "notify::id",
@@ -137,15 +143,19 @@ bt_machine_list_model_add (BtMachineListModel * model, BtMachine * machine)
 static void
 bt_machine_list_model_rem (BtMachineListModel * model, BtMachine * machine)
 {
-  GSequence *seq = model->priv->seq;
   GtkTreePath *path;
   GSequenceIter *iter;
   gint position;
 
   GST_INFO_OBJECT (machine, "removing machine from model");
 
+  if (!(iter = g_hash_table_lookup (model->priv->iters, machine)))
+    return;
+
   // remove entry
-  iter = g_sequence_lookup (seq, machine, model_item_cmp, NULL);
+  g_signal_handlers_disconnect_by_func (machine, on_machine_id_changed,
+      (gpointer) model);
+  g_hash_table_remove (model->priv->iters, machine);
   position = g_sequence_iter_get_position (iter);
   g_sequence_remove (iter);
 
@@ -165,24 +175,18 @@ on_machine_id_changed (BtMachine * machine, GParamSpec * arg,
     gpointer user_data)
 {
   BtMachineListModel *model = BT_MACHINE_LIST_MODEL (user_data);
-  GSequence *seq = model->priv->seq;
   GtkTreePath *path;
   GtkTreeIter iter;
-  gint pos1, pos2 = -1, len;
+  gint pos1, pos2;
 
   // find the item by machine (cannot use model_item_cmp, as id has changed)
   iter.stamp = model->priv->stamp;
-  len = g_sequence_get_length (seq);
-  for (pos1 = 0; pos1 < len; pos1++) {
-    iter.user_data = g_sequence_get_iter_at_pos (seq, pos1);
-    if (g_sequence_get (iter.user_data) == machine) {
-      g_sequence_sort_changed (iter.user_data, model_item_cmp, NULL);
-      pos2 = g_sequence_iter_get_position (iter.user_data);
-      break;
-    }
-  }
-  if (G_UNLIKELY (pos2 == -1))
+  if (G_UNLIKELY (!(iter.user_data =
+              g_hash_table_lookup (model->priv->iters, machine))))
     return;
+  pos1 = g_sequence_iter_get_position (iter.user_data);
+  g_sequence_sort_changed (iter.user_data, model_item_cmp, NULL);
+  pos2 = g_sequence_iter_get_position (iter.user_data);
 
   GST_DEBUG ("pos %d -> %d", pos1, pos2);
 
@@ -250,13 +254,18 @@ bt_machine_list_model_new (BtSetup * setup)
 
   // get machine list from setup
   g_object_get ((gpointer) setup, "machines", &list, NULL);
-  // add machines
+  // add machines, nobody is watching the model yet, thus we don't need to
+  // signal the rows and can sort them once
   for (node = list; node; node = g_list_next (node)) {
     // we take no extra ref on the machines here
     machine = BT_MACHINE (node->data);
-    bt_machine_list_model_add (self, machine);
+    g_hash_table_insert (self->priv->iters, machine,
+        g_sequence_append (self->priv->seq, machine));
+    g_signal_connect_object (machine, "notify::id",
+        G_CALLBACK (on_machine_id_changed), (gpointer) self, 0);
   }
   g_list_free (list);
+  g_sequence_sort (self->priv->seq, model_item_cmp, NULL);
 
   g_signal_connect_object (setup, "machine-added",
       G_CALLBACK (on_machine_added), (gpointer) self, 0);
@@ -485,6 +494,7 @@ bt_machine_list_model_finalize (GObject * object)
         (gpointer *) & self->priv->setup);
   }
 
+  g_hash_table_destroy (self->priv->iters);
   g_sequence_free (self->priv->seq);
 
   G_OBJECT_CLASS (bt_machine_list_model_parent_class)->finalize (object);
@@ -496,6 +506,7 @@ bt_machine_list_model_init (BtMachineListModel * self)
   self->priv = bt_machine_list_model_get_instance_private(self);
 
   self->priv->seq = g_sequence_new (NULL);
+  self->priv->iters = g_hash_table_new (NULL, NULL);
   // random int to check whether an iter belongs to our model
   self->priv->stamp = g_random_int ();
 }
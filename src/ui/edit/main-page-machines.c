@@ -88,6 +88,8 @@ enum
 // TODO(ensonic): should we check screen dpi?
 #define MACHINE_VIEW_W 1000.0
 #define MACHINE_VIEW_H 750.0
+// resolution of the wire layer relative to the canvas size
+#define WIRES_UPSAMPLING 2.0
 // zoom range
 #define ZOOM_MIN 0.45
 #define ZOOM_MAX 2.5
@@ -114,6 +116,11 @@ struct _BtMainPageMachinesPrivate
   GtkAdjustment *hadjustment, *vadjustment;
   /* canvas background grid, child of canvas */
   ClutterContent *grid_canvas;
+  /* all wire lines drawn as one layer, child of canvas */
+  ClutterActor *wires_layer;
+  ClutterContent *wires_canvas;
+  GdkRGBA wire_line_color;
+  guint wires_update_id;
 
   /* the zoomration in pixels/per unit */
   gdouble zoom;
@@ -358,6 +365,76 @@ on_grid_draw (ClutterCanvas * canvas, cairo_t * cr, gint width, gint height,
   return TRUE;
 }
 
+/* draw all wires as one path, the wire items only show the pads */
+static gboolean
+on_wires_draw (ClutterCanvas * canvas, cairo_t * cr, gint width, gint height,
+    gpointer user_data)
+{
+  BtMainPageMachines *self = BT_MAIN_PAGE_MACHINES (user_data);
+  BtMainPageMachinesPrivate *p = self->priv;
+  BtMachineCanvasItem *src, *dst;
+  GHashTableIter iter;
+  gpointer item;
+  gfloat xs, ys, xe, ye;
+
+  /* clear the contents of the canvas, to not paint over the previous frame */
+  cairo_save (cr);
+  cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+  cairo_paint (cr);
+  cairo_restore (cr);
+  cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+
+  if (!p->canvas_w || !p->canvas_h)
+    return TRUE;
+
+  cairo_scale (cr, width / p->canvas_w, height / p->canvas_h);
+  cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
+  cairo_set_line_width (cr, 1.0);
+  gdk_cairo_set_source_rgba (cr, &p->wire_line_color);
+
+  g_hash_table_iter_init (&iter, p->wires);
+  while (g_hash_table_iter_next (&iter, NULL, &item)) {
+    g_object_get (item, "src", &src, "dst", &dst, NULL);
+    clutter_actor_get_position ((ClutterActor *) src, &xs, &ys);
+    clutter_actor_get_position ((ClutterActor *) dst, &xe, &ye);
+    cairo_move_to (cr, xs, ys);
+    cairo_line_to (cr, xe, ye);
+    g_object_unref (src);
+    g_object_unref (dst);
+  }
+  cairo_stroke (cr);
+  return TRUE;
+}
+
+static gboolean
+update_wires (gpointer user_data)
+{
+  BtMainPageMachines *self = BT_MAIN_PAGE_MACHINES (user_data);
+  BtMainPageMachinesPrivate *p = self->priv;
+  gdouble scale = MIN (p->zoom, WIRES_UPSAMPLING);
+
+  p->wires_update_id = 0;
+  clutter_actor_set_size (p->wires_layer, p->canvas_w, p->canvas_h);
+  // this already redraws if the size changes
+  if (!clutter_canvas_set_size (CLUTTER_CANVAS (p->wires_canvas),
+          (gint) (p->canvas_w * scale), (gint) (p->canvas_h * scale))) {
+    clutter_content_invalidate (p->wires_canvas);
+  }
+  return FALSE;
+}
+
+/* redraw the wire layer once before the next frame, no matter how many wires
+ * or machines changed */
+static void
+queue_wires_update (const BtMainPageMachines * self)
+{
+  if (!self->priv->wires_update_id) {
+    self->priv->wires_update_id =
+        g_idle_add_full (G_PRIORITY_HIGH_IDLE, update_wires, (gpointer) self,
+        NULL);
+  }
+}
+
 //-- linking signal handler & helper
 
 static void
@@ -530,6 +607,10 @@ wire_item_new (const BtMainPageMachines * self, BtWire * wire,
   item =
       bt_wire_canvas_item_new (self, wire, src_machine_item, dst_machine_item);
   g_hash_table_insert (self->priv->wires, wire, item);
+  // keep the wire lines below the wire pads
+  clutter_actor_set_child_below_sibling (self->priv->canvas,
+      self->priv->wires_layer, NULL);
+  queue_wires_update (self);
 }
 
 /* TODO(ensonic):
@@ -663,6 +744,7 @@ update_scrolled_window_zoom (const BtMainPageMachines * self)
 
   // keep machines centered
   g_hash_table_foreach (p->machines, machine_actor_move, delta);
+  queue_wires_update (self);
 
   update_scrolled_window (self);
 }
@@ -684,6 +766,7 @@ machine_view_clear (const BtMainPageMachines * self)
   GST_DEBUG ("before destoying wire canvas items");
   g_hash_table_foreach_remove (self->priv->wires,
       machine_view_remove_item, NULL);
+  queue_wires_update (self);
   GST_DEBUG ("done");
 }
 
@@ -912,6 +995,7 @@ on_machine_item_position_changed (BtMachineCanvasItem * machine_item,
   BtMainPageMachines *self = BT_MAIN_PAGE_MACHINES (user_data);
   gchar *mid;
 
+  queue_wires_update (self);
   switch (ev_type) {
     case CLUTTER_BUTTON_PRESS:
       machine_actor_update_pos_and_bb (self, (ClutterActor *) machine_item,
@@ -1044,6 +1128,7 @@ on_wire_removed (BtSetup * setup, BtWire * wire, gpointer user_data)
         G_OBJECT_LOG_REF_COUNT (item));
     g_hash_table_remove (self->priv->wires, wire);
     clutter_actor_destroy (item);
+    queue_wires_update (self);
   }
 
   GST_INFO_OBJECT (wire, "... wire removed: %" G_OBJECT_REF_COUNT_FMT,
@@ -1576,10 +1661,15 @@ on_canvas_style_updated (GtkStyleContext * style_ctx, gconstpointer user_data)
       &self->priv->wire_good_color);
   gtk_style_context_lookup_color (style_ctx, "new_wire_bad",
       &self->priv->wire_bad_color);
+  gtk_style_context_lookup_color (style_ctx, "wire_line",
+      &self->priv->wire_line_color);
 
   if (self->priv->grid_canvas) {
     clutter_content_invalidate (self->priv->grid_canvas);
   }
+  if (self->priv->wires_canvas) {
+    queue_wires_update (self);
+  }
 }
 
 //-- helper methods
@@ -1803,6 +1893,16 @@ bt_main_page_machines_init_ui (const BtMainPageMachines * self,
   /* invalidate the canvas, so that we can draw before the main loop starts */
   clutter_content_invalidate (self->priv->grid_canvas);
 
+  self->priv->wires_canvas = clutter_canvas_new ();
+  g_signal_connect_object (self->priv->wires_canvas, "draw",
+      G_CALLBACK (on_wires_draw), (gpointer) self, 0);
+  self->priv->wires_layer = clutter_actor_new ();
+  clutter_actor_set_content (self->priv->wires_layer, self->priv->wires_canvas);
+  clutter_actor_set_content_scaling_filters (self->priv->wires_layer,
+      CLUTTER_SCALING_FILTER_TRILINEAR, CLUTTER_SCALING_FILTER_LINEAR);
+  clutter_actor_add_child (self->priv->canvas, self->priv->wires_layer);
+  queue_wires_update (self);
+
   gtk_grid_attach (GTK_GRID (table), self->priv->canvas_widget, 0, 0, 1, 1);
   gtk_box_pack_start (GTK_BOX (self), table, TRUE, TRUE, 0);
 
@@ -2589,6 +2689,10 @@ bt_main_page_machines_dispose (GObject * object)
   return_if_disposed ();
   self->priv->dispose_has_run = TRUE;
   GST_DEBUG ("!!!! self=%p", self);
+  if (self->priv->wires_update_id) {
+    g_source_remove (self->priv->wires_update_id);
+  }
+  g_object_try_unref (self->priv->wires_canvas);
   GST_DEBUG ("  unrefing popups");
   g_object_try_unref (self->priv->wire_gain);
   if (self->priv->vol_popup) {
@@ -182,6 +182,14 @@ typedef struct
   gfloat min, max;
 } BtPatternEditorColumnConverters;
 
+/* packed value group columns before and after an edit, in the order the
+ * columns are logged, see pattern_range_pack() */
+typedef struct
+{
+  GPtrArray *old_cols, *new_cols;
+  guint ix;
+} BtPatternRangeColumns;
+
 //-- the class
 
 static void bt_main_page_patterns_change_logger_interface_init (gpointer const
@@ -417,9 +425,95 @@ pattern_range_copy (const BtMainPagePatterns * self, gint beg, gint end,
   }
 }
 
+/* pattern_column_pack:
+ *
+ * Append the packed column range to @columns.
+ */
+static void
+pattern_column_pack (BtValueGroup * vg, gint beg, gint end, gint param,
+    GPtrArray * columns)
+{
+  GByteArray *data = g_byte_array_new ();
+
+  bt_value_group_pack_column_range (vg, beg, end, param, data);
+  g_ptr_array_add (columns, g_byte_array_free_to_bytes (data));
+}
+
+/* pattern_column_unpack:
+ *
+ * Restore the column range from @column if we have it, otherwise or if it does
+ * not fit parse the values from @str.
+ */
+static gboolean
+pattern_column_unpack (BtValueGroup * vg, gint beg, gint end, gint param,
+    const gchar * str, GBytes * column)
+{
+  if (column) {
+    gsize size;
+    gconstpointer data = g_bytes_get_data (column, &size);
+
+    if (bt_value_group_unpack_column_range (vg, beg, end, param, data, size))
+      return TRUE;
+  }
+  return bt_value_group_deserialize_column (vg, beg, end, param, str);
+}
+
+/* pattern_range_pack:
+ *
+ * Pack the columns of the given range for undo/redo, in the order they are
+ * logged by pattern_range_log_undo_redo().
+ */
+static GPtrArray *
+pattern_range_pack (const BtMainPagePatterns * self, gint beg, gint end,
+    gint group, gint param)
+{
+  GPtrArray *columns =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+  BtPatternEditorColumnGroup *pc_group;
+  guint g, beg_group = 0, end_group = self->priv->number_of_groups;
+  guint p, beg_param, end_param;
+
+  if (group != -1) {
+    beg_group = group;
+    end_group = group + 1;
+  }
+  for (g = beg_group; g < end_group; g++) {
+    pc_group = &self->priv->param_groups[g];
+    beg_param = (param != -1) ? param : 0;
+    end_param = (param != -1) ? param + 1 : pc_group->num_columns;
+    for (p = beg_param; p < end_param; p++) {
+      pattern_column_pack (pc_group->vg, beg, end, p, columns);
+    }
+  }
+  return columns;
+}
+
+/* pattern_column_log_change:
+ *
+ * Add the change to the log, with the next packed columns from @cols if we
+ * have them.
+ */
+static void
+pattern_column_log_change (const BtMainPagePatterns * self, gchar * undo_str,
+    gchar * redo_str, BtPatternRangeColumns * cols)
+{
+  if (cols && cols->ix < cols->old_cols->len
+      && cols->ix < cols->new_cols->len) {
+    bt_change_log_add_column (self->priv->change_log, BT_CHANGE_LOGGER (self),
+        undo_str, redo_str,
+        g_bytes_ref (g_ptr_array_index (cols->old_cols, cols->ix)),
+        g_bytes_ref (g_ptr_array_index (cols->new_cols, cols->ix)));
+    cols->ix++;
+  } else {
+    bt_change_log_add (self->priv->change_log, BT_CHANGE_LOGGER (self),
+        undo_str, redo_str);
+  }
+}
+
 static void
 pattern_column_log_undo_redo (const BtMainPagePatterns * self,
-    const gchar * fmt, gint param, gchar ** old_str, gchar ** new_str)
+    const gchar * fmt, gint param, gchar ** old_str, gchar ** new_str,
+    BtPatternRangeColumns * cols)
 {
   gchar *p, *undo_str, *redo_str;
 
@@ -435,13 +529,13 @@ pattern_column_log_undo_redo (const BtMainPagePatterns * self,
   } else {
     redo_str = g_strdup (undo_str);
   }
-  bt_change_log_add (self->priv->change_log, BT_CHANGE_LOGGER (self), undo_str,
-      redo_str);
+  pattern_column_log_change (self, undo_str, redo_str, cols);
 }
 
 static void
 pattern_columns_log_undo_redo (const BtMainPagePatterns * self,
-    const gchar * fmt, guint num_columns, gchar ** old_str, gchar ** new_str)
+    const gchar * fmt, guint num_columns, gchar ** old_str, gchar ** new_str,
+    BtPatternRangeColumns * cols)
 {
   guint i;
   gchar *p, *undo_str, *redo_str;
@@ -459,18 +553,20 @@ pattern_columns_log_undo_redo (const BtMainPagePatterns * self,
     } else {
       redo_str = g_strdup (undo_str);
     }
-    bt_change_log_add (self->priv->change_log, BT_CHANGE_LOGGER (self),
-        undo_str, redo_str);
+    pattern_column_log_change (self, undo_str, redo_str, cols);
   }
 }
 
 /* pattern_range_log_undo_redo:
  *
- * Add undo/redo events for the given data to the log.
+ * Add undo/redo events for the given data to the log. If @cols is not %NULL,
+ * it has the packed columns from pattern_range_pack() before and after the
+ * change, which are restored on undo/redo.
  */
 static void
 pattern_range_log_undo_redo (const BtMainPagePatterns * self, gint beg,
-    gint end, gint group, gint param, gchar * old_str, gchar * new_str)
+    gint end, gint group, gint param, gchar * old_str, gchar * new_str,
+    BtPatternRangeColumns * cols)
 {
   BtPatternEditorColumnGroup *pc_group;
   BtMachine *machine;
@@ -492,22 +588,22 @@ pattern_range_log_undo_redo (const BtMainPagePatterns * self, gint beg,
     for (g = 0; g < wire_groups; g++) {
       pc_group = &self->priv->param_groups[g];
       g_snprintf (fmt, MAX_CHANGE_LOGGER_METHOD_LEN, pc_group->fmt, beg, end);
-      pattern_columns_log_undo_redo (self, fmt, pc_group->num_columns, &old_str,
-          &new_str);
+      pattern_columns_log_undo_redo (self, fmt, pc_group->num_columns,
+          &old_str, &new_str, cols);
     }
 
     if (self->priv->global_params) {
       pc_group = &self->priv->param_groups[g];
       g_snprintf (fmt, MAX_CHANGE_LOGGER_METHOD_LEN, pc_group->fmt, beg, end);
-      pattern_columns_log_undo_redo (self, fmt, pc_group->num_columns, &old_str,
-          &new_str);
+      pattern_columns_log_undo_redo (self, fmt, pc_group->num_columns,
+          &old_str, &new_str, cols);
       g++;
     }
     for (v = 0; v < voices; v++, g++) {
       pc_group = &self->priv->param_groups[g];
       g_snprintf (fmt, MAX_CHANGE_LOGGER_METHOD_LEN, pc_group->fmt, beg, end);
-      pattern_columns_log_undo_redo (self, fmt, pc_group->num_columns, &old_str,
-          &new_str);
+      pattern_columns_log_undo_redo (self, fmt, pc_group->num_columns,
+          &old_str, &new_str, cols);
     }
     bt_change_log_end_group (self->priv->change_log);
   }
@@ -517,15 +613,16 @@ pattern_range_log_undo_redo (const BtMainPagePatterns * self, gint beg,
 
     pc_group = &self->priv->param_groups[group];
     g_snprintf (fmt, MAX_CHANGE_LOGGER_METHOD_LEN, pc_group->fmt, beg, end);
-    pattern_columns_log_undo_redo (self, fmt, pc_group->num_columns, &old_str,
-        &new_str);
+    pattern_columns_log_undo_redo (self, fmt, pc_group->num_columns,
+        &old_str, &new_str, cols);
     bt_change_log_end_group (self->priv->change_log);
   }
   // process one param in one group
   if (group != -1 && param != -1) {
     pc_group = &self->priv->param_groups[group];
     g_snprintf (fmt, MAX_CHANGE_LOGGER_METHOD_LEN, pc_group->fmt, beg, end);
-    pattern_column_log_undo_redo (self, fmt, param, &old_str, &new_str);
+    pattern_column_log_undo_redo (self, fmt, param, &old_str, &new_str,
+        cols);
   }
   g_object_unref (machine);
 }
@@ -550,8 +647,10 @@ pattern_selection_apply (const BtMainPagePatterns * self, BtValueGroupOp op)
           &group, &param)) {
     GString *old_data = g_string_new (NULL), *new_data = g_string_new (NULL);
     BtPatternEditorColumnGroup *pc_group;
+    BtPatternRangeColumns cols = { NULL, };
 
     pattern_range_copy (self, beg, end, group, param, old_data);
+    cols.old_cols = pattern_range_pack (self, beg, end, group, param);
 
     GST_INFO ("applying : %d %d , %d %d", beg, end, group, param);
     // process full pattern
@@ -575,9 +674,12 @@ pattern_selection_apply (const BtMainPagePatterns * self, BtValueGroupOp op)
     if (res) {
       gtk_widget_queue_draw (GTK_WIDGET (self->priv->pattern_table));
       pattern_range_copy (self, beg, end, group, param, new_data);
+      cols.new_cols = pattern_range_pack (self, beg, end, group, param);
       pattern_range_log_undo_redo (self, beg, end, group, param, old_data->str,
-          new_data->str);
+          new_data->str, &cols);
+      g_ptr_array_unref (cols.new_cols);
     }
+    g_ptr_array_unref (cols.old_cols);
     g_string_free (old_data, TRUE);
     g_string_free (new_data, TRUE);
   }
@@ -660,19 +762,20 @@ on_pattern_removed (BtMachine * machine, BtPattern * pattern,
       g_object_get (smachine, "id", &smid, NULL);
       g_snprintf (fmt, MAX_CHANGE_LOGGER_METHOD_LEN,
           "set_wire_events \"%s\",\"%s\",\"%s\",0,%u", smid, mid, pid, end);
-      pattern_columns_log_undo_redo (self, fmt, wire_params, &str, NULL);
+      pattern_columns_log_undo_redo (self, fmt, wire_params, &str, NULL, NULL);
       g_free (smid);
       g_object_unref (smachine);
     }
     if (global_params) {
       g_snprintf (fmt, MAX_CHANGE_LOGGER_METHOD_LEN,
           "set_global_events \"%s\",\"%s\",0,%u", mid, pid, end);
-      pattern_columns_log_undo_redo (self, fmt, global_params, &str, NULL);
+      pattern_columns_log_undo_redo (self, fmt, global_params, &str, NULL,
+          NULL);
     }
     for (v = 0; v < voices; v++) {
       g_snprintf (fmt, MAX_CHANGE_LOGGER_METHOD_LEN,
           "set_voice_events \"%s\",\"%s\",0,%u,%u", mid, pid, end, v);
-      pattern_columns_log_undo_redo (self, fmt, voice_params, &str, NULL);
+      pattern_columns_log_undo_redo (self, fmt, voice_params, &str, NULL, NULL);
     }
     g_string_free (data, TRUE);
 
@@ -767,6 +870,7 @@ on_pattern_table_key_press_event (GtkWidget * widget, GdkEventKey * event,
     g_object_unref (pg);
   } else if (event->keyval == GDK_KEY_Insert) {
     GString *old_data = g_string_new (NULL), *new_data = g_string_new (NULL);
+    BtPatternRangeColumns cols = { NULL, };
     gulong number_of_ticks;
     gint beg, end, group, param;
 
@@ -788,6 +892,7 @@ on_pattern_table_key_press_event (GtkWidget * widget, GdkEventKey * event,
       param = p->cursor_param;
     }
     pattern_range_copy (self, beg, end, group, param, old_data);
+    cols.old_cols = pattern_range_pack (self, beg, end, group, param);
 
     if ((modifier & (GDK_CONTROL_MASK | GDK_SHIFT_MASK)) ==
         (GDK_CONTROL_MASK | GDK_SHIFT_MASK)) {
@@ -814,13 +919,17 @@ on_pattern_table_key_press_event (GtkWidget * widget, GdkEventKey * event,
     if (res) {
       gtk_widget_queue_draw (GTK_WIDGET (p->pattern_table));
       pattern_range_copy (self, beg, end, group, param, new_data);
+      cols.new_cols = pattern_range_pack (self, beg, end, group, param);
       pattern_range_log_undo_redo (self, beg, end, group, param, old_data->str,
-          new_data->str);
+          new_data->str, &cols);
+      g_ptr_array_unref (cols.new_cols);
     }
+    g_ptr_array_unref (cols.old_cols);
     g_string_free (old_data, TRUE);
     g_string_free (new_data, TRUE);
   } else if (event->keyval == GDK_KEY_Delete) {
     GString *old_data = g_string_new (NULL), *new_data = g_string_new (NULL);
+    BtPatternRangeColumns cols = { NULL, };
     gulong number_of_ticks;
     gint beg, end, group, param;
 
@@ -843,6 +952,7 @@ on_pattern_table_key_press_event (GtkWidget * widget, GdkEventKey * event,
     }
 
     pattern_range_copy (self, beg, end, group, param, old_data);
+    cols.old_cols = pattern_range_pack (self, beg, end, group, param);
 
     if ((modifier & (GDK_CONTROL_MASK | GDK_SHIFT_MASK)) ==
         (GDK_CONTROL_MASK | GDK_SHIFT_MASK)) {
@@ -869,9 +979,12 @@ on_pattern_table_key_press_event (GtkWidget * widget, GdkEventKey * event,
     if (res) {
       gtk_widget_queue_draw (GTK_WIDGET (p->pattern_table));
       pattern_range_copy (self, beg, end, group, param, new_data);
+      cols.new_cols = pattern_range_pack (self, beg, end, group, param);
       pattern_range_log_undo_redo (self, beg, end, group, param, old_data->str,
-          new_data->str);
+          new_data->str, &cols);
+      g_ptr_array_unref (cols.new_cols);
     }
+    g_ptr_array_unref (cols.old_cols);
     g_string_free (old_data, TRUE);
     g_string_free (new_data, TRUE);
   } else if (event->keyval == GDK_KEY_f) {
@@ -1432,17 +1545,26 @@ pattern_edit_set_data_at (gpointer pattern_data, gpointer column_data,
     gtk_widget_queue_draw (GTK_WIDGET (self->priv->pattern_table));
   } else {
     GString *old_data = g_string_new (NULL), *new_data = g_string_new (NULL);
+    BtPatternRangeColumns cols = { NULL, };
 
+    cols.old_cols =
+        g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
     bt_value_group_serialize_column (group->vg, row, row, param, old_data);
+    pattern_column_pack (group->vg, row, row, param, cols.old_cols);
     if (bt_value_group_set_event (group->vg, row, param, str)) {
       gchar fmt[MAX_CHANGE_LOGGER_METHOD_LEN];
       gchar *old_str, *new_str;
 
       bt_value_group_serialize_column (group->vg, row, row, param, new_data);
+      cols.new_cols =
+          g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+      pattern_column_pack (group->vg, row, row, param, cols.new_cols);
       old_str = old_data->str;
       new_str = new_data->str;
       g_snprintf (fmt, MAX_CHANGE_LOGGER_METHOD_LEN, group->fmt, row, row);
-      pattern_column_log_undo_redo (self, fmt, param, &old_str, &new_str);
+      pattern_column_log_undo_redo (self, fmt, param, &old_str, &new_str,
+          &cols);
+      g_ptr_array_unref (cols.new_cols);
       g_string_free (new_data, TRUE);
     } else {
       // reject edit (e.g. value out of range)
@@ -2665,7 +2787,7 @@ on_context_menu_voice_remove_activate (GtkMenuItem * menuitem,
       old_data = g_string_new (NULL);
       pattern_range_copy (self, 0, length - 1, group, -1, old_data);
       pattern_range_log_undo_redo (self, 0, length - 1, group, -1,
-          old_data->str, g_strdup (old_data->str));
+          old_data->str, g_strdup (old_data->str), NULL);
       g_string_free (old_data, TRUE);
     }
     g_object_unref (node->data);
@@ -2789,7 +2911,7 @@ on_context_menu_pattern_properties_activate (GtkMenuItem * menuitem,
         GString *old_data = g_string_new (NULL);
         pattern_range_copy (self, new_length, old_length - 1, -1, -1, old_data);
         pattern_range_log_undo_redo (self, new_length, old_length - 1, -1, -1,
-            old_data->str, g_strdup (old_data->str));
+            old_data->str, g_strdup (old_data->str), NULL);
         g_string_free (old_data, TRUE);
       }
     }
@@ -2827,7 +2949,7 @@ on_context_menu_pattern_properties_activate (GtkMenuItem * menuitem,
               old_data = g_string_new (NULL);
               pattern_range_copy (self, 0, length - 1, group, -1, old_data);
               pattern_range_log_undo_redo (self, 0, length - 1, group, -1,
-                  old_data->str, g_strdup (old_data->str));
+                  old_data->str, g_strdup (old_data->str), NULL);
               g_string_free (old_data, TRUE);
             }
           }
@@ -3547,8 +3669,8 @@ bt_main_page_patterns_paste_selection (const BtMainPagePatterns * self)
 //-- change logger interface
 
 static gboolean
-bt_main_page_patterns_change_logger_change (const BtChangeLogger * owner,
-    const gchar * data)
+bt_main_page_patterns_change_logger_change_column (const BtChangeLogger *
+    owner, const gchar * data, GBytes * column)
 {
   BtMainPagePatterns *self = BT_MAIN_PAGE_PATTERNS (owner);
   gboolean res = FALSE;
@@ -3594,7 +3716,7 @@ bt_main_page_patterns_change_logger_change (const BtChangeLogger * owner,
       lookup_machine_and_pattern (self, &machine, &pattern, mid, c_mid, pid,
           c_pid);
       vg = bt_pattern_get_global_group (pattern);
-      res = bt_value_group_deserialize_column (vg, s_row, e_row, param, str);
+      res = pattern_column_unpack (vg, s_row, e_row, param, str, column);
       g_free (str);
       g_free (mid);
       g_free (pid);
@@ -3638,7 +3760,7 @@ bt_main_page_patterns_change_logger_change (const BtChangeLogger * owner,
       lookup_machine_and_pattern (self, &machine, &pattern, mid, c_mid, pid,
           c_pid);
       vg = bt_pattern_get_voice_group (pattern, voice);
-      res = bt_value_group_deserialize_column (vg, s_row, e_row, param, str);
+      res = pattern_column_unpack (vg, s_row, e_row, param, str, column);
       g_free (str);
       g_free (mid);
       g_free (pid);
@@ -3686,7 +3808,7 @@ bt_main_page_patterns_change_logger_change (const BtChangeLogger * owner,
       smachine = bt_setup_get_machine_by_id (setup, smid);
       wire = bt_setup_get_wire_by_machines (setup, smachine, machine);
       vg = bt_pattern_get_wire_group (pattern, wire);
-      res = bt_value_group_deserialize_column (vg, s_row, e_row, param, str);
+      res = pattern_column_unpack (vg, s_row, e_row, param, str, column);
       g_free (str);
       g_free (smid);
       g_free (dmid);
@@ -3807,6 +3929,13 @@ bt_main_page_patterns_change_logger_change (const BtChangeLogger * owner,
   return res;
 }
 
+static gboolean
+bt_main_page_patterns_change_logger_change (const BtChangeLogger * owner,
+    const gchar * data)
+{
+  return bt_main_page_patterns_change_logger_change_column (owner, data, NULL);
+}
+
 static void
 bt_main_page_patterns_change_logger_interface_init (gpointer const g_iface,
     gconstpointer const iface_data)
@@ -3814,6 +3943,7 @@ bt_main_page_patterns_change_logger_interface_init (gpointer const g_iface,
   BtChangeLoggerInterface *const iface = g_iface;
 
   iface->change = bt_main_page_patterns_change_logger_change;
+  iface->change_column = bt_main_page_patterns_change_logger_change_column;
 }
 
 //-- wrapper
@@ -167,7 +167,7 @@ struct _BtMainPageSequencePrivate
 
   /* vumeter data */
   GHashTable *level_to_vumeter;
-  GstClock *clock;
+  BtMeterHub *meter_hub;
 
   /* number of rows contained in the model, this is the length of the sequence
    * plus extra dummy lines */
@@ -179,9 +179,6 @@ struct _BtMainPageSequencePrivate
   /* playback state */
   gboolean is_playing;
 
-  /* lock for multithreaded access */
-  GMutex lock;
-
   /* cached sequence properties */
   GHashTable *properties;
 
@@ -189,7 +186,6 @@ struct _BtMainPageSequencePrivate
   BtChangeLog *change_log;
 };
 
-static GQuark bus_msg_level_quark = 0;
 static GQuark vu_meter_skip_update = 0;
 static GQuark machine_for_track = 0;
 
@@ -986,135 +982,75 @@ on_machine_state_changed_bypass (GObject * obj, GParamSpec * arg,
       on_machine_state_changed_bypass_idle);
 }
 
-typedef struct
+static void
+on_track_level_change (GstElement * level, const BtMeterLevels * levels,
+    gpointer user_data)
 {
-  BtMainPageSequence *self;
+  BtMainPageSequence *self = BT_MAIN_PAGE_SEQUENCE (user_data);
   GtkVUMeter *vumeter;
-  gint peak, decay;
-  // DEBUG
-  //GstClockTime t0,t1,t2,t3;
-  // DEBUG
-} BtUpdateIdleData;
-
-#define MAKE_UPDATE_IDLE_DATA(data,self,vumeter,peak,decay) G_STMT_START { \
-  data=g_slice_new(BtUpdateIdleData); \
-  data->self=self; \
-  data->vumeter=vumeter; \
-  data->peak=(gint)(peak+0.5); \
-  data->decay=(gint)(decay+0.5); \
-  g_mutex_lock(&self->priv->lock); \
-  g_object_add_weak_pointer((GObject *)self,(gpointer *)(&data->self)); \
-  g_object_add_weak_pointer((GObject *)vumeter,(gpointer *)(&data->vumeter)); \
-  g_mutex_unlock(&self->priv->lock); \
-} G_STMT_END
-
-#define FREE_UPDATE_IDLE_DATA(data) G_STMT_START { \
-  if(data->self) { \
-    g_mutex_lock(&data->self->priv->lock); \
-    g_object_remove_weak_pointer((gpointer)data->self,(gpointer *)(&data->self)); \
-    if(data->vumeter) g_object_remove_weak_pointer((gpointer)data->vumeter,(gpointer *)(&data->vumeter)); \
-    g_mutex_unlock(&data->self->priv->lock); \
-  } \
-  g_slice_free(BtUpdateIdleData,data); \
-} G_STMT_END
+  gdouble decay, peak;
+  gint new_skip = 0, old_skip = 0;
 
+  // check if its our element (we can have multiple level meters)
+  if (!self->priv->is_playing ||
+      !(vumeter = g_hash_table_lookup (self->priv->level_to_vumeter, level)))
+    return;
 
-static gboolean
-on_delayed_idle_track_level_change (gpointer user_data)
-{
-  BtUpdateIdleData *data = (BtUpdateIdleData *) user_data;
-  BtMainPageSequence *self = data->self;
-
-  if (self && self->priv->is_playing && data->vumeter) {
-    //data->t3 = gst_util_get_timestamp ();
-    //GST_WARNING ("wait.2 for %"GST_TIME_FORMAT", d %"GST_TIME_FORMAT", d %"GST_TIME_FORMAT,
-    //  GST_TIME_ARGS (data->t0), GST_TIME_ARGS (data->t3 - data->t1), GST_TIME_ARGS (data->t3 - data->t2));
-    //gtk_vumeter_set_levels (data->vumeter, data->decay, data->peak);
-    gtk_vumeter_set_levels (data->vumeter, data->peak, data->decay);
+  peak = bt_meter_levels_get_aggregated (levels->peak, levels->channels,
+      LOW_VUMETER_VAL);
+  decay = bt_meter_levels_get_aggregated (levels->decay, levels->channels,
+      LOW_VUMETER_VAL);
+  // check if we are silent or very loud
+  if (decay <= LOW_VUMETER_VAL && peak <= LOW_VUMETER_VAL) {
+    new_skip = 1;               // below min level
+  } else if (decay >= 0.0 && peak >= 0.0) {
+    new_skip = 2;               // beyond max level
   }
-  FREE_UPDATE_IDLE_DATA (data);
-  return FALSE;
+  // skip *updates* if we are still below LOW_VUMETER_VAL or beyond 0.0
+  old_skip =
+      GPOINTER_TO_INT (g_object_get_qdata ((GObject *) vumeter,
+          vu_meter_skip_update));
+  g_object_set_qdata ((GObject *) vumeter, vu_meter_skip_update,
+      GINT_TO_POINTER (new_skip));
+  if (!old_skip || !new_skip || old_skip != new_skip) {
+    gtk_vumeter_set_levels (vumeter, (gint) (peak + 0.5),
+        (gint) (decay + 0.5));
+  }
+  // just for counting
+  //else GST_WARNING_OBJECT(level,"skipping level update");
 }
 
-static gboolean
-on_delayed_track_level_change (GstClock * clock, GstClockTime time,
-    GstClockID id, gpointer user_data)
+static void
+add_level_meter (BtMainPageSequence * self, GstElement * level,
+    GtkVUMeter * vumeter)
 {
-  // the callback is called from a clock thread
-  if (GST_CLOCK_TIME_IS_VALID (time)) {
-    //BtUpdateIdleData *data = (BtUpdateIdleData *) user_data;
-    //data->t2 = gst_util_get_timestamp ();
-    //GST_WARNING ("wait.1 for %"GST_TIME_FORMAT", d %"GST_TIME_FORMAT,
-    //  GST_TIME_ARGS (time), GST_TIME_ARGS (data->t2 - data->t1));
-    g_idle_add_full (G_PRIORITY_HIGH, on_delayed_idle_track_level_change,
-        user_data, NULL);
-  } else {
-    BtUpdateIdleData *data = (BtUpdateIdleData *) user_data;
-    FREE_UPDATE_IDLE_DATA (data);
+  if (!g_hash_table_contains (self->priv->level_to_vumeter, level)) {
+    bt_meter_hub_add (self->priv->meter_hub, level, on_track_level_change,
+        (gpointer) self);
   }
-  return TRUE;
+  g_hash_table_insert (self->priv->level_to_vumeter, level, vumeter);
 }
 
 static void
-on_track_level_change (GstBus * bus, GstMessage * message, gpointer user_data)
+release_level_meter (gpointer key, gpointer value, gpointer user_data)
 {
-  const GstStructure *s = gst_message_get_structure (message);
-  const GQuark name_id = gst_structure_get_name_id (s);
-
-  if (name_id == bus_msg_level_quark) {
-    BtMainPageSequence *self = BT_MAIN_PAGE_SEQUENCE (user_data);
-    GstElement *level = GST_ELEMENT (GST_MESSAGE_SRC (message));
-    GtkVUMeter *vumeter;
-
-    // check if its our element (we can have multiple level meters)
-    if ((vumeter = g_hash_table_lookup (self->priv->level_to_vumeter, level))) {
-      GstClockTime waittime = bt_gst_analyzer_get_waittime (level, s, TRUE);
-      if (GST_CLOCK_TIME_IS_VALID (waittime)) {
-        gdouble decay, peak;
-        gint new_skip = 0, old_skip = 0;
-
-        peak =
-            bt_gst_level_message_get_aggregated_field (s, "peak",
-            LOW_VUMETER_VAL);
-        decay =
-            bt_gst_level_message_get_aggregated_field (s, "decay",
-            LOW_VUMETER_VAL);
-        // check if we are silent or very loud
-        if (decay <= LOW_VUMETER_VAL && peak <= LOW_VUMETER_VAL) {
-          new_skip = 1;         // below min level
-        } else if (decay >= 0.0 && peak >= 0.0) {
-          new_skip = 2;         // beyond max level
-        }
-        // skip *updates* if we are still below LOW_VUMETER_VAL or beyond 0.0
-        old_skip =
-            GPOINTER_TO_INT (g_object_get_qdata ((GObject *) vumeter,
-                vu_meter_skip_update));
-        g_object_set_qdata ((GObject *) vumeter, vu_meter_skip_update,
-            GINT_TO_POINTER (new_skip));
-        if (!old_skip || !new_skip || old_skip != new_skip) {
-          BtUpdateIdleData *data;
-          GstClockID clock_id;
-          GstClockReturn clk_ret;
-
-          waittime += gst_element_get_base_time (level);
-          clock_id = gst_clock_new_single_shot_id (self->priv->clock, waittime);
-          MAKE_UPDATE_IDLE_DATA (data, self, vumeter, peak, decay);
-          //data->t0 = waittime;
-          //data->t1 = gst_util_get_timestamp ();
-          //GST_WARNING ("wait.0 for %"GST_TIME_FORMAT, GST_TIME_ARGS (waittime));
-          if ((clk_ret = gst_clock_id_wait_async (clock_id,
-                      on_delayed_track_level_change,
-                      (gpointer) data, NULL)) != GST_CLOCK_OK) {
-            GST_WARNING_OBJECT (vumeter, "clock wait failed: %d", clk_ret);
-            FREE_UPDATE_IDLE_DATA (data);
-          }
-          gst_clock_id_unref (clock_id);
-        }
-        // just for counting
-        //else GST_WARNING_OBJECT(level,"skipping level update");
-      }
-    }
+  BtMainPageSequence *self = BT_MAIN_PAGE_SEQUENCE (user_data);
+
+  bt_meter_hub_remove (self->priv->meter_hub, GST_ELEMENT (key),
+      (gpointer) self);
+}
+
+static void
+reset_level_meters (BtMainPageSequence * self)
+{
+  if (self->priv->level_to_vumeter) {
+    g_hash_table_foreach (self->priv->level_to_vumeter, release_level_meter,
+        (gpointer) self);
+    g_hash_table_destroy (self->priv->level_to_vumeter);
   }
+  self->priv->level_to_vumeter =
+      g_hash_table_new_full (NULL, NULL, (GDestroyNotify) gst_object_unref,
+      NULL);
 }
 
 static void
@@ -1472,11 +1408,7 @@ sequence_table_init (const BtMainPageSequence * self)
   } else
     GST_WARNING ("can't create treeview column");
 
-  if (self->priv->level_to_vumeter)
-    g_hash_table_destroy (self->priv->level_to_vumeter);
-  self->priv->level_to_vumeter =
-      g_hash_table_new_full (NULL, NULL, (GDestroyNotify) gst_object_unref,
-      NULL);
+  reset_level_meters (self);
 
   GST_DEBUG ("    number of columns : %d", col_index);
 }
@@ -1624,7 +1556,7 @@ sequence_table_refresh_columns (const BtMainPageSequence * self,
 
         // add level meters to hashtable
         if (level) {
-          g_hash_table_insert (self->priv->level_to_vumeter, level, vumeter);
+          add_level_meter (self, level, vumeter);
         }
       } else {
         // eat space
@@ -1998,6 +1930,7 @@ reset_selection (const BtMainPageSequence * self)
 {
   self->priv->selection_start_column = self->priv->selection_start_row =
       self->priv->selection_end_column = self->priv->selection_end_row = -1;
+  bt_sequence_view_refresh (BT_SEQUENCE_VIEW (self->priv->sequence_table));
 }
 
 /*
@@ -2603,7 +2536,7 @@ on_sequence_table_cursor_changed_idle (gpointer user_data)
       }
       gtk_tree_view_scroll_to_cell (self->priv->sequence_table, path, column,
           FALSE, 1.0, 0.0);
-      gtk_widget_queue_draw (GTK_WIDGET (self->priv->sequence_table));
+      bt_sequence_view_refresh (BT_SEQUENCE_VIEW (self->priv->sequence_table));
     }
   } else {
     GST_INFO ("No cursor pos, column=%p, path=%p", column, path);
@@ -2843,7 +2776,8 @@ on_sequence_table_key_press_event (GtkWidget * widget, GdkEventKey * event,
             break;
         }
         if (select) {
-          gtk_widget_queue_draw (GTK_WIDGET (self->priv->sequence_table));
+          bt_sequence_view_refresh (BT_SEQUENCE_VIEW (self->
+                  priv->sequence_table));
           res = TRUE;
         }
       } else {
@@ -2852,7 +2786,8 @@ on_sequence_table_key_press_event (GtkWidget * widget, GdkEventKey * event,
           self->priv->selection_start_column = self->priv->selection_start_row =
               self->priv->selection_end_column = self->priv->selection_end_row =
               -1;
-          gtk_widget_queue_draw (GTK_WIDGET (self->priv->sequence_table));
+          bt_sequence_view_refresh (BT_SEQUENCE_VIEW (self->
+                  priv->sequence_table));
         }
       }
     } else if (event->keyval == GDK_KEY_b) {
@@ -3121,10 +3056,7 @@ on_sequence_table_button_press_event (GtkWidget * widget,
             gtk_widget_grab_focus_savely (GTK_WIDGET (self->
                     priv->sequence_table));
             // reset selection
-            self->priv->selection_start_column =
-                self->priv->selection_start_row =
-                self->priv->selection_end_column =
-                self->priv->selection_end_row = -1;
+            reset_selection (self);
             if (event->type == GDK_2BUTTON_PRESS) {
               switch_to_pattern_editor (self, row, track - 1);
             }
@@ -3229,7 +3161,8 @@ on_sequence_table_motion_notify_event (GtkWidget * widget,
                 self->priv->selection_end_row = self->priv->cursor_row;
               }
             }
-            gtk_widget_queue_draw (GTK_WIDGET (self->priv->sequence_table));
+            bt_sequence_view_refresh (BT_SEQUENCE_VIEW (self->
+                    priv->sequence_table));
           }
         }
         res = TRUE;
@@ -3483,8 +3416,6 @@ on_song_changed (const BtEditApplication * app, GParamSpec * arg,
   BtMainPageSequence *self = BT_MAIN_PAGE_SEQUENCE (user_data);
   BtSong *song;
   BtSetup *setup;
-  GstBin *bin;
-  GstBus *bus;
   glong bars;
   gulong sequence_length;
   gchar *prop;
@@ -3504,18 +3435,14 @@ on_song_changed (const BtEditApplication * app, GParamSpec * arg,
   GST_INFO ("song: %" G_OBJECT_REF_COUNT_FMT, G_OBJECT_LOG_REF_COUNT (song));
 
   g_object_get (song, "setup", &setup, "song-info", &self->priv->song_info,
-      "sequence", &self->priv->sequence, "bin", &bin, NULL);
+      "sequence", &self->priv->sequence, NULL);
   g_object_get (self->priv->sequence, "len-patterns", &sequence_length, "properties",
       &self->priv->properties, NULL);
   // make sequence_length and step_filter_pos accord to song length
   self->priv->sequence_length = sequence_length;
 
   // reset vu-meter hash (rebuilt below)
-  if (self->priv->level_to_vumeter)
-    g_hash_table_destroy (self->priv->level_to_vumeter);
-  self->priv->level_to_vumeter =
-      g_hash_table_new_full (NULL, NULL, (GDestroyNotify) gst_object_unref,
-      NULL);
+  reset_level_meters (self);
 
   // reset cursor pos
   self->priv->cursor_column = 1;
@@ -3553,14 +3480,6 @@ on_song_changed (const BtEditApplication * app, GParamSpec * arg,
   sequence_calculate_visible_lines (self);
   g_object_set (self->priv->sequence_table, "play-position", 0.0, NULL);
   g_object_set (self->priv->sequence_pos_table, "play-position", 0.0, NULL);
-  // vumeters
-  bus = gst_element_get_bus (GST_ELEMENT (bin));
-  bt_g_signal_connect_object (bus, "sync-message::element",
-      G_CALLBACK (on_track_level_change), (gpointer) self, 0);
-  gst_object_unref (bus);
-  if (self->priv->clock)
-    gst_object_unref (self->priv->clock);
-  self->priv->clock = gst_pipeline_get_clock (GST_PIPELINE (bin));
 
   // subscribe to play-pos changes of song->sequence
   g_signal_connect_object (song, "notify::play-pos",
@@ -3571,7 +3490,6 @@ on_song_changed (const BtEditApplication * app, GParamSpec * arg,
   g_signal_connect_object (self->priv->song_info, "notify::bars",
       G_CALLBACK (on_song_info_bars_changed), (gpointer) self, 0);
   //-- release the references
-  gst_object_unref (bin);
   g_object_unref (setup);
   g_object_unref (song);
   GST_INFO ("song has changed done");
@@ -4111,8 +4029,7 @@ bt_main_page_sequence_delete_selection (const BtMainPageSequence * self)
     GST_WARNING ("  can't get tree-model");
   }
   // reset selection
-  self->priv->selection_start_column = self->priv->selection_start_row =
-      self->priv->selection_end_column = self->priv->selection_end_row = -1;
+  reset_selection (self);
 }
 
 /**
@@ -4703,8 +4620,12 @@ bt_main_page_sequence_dispose (GObject * object)
 
   g_object_try_unref (self->priv->accel_group);
 
-  if (self->priv->clock)
-    gst_object_unref (self->priv->clock);
+  if (self->priv->level_to_vumeter) {
+    g_hash_table_foreach (self->priv->level_to_vumeter, release_level_meter,
+        (gpointer) self);
+    g_hash_table_remove_all (self->priv->level_to_vumeter);
+  }
+  g_object_unref (self->priv->meter_hub);
 
   GST_DEBUG ("  chaining up");
   G_OBJECT_CLASS (bt_main_page_sequence_parent_class)->dispose (object);
@@ -4716,7 +4637,6 @@ bt_main_page_sequence_finalize (GObject * object)
   BtMainPageSequence *self = BT_MAIN_PAGE_SEQUENCE (object);
 
   GST_DEBUG ("!!!! self=%p", self);
-  g_mutex_clear (&self->priv->lock);
   g_hash_table_destroy (self->priv->level_to_vumeter);
 
   G_OBJECT_CLASS (bt_main_page_sequence_parent_class)->finalize (object);
@@ -4740,7 +4660,7 @@ bt_main_page_sequence_init (BtMainPageSequence * self)
 
   self->priv->follow_playback = TRUE;
 
-  g_mutex_init (&self->priv->lock);
+  self->priv->meter_hub = bt_meter_hub_new ();
 
   // the undo/redo changelogger
   self->priv->change_log = bt_change_log_new ();
@@ -4761,7 +4681,6 @@ bt_main_page_sequence_class_init (BtMainPageSequenceClass * klass)
 
   column_index_quark =
       g_quark_from_static_string ("BtMainPageSequence::column-index");
-  bus_msg_level_quark = g_quark_from_static_string ("level");
   vu_meter_skip_update =
       g_quark_from_static_string ("BtMainPageSequence::skip-update");
   machine_for_track =
@@ -102,6 +102,8 @@ struct _BtMainPageWavesPrivate
   GstElement *preview, *preview_src, *preview_sink;
   BtWave *play_wave;
   BtWavelevel *play_wavelevel;
+  /* the wave shown in the waveform viewer */
+  BtWave *show_wave;
   GstBtToneConversion *n2f;
 
   /* the query is used in update_playback_position */
@@ -279,7 +281,11 @@ preview_stop (const BtMainPageWaves * self)
   }
   /* if I set state directly to NULL, I don't get inbetween state-change messages */
   gst_element_set_state (self->priv->preview, GST_STATE_READY);
-  self->priv->play_wave = NULL;
+  if (self->priv->play_wave) {
+    bt_wavetable_release_wave (self->priv->wavetable, self->priv->play_wave);
+    g_object_unref (self->priv->play_wave);
+    self->priv->play_wave = NULL;
+  }
   self->priv->play_wavelevel = NULL;
 
   /* untoggle play button */
@@ -287,6 +293,23 @@ preview_stop (const BtMainPageWaves * self)
           priv->wavetable_play), FALSE);
 }
 
+/* keep the data of the wave in memory while the waveform viewer shows it */
+static void
+waveform_viewer_show_wave (const BtMainPageWaves * self, BtWave * wave)
+{
+  if (self->priv->show_wave == wave)
+    return;
+  if (self->priv->show_wave) {
+    bt_wavetable_release_wave (self->priv->wavetable, self->priv->show_wave);
+    g_object_unref (self->priv->show_wave);
+    self->priv->show_wave = NULL;
+  }
+  if (wave) {
+    bt_wavetable_use_wave (self->priv->wavetable, wave);
+    self->priv->show_wave = g_object_ref (wave);
+  }
+}
+
 static void
 preview_update_seeks (const BtMainPageWaves * self)
 {
@@ -796,6 +819,7 @@ on_wavelevels_list_cursor_changed (GtkTreeView * treeview, gpointer user_data)
       gint64 loop_start = -1, loop_end = -1;
       BtWaveLoopMode loop_mode;
 
+      waveform_viewer_show_wave (self, wave);
       g_object_get (wave, "channels", &channels, "loop-mode", &loop_mode, NULL);
       g_object_get (wavelevel, "length", &length, "data", &data, NULL);
       GST_INFO ("select wave-level: %p, %lu", data, length);
@@ -808,7 +832,8 @@ on_wavelevels_list_cursor_changed (GtkTreeView * treeview, gpointer user_data)
       }
 
       bt_waveform_viewer_set_wave (BT_WAVEFORM_VIEWER (self->
-              priv->waveform_viewer), data, channels, length);
+              priv->waveform_viewer), (GObject *) wavelevel, data, channels,
+          length);
       g_object_set (self->priv->waveform_viewer, "loop-start", loop_start,
           "loop-end", loop_end, NULL);
 
@@ -822,8 +847,9 @@ on_wavelevels_list_cursor_changed (GtkTreeView * treeview, gpointer user_data)
     GST_INFO ("no current wave");
   }
   if (!drawn) {
+    waveform_viewer_show_wave (self, NULL);
     bt_waveform_viewer_set_wave (BT_WAVEFORM_VIEWER (self->
-            priv->waveform_viewer), NULL, 0, 0);
+            priv->waveform_viewer), NULL, NULL, 0, 0);
   }
 }
 
@@ -891,6 +917,10 @@ on_song_changed (const BtEditApplication * app, GParamSpec * arg,
     return;
   GST_INFO ("song: %" G_OBJECT_REF_COUNT_FMT, G_OBJECT_LOG_REF_COUNT (song));
 
+  // release the waves of the old song
+  if (self->priv->play_wave)
+    preview_stop (self);
+  waveform_viewer_show_wave (self, NULL);
   g_object_try_unref (self->priv->wavetable);
   g_object_get (song, "wavetable", &self->priv->wavetable, NULL);
   waves_list_refresh (self);
@@ -1075,7 +1105,13 @@ on_wavetable_toolbar_play_clicked (GtkToolButton * button, gpointer user_data)
         self->priv->position_query =
             gst_query_new_position (GST_FORMAT_DEFAULT);
       }
-      // get parameters
+      // get parameters, keep the data in memory until the playback stops
+      if (self->priv->play_wave) {
+        bt_wavetable_release_wave (self->priv->wavetable,
+            self->priv->play_wave);
+        g_object_unref (self->priv->play_wave);
+      }
+      bt_wavetable_use_wave (self->priv->wavetable, wave);
       g_object_get (wave, "channels", &play_channels, NULL);
       g_object_get (wavelevel,
           "length", &play_length, "rate", &play_rate, "data", &play_data, NULL);
@@ -1089,7 +1125,7 @@ on_wavetable_toolbar_play_clicked (GtkToolButton * button, gpointer user_data)
           "caps", caps, "data", play_data, "length", play_length, NULL);
       gst_caps_unref (caps);
 
-      self->priv->play_wave = wave;
+      self->priv->play_wave = g_object_ref (wave);
       self->priv->play_wavelevel = wavelevel;
 
       // build seek events for looping
@@ -1351,6 +1387,22 @@ bt_main_page_waves_init_ui (const BtMainPageWaves * self,
   gtk_tree_view_insert_column_with_attributes (self->priv->waves_list, -1,
       _("Wave"), renderer, "text", BT_WAVE_LIST_MODEL_NAME, "editable",
       BT_WAVE_LIST_MODEL_HAS_WAVE, NULL);
+  renderer = gtk_cell_renderer_text_new ();
+  gtk_cell_renderer_set_fixed_size (renderer, 1, -1);
+  gtk_cell_renderer_text_set_fixed_height_from_font (GTK_CELL_RENDERER_TEXT
+      (renderer), 1);
+  g_object_set (renderer, "xalign", 1.0, NULL);
+  /* Memory: size of the sample data in memory */
+  gtk_tree_view_insert_column_with_attributes (self->priv->waves_list, -1,
+      _("Memory"), renderer, "text", BT_WAVE_LIST_MODEL_RESIDENT_SIZE, NULL);
+  renderer = gtk_cell_renderer_text_new ();
+  gtk_cell_renderer_set_fixed_size (renderer, 1, -1);
+  gtk_cell_renderer_text_set_fixed_height_from_font (GTK_CELL_RENDERER_TEXT
+      (renderer), 1);
+  g_object_set (renderer, "xalign", 1.0, NULL);
+  /* Disk: size of the sample data in the sample cache */
+  gtk_tree_view_insert_column_with_attributes (self->priv->waves_list, -1,
+      _("Disk"), renderer, "text", BT_WAVE_LIST_MODEL_DISK_SIZE, NULL);
   gtk_container_add (GTK_CONTAINER (scrolled_window),
       GTK_WIDGET (self->priv->waves_list));
   gtk_box_pack_start (GTK_BOX (box), scrolled_window, TRUE, TRUE, 0);
@@ -1573,7 +1625,6 @@ bt_main_page_waves_dispose (GObject * object)
 
   g_object_unref (self->priv->settings);
   g_object_unref (self->priv->n2f);
-  g_object_try_unref (self->priv->wavetable);
   g_object_unref (self->priv->app);
 
   // shut down loader-preview playbin
@@ -1600,6 +1651,8 @@ bt_main_page_waves_dispose (GObject * object)
       gst_event_unref (self->priv->loop_seek_event[1]);
     gst_query_unref (self->priv->position_query);
   }
+  waveform_viewer_show_wave (self, NULL);
+  g_object_try_unref (self->priv->wavetable);
 
   GST_DEBUG ("  chaining up");
   G_OBJECT_CLASS (bt_main_page_waves_parent_class)->dispose (object);
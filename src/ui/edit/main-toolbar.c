@@ -51,7 +51,7 @@ struct _BtMainToolbarPrivate
   /* the level meters */
   GtkVUMeter *vumeter[MAX_VUMETER];
   GstElement *level;
-  GstClock *clock;
+  BtMeterHub *meter_hub;
   gint num_channels;
 
   /* the volume gain */
@@ -73,13 +73,8 @@ struct _BtMainToolbarPrivate
   gboolean is_playing;
   gboolean has_error;
   gdouble playback_rate;
-
-  /* lock for multithreaded access */
-  GMutex lock;
 };
 
-static GQuark bus_msg_level_quark = 0;
-
 static void on_toolbar_play_clicked (GtkButton * button, gpointer user_data);
 static void reset_playback_rate (BtMainToolbar * self);
 static void on_song_volume_changed (GstElement * gain, GParamSpec * arg,
@@ -93,11 +88,20 @@ G_DEFINE_TYPE_WITH_CODE (BtMainToolbar, bt_main_toolbar, GTK_TYPE_TOOLBAR,
 
 //-- event handler
 
+#if GTK_CHECK_VERSION (3,8,0)
+static gboolean
+on_song_playback_update (GtkWidget * widget, GdkFrameClock * frame_clock,
+    gpointer user_data)
+{
+  return bt_song_update_playback_position (BT_SONG (user_data));
+}
+#else
 static gboolean
 on_song_playback_update (gpointer user_data)
 {
   return bt_song_update_playback_position (BT_SONG (user_data));
 }
+#endif
 
 static void
 on_song_is_playing_notify (const BtSong * song, GParamSpec * arg,
@@ -112,7 +116,12 @@ on_song_is_playing_notify (const BtSong * song, GParamSpec * arg,
     GST_INFO ("song stop event occurred: %p", g_thread_self ());
     // stop update timer and reset trick playback
     if (self->priv->playback_update_id) {
+#if GTK_CHECK_VERSION (3,8,0)
+      gtk_widget_remove_tick_callback (gtk_widget_get_toplevel (GTK_WIDGET
+              (self)), self->priv->playback_update_id);
+#else
       g_source_remove (self->priv->playback_update_id);
+#endif
       self->priv->playback_update_id = 0;
     }
     bt_song_update_playback_position (song);
@@ -134,10 +143,18 @@ on_song_is_playing_notify (const BtSong * song, GParamSpec * arg,
 
     GST_INFO ("song stop event handled");
   } else {
+#if GTK_CHECK_VERSION (3,8,0)
+    // update playback position for each frame, this only reads the position
+    // that the sink published, use the toplevel as the toolbar can be hidden
+    self->priv->playback_update_id =
+        gtk_widget_add_tick_callback (gtk_widget_get_toplevel (GTK_WIDGET
+            (self)), on_song_playback_update, (gpointer) song, NULL);
+#else
     // update playback position 10 times a second
     self->priv->playback_update_id =
         g_timeout_add_full (G_PRIORITY_HIGH, 1000 / 10, on_song_playback_update,
         (gpointer) song, NULL);
+#endif
     bt_song_update_playback_position (song);
 
     // if we started playback remotely activate playbutton
@@ -439,110 +456,27 @@ on_song_warning (const GstBus * const bus, GstMessage * message,
   }
 }
 
-#define g_value_array_get_ix(va,ix) (va->values + ix)
-
-static gboolean
-on_delayed_idle_song_level_change (gpointer user_data)
-{
-  gconstpointer *const params = (gconstpointer *) user_data;
-  BtMainToolbar *self = (BtMainToolbar *) params[0];
-  GstMessage *message = (GstMessage *) params[1];
-
-  if (self) {
-    const GstStructure *structure = gst_message_get_structure (message);
-    const GValue *values;
-    GValueArray *decay_arr, *peak_arr;
-    gdouble decay, peak;
-    guint i, size;
-
-    g_mutex_lock (&self->priv->lock);
-    g_object_remove_weak_pointer ((gpointer) self, (gpointer *) & params[0]);
-    g_mutex_unlock (&self->priv->lock);
-
-    if (!self->priv->is_playing)
-      goto done;
-
-    values = (GValue *) gst_structure_get_value (structure, "peak");
-    peak_arr = (GValueArray *) g_value_get_boxed (values);
-    values = (GValue *) gst_structure_get_value (structure, "decay");
-    decay_arr = (GValueArray *) g_value_get_boxed (values);
-    size = decay_arr->n_values;
-    for (i = 0; i < size; i++) {
-      decay = g_value_get_double (g_value_array_get_ix (decay_arr, i));
-      peak = g_value_get_double (g_value_array_get_ix (peak_arr, i));
-      if (isinf (decay) || isnan (decay))
-        decay = LOW_VUMETER_VAL;
-      if (isinf (peak) || isnan (peak))
-        peak = LOW_VUMETER_VAL;
-      //GST_INFO("level.%d  %.3f %.3f", i, peak, decay);
-      //gtk_vumeter_set_levels (self->priv->vumeter[i], (gint)decay, (gint)peak);
-      gtk_vumeter_set_levels (self->priv->vumeter[i], (gint) peak,
-          (gint) decay);
-    }
-  }
-done:
-  gst_message_unref (message);
-  g_slice_free1 (2 * sizeof (gconstpointer), params);
-  return FALSE;
-}
-
-static gboolean
-on_delayed_song_level_change (GstClock * clock, GstClockTime time,
-    GstClockID id, gpointer user_data)
-{
-  // the callback is called from a clock thread
-  if (GST_CLOCK_TIME_IS_VALID (time))
-    g_idle_add_full (G_PRIORITY_HIGH, on_delayed_idle_song_level_change,
-        user_data, NULL);
-  else {
-    gconstpointer *const params = (gconstpointer *) user_data;
-    GstMessage *message = (GstMessage *) params[1];
-    gst_message_unref (message);
-    g_slice_free1 (2 * sizeof (gconstpointer), user_data);
-  }
-  return TRUE;
-}
-
-
 static void
-on_song_level_change (GstBus * bus, GstMessage * message, gpointer user_data)
+on_song_level_change (GstElement * level, const BtMeterLevels * levels,
+    gpointer user_data)
 {
-  const GstStructure *s = gst_message_get_structure (message);
-  const GQuark name_id = gst_structure_get_name_id (s);
+  BtMainToolbar *self = BT_MAIN_TOOLBAR (user_data);
+  gdouble decay, peak;
+  guint i;
 
-  if (name_id == bus_msg_level_quark) {
-    BtMainToolbar *self = BT_MAIN_TOOLBAR (user_data);
-    GstElement *level = GST_ELEMENT (GST_MESSAGE_SRC (message));
-
-    // check if its our element (we can have multiple level meters)
-    if (level == self->priv->level) {
-      GstClockTime waittime = bt_gst_analyzer_get_waittime (level, s, TRUE);
-      if (GST_CLOCK_TIME_IS_VALID (waittime)) {
-        gpointer *data = (gpointer *) g_slice_alloc (2 * sizeof (gpointer));
-        GstClockID clock_id;
-        GstClockReturn clk_ret;
-
-        //GST_WARNING("target %"GST_TIME_FORMAT" %"GST_TIME_FORMAT,
-        //  GST_TIME_ARGS(endtime),GST_TIME_ARGS(waittime));
-
-        data[0] = (gpointer) self;
-        data[1] = (gpointer) gst_message_ref (message);
-        g_mutex_lock (&self->priv->lock);
-        g_object_add_weak_pointer ((gpointer) self, &data[0]);
-        g_mutex_unlock (&self->priv->lock);
-        waittime += gst_element_get_base_time (level);
-        clock_id = gst_clock_new_single_shot_id (self->priv->clock, waittime);
-        if ((clk_ret =
-                gst_clock_id_wait_async (clock_id, on_delayed_song_level_change,
-                    (gpointer) data, NULL)) != GST_CLOCK_OK) {
-          GST_WARNING_OBJECT (level, "clock wait failed: %d", clk_ret);
-          gst_message_unref (message);
-          g_object_remove_weak_pointer ((gpointer) self, &data[0]);
-          g_slice_free1 (2 * sizeof (gpointer), data);
-        }
-        gst_clock_id_unref (clock_id);
-      }
-    }
+  if (!self->priv->is_playing)
+    return;
+
+  for (i = 0; i < MIN (levels->channels, MAX_VUMETER); i++) {
+    decay = levels->decay[i];
+    peak = levels->peak[i];
+    if (isinf (decay) || isnan (decay))
+      decay = LOW_VUMETER_VAL;
+    if (isinf (peak) || isnan (peak))
+      peak = LOW_VUMETER_VAL;
+    //GST_INFO("level.%d  %.3f %.3f", i, peak, decay);
+    //gtk_vumeter_set_levels (self->priv->vumeter[i], (gint)decay, (gint)peak);
+    gtk_vumeter_set_levels (self->priv->vumeter[i], (gint) peak, (gint) decay);
   }
 }
 
@@ -775,11 +709,17 @@ on_song_changed (const BtEditApplication * app, GParamSpec * arg,
 
     // get the input_level and input_gain properties from audio_sink
     g_object_try_weak_unref (self->priv->gain);
+    if (self->priv->level) {
+      bt_meter_hub_remove (self->priv->meter_hub, self->priv->level,
+          (gpointer) self);
+    }
     g_object_try_weak_unref (self->priv->level);
     g_object_get (self->priv->master, "input-post-level", &self->priv->level,
         "machine", &self->priv->gain, NULL);
     g_object_try_weak_ref (self->priv->gain);
     g_object_try_weak_ref (self->priv->level);
+    bt_meter_hub_add (self->priv->meter_hub, self->priv->level,
+        on_song_level_change, (gpointer) self);
 
     // connect bus signals
     bus = gst_element_get_bus (GST_ELEMENT (bin));
@@ -787,14 +727,8 @@ on_song_changed (const BtEditApplication * app, GParamSpec * arg,
         G_CALLBACK (on_song_error), (gpointer) self, 0);
     bt_g_signal_connect_object (bus, "message::warning",
         G_CALLBACK (on_song_warning), (gpointer) self, 0);
-    bt_g_signal_connect_object (bus, "sync-message::element",
-        G_CALLBACK (on_song_level_change), (gpointer) self, 0);
     gst_object_unref (bus);
 
-    if (self->priv->clock)
-      gst_object_unref (self->priv->clock);
-    self->priv->clock = gst_pipeline_get_clock (GST_PIPELINE (bin));
-
     // get the pad from the input-level and listen there for channel negotiation
     g_assert (GST_IS_ELEMENT (self->priv->level));
     if ((pad = gst_element_get_static_pad (self->priv->level, "src"))) {
@@ -1025,10 +959,12 @@ bt_main_toolbar_dispose (GObject * object)
 
   g_object_try_weak_unref (self->priv->master);
   g_object_try_weak_unref (self->priv->gain);
+  if (self->priv->level) {
+    bt_meter_hub_remove (self->priv->meter_hub, self->priv->level,
+        (gpointer) self);
+  }
   g_object_try_weak_unref (self->priv->level);
-
-  if (self->priv->clock)
-    gst_object_unref (self->priv->clock);
+  g_object_unref (self->priv->meter_hub);
 
   g_object_unref (self->priv->app);
 
@@ -1041,7 +977,6 @@ bt_main_toolbar_finalize (GObject * object)
   BtMainToolbar *self = BT_MAIN_TOOLBAR (object);
 
   GST_DEBUG ("!!!! self=%p", self);
-  g_mutex_clear (&self->priv->lock);
 
   G_OBJECT_CLASS (bt_main_toolbar_parent_class)->finalize (object);
 }
@@ -1052,7 +987,7 @@ bt_main_toolbar_init (BtMainToolbar * self)
   self->priv = bt_main_toolbar_get_instance_private(self);
   GST_DEBUG ("!!!! self=%p", self);
   self->priv->app = bt_edit_application_new ();
-  g_mutex_init (&self->priv->lock);
+  self->priv->meter_hub = bt_meter_hub_new ();
   self->priv->playback_rate = 1.0;
   self->priv->num_channels = 2;
 }
@@ -1062,8 +997,6 @@ bt_main_toolbar_class_init (BtMainToolbarClass * klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
-  bus_msg_level_quark = g_quark_from_static_string ("level");
-
   gobject_class->dispose = bt_main_toolbar_dispose;
   gobject_class->finalize = bt_main_toolbar_finalize;
 
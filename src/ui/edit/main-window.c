@@ -172,6 +172,59 @@ load_song (const BtMainWindow * self, gchar * file_name)
   return TRUE;
 }
 
+/* data for the callback of a background save */
+typedef struct
+{
+  BtMainWindow *self;
+  gchar *file_name;
+  gchar *old_file_name;
+  gboolean update_recent;
+} BtMainWindowSaveData;
+
+static BtMainWindowSaveData *
+bt_main_window_save_data_new (const BtMainWindow * self,
+    const gchar * file_name, const gchar * old_file_name,
+    gboolean update_recent)
+{
+  BtMainWindowSaveData *data = g_slice_new (BtMainWindowSaveData);
+
+  data->self = g_object_ref ((gpointer) self);
+  data->file_name = g_strdup (file_name);
+  data->old_file_name = g_strdup (old_file_name);
+  data->update_recent = update_recent;
+  return data;
+}
+
+static void
+bt_main_window_save_data_free (BtMainWindowSaveData * data)
+{
+  g_object_unref (data->self);
+  g_free (data->file_name);
+  g_free (data->old_file_name);
+  g_slice_free (BtMainWindowSaveData, data);
+}
+
+static void
+bt_main_window_update_recent (const gchar * file_name,
+    const gchar * old_file_name)
+{
+  GtkRecentManager *manager = gtk_recent_manager_get_default ();
+  gchar *uri;
+
+  if (old_file_name) {
+    uri = g_filename_to_uri (old_file_name, NULL, NULL);
+    if (!gtk_recent_manager_remove_item (manager, uri, NULL)) {
+      GST_WARNING ("Can't store recent file");
+    }
+    g_free (uri);
+  }
+  uri = g_filename_to_uri (file_name, NULL, NULL);
+  if (!gtk_recent_manager_add_item (manager, uri)) {
+    GST_WARNING ("Can't store recent file");
+  }
+  g_free (uri);
+}
+
 //-- event handler
 
 static void
@@ -405,6 +458,24 @@ bt_main_window_make_unsaved_changes_message (const BtSong * song)
   return msg;
 }
 
+static void
+on_song_saved (GObject * object, GAsyncResult * result, gpointer user_data)
+{
+  BtMainWindowSaveData *data = (BtMainWindowSaveData *) user_data;
+  GError *err = NULL;
+
+  if (!bt_edit_application_save_song_finish (BT_EDIT_APPLICATION (object),
+          result, &err)) {
+    gchar *msg = g_strdup_printf (_("Can't save song '%s'."), data->file_name);
+    bt_dialog_message (data->self, _("Can't save song"), msg, err->message);
+    g_free (msg);
+    g_error_free (err);
+  } else if (data->update_recent) {
+    bt_main_window_update_recent (data->file_name, data->old_file_name);
+  }
+  bt_main_window_save_data_free (data);
+}
+
 //-- helper methods
 
 static void
@@ -724,13 +795,9 @@ bt_main_window_save_song (const BtMainWindow * self)
 
   // check the file_name of the song
   if (file_name) {
-    GError *err = NULL;
-    if (!bt_edit_application_save_song (self->priv->app, file_name, &err)) {
-      gchar *msg = g_strdup_printf (_("Can't save song '%s'."), file_name);
-      bt_dialog_message (self, _("Can't save song"), msg, err->message);
-      g_free (msg);
-      g_error_free (err);
-    }
+    bt_edit_application_save_song_async (self->priv->app, file_name,
+        on_song_saved, bt_main_window_save_data_new (self, file_name, NULL,
+            FALSE));
   } else {
     // it is a new song
     bt_main_window_save_song_as (self);
@@ -986,30 +1053,9 @@ bt_main_window_save_song_as (const BtMainWindow * self)
       }
     }
     if (cont) {
-      GError *err = NULL;
-      if (!bt_edit_application_save_song (self->priv->app, file_name, &err)) {
-        gchar *msg = g_strdup_printf (_("Can't save song '%s'."), file_name);
-        bt_dialog_message (self, _("Can't save song"), msg, err->message);
-        g_free (msg);
-        g_error_free (err);
-      } else {
-        // store recent file
-        GtkRecentManager *manager = gtk_recent_manager_get_default ();
-        gchar *uri;
-
-        if (old_file_name) {
-          uri = g_filename_to_uri (old_file_name, NULL, NULL);
-          if (!gtk_recent_manager_remove_item (manager, uri, NULL)) {
-            GST_WARNING ("Can't store recent file");
-          }
-          g_free (uri);
-        }
-        uri = g_filename_to_uri (file_name, NULL, NULL);
-        if (!gtk_recent_manager_add_item (manager, uri)) {
-          GST_WARNING ("Can't store recent file");
-        }
-        g_free (uri);
-      }
+      bt_edit_application_save_song_async (self->priv->app, file_name,
+          on_song_saved, bt_main_window_save_data_new (self, file_name,
+              old_file_name, TRUE));
     }
     g_free (file_name);
   }
@@ -0,0 +1,632 @@
+/* Buzztrax
+ * Copyright (C) 2017 Buzztrax team <buzztrax-devel@buzztrax.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * SECTION:btmeterhub
+ * @short_description: shared receiver for level meter messages
+ *
+ * All level elements of a song post their values on the same bus. Instead of
+ * each view parsing every message, scheduling a clock wait and an idle
+ * handler per message, the hub handles the messages once. It queues the
+ * values of each registered level element together with the clock time when
+ * the corresponding audio gets played. With a high latency, several messages
+ * are waiting to be played.
+ *
+ * Once per frame of the main window, the hub passes the newest values that are
+ * due to the views. Values that did not change are not passed on again, so
+ * silent meters don't cause redraws. The frame callback only runs while
+ * level messages arrive.
+ *
+ * It is implemented as a singleton.
+ */
+
+#define BT_EDIT
+#define BT_METER_HUB_C
+
+#include "bt-edit.h"
+#include <math.h>
+
+/* how many frames we keep polling after the last level message */
+#define MAX_IDLE_FRAMES 60
+/* how many level messages we queue per level element, the audio latency is at
+ * most 200 ms and the level interval is 50 ms, the sink buffers twice the
+ * latency */
+#define MAX_QUEUED_LEVELS 16
+
+typedef struct
+{
+  BtMeterHubFunc func;
+  gpointer user_data;
+} BtMeterHubListener;
+
+typedef struct
+{
+  GstClockTime due;
+  BtMeterLevels levels;
+} BtMeterHubEntry;
+
+typedef struct
+{
+  GstElement *level;
+  GSList *listeners;
+
+  /* ring buffer of the values that are not yet shown, filled by the streaming
+   * threads */
+  BtMeterHubEntry queue[MAX_QUEUED_LEVELS];
+  guint head, len;
+
+  /* only used from the main thread */
+  BtMeterLevels shown;
+} BtMeterHubSlot;
+
+typedef struct
+{
+  GstElement *level;
+  BtMeterLevels levels;
+} BtMeterHubUpdate;
+
+struct _BtMeterHubPrivate
+{
+  /* used to validate if dispose has run */
+  gboolean dispose_has_run;
+
+  /* the song pipeline, for its bus and clock */
+  GstElement *bin;
+
+  /* level element -> BtMeterHubSlot, the lock guards the table and the slots
+   * against the streaming threads */
+  GHashTable *slots;
+  GMutex lock;
+
+  /* TRUE while the frame callback is installed or about to be */
+  gint ticking;
+  guint tick_id;
+  GtkWidget *tick_widget;
+  guint idle_frames;
+  GArray *updates;
+};
+
+static BtMeterHub *singleton = NULL;
+
+static GQuark bus_msg_level_quark = 0;
+
+//-- the class
+
+G_DEFINE_TYPE_WITH_CODE (BtMeterHub, bt_meter_hub, G_TYPE_OBJECT,
+    G_ADD_PRIVATE(BtMeterHub));
+
+//-- helper methods
+
+static void
+free_slot (BtMeterHubSlot * slot)
+{
+  g_slist_free_full (slot->listeners, (GDestroyNotify) g_free);
+  g_slice_free (BtMeterHubSlot, slot);
+}
+
+static void
+on_level_disposed (gpointer user_data, GObject * where_the_object_was)
+{
+  BtMeterHub *self = BT_METER_HUB (user_data);
+
+  g_mutex_lock (&self->priv->lock);
+  g_hash_table_remove (self->priv->slots, where_the_object_was);
+  g_mutex_unlock (&self->priv->lock);
+}
+
+static void
+release_slot (gpointer key, gpointer value, gpointer user_data)
+{
+  g_object_weak_unref ((GObject *) key, on_level_disposed, user_data);
+}
+
+static void
+read_levels (const GstStructure * s, BtMeterLevels * levels)
+{
+  const GValueArray *peak_arr, *decay_arr;
+  guint i;
+
+  peak_arr = g_value_get_boxed (gst_structure_get_value (s, "peak"));
+  decay_arr = g_value_get_boxed (gst_structure_get_value (s, "decay"));
+  levels->channels = MIN (MIN (peak_arr->n_values, decay_arr->n_values),
+      BT_METER_HUB_MAX_CHANNELS);
+  for (i = 0; i < levels->channels; i++) {
+    levels->peak[i] = g_value_get_double (&peak_arr->values[i]);
+    levels->decay[i] = g_value_get_double (&decay_arr->values[i]);
+  }
+}
+
+static gboolean
+levels_equal (const BtMeterLevels * a, const BtMeterLevels * b)
+{
+  const gsize size = a->channels * sizeof (gdouble);
+
+  // compare the bits, so that -inf and nan compare equal to themselves
+  return (a->channels == b->channels) &&
+      !memcmp (a->peak, b->peak, size) && !memcmp (a->decay, b->decay, size);
+}
+
+/* collect the newest values that are due, call with the lock taken, returns
+ * the number of values that are not yet due */
+static guint
+collect_updates (BtMeterHub * self, GstClockTime now)
+{
+  GHashTableIter iter;
+  gpointer value;
+  guint pending = 0;
+
+  g_hash_table_iter_init (&iter, self->priv->slots);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    BtMeterHubSlot *slot = (BtMeterHubSlot *) value;
+    BtMeterHubEntry *due = NULL, *e;
+    BtMeterHubUpdate u;
+
+    // drop the values if the song is not playing anymore
+    if (!GST_CLOCK_TIME_IS_VALID (now)) {
+      slot->len = 0;
+      continue;
+    }
+    while (slot->len) {
+      e = &slot->queue[slot->head];
+      if (e->due > now)
+        break;
+      due = e;
+      slot->head = (slot->head + 1) % MAX_QUEUED_LEVELS;
+      slot->len--;
+    }
+    pending += slot->len;
+    if (!due || levels_equal (&due->levels, &slot->shown))
+      continue;
+
+    slot->shown = due->levels;
+    u.level = slot->level;
+    u.levels = slot->shown;
+    g_array_append_val (self->priv->updates, u);
+  }
+  return pending;
+}
+
+/* check for values that arrived after the last collect_updates() call, call
+ * with the lock taken */
+static gboolean
+has_new_values (BtMeterHub * self)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  g_hash_table_iter_init (&iter, self->priv->slots);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    BtMeterHubSlot *slot = (BtMeterHubSlot *) value;
+
+    if (slot->len)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static gpointer
+copy_listener (gconstpointer src, gpointer user_data)
+{
+  return g_slice_dup (BtMeterHubListener, src);
+}
+
+static void
+free_listener (gpointer data)
+{
+  g_slice_free (BtMeterHubListener, data);
+}
+
+/* check if the listener is still registered, call with the lock taken */
+static gboolean
+has_listener (BtMeterHub * self, GstElement * level,
+    const BtMeterHubListener * listener)
+{
+  BtMeterHubSlot *slot;
+  GSList *node;
+
+  if (!(slot = g_hash_table_lookup (self->priv->slots, level)))
+    return FALSE;
+  for (node = slot->listeners; node; node = g_slist_next (node)) {
+    BtMeterHubListener *l = (BtMeterHubListener *) node->data;
+
+    if (l->func == listener->func && l->user_data == listener->user_data)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static gboolean
+dispatch_updates (BtMeterHub * self)
+{
+  GstClock *clock;
+  GstClockTime now = GST_CLOCK_TIME_NONE;
+  GArray *updates = self->priv->updates;
+  guint i, pending;
+
+  if ((clock = gst_element_get_clock (self->priv->bin))) {
+    now = gst_clock_get_time (clock);
+    gst_object_unref (clock);
+  }
+
+  BT_TRACE_BEGIN ("ui", "meter-hub-tick");
+  g_array_set_size (updates, 0);
+  g_mutex_lock (&self->priv->lock);
+  pending = collect_updates (self, now);
+  // the values and listeners are copied, the callbacks run without holding the
+  // lock, that way they can add or remove listeners, listeners that got
+  // removed meanwhile are skipped
+  for (i = 0; i < updates->len; i++) {
+    BtMeterHubUpdate *u = &g_array_index (updates, BtMeterHubUpdate, i);
+    BtMeterHubSlot *slot;
+    GSList *listeners, *node;
+
+    if (!(slot = g_hash_table_lookup (self->priv->slots, u->level)))
+      continue;
+    listeners = g_slist_copy_deep (slot->listeners, copy_listener, NULL);
+    for (node = listeners; node; node = g_slist_next (node)) {
+      BtMeterHubListener *l = (BtMeterHubListener *) node->data;
+
+      if (!has_listener (self, u->level, l))
+        continue;
+      g_mutex_unlock (&self->priv->lock);
+      l->func (u->level, &u->levels, l->user_data);
+      g_mutex_lock (&self->priv->lock);
+    }
+    g_slist_free_full (listeners, free_listener);
+  }
+  g_mutex_unlock (&self->priv->lock);
+  BT_TRACE_COUNTER ("ui", "meter-updates", updates->len);
+  BT_TRACE_END ("ui", "meter-hub-tick");
+
+  if (pending || updates->len) {
+    self->priv->idle_frames = 0;
+    return TRUE;
+  }
+  if (++self->priv->idle_frames < MAX_IDLE_FRAMES)
+    return TRUE;
+
+  // stop polling, unless a new level message got in between
+  g_atomic_int_set (&self->priv->ticking, FALSE);
+  g_mutex_lock (&self->priv->lock);
+  pending = has_new_values (self);
+  g_mutex_unlock (&self->priv->lock);
+  if (pending
+      && g_atomic_int_compare_and_exchange (&self->priv->ticking, FALSE,
+          TRUE)) {
+    self->priv->idle_frames = 0;
+    return TRUE;
+  }
+  GST_DEBUG ("stop polling level meters");
+  self->priv->tick_id = 0;
+  return FALSE;
+}
+
+//-- event handler
+
+#if GTK_CHECK_VERSION (3,8,0)
+static gboolean
+on_tick (GtkWidget * widget, GdkFrameClock * frame_clock, gpointer user_data)
+{
+  return dispatch_updates (BT_METER_HUB (user_data));
+}
+#else
+static gboolean
+on_tick (gpointer user_data)
+{
+  return dispatch_updates (BT_METER_HUB (user_data));
+}
+#endif
+
+static gboolean
+start_ticking (gpointer user_data)
+{
+  BtMeterHub *self = BT_METER_HUB (user_data);
+  BtEditApplication *app;
+  GtkWidget *window = NULL;
+
+  if (self->priv->dispose_has_run || self->priv->tick_id)
+    return FALSE;
+
+  GST_DEBUG ("start polling level meters");
+  self->priv->idle_frames = 0;
+#if GTK_CHECK_VERSION (3,8,0)
+  app = bt_edit_application_new ();
+  g_object_get (app, "main-window", &window, NULL);
+  g_object_unref (app);
+  if (window) {
+    g_object_try_weak_unref (self->priv->tick_widget);
+    self->priv->tick_widget = window;
+    g_object_try_weak_ref (self->priv->tick_widget);
+    self->priv->tick_id =
+        gtk_widget_add_tick_callback (window, on_tick, (gpointer) self, NULL);
+    g_object_unref (window);
+  } else {
+    g_atomic_int_set (&self->priv->ticking, FALSE);
+  }
+#else
+  self->priv->tick_id =
+      g_timeout_add_full (G_PRIORITY_HIGH, 1000 / 60, on_tick,
+      (gpointer) self, NULL);
+#endif
+  return FALSE;
+}
+
+static void
+on_level_message (GstBus * bus, GstMessage * message, gpointer user_data)
+{
+  const GstStructure *s = gst_message_get_structure (message);
+  BtMeterHub *self;
+  BtMeterHubSlot *slot;
+  GstElement *level;
+  GstClockTime waittime;
+
+  if (gst_structure_get_name_id (s) != bus_msg_level_quark)
+    return;
+
+  // this is called from the streaming threads
+  self = BT_METER_HUB (user_data);
+  level = GST_ELEMENT (GST_MESSAGE_SRC (message));
+  waittime = bt_gst_analyzer_get_waittime (level, s, TRUE);
+  if (!GST_CLOCK_TIME_IS_VALID (waittime))
+    return;
+
+  g_mutex_lock (&self->priv->lock);
+  if ((slot = g_hash_table_lookup (self->priv->slots, level))) {
+    BtMeterHubEntry *e;
+
+    // drop the oldest values if the queue is full
+    if (slot->len == MAX_QUEUED_LEVELS) {
+      slot->head = (slot->head + 1) % MAX_QUEUED_LEVELS;
+      slot->len--;
+    }
+    e = &slot->queue[(slot->head + slot->len) % MAX_QUEUED_LEVELS];
+    read_levels (s, &e->levels);
+    e->due = waittime + gst_element_get_base_time (level);
+    slot->len++;
+  }
+  g_mutex_unlock (&self->priv->lock);
+
+  if (slot &&
+      g_atomic_int_compare_and_exchange (&self->priv->ticking, FALSE, TRUE)) {
+    g_idle_add_full (G_PRIORITY_HIGH, start_ticking, g_object_ref (self),
+        g_object_unref);
+  }
+}
+
+//-- constructor methods
+
+/**
+ * bt_meter_hub_new:
+ *
+ * Create a new instance on first call and return a reference later on.
+ *
+ * Returns: the new singleton instance
+ */
+BtMeterHub *
+bt_meter_hub_new (void)
+{
+  return (g_object_new (BT_TYPE_METER_HUB, NULL));
+}
+
+//-- methods
+
+/**
+ * bt_meter_hub_add:
+ * @self: the meter hub
+ * @level: the level element
+ * @func: the function to call with new values
+ * @user_data: data for @func
+ *
+ * Start passing the values of @level to @func. The hub does not keep a
+ * reference to @level, it forgets about it when the element is disposed.
+ */
+void
+bt_meter_hub_add (BtMeterHub * self, GstElement * level,
+    BtMeterHubFunc func, gpointer user_data)
+{
+  BtMeterHubSlot *slot;
+  BtMeterHubListener *l;
+
+  g_return_if_fail (BT_IS_METER_HUB (self));
+  g_return_if_fail (GST_IS_ELEMENT (level));
+
+  l = g_new (BtMeterHubListener, 1);
+  l->func = func;
+  l->user_data = user_data;
+
+  g_mutex_lock (&self->priv->lock);
+  if (!(slot = g_hash_table_lookup (self->priv->slots, level))) {
+    slot = g_slice_new0 (BtMeterHubSlot);
+    slot->level = level;
+    g_hash_table_insert (self->priv->slots, level, slot);
+    g_object_weak_ref ((GObject *) level, on_level_disposed, (gpointer) self);
+  }
+  slot->listeners = g_slist_append (slot->listeners, l);
+  g_mutex_unlock (&self->priv->lock);
+}
+
+/**
+ * bt_meter_hub_remove:
+ * @self: the meter hub
+ * @level: the level element
+ * @user_data: the data passed to bt_meter_hub_add()
+ *
+ * Stop passing the values of @level to the function registered together with
+ * @user_data.
+ */
+void
+bt_meter_hub_remove (BtMeterHub * self, GstElement * level,
+    gpointer user_data)
+{
+  BtMeterHubSlot *slot;
+  GSList *node;
+
+  g_return_if_fail (BT_IS_METER_HUB (self));
+
+  g_mutex_lock (&self->priv->lock);
+  if ((slot = g_hash_table_lookup (self->priv->slots, level))) {
+    for (node = slot->listeners; node; node = g_slist_next (node)) {
+      if (((BtMeterHubListener *) node->data)->user_data == user_data) {
+        g_free (node->data);
+        slot->listeners = g_slist_delete_link (slot->listeners, node);
+        break;
+      }
+    }
+    if (!slot->listeners) {
+      g_object_weak_unref ((GObject *) level, on_level_disposed,
+          (gpointer) self);
+      g_hash_table_remove (self->priv->slots, level);
+    }
+  }
+  g_mutex_unlock (&self->priv->lock);
+}
+
+/**
+ * bt_meter_levels_get_aggregated:
+ * @values: the per channel levels
+ * @channels: the number of channels
+ * @default_value: a default, in the case of inf/nan levels
+ *
+ * Aggregate the levels per channel and return the averaged level.
+ *
+ * Returns: the average level for all channels
+ */
+gdouble
+bt_meter_levels_get_aggregated (const gdouble * values, guint channels,
+    gdouble default_value)
+{
+  gdouble sum = 0.0;
+  guint i;
+
+  if (!channels)
+    return default_value;
+  for (i = 0; i < channels; i++) {
+    sum += values[i];
+  }
+  if (G_UNLIKELY (isinf (sum) || isnan (sum))) {
+    return default_value;
+  }
+  return (sum / channels);
+}
+
+//-- wrapper
+
+//-- class internals
+
+static void
+bt_meter_hub_dispose (GObject * object)
+{
+  BtMeterHub *self = BT_METER_HUB (object);
+
+  return_if_disposed ();
+  self->priv->dispose_has_run = TRUE;
+
+  GST_DEBUG ("!!!! self=%p", self);
+
+  if (self->priv->tick_id) {
+#if GTK_CHECK_VERSION (3,8,0)
+    if (self->priv->tick_widget)
+      gtk_widget_remove_tick_callback (self->priv->tick_widget,
+          self->priv->tick_id);
+#else
+    g_source_remove (self->priv->tick_id);
+#endif
+    self->priv->tick_id = 0;
+  }
+  g_object_try_weak_unref (self->priv->tick_widget);
+
+  if (self->priv->bin) {
+    GstBus *bus = gst_element_get_bus (self->priv->bin);
+
+    g_signal_handlers_disconnect_by_func (bus, on_level_message, self);
+    gst_object_unref (bus);
+    gst_object_unref (self->priv->bin);
+    self->priv->bin = NULL;
+  }
+  g_mutex_lock (&self->priv->lock);
+  g_hash_table_foreach (self->priv->slots, release_slot, self);
+  g_hash_table_remove_all (self->priv->slots);
+  g_mutex_unlock (&self->priv->lock);
+
+  G_OBJECT_CLASS (bt_meter_hub_parent_class)->dispose (object);
+}
+
+static void
+bt_meter_hub_finalize (GObject * object)
+{
+  BtMeterHub *self = BT_METER_HUB (object);
+
+  GST_DEBUG ("!!!! self=%p", self);
+
+  g_hash_table_destroy (self->priv->slots);
+  g_array_free (self->priv->updates, TRUE);
+  g_mutex_clear (&self->priv->lock);
+
+  G_OBJECT_CLASS (bt_meter_hub_parent_class)->finalize (object);
+}
+
+static GObject *
+bt_meter_hub_constructor (GType type, guint n_construct_params,
+    GObjectConstructParam * construct_params)
+{
+  GObject *object;
+
+  if (G_UNLIKELY (!singleton)) {
+    BtEditApplication *app;
+    GstBus *bus;
+
+    object =
+        G_OBJECT_CLASS (bt_meter_hub_parent_class)->constructor (type,
+        n_construct_params, construct_params);
+    singleton = BT_METER_HUB (object);
+    g_object_add_weak_pointer (object, (gpointer *) (gpointer) & singleton);
+
+    // the pipeline stays the same when songs are loaded
+    app = bt_edit_application_new ();
+    g_object_get (app, "bin", &singleton->priv->bin, NULL);
+    g_object_unref (app);
+
+    bus = gst_element_get_bus (singleton->priv->bin);
+    g_signal_connect (bus, "sync-message::element",
+        G_CALLBACK (on_level_message), (gpointer) singleton);
+    gst_object_unref (bus);
+  } else {
+    object = g_object_ref ((gpointer) singleton);
+  }
+  return object;
+}
+
+static void
+bt_meter_hub_init (BtMeterHub * self)
+{
+  self->priv = bt_meter_hub_get_instance_private(self);
+  self->priv->slots = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) free_slot);
+  self->priv->updates = g_array_new (FALSE, FALSE, sizeof (BtMeterHubUpdate));
+  g_mutex_init (&self->priv->lock);
+}
+
+static void
+bt_meter_hub_class_init (BtMeterHubClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  bus_msg_level_quark = g_quark_from_static_string ("level");
+
+  gobject_class->constructor = bt_meter_hub_constructor;
+  gobject_class->dispose = bt_meter_hub_dispose;
+  gobject_class->finalize = bt_meter_hub_finalize;
+}
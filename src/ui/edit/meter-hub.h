@@ -0,0 +1,96 @@
+/* Buzztrax
+ * Copyright (C) 2017 Buzztrax team <buzztrax-devel@buzztrax.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BT_METER_HUB_H
+#define BT_METER_HUB_H
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gst/gst.h>
+
+#define BT_TYPE_METER_HUB            (bt_meter_hub_get_type ())
+#define BT_METER_HUB(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), BT_TYPE_METER_HUB, BtMeterHub))
+#define BT_METER_HUB_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), BT_TYPE_METER_HUB, BtMeterHubClass))
+#define BT_IS_METER_HUB(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), BT_TYPE_METER_HUB))
+#define BT_IS_METER_HUB_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), BT_TYPE_METER_HUB))
+#define BT_METER_HUB_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), BT_TYPE_METER_HUB, BtMeterHubClass))
+
+/* type macros */
+
+typedef struct _BtMeterHub BtMeterHub;
+typedef struct _BtMeterHubClass BtMeterHubClass;
+typedef struct _BtMeterHubPrivate BtMeterHubPrivate;
+
+/**
+ * BtMeterHub:
+ *
+ * collects the level meter values of a song
+ */
+struct _BtMeterHub {
+  GObject parent;
+
+  /*< private >*/
+  BtMeterHubPrivate *priv;
+};
+
+struct _BtMeterHubClass {
+  GObjectClass parent;
+};
+
+/**
+ * BT_METER_HUB_MAX_CHANNELS:
+ *
+ * The number of channels a level meter keeps values for.
+ */
+#define BT_METER_HUB_MAX_CHANNELS 8
+
+/**
+ * BtMeterLevels:
+ * @channels: number of valid entries in @peak and @decay
+ * @peak: the peak level per channel in dB
+ * @decay: the decaying peak level per channel in dB
+ *
+ * The values of a level meter, as posted by the level element. Levels for
+ * silence can be -inf.
+ */
+typedef struct {
+  guint channels;
+  gdouble peak[BT_METER_HUB_MAX_CHANNELS];
+  gdouble decay[BT_METER_HUB_MAX_CHANNELS];
+} BtMeterLevels;
+
+/**
+ * BtMeterHubFunc:
+ * @level: the level element
+ * @levels: the new values
+ * @user_data: the data passed to bt_meter_hub_add()
+ *
+ * Called from the main thread when the audio for new level values is played
+ * and the values differ from the ones shown before.
+ */
+typedef void (*BtMeterHubFunc) (GstElement *level, const BtMeterLevels *levels, gpointer user_data);
+
+GType bt_meter_hub_get_type(void) G_GNUC_CONST;
+
+BtMeterHub *bt_meter_hub_new(void);
+
+void bt_meter_hub_add(BtMeterHub *self, GstElement *level, BtMeterHubFunc func, gpointer user_data);
+void bt_meter_hub_remove(BtMeterHub *self, GstElement *level, gpointer user_data);
+
+gdouble bt_meter_levels_get_aggregated(const gdouble *values, guint channels, gdouble default_value);
+
+#endif // BT_METER_HUB_H
@@ -44,6 +44,8 @@ struct _BtObjectListModelPrivate
 
   GParamSpec **params;
   GSequence *seq;
+  /* object -> GSequenceIter, to find the row of an object */
+  GHashTable *iters;
 };
 
 //-- the class
@@ -58,6 +60,35 @@ G_DEFINE_TYPE_WITH_CODE (BtObjectListModel, bt_object_list_model, G_TYPE_OBJECT,
 
 //-- helper
 
+//-- signal handlers
+
+static void
+on_object_property_changed (GObject * object, GParamSpec * arg,
+    gpointer user_data)
+{
+  BtObjectListModel *model = BT_OBJECT_LIST_MODEL (user_data);
+  GtkTreePath *path;
+  GtkTreeIter iter;
+  gint i;
+
+  // only signal the row if the property is bound to a column
+  for (i = 0; i < model->priv->n_columns; i++) {
+    if (model->priv->params[i] && model->priv->params[i]->name == arg->name)
+      break;
+  }
+  if (i == model->priv->n_columns)
+    return;
+  if (!(iter.user_data = g_hash_table_lookup (model->priv->iters, object)))
+    return;
+
+  iter.stamp = model->priv->stamp;
+  path = gtk_tree_path_new ();
+  gtk_tree_path_append_index (path,
+      g_sequence_iter_get_position (iter.user_data));
+  gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+  gtk_tree_path_free (path);
+}
+
 //-- constructor methods
 
 /**
@@ -117,6 +148,11 @@ _object_list_model_insert (BtObjectListModel * model, GObject * object,
 
   iter.stamp = model->priv->stamp;
   iter.user_data = g_sequence_insert_before (seq_iter, g_object_ref (object));
+  if (!g_hash_table_contains (model->priv->iters, object)) {
+    g_signal_connect_object (object, "notify",
+        G_CALLBACK (on_object_property_changed), (gpointer) model, 0);
+  }
+  g_hash_table_insert (model->priv->iters, object, iter.user_data);
 
   path = gtk_tree_path_new ();
   gtk_tree_path_append_index (path, position);
@@ -388,7 +424,19 @@ bt_object_list_model_dispose (GObject * object)
 
   GST_DEBUG ("!!!! self=%p", self);
 
-  g_sequence_foreach (self->priv->seq, (GFunc) g_object_unref, NULL);
+  if (self->priv->iters) {
+    GHashTableIter iter;
+    gpointer object;
+
+    g_hash_table_iter_init (&iter, self->priv->iters);
+    while (g_hash_table_iter_next (&iter, &object, NULL)) {
+      g_signal_handlers_disconnect_by_func (object,
+          on_object_property_changed, (gpointer) self);
+    }
+    g_hash_table_destroy (self->priv->iters);
+    self->priv->iters = NULL;
+    g_sequence_foreach (self->priv->seq, (GFunc) g_object_unref, NULL);
+  }
 
   G_OBJECT_CLASS (bt_object_list_model_parent_class)->dispose (object);
 }
@@ -412,6 +460,7 @@ bt_object_list_model_init (BtObjectListModel * self)
   self->priv = bt_object_list_model_get_instance_private(self);
 
   self->priv->seq = g_sequence_new (NULL);
+  self->priv->iters = g_hash_table_new (NULL, NULL);
   // random int to check whether an iter belongs to our model
   self->priv->stamp = g_random_int ();
 }
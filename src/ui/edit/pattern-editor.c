@@ -51,12 +51,12 @@
 /* IDEA(ensonic): use gtk_widget_error_bell (widget) when hitting borders with
  * cursor
  */
-/* for more performance, we need to render to memory surfaces and blit them when
- * scolling
- * - we need to update the memory surfaces when layout or data changes
- * - do we want to handle the cursor moves like data changes?
- * rendering to memory surfaces:
- * blitting:
+/* rendering:
+ * - the data area is rendered to a backing surface, when scrolling the surface
+ *   is blitted and only the uncovered parts are rendered
+ * - data changes are tracked through the signals of the #BtValueGroups, they
+ *   invalidate the cached cell texts and mark the cells as dirty
+ * - cursor, play-pos and headers are drawn on top when exposing
  */
 
 #define BT_EDIT
@@ -95,6 +95,17 @@ typedef struct _ParamType
   gfloat scale;
 } ParamType;
 
+/* cached value and text of a cell */
+struct _BtPatternEditorCell
+{
+  gfloat value;
+  gchar str[16];
+  gboolean valid;
+};
+
+/* text layouts are rebuilt, once we have more than this */
+#define MAX_GLYPHS 4096
+
 //-- helper methods
 
 static gchar *
@@ -179,18 +190,80 @@ bt_pattern_editor_rownum_width (BtPatternEditor * self)
   return self->cw * 5;
 }
 
+static PangoLayout *
+bt_pattern_editor_get_glyphs (BtPatternEditor * self, const gchar * str)
+{
+  PangoLayout *pl = g_hash_table_lookup (self->glyphs, str);
+
+  if (!pl) {
+    if (g_hash_table_size (self->glyphs) >= MAX_GLYPHS)
+      g_hash_table_remove_all (self->glyphs);
+    pl = pango_layout_copy (self->pl);
+    pango_layout_set_text (pl, str, -1);
+    g_hash_table_insert (self->glyphs, g_strdup (str), pl);
+  }
+  return pl;
+}
+
+static BtPatternEditorCell *
+bt_pattern_editor_get_cell (BtPatternEditor * self, guint row, guint group,
+    guint param)
+{
+  BtPatternEditorColumnGroup *cgrp = &self->groups[group];
+  BtPatternEditorCell *cell =
+      &self->cells[group][row * cgrp->num_columns + param];
+
+  if (!cell->valid) {
+    BtPatternEditorColumn *col = &cgrp->columns[param];
+    ParamType *pt = &param_types[col->type];
+    gchar buf[16], *str;
+
+    cell->value = self->callbacks->get_data_func (self->pattern_data,
+        col->user_data, row, group, param);
+    str = pt->to_string_func (buf, sizeof (buf), cell->value, col->def);
+    g_strlcpy (cell->str, str, MIN (pt->chars + 1, sizeof (cell->str)));
+    cell->valid = TRUE;
+  }
+  return cell;
+}
+
+static void
+bt_pattern_editor_free_cells (BtPatternEditor * self)
+{
+  gint g;
+
+  if (!self->cells)
+    return;
+
+  for (g = 0; g < self->num_groups; g++)
+    g_free (self->cells[g]);
+  g_free (self->cells);
+  self->cells = NULL;
+}
+
+static void
+bt_pattern_editor_free_backing (BtPatternEditor * self)
+{
+  if (self->backing) {
+    cairo_surface_destroy (self->backing);
+    self->backing = NULL;
+  }
+  if (self->backing_spare) {
+    cairo_surface_destroy (self->backing_spare);
+    self->backing_spare = NULL;
+  }
+}
+
 static void
 bt_pattern_editor_draw_rownum (BtPatternEditor * self, cairo_t * cr,
-    gint x, gint y, gint max_y)
+    gint x, gint y, gint row, gint end_row)
 {
-  PangoLayout *pl = self->pl;
   gchar buf[16];
-  gint row = 0;
   gint ch = self->ch, cw = self->cw;
   gint colw1 = bt_pattern_editor_rownum_width (self);
   gint colw = colw1 - cw;
 
-  while (y < max_y && row < self->num_rows) {
+  while (row <= end_row) {
     gdk_cairo_set_source_rgba (cr, &self->bg_shade_color[row & 0x1]);
     cairo_rectangle (cr, x, y, colw, ch);
     cairo_fill (cr);
@@ -198,8 +271,7 @@ bt_pattern_editor_draw_rownum (BtPatternEditor * self, cairo_t * cr,
     gdk_cairo_set_source_rgba (cr, &self->text_color);
     snprintf (buf, sizeof (buf), "%04X", row);
     cairo_move_to (cr, x, y);
-    pango_layout_set_text (pl, buf, 4);
-    pango_cairo_show_layout (cr, pl);
+    pango_cairo_show_layout (cr, bt_pattern_editor_get_glyphs (self, buf));
 
     y += ch;
     row++;
@@ -273,36 +345,28 @@ in_selection_row (BtPatternEditor * self, guint row)
 
 /*
  * bt_pattern_editor_draw_column:
- * @x,@y: the top left corner for the column
+ * @x,@y: the top left corner for the first row to draw
  * @col,@group,@param: column data, group and param to draw
- * @max_y: max-y for clipping
+ * @row,@end_row: the range of rows to draw
  */
 static void
 bt_pattern_editor_draw_column (BtPatternEditor * self, cairo_t * cr,
     gint x, gint y, BtPatternEditorColumn * col,
-    guint group, guint param, gint max_y)
+    guint group, guint param, gint row, gint end_row)
 {
-  PangoLayout *pl = self->pl;
   ParamType *pt = &param_types[col->type];
-  gchar buf[16], *str;
-  gint row = 0;
   gint cw = self->cw, ch = self->ch;
   gint col_w = cw * (pt->chars + 1);
   gint col_w2 = col_w - (param == self->groups[group].num_columns - 1 ? cw : 0);
-  gfloat (*get_data_func) (gpointer pattern_data, gpointer column_data,
-      guint row, guint group, guint param) = self->callbacks->get_data_func;
 
-  gboolean is_cursor_column = (param == self->parameter
-      && group == self->group);
   gboolean is_selection_column = (self->selection_enabled
       && in_selection_column (self, group, param));
 
-  while (y < max_y && row < self->num_rows) {
+  while (row <= end_row) {
+    BtPatternEditorCell *cell =
+        bt_pattern_editor_get_cell (self, row, group, param);
     gint col_w3 = col_w2;
-    gfloat pval = get_data_func (self->pattern_data, col->user_data, row, group,
-        param);
     gboolean sel = (is_selection_column && in_selection_row (self, row));
-    str = pt->to_string_func (buf, sizeof (buf), pval, col->def);
 
     /* draw background */
     gdk_cairo_set_source_rgba (cr, &self->bg_shade_color[row & 0x1]);
@@ -326,23 +390,16 @@ bt_pattern_editor_draw_column (BtPatternEditor * self, cairo_t * cr,
     cairo_fill (cr);
 
     // draw value bar
-    if (!sel && (str[0] != '.')) {
+    if (!sel && (cell->str[0] != '.')) {
       gdk_cairo_set_source_rgba (cr, &self->value_color[row & 0x1]);
-      cairo_rectangle (cr, x, y, (col_w - cw) * (pval / (col->max * pt->scale)),
-          ch);
-      cairo_fill (cr);
-    }
-    // draw cursor
-    if (row == self->row && is_cursor_column) {
-      gint cp = pt->column_pos[self->digit];
-      gdk_cairo_set_source_rgba (cr, &self->cursor_color);
-      cairo_rectangle (cr, x + cw * cp, y, cw, ch);
+      cairo_rectangle (cr, x, y,
+          (col_w - cw) * (cell->value / (col->max * pt->scale)), ch);
       cairo_fill (cr);
     }
     gdk_cairo_set_source_rgba (cr, &self->text_color);
     cairo_move_to (cr, x, y);
-    pango_layout_set_text (pl, str, pt->chars);
-    pango_cairo_show_layout (cr, pl);
+    pango_cairo_show_layout (cr, bt_pattern_editor_get_glyphs (self,
+            cell->str));
 
     y += ch;
     row++;
@@ -365,36 +422,106 @@ bt_pattern_editor_get_col_height (BtPatternEditor * self)
 }
 
 static void
-bt_pattern_editor_refresh_cell (BtPatternEditor * self)
+bt_pattern_editor_update_layout (BtPatternEditor * self)
+{
+  gint g, i;
+
+  for (g = 0; g < self->num_groups; g++) {
+    BtPatternEditorColumnGroup *cgrp = &self->groups[g];
+    gint w = 0;
+
+    for (i = 0; i < cgrp->num_columns; i++)
+      w += self->cw * (param_types[cgrp->columns[i].type].chars + 1);
+    cgrp->width = w + self->cw;
+  }
+}
+
+/*
+ * bt_pattern_editor_get_column_pos:
+ * @x: location for the left side of the column, relative to the first column
+ * @w: location for the width of the column
+ */
+static void
+bt_pattern_editor_get_column_pos (BtPatternEditor * self, guint group,
+    guint param, gint * x, gint * w)
 {
-  gint y = self->colhdr_height + (self->row * self->ch) - self->ofs_y;
-  gint x = self->rowhdr_width - self->ofs_x;
-  gint g, i, w;
   BtPatternEditorColumnGroup *cgrp;
-  BtPatternEditorColumn *col;
-  ParamType *pt;
+  gint g, i;
+
+  *x = 0;
+  for (g = 0; g < group; g++)
+    *x += self->groups[g].width;
+  cgrp = &self->groups[group];
+  for (i = 0; i < param; i++)
+    *x += self->cw * (param_types[cgrp->columns[i].type].chars + 1);
+  *w = self->cw * (param_types[cgrp->columns[param].type].chars + 1);
+}
+
+/*
+ * bt_pattern_editor_invalidate_area:
+ * @x,@y,@w,@h: the area relative to the first cell
+ *
+ * Mark the area to be rendered again and queue a redraw for it.
+ */
+static void
+bt_pattern_editor_invalidate_area (BtPatternEditor * self, gint x, gint y,
+    gint w, gint h)
+{
   GtkAllocation allocation;
 
-  for (g = 0; g < self->group; g++) {
-    cgrp = &self->groups[g];
-    x += cgrp->width;
+  if (self->backing) {
+    cairo_rectangle_int_t area = { 0, 0, self->backing_width,
+      self->backing_height
+    };
+    cairo_region_t *region;
+    cairo_rectangle_int_t r = { x - self->backing_ofs_x,
+      y - self->backing_ofs_y, w, h
+    };
+
+    // parts outside of the backing surface get rendered when scrolled in
+    region = cairo_region_create_rectangle (&r);
+    cairo_region_intersect_rectangle (region, &area);
+    cairo_region_union (self->dirty, region);
+    cairo_region_destroy (region);
   }
-  cgrp = &self->groups[self->group];
-  for (i = 0; i < self->parameter; i++) {
-    col = &cgrp->columns[i];
-    pt = &param_types[col->type];
-    x += self->cw * (pt->chars + 1);
-  }
-  col = &cgrp->columns[self->parameter];
-  pt = &param_types[col->type];
-  w = self->cw * (pt->chars + 1);
+  if (!gtk_widget_get_realized (GTK_WIDGET (self)))
+    return;
 
   gtk_widget_get_allocation (GTK_WIDGET (self), &allocation);
-  x += allocation.x;
-  y += allocation.y;
+  x += allocation.x + self->rowhdr_width - self->ofs_x;
+  y += allocation.y + self->colhdr_height - self->ofs_y;
 
-  //GST_INFO("Mark Area Dirty: %d,%d -> %d,%d",x, y, w, self->ch);
-  gtk_widget_queue_draw_area (GTK_WIDGET (self), x, y, w, self->ch);
+  //GST_INFO("Mark Area Dirty: %d,%d -> %d,%d",x, y, w, h);
+  gtk_widget_queue_draw_area (GTK_WIDGET (self), x, y, w, h);
+}
+
+static void
+bt_pattern_editor_invalidate_all (BtPatternEditor * self)
+{
+  if (self->backing) {
+    cairo_rectangle_int_t area = { 0, 0, self->backing_width,
+      self->backing_height
+    };
+
+    cairo_region_union_rectangle (self->dirty, &area);
+  }
+  gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+static void
+bt_pattern_editor_refresh_cell (BtPatternEditor * self)
+{
+  BtPatternEditorColumnGroup *cgrp = &self->groups[self->group];
+  gint x, w;
+
+  // the value might have changed without a notify from the value-group
+  self->cells[self->group][self->row * cgrp->num_columns +
+      self->parameter].valid = FALSE;
+
+  bt_pattern_editor_get_column_pos (self, self->group, self->parameter, &x,
+      &w);
+  bt_pattern_editor_invalidate_area (self, x, self->row * self->ch, w,
+      self->ch);
 }
 
 static void
@@ -582,10 +709,81 @@ bt_pattern_editor_style_updated (GtkWidget * widget)
 {
   bt_pattern_editor_configure_style (BT_PATTERN_EDITOR (widget),
       gtk_widget_get_style_context (widget));
+  bt_pattern_editor_invalidate_all (BT_PATTERN_EDITOR (widget));
 
   GTK_WIDGET_CLASS (bt_pattern_editor_parent_class)->style_updated (widget);
 }
 
+static gint
+bt_pattern_editor_find_group (BtPatternEditor * self, BtValueGroup * vg)
+{
+  gint g;
+
+  for (g = 0; g < self->num_groups; g++) {
+    if (self->groups[g].vg == vg)
+      return g;
+  }
+  return -1;
+}
+
+static void
+bt_pattern_editor_release_value_groups (BtPatternEditor * self)
+{
+  guint i;
+
+  for (i = 0; i < self->value_groups->len; i++) {
+    BtValueGroup *vg = g_ptr_array_index (self->value_groups, i);
+
+    g_signal_handlers_disconnect_by_data (vg, self);
+    g_object_unref (vg);
+  }
+  g_ptr_array_set_size (self->value_groups, 0);
+}
+
+//-- event handler
+
+static void
+on_value_group_param_changed (BtValueGroup * vg, BtParameterGroup * pg,
+    gulong tick, gulong param, gpointer user_data)
+{
+  BtPatternEditor *self = BT_PATTERN_EDITOR (user_data);
+  BtPatternEditorColumnGroup *cgrp;
+  gint g = bt_pattern_editor_find_group (self, vg);
+  gint x, w;
+
+  if (g == -1)
+    return;
+  cgrp = &self->groups[g];
+  if (tick >= self->num_rows || param >= cgrp->num_columns)
+    return;
+
+  self->cells[g][tick * cgrp->num_columns + param].valid = FALSE;
+  bt_pattern_editor_get_column_pos (self, g, param, &x, &w);
+  bt_pattern_editor_invalidate_area (self, x, tick * self->ch, w, self->ch);
+}
+
+static void
+on_value_group_group_changed (BtValueGroup * vg, BtParameterGroup * pg,
+    gboolean intermediate, gpointer user_data)
+{
+  BtPatternEditor *self = BT_PATTERN_EDITOR (user_data);
+  BtPatternEditorColumnGroup *cgrp;
+  gint g = bt_pattern_editor_find_group (self, vg);
+  gint i, x = 0;
+
+  // wait for the final update
+  if (g == -1 || intermediate)
+    return;
+  cgrp = &self->groups[g];
+
+  memset (self->cells[g], 0,
+      self->num_rows * cgrp->num_columns * sizeof (BtPatternEditorCell));
+  for (i = 0; i < g; i++)
+    x += self->groups[i].width;
+  bt_pattern_editor_invalidate_area (self, x, 0, cgrp->width,
+      self->num_rows * self->ch);
+}
+
 //-- constructor methods
 
 /**
@@ -695,10 +893,12 @@ bt_pattern_editor_realize (GtkWidget * widget)
   self->pl = pango_layout_new (pc);
   pango_layout_set_font_description (self->pl, pfd);
   pango_font_description_free (pfd);
+  g_hash_table_remove_all (self->glyphs);
 
   /* static layout variables */
   self->rowhdr_width = bt_pattern_editor_rownum_width (self) + self->cw;
   self->colhdr_height = self->ch;
+  bt_pattern_editor_update_layout (self);
 
   GST_INFO ("char size: %d x %d", self->cw, self->ch);
 }
@@ -708,8 +908,10 @@ bt_pattern_editor_unrealize (GtkWidget * widget)
 {
   BtPatternEditor *self = BT_PATTERN_EDITOR (widget);
 
+  g_hash_table_remove_all (self->glyphs);
   g_object_unref (self->pl);
   self->pl = NULL;
+  bt_pattern_editor_free_backing (self);
 
   if (self->hadj) {
     g_object_unref (self->hadj);
@@ -751,25 +953,187 @@ bt_pattern_editor_unmap (GtkWidget * widget)
 }
 
 
-/* TODO(ensonic): speedup
- * - refactor layout and redrawing
- *   - calculate layout in bt_pattern_editor_size_allocate() and cache (what exactly)
- *   - only redraw in expose
- * - do columns in two passes to avoid changing the color for the text
+static void
+bt_pattern_editor_draw_cursor (BtPatternEditor * self, cairo_t * cr)
+{
+  BtPatternEditorCell *cell;
+  ParamType *pt;
+  gint x, y, w;
+
+  if (!self->num_groups || self->row >= self->num_rows)
+    return;
+
+  pt = &param_types[cur_column (self)->type];
+  cell = bt_pattern_editor_get_cell (self, self->row, self->group,
+      self->parameter);
+  bt_pattern_editor_get_column_pos (self, self->group, self->parameter, &x,
+      &w);
+  x += self->rowhdr_width - self->ofs_x;
+  y = self->colhdr_height + (self->row * self->ch) - self->ofs_y;
+
+  cairo_save (cr);
+  cairo_rectangle (cr, x + self->cw * pt->column_pos[self->digit], y,
+      self->cw, self->ch);
+  cairo_clip (cr);
+  gdk_cairo_set_source_rgba (cr, &self->cursor_color);
+  cairo_paint (cr);
+  gdk_cairo_set_source_rgba (cr, &self->text_color);
+  cairo_move_to (cr, x, y);
+  pango_cairo_show_layout (cr, bt_pattern_editor_get_glyphs (self, cell->str));
+  cairo_restore (cr);
+}
+
+/*
+ * bt_pattern_editor_scroll_backing:
+ * @dx,@dy: how much the content moves
+ *
+ * Move the content of the backing surface and mark the uncovered parts dirty.
+ */
+static void
+bt_pattern_editor_scroll_backing (BtPatternEditor * self, gint dx, gint dy)
+{
+  gint w = self->backing_width, h = self->backing_height;
+  cairo_rectangle_int_t r = { 0, 0, w, h };
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  self->backing_ofs_x = self->ofs_x;
+  self->backing_ofs_y = self->ofs_y;
+
+  if (ABS (dx) >= w || ABS (dy) >= h) {
+    cairo_region_union_rectangle (self->dirty, &r);
+    return;
+  }
+
+  cr = cairo_create (self->backing_spare);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface (cr, self->backing, dx, dy);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+  surface = self->backing;
+  self->backing = self->backing_spare;
+  self->backing_spare = surface;
+
+  cairo_region_translate (self->dirty, dx, dy);
+  if (dx) {
+    r.x = (dx > 0) ? 0 : w + dx;
+    r.y = 0;
+    r.width = ABS (dx);
+    r.height = h;
+    cairo_region_union_rectangle (self->dirty, &r);
+  }
+  if (dy) {
+    r.x = 0;
+    r.y = (dy > 0) ? 0 : h + dy;
+    r.width = w;
+    r.height = ABS (dy);
+    cairo_region_union_rectangle (self->dirty, &r);
+  }
+}
+
+/*
+ * bt_pattern_editor_render_area:
+ * @r: the area in backing surface coordinates
+ *
+ * Render all cells that intersect the area.
  */
+static void
+bt_pattern_editor_render_area (BtPatternEditor * self, cairo_t * cr,
+    cairo_rectangle_int_t * r)
+{
+  gint ch = self->ch, cw = self->cw;
+  gint ofs_x = self->backing_ofs_x, ofs_y = self->backing_ofs_y;
+  gint x = 0, g, i, row, end_row;
+
+  row = (r->y + ofs_y) / ch;
+  end_row = MIN ((gint) self->num_rows - 1,
+      (r->y + r->height - 1 + ofs_y) / ch);
+
+  cairo_save (cr);
+  cairo_rectangle (cr, r->x, r->y, r->width, r->height);
+  cairo_clip (cr);
+  cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+  cairo_paint (cr);
+  cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+
+  for (g = 0; g < self->num_groups; g++) {
+    BtPatternEditorColumnGroup *cgrp = &self->groups[g];
+
+    for (i = 0; i < cgrp->num_columns; i++) {
+      BtPatternEditorColumn *col = &cgrp->columns[i];
+      gint w = cw * (param_types[col->type].chars + 1);
+
+      // check intersection
+      if ((x + w > r->x + ofs_x) && (x < r->x + r->width + ofs_x)) {
+        bt_pattern_editor_draw_column (self, cr, x - ofs_x,
+            row * ch - ofs_y, col, g, i, row, end_row);
+      }
+      x += w;
+    }
+    x += cw;
+  }
+  cairo_restore (cr);
+}
+
+static void
+bt_pattern_editor_update_backing (BtPatternEditor * self, gint w, gint h)
+{
+  cairo_rectangle_int_t area = { 0, 0, w, h };
+  gint i, n;
+
+  if (!self->backing || self->backing_width != w || self->backing_height != h) {
+    bt_pattern_editor_free_backing (self);
+    self->backing = gdk_window_create_similar_surface (self->window,
+        CAIRO_CONTENT_COLOR_ALPHA, w, h);
+    self->backing_spare = gdk_window_create_similar_surface (self->window,
+        CAIRO_CONTENT_COLOR_ALPHA, w, h);
+    self->backing_width = w;
+    self->backing_height = h;
+    self->backing_ofs_x = self->ofs_x;
+    self->backing_ofs_y = self->ofs_y;
+    cairo_region_union_rectangle (self->dirty, &area);
+  } else if ((self->backing_ofs_x != self->ofs_x) ||
+      (self->backing_ofs_y != self->ofs_y)) {
+    bt_pattern_editor_scroll_backing (self,
+        self->backing_ofs_x - self->ofs_x, self->backing_ofs_y - self->ofs_y);
+  }
+
+  cairo_region_intersect_rectangle (self->dirty, &area);
+  if ((n = cairo_region_num_rectangles (self->dirty))) {
+    cairo_t *cr = cairo_create (self->backing);
+
+    GST_DEBUG ("render %d dirty areas", n);
+    for (i = 0; i < n; i++) {
+      cairo_rectangle_int_t r;
+
+      cairo_region_get_rectangle (self->dirty, i, &r);
+      bt_pattern_editor_render_area (self, cr, &r);
+    }
+    cairo_destroy (cr);
+    cairo_region_subtract_rectangle (self->dirty, &area);
+  }
+}
+
 static gboolean
 bt_pattern_editor_draw (GtkWidget * widget, cairo_t * cr)
 {
   BtPatternEditor *self = BT_PATTERN_EDITOR (widget);
   GtkStyleContext *style;
   GtkAllocation allocation;
-  gint y, x, i, g, max_y;
-  gint grp_x;
+  GdkRectangle clip;
+  gint y, dw, dh, row, end_row;
   gint ch;
 
   g_return_val_if_fail (BT_IS_PATTERN_EDITOR (widget), FALSE);
 
+  BT_TRACE_BEGIN ("ui", "pattern-editor-draw");
+
   gtk_widget_get_allocation (widget, &allocation);
+  if (!gdk_cairo_get_clip_rectangle (cr, &clip)) {
+    clip.x = clip.y = 0;
+    clip.width = allocation.width;
+    clip.height = allocation.height;
+  }
 
   style = gtk_widget_get_style_context (widget);
   gtk_render_background (style, cr, 0, 0, allocation.width, allocation.height);
@@ -779,44 +1143,35 @@ bt_pattern_editor_draw (GtkWidget * widget, cairo_t * cr)
     self->ofs_y = (gint) gtk_adjustment_get_value (self->vadj);
   }
 
-  /* leave space for headers */
-  x = self->rowhdr_width;
-  y = ch = self->ch;
-  /* calculate the first and last row in the dirty region */
-  max_y = allocation.height + ch;       // one extra line
-  max_y = ch + (gint) (ch * ((max_y - ch) / ch));
+  ch = self->ch;
+  /* the data area, without the headers */
+  dw = allocation.width - self->rowhdr_width;
+  dh = allocation.height - self->colhdr_height;
 
   GST_DEBUG ("Scroll: %d,%d, rows: %d", self->ofs_x, self->ofs_y,
       self->num_rows);
 
   /* draw group parameter columns */
-  for (g = 0; g < self->num_groups; g++) {
-    BtPatternEditorColumnGroup *cgrp = &self->groups[g];
-    grp_x = x;
-    for (i = 0; i < cgrp->num_columns; i++) {
-      BtPatternEditorColumn *col = &cgrp->columns[i];
-      ParamType *pt = &param_types[col->type];
-      gint w = self->cw * (pt->chars + 1);
-      gint xs = x - self->ofs_x, xe = xs + (w - 1);
-
-      // check intersection
-      if ((xs <= allocation.width) || (xe <= allocation.width)
-          || (xe >= allocation.width)) {
-        GST_DEBUG ("Draw Group/Column: %d,%d : x=%3d-%3d : y=%3d..%3d", g, i,
-            xs, xe, y - self->ofs_y, max_y);
-        bt_pattern_editor_draw_column (self, cr, x - self->ofs_x,
-            y - self->ofs_y, col, g, i, max_y);
-      } else {
-        GST_DEBUG ("Skip Group/Column: %d,%d : x=%3d-%3d", g, i, xs, xe);
-      }
-      x += w;
-    }
-    x += self->cw;
-    cgrp->width = x - grp_x;
+  if (self->num_groups && dw > 0 && dh > 0) {
+    bt_pattern_editor_update_layout (self);
+    bt_pattern_editor_update_backing (self, dw, dh);
+
+    cairo_save (cr);
+    cairo_rectangle (cr, self->rowhdr_width, self->colhdr_height, dw, dh);
+    cairo_clip (cr);
+    cairo_set_source_surface (cr, self->backing, self->rowhdr_width,
+        self->colhdr_height);
+    cairo_paint (cr);
+    bt_pattern_editor_draw_cursor (self, cr);
+    cairo_restore (cr);
   }
 
-  /* draw left and top headers */
-  bt_pattern_editor_draw_rownum (self, cr, 0, y - self->ofs_y, max_y);
+  /* draw left and top headers, only the rows in the clip area */
+  row = MAX (0, (clip.y + self->ofs_y - self->colhdr_height) / ch);
+  end_row = MIN ((gint) self->num_rows - 1,
+      (clip.y + clip.height - 1 + self->ofs_y - self->colhdr_height) / ch);
+  bt_pattern_editor_draw_rownum (self, cr, 0,
+      self->colhdr_height + row * ch - self->ofs_y, row, end_row);
   bt_pattern_editor_draw_colnames (self, cr, self->rowhdr_width - self->ofs_x,
       0, allocation.width);
   bt_pattern_editor_draw_rowname (self, cr, 0, 0);
@@ -837,6 +1192,7 @@ bt_pattern_editor_draw (GtkWidget * widget, cairo_t * cr)
     }
   }
 
+  BT_TRACE_END ("ui", "pattern-editor-draw");
   return FALSE;
 }
 
@@ -1108,7 +1464,7 @@ bt_pattern_editor_key_press (GtkWidget * widget, GdkEventKey * event)
         }
         if (handled) {
           // selection changed
-          gtk_widget_queue_draw (GTK_WIDGET (self));
+          bt_pattern_editor_invalidate_all (self);
           return TRUE;
         }
       }
@@ -1538,10 +1894,25 @@ bt_pattern_editor_dispose (GObject * object)
     g_object_unref (self->vadj);
     self->vadj = NULL;
   }
+  bt_pattern_editor_release_value_groups (self);
+  bt_pattern_editor_free_cells (self);
+  bt_pattern_editor_free_backing (self);
 
   G_OBJECT_CLASS (bt_pattern_editor_parent_class)->dispose (object);
 }
 
+static void
+bt_pattern_editor_finalize (GObject * object)
+{
+  BtPatternEditor *self = BT_PATTERN_EDITOR (object);
+
+  g_ptr_array_free (self->value_groups, TRUE);
+  g_hash_table_destroy (self->glyphs);
+  cairo_region_destroy (self->dirty);
+
+  G_OBJECT_CLASS (bt_pattern_editor_parent_class)->finalize (object);
+}
+
 static void
 bt_pattern_editor_class_init (BtPatternEditorClass * klass)
 {
@@ -1551,6 +1922,7 @@ bt_pattern_editor_class_init (BtPatternEditorClass * klass)
   gobject_class->set_property = bt_pattern_editor_set_property;
   gobject_class->get_property = bt_pattern_editor_get_property;
   gobject_class->dispose = bt_pattern_editor_dispose;
+  gobject_class->finalize = bt_pattern_editor_finalize;
 
   widget_class->realize = bt_pattern_editor_realize;
   widget_class->unrealize = bt_pattern_editor_unrealize;
@@ -1630,6 +2002,10 @@ bt_pattern_editor_init (BtPatternEditor * self)
   self->selection_end = 0;
   self->selection_group = 0;
   self->selection_param = 0;
+  self->value_groups = g_ptr_array_new ();
+  self->glyphs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      g_object_unref);
+  self->dirty = cairo_region_create ();
 
   gtk_widget_set_can_focus (GTK_WIDGET (self), TRUE);
   gtk_widget_set_has_window (GTK_WIDGET (self), FALSE);
@@ -1652,6 +2028,10 @@ bt_pattern_editor_set_pattern (BtPatternEditor * self, gpointer pattern_data,
     BtPatternEditorColumnGroup * groups, BtPatternEditorCallbacks * cb)
 {
   GtkWidget *widget = GTK_WIDGET (self);
+  guint g;
+
+  bt_pattern_editor_release_value_groups (self);
+  bt_pattern_editor_free_cells (self);
 
   self->num_rows = num_rows;
   self->num_groups = num_groups;
@@ -1659,6 +2039,25 @@ bt_pattern_editor_set_pattern (BtPatternEditor * self, gpointer pattern_data,
   self->pattern_data = pattern_data;
   self->callbacks = cb;
 
+  if (num_groups) {
+    self->cells = g_new (BtPatternEditorCell *, num_groups);
+    for (g = 0; g < num_groups; g++) {
+      BtValueGroup *vg = groups[g].vg;
+
+      self->cells[g] = g_new0 (BtPatternEditorCell,
+          num_rows * groups[g].num_columns);
+      if (vg) {
+        g_ptr_array_add (self->value_groups, g_object_ref (vg));
+        g_signal_connect (vg, "param-changed",
+            G_CALLBACK (on_value_group_param_changed), (gpointer) self);
+        g_signal_connect (vg, "group-changed",
+            G_CALLBACK (on_value_group_group_changed), (gpointer) self);
+      }
+    }
+  }
+  bt_pattern_editor_update_layout (self);
+  bt_pattern_editor_invalidate_all (self);
+
   if (self->row >= self->num_rows)
     self->row = 0;
   if (self->group >= self->num_groups)
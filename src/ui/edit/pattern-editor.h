@@ -109,6 +109,7 @@ typedef struct _BtPatternEditorCallbacks BtPatternEditorCallbacks;
 typedef struct _BtPatternEditor BtPatternEditor;
 typedef struct _BtPatternEditorClass BtPatternEditorClass;
 typedef struct _BtPatternEditorPrivate BtPatternEditorPrivate;
+typedef struct _BtPatternEditorCell BtPatternEditorCell;
 
 /**
  * BtPatternEditorSelectionMode:
@@ -171,6 +172,19 @@ struct _BtPatternEditor {
   /* scroll adjustments */
   GtkAdjustment *hadj, *vadj;
   GtkScrollablePolicy hscroll_policy, vscroll_policy;
+
+  /* formatted cell values, one array (rows x columns) per group */
+  BtPatternEditorCell **cells;
+  /* the value-groups we get change notifications from */
+  GPtrArray *value_groups;
+  /* text layouts by string */
+  GHashTable *glyphs;
+  /* rendered data area, the scroll offset it was rendered for and the parts
+   * that need to be rendered again */
+  cairo_surface_t *backing, *backing_spare;
+  gint backing_width, backing_height;
+  gint backing_ofs_x, backing_ofs_y;
+  cairo_region_t *dirty;
 };
 
 struct _BtPatternEditorClass {
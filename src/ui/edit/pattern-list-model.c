@@ -60,6 +60,8 @@ struct _BtPatternListModelPrivate
 
   GType param_types[N_COLUMNS];
   GSequence *seq;
+  /* pattern -> GSequenceIter, to find rows without comparing names */
+  GHashTable *iters;
 };
 
 //-- the class
@@ -118,6 +120,31 @@ model_item_cmp (gconstpointer a, gconstpointer b, gpointer data)
 }
 
 
+/* the shortcut column depends on the position, rows that move from or to a
+ * position with a shortcut need to be updated */
+static void
+bt_pattern_list_model_shortcuts_changed (BtPatternListModel * model,
+    gint start, gint end)
+{
+  GtkTreePath *path;
+  GtkTreeIter iter;
+  gint pos;
+
+  end = MIN (end, MIN (64, g_sequence_get_length (model->priv->seq)));
+  if (start >= end)
+    return;
+
+  iter.stamp = model->priv->stamp;
+  iter.user_data = g_sequence_get_iter_at_pos (model->priv->seq, start);
+  for (pos = start; pos < end; pos++) {
+    path = gtk_tree_path_new ();
+    gtk_tree_path_append_index (path, pos);
+    gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+    gtk_tree_path_free (path);
+    iter.user_data = g_sequence_iter_next (iter.user_data);
+  }
+}
+
 static void
 bt_pattern_list_model_add (BtPatternListModel * model, BtCmdPattern * pattern)
 {
@@ -133,6 +160,8 @@ bt_pattern_list_model_add (BtPatternListModel * model, BtCmdPattern * pattern)
       return;
     }
   }
+  if (g_hash_table_contains (model->priv->iters, pattern))
+    return;
 
   GST_INFO ("add pattern to model");
 
@@ -140,6 +169,7 @@ bt_pattern_list_model_add (BtPatternListModel * model, BtCmdPattern * pattern)
   iter.stamp = model->priv->stamp;
   iter.user_data =
       g_sequence_insert_sorted (seq, pattern, model_item_cmp, NULL);
+  g_hash_table_insert (model->priv->iters, pattern, iter.user_data);
   position = g_sequence_iter_get_position (iter.user_data);
 
   g_signal_connect_object (pattern, "notify::name",
@@ -150,21 +180,26 @@ bt_pattern_list_model_add (BtPatternListModel * model, BtCmdPattern * pattern)
   gtk_tree_path_append_index (path, position);
   gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
   gtk_tree_path_free (path);
+  bt_pattern_list_model_shortcuts_changed (model, position + 1, G_MAXINT);
   GST_DEBUG ("inserted pattern %p at position %d", pattern, position);
 }
 
 static void
 bt_pattern_list_model_rem (BtPatternListModel * model, BtPattern * pattern)
 {
-  GSequence *seq = model->priv->seq;
   GtkTreePath *path;
   GSequenceIter *iter;
   gint position;
 
+  if (!(iter = g_hash_table_lookup (model->priv->iters, pattern)))
+    return;
+
   GST_INFO ("removing pattern from model");
 
   // remove entry
-  iter = g_sequence_lookup (seq, pattern, model_item_cmp, NULL);
+  g_signal_handlers_disconnect_by_func (pattern, on_pattern_name_changed,
+      (gpointer) model);
+  g_hash_table_remove (model->priv->iters, pattern);
   position = g_sequence_iter_get_position (iter);
   g_sequence_remove (iter);
 
@@ -173,6 +208,7 @@ bt_pattern_list_model_rem (BtPatternListModel * model, BtPattern * pattern)
   gtk_tree_path_append_index (path, position);
   gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
   gtk_tree_path_free (path);
+  bt_pattern_list_model_shortcuts_changed (model, position, G_MAXINT);
 
   GST_INFO ("removed pattern from model at pos %d ", position);
 }
@@ -184,24 +220,18 @@ on_pattern_name_changed (BtPattern * pattern, GParamSpec * arg,
     gpointer user_data)
 {
   BtPatternListModel *model = BT_PATTERN_LIST_MODEL (user_data);
-  GSequence *seq = model->priv->seq;
   GtkTreePath *path;
   GtkTreeIter iter;
-  gint pos1, pos2 = -1, len;
+  gint pos1, pos2;
 
   // find the item by pattern (cannot use model_item_cmp, as id has changed)
   iter.stamp = model->priv->stamp;
-  len = g_sequence_get_length (seq);
-  for (pos1 = 0; pos1 < len; pos1++) {
-    iter.user_data = g_sequence_get_iter_at_pos (seq, pos1);
-    if (g_sequence_get (iter.user_data) == pattern) {
-      g_sequence_sort_changed (iter.user_data, model_item_cmp, NULL);
-      pos2 = g_sequence_iter_get_position (iter.user_data);
-      break;
-    }
-  }
-  if (G_UNLIKELY (pos2 == -1))
+  if (G_UNLIKELY (!(iter.user_data =
+              g_hash_table_lookup (model->priv->iters, pattern))))
     return;
+  pos1 = g_sequence_iter_get_position (iter.user_data);
+  g_sequence_sort_changed (iter.user_data, model_item_cmp, NULL);
+  pos2 = g_sequence_iter_get_position (iter.user_data);
 
   GST_DEBUG ("pos %d -> %d", pos1, pos2);
 
@@ -215,6 +245,11 @@ on_pattern_name_changed (BtPattern * pattern, GParamSpec * arg,
     gtk_tree_path_append_index (path, pos2);
     gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
     gtk_tree_path_free (path);
+    // the rows in between moved by one
+    if (pos1 < pos2)
+      bt_pattern_list_model_shortcuts_changed (model, pos1, pos2);
+    else
+      bt_pattern_list_model_shortcuts_changed (model, pos2 + 1, pos1 + 1);
   } else {
     path = gtk_tree_path_new ();
     gtk_tree_path_append_index (path, pos2);
@@ -247,26 +282,19 @@ on_sequence_pattern_usage_changed (BtSequence * sequence, BtPattern * pattern,
     gpointer user_data)
 {
   BtPatternListModel *model = BT_PATTERN_LIST_MODEL (user_data);
-  BtMachine *machine;
+  GtkTreeIter iter;
+  GtkTreePath *path;
 
-  g_object_get (pattern, "machine", &machine, NULL);
-  if (machine) {
-    if (machine == model->priv->machine) {
-      GSequence *seq = model->priv->seq;
-      GtkTreeIter iter;
-      GtkTreePath *path;
-
-      // find the item by pattern
-      iter.stamp = model->priv->stamp;
-      iter.user_data = g_sequence_lookup (seq, pattern, model_item_cmp, NULL);
-      path = gtk_tree_path_new ();
-      gtk_tree_path_append_index (path,
-          g_sequence_iter_get_position (iter.user_data));
-      gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
-      gtk_tree_path_free (path);
-    }
-    g_object_unref (machine);
-  }
+  // find the item by pattern, patterns of other machines are not in the model
+  iter.stamp = model->priv->stamp;
+  if (!(iter.user_data = g_hash_table_lookup (model->priv->iters, pattern)))
+    return;
+
+  path = gtk_tree_path_new ();
+  gtk_tree_path_append_index (path,
+      g_sequence_iter_get_position (iter.user_data));
+  gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+  gtk_tree_path_free (path);
 }
 
 //-- constructor methods
@@ -319,13 +347,20 @@ bt_pattern_list_model_new (BtMachine * machine, BtSequence * sequence,
   }
   // get pattern list from machine
   g_object_get ((gpointer) machine, "patterns", &list, NULL);
-  // add patterns
+  // add patterns, nobody is watching the model yet, thus we don't need to
+  // signal the rows and can sort them once
   for (node = list; node; node = g_list_next (node)) {
     pattern = BT_CMD_PATTERN (node->data);      // we take no extra ref on the patterns here
-    bt_pattern_list_model_add (self, pattern);
+    if (!skip_internal || BT_IS_PATTERN (pattern)) {
+      g_hash_table_insert (self->priv->iters, pattern,
+          g_sequence_append (self->priv->seq, pattern));
+      g_signal_connect_object (pattern, "notify::name",
+          G_CALLBACK (on_pattern_name_changed), (gpointer) self, 0);
+    }
     g_object_unref (pattern);
   }
   g_list_free (list);
+  g_sequence_sort (self->priv->seq, model_item_cmp, NULL);
 
   g_signal_connect_object (machine, "pattern-added",
       G_CALLBACK (on_pattern_added), (gpointer) self, 0);
@@ -611,6 +646,7 @@ bt_pattern_list_model_finalize (GObject * object)
         (gpointer *) & self->priv->sequence);
   }
 
+  g_hash_table_destroy (self->priv->iters);
   g_sequence_free (self->priv->seq);
 
   G_OBJECT_CLASS (bt_pattern_list_model_parent_class)->finalize (object);
@@ -622,6 +658,7 @@ bt_pattern_list_model_init (BtPatternListModel * self)
   self->priv = bt_pattern_list_model_get_instance_private(self);
 
   self->priv->seq = g_sequence_new (NULL);
+  self->priv->iters = g_hash_table_new (NULL, NULL);
   // random int to check whether an iter belongs to our model
   self->priv->stamp = g_random_int ();
 }
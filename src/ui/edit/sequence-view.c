@@ -21,6 +21,13 @@
  *
  * This widget derives from the #GtkTreeView to additionaly draw loop- and
  * play-position bars.
+ *
+ * The rendered rows are kept in tiles of a few rows. Moving the bars and
+ * scrolling only paints the cached tiles, rows are only rendered again when
+ * they become visible for the first time or when they change. Changes are
+ * tracked through the signals of the tree-model and the cursor. Changes that
+ * are not reflected in the model (e.g. the selection) need to be announced
+ * with bt_sequence_view_refresh().
  */
 
 #define BT_EDIT
@@ -30,6 +37,9 @@
 
 #include "bt-edit.h"
 
+// number of rows in a tile, needs to fit into the valid mask
+#define TILE_ROWS 16
+
 enum
 {
   SEQUENCE_VIEW_PLAY_POSITION = 1,
@@ -60,18 +70,78 @@ struct _BtSequenceViewPrivate
   /* cache some ressources */
   GdkWindow *window;
   GdkRGBA play_line_color, end_line_color, loop_line_color;
+
+  /* rendered rows: tile-index -> BtSequenceViewTile */
+  GHashTable *tiles;
+  /* the geometry the tiles have been rendered for */
+  gint tile_x, tile_width, tile_row_height;
+  /* the rows with the cursor and the pointer, as they are rendered */
+  gint cursor_row, hover_row;
+  GtkTreeModel *model;
 };
 
+typedef struct
+{
+  cairo_surface_t *surface;
+  /* one bit per rendered row */
+  guint32 valid;
+} BtSequenceViewTile;
+
 //-- the class
 
 G_DEFINE_TYPE_WITH_CODE (BtSequenceView, bt_sequence_view, GTK_TYPE_TREE_VIEW, 
     G_ADD_PRIVATE(BtSequenceView));
 
 
-//-- event handler
-
 //-- helper methods
 
+static void
+bt_sequence_view_tile_free (gpointer data)
+{
+  BtSequenceViewTile *tile = (BtSequenceViewTile *) data;
+
+  cairo_surface_destroy (tile->surface);
+  g_slice_free (BtSequenceViewTile, tile);
+}
+
+static void
+bt_sequence_view_invalidate_rows (const BtSequenceView * self, gint beg,
+    gint end)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_hash_table_iter_init (&iter, self->priv->tiles);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    BtSequenceViewTile *tile = (BtSequenceViewTile *) value;
+    gint r0 = GPOINTER_TO_INT (key) * TILE_ROWS;
+    gint r1 = r0 + TILE_ROWS - 1;
+    gint i;
+
+    if ((r1 < beg) || (r0 > end))
+      continue;
+    for (i = MAX (beg, r0); i <= MIN (end, r1); i++) {
+      tile->valid &= ~(1U << (i - r0));
+    }
+    if (!tile->valid)
+      g_hash_table_iter_remove (&iter);
+  }
+}
+
+static void
+bt_sequence_view_invalidate_all (const BtSequenceView * self)
+{
+  g_hash_table_remove_all (self->priv->tiles);
+}
+
+static gint
+get_path_row (GtkTreePath * path)
+{
+  gint *indices = path ? gtk_tree_path_get_indices (path) : NULL;
+
+  return indices ? indices[0] : -1;
+}
+
 static void
 bt_sequence_view_invalidate (const BtSequenceView * self, gdouble old_pos,
     gdouble new_pos)
@@ -91,6 +161,68 @@ bt_sequence_view_invalidate (const BtSequenceView * self, gdouble old_pos,
       gtk_widget_get_allocated_width (widget), 3);
 }
 
+//-- event handler
+
+static void
+on_model_row_changed (GtkTreeModel * model, GtkTreePath * path,
+    GtkTreeIter * iter, gpointer user_data)
+{
+  BtSequenceView *self = BT_SEQUENCE_VIEW (user_data);
+  gint row = get_path_row (path);
+
+  bt_sequence_view_invalidate_rows (self, row, row);
+}
+
+static void
+on_model_row_inserted (GtkTreeModel * model, GtkTreePath * path,
+    GtkTreeIter * iter, gpointer user_data)
+{
+  BtSequenceView *self = BT_SEQUENCE_VIEW (user_data);
+
+  // all rows below move
+  bt_sequence_view_invalidate_rows (self, get_path_row (path), G_MAXINT);
+}
+
+static void
+on_model_row_deleted (GtkTreeModel * model, GtkTreePath * path,
+    gpointer user_data)
+{
+  BtSequenceView *self = BT_SEQUENCE_VIEW (user_data);
+
+  bt_sequence_view_invalidate_rows (self, get_path_row (path), G_MAXINT);
+}
+
+static void
+on_model_rows_reordered (GtkTreeModel * model, GtkTreePath * path,
+    GtkTreeIter * iter, gpointer new_order, gpointer user_data)
+{
+  bt_sequence_view_invalidate_all (BT_SEQUENCE_VIEW (user_data));
+}
+
+static void
+on_model_notify (GObject * object, GParamSpec * arg, gpointer user_data)
+{
+  BtSequenceView *self = BT_SEQUENCE_VIEW (user_data);
+  GtkTreeModel *model = gtk_tree_view_get_model (GTK_TREE_VIEW (self));
+
+  if (self->priv->model) {
+    g_signal_handlers_disconnect_by_data (self->priv->model, self);
+    g_object_unref (self->priv->model);
+  }
+  self->priv->model = model ? g_object_ref (model) : NULL;
+  if (model) {
+    g_signal_connect (model, "row-changed",
+        G_CALLBACK (on_model_row_changed), (gpointer) self);
+    g_signal_connect (model, "row-inserted",
+        G_CALLBACK (on_model_row_inserted), (gpointer) self);
+    g_signal_connect (model, "row-deleted",
+        G_CALLBACK (on_model_row_deleted), (gpointer) self);
+    g_signal_connect (model, "rows-reordered",
+        G_CALLBACK (on_model_rows_reordered), (gpointer) self);
+  }
+  bt_sequence_view_invalidate_all (self);
+}
+
 //-- constructor methods
 
 /**
@@ -111,6 +243,23 @@ bt_sequence_view_new (void)
 
 //-- methods
 
+/**
+ * bt_sequence_view_refresh:
+ * @self: the sequence view
+ *
+ * Drop the cached rows and redraw the view. Needs to be called if the look of
+ * the cells changes without the model telling about it, e.g. when the
+ * selection changes.
+ */
+void
+bt_sequence_view_refresh (const BtSequenceView * self)
+{
+  g_return_if_fail (BT_IS_SEQUENCE_VIEW (self));
+
+  bt_sequence_view_invalidate_all (self);
+  gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
 //-- wrapper
 
 //-- class internals
@@ -141,6 +290,136 @@ bt_sequence_view_realize (GtkWidget * widget)
   }
 }
 
+static BtSequenceViewTile *
+bt_sequence_view_get_tile (const BtSequenceView * self, gint ix)
+{
+  BtSequenceViewTile *tile =
+      g_hash_table_lookup (self->priv->tiles, GINT_TO_POINTER (ix));
+
+  if (!tile) {
+    tile = g_slice_new0 (BtSequenceViewTile);
+    tile->surface = gdk_window_create_similar_surface (self->priv->window,
+        CAIRO_CONTENT_COLOR_ALPHA, self->priv->tile_width,
+        TILE_ROWS * self->priv->tile_row_height);
+    g_hash_table_insert (self->priv->tiles, GINT_TO_POINTER (ix), tile);
+  }
+  return tile;
+}
+
+/* let the tree-view render the rows beg...end of the tile, the rows need to be
+ * visible */
+static void
+bt_sequence_view_render_rows (BtSequenceView * self, BtSequenceViewTile * tile,
+    gint ix, gint beg, gint end, const GdkRectangle * vr, gint bx, gint by)
+{
+  GtkWidget *widget = (GtkWidget *) self;
+  gint rh = self->priv->tile_row_height;
+  gint ty = by + ix * TILE_ROWS * rh - vr->y;
+  gint i;
+  cairo_t *c = cairo_create (tile->surface);
+
+  // use widget coordinates
+  cairo_translate (c, -bx, -ty);
+  cairo_rectangle (c, bx, by + beg * rh - vr->y, vr->width,
+      (end + 1 - beg) * rh);
+  cairo_clip (c);
+  cairo_set_operator (c, CAIRO_OPERATOR_CLEAR);
+  cairo_paint (c);
+  cairo_set_operator (c, CAIRO_OPERATOR_OVER);
+  GTK_WIDGET_CLASS (bt_sequence_view_parent_class)->draw (widget, c);
+  cairo_destroy (c);
+
+  // rows on the edges are only partially rendered
+  for (i = beg; i <= end; i++) {
+    if ((i * rh >= vr->y) && ((i + 1) * rh <= vr->y + vr->height)) {
+      tile->valid |= (1U << (i - ix * TILE_ROWS));
+    }
+  }
+}
+
+/* draw the rows from the tiles, returns %FALSE if the tiles can't be used */
+static gboolean
+bt_sequence_view_draw_rows (BtSequenceView * self, cairo_t * c,
+    const GdkRectangle * vr)
+{
+  GtkWidget *widget = (GtkWidget *) self;
+  BtSequenceViewPrivate *p = self->priv;
+  GdkRectangle clip;
+  GHashTableIter iter;
+  gpointer key;
+  GList *children;
+  gint bx, by, rh = (gint) p->row_height;
+  gint r, r0, r1, ix, ix0, ix1, beg, keep;
+
+  if (!gdk_cairo_get_clip_rectangle (c, &clip))
+    return TRUE;
+
+  // editing widgets are drawn by the tree-view
+  if ((children = gtk_container_get_children (GTK_CONTAINER (self)))) {
+    g_list_free (children);
+    return FALSE;
+  }
+
+  gtk_tree_view_convert_bin_window_to_widget_coords (GTK_TREE_VIEW (self), 0,
+      0, &bx, &by);
+  if ((clip.x < bx) || (clip.y < by) ||
+      (clip.x + clip.width > bx + vr->width) ||
+      (clip.y + clip.height > by + vr->height))
+    return FALSE;
+
+  // the tiles are only valid for the same geometry
+  if ((p->tile_x != vr->x) || (p->tile_width != vr->width) ||
+      (p->tile_row_height != rh)) {
+    bt_sequence_view_invalidate_all (self);
+    p->tile_x = vr->x;
+    p->tile_width = vr->width;
+    p->tile_row_height = rh;
+  }
+
+  r0 = (clip.y - by + vr->y) / rh;
+  r1 = (clip.y + clip.height - 1 - by + vr->y) / rh;
+  ix0 = r0 / TILE_ROWS;
+  ix1 = r1 / TILE_ROWS;
+
+  for (ix = ix0; ix <= ix1; ix++) {
+    BtSequenceViewTile *tile = bt_sequence_view_get_tile (self, ix);
+    gint tr0 = MAX (r0, ix * TILE_ROWS);
+    gint tr1 = MIN (r1, ix * TILE_ROWS + TILE_ROWS - 1);
+
+    // render missing rows, a span at a time
+    for (beg = -1, r = tr0; r <= tr1 + 1; r++) {
+      gboolean valid = (r <= tr1) &&
+          (tile->valid & (1U << (r - ix * TILE_ROWS)));
+
+      if (!valid && (r <= tr1)) {
+        if (beg == -1)
+          beg = r;
+      } else if (beg != -1) {
+        bt_sequence_view_render_rows (self, tile, ix, beg, r - 1, vr, bx, by);
+        beg = -1;
+      }
+    }
+
+    cairo_set_source_surface (c, tile->surface, bx,
+        by + ix * TILE_ROWS * rh - vr->y);
+    cairo_rectangle (c, clip.x, by + tr0 * rh - vr->y, clip.width,
+        (tr1 + 1 - tr0) * rh);
+    cairo_fill (c);
+  }
+
+  // keep tiles close to the visible area, drop the others
+  ix0 = (vr->y / rh) / TILE_ROWS;
+  ix1 = ((vr->y + vr->height) / rh) / TILE_ROWS;
+  keep = 1 + ix1 - ix0;
+  g_hash_table_iter_init (&iter, p->tiles);
+  while (g_hash_table_iter_next (&iter, &key, NULL)) {
+    ix = GPOINTER_TO_INT (key);
+    if ((ix < ix0 - keep) || (ix > ix1 + keep))
+      g_hash_table_iter_remove (&iter);
+  }
+  return TRUE;
+}
+
 static gboolean
 bt_sequence_view_draw (GtkWidget * widget, cairo_t * c)
 {
@@ -149,8 +428,19 @@ bt_sequence_view_draw (GtkWidget * widget, cairo_t * c)
   GdkRectangle vr;
   gdouble loop_pos_dash_list[] = { 4.0 };
 
-  // let the parent draw first
-  GTK_WIDGET_CLASS (bt_sequence_view_parent_class)->draw (widget, c);
+  BT_TRACE_BEGIN ("ui", "sequence-view-draw");
+
+  gtk_tree_view_get_visible_rect (GTK_TREE_VIEW (widget), &vr);
+  GST_DEBUG ("view=%p, visible rect: %d x %d, %d x %d",
+      widget, vr.x, vr.y, vr.width, vr.height);
+
+  // draw the rows from the cache or let the parent draw them
+  if (!self->priv->row_height || !self->priv->window ||
+      !bt_sequence_view_draw_rows (self, c, &vr)) {
+    cairo_save (c);
+    GTK_WIDGET_CLASS (bt_sequence_view_parent_class)->draw (widget, c);
+    cairo_restore (c);
+  }
 
   if (G_UNLIKELY (!self->priv->row_height)) {
     GtkTreePath *path;
@@ -165,14 +455,6 @@ bt_sequence_view_draw (GtkWidget * widget, cairo_t * c)
         br.y, br.width, br.height);
   }
 
-  gtk_tree_view_get_visible_rect (GTK_TREE_VIEW (widget), &vr);
-  GST_DEBUG ("view=%p, visible rect: %d x %d, %d x %d",
-      widget, vr.x, vr.y, vr.width, vr.height);
-
-  //h=(gint)(self->priv->play_pos*(double)widget->allocation.height);
-  //w=vr.width;
-  //h=(gint)(self->priv->play_pos*(double)vr.height);
-
   w = (gdouble) gtk_widget_get_allocated_width (widget);
   h = (gdouble) (self->priv->visible_rows * self->priv->row_height);
   gdouble h_song = (gdouble) (self->priv->song_end_rows * self->priv->row_height);
@@ -212,9 +494,142 @@ bt_sequence_view_draw (GtkWidget * widget, cairo_t * c)
     cairo_stroke (c);
   }
 
+  BT_TRACE_END ("ui", "sequence-view-draw");
   return FALSE;
 }
 
+static void
+bt_sequence_view_unrealize (GtkWidget * widget)
+{
+  BtSequenceView *self = BT_SEQUENCE_VIEW (widget);
+
+  // the tiles are similar to the window
+  bt_sequence_view_invalidate_all (self);
+  self->priv->window = NULL;
+
+  GTK_WIDGET_CLASS (bt_sequence_view_parent_class)->unrealize (widget);
+}
+
+static void
+bt_sequence_view_style_updated (GtkWidget * widget)
+{
+  BtSequenceView *self = BT_SEQUENCE_VIEW (widget);
+
+  bt_sequence_view_invalidate_all (self);
+  self->priv->row_height = 0;
+
+  GTK_WIDGET_CLASS (bt_sequence_view_parent_class)->style_updated (widget);
+}
+
+static void
+bt_sequence_view_state_flags_changed (GtkWidget * widget,
+    GtkStateFlags previous_state)
+{
+  bt_sequence_view_invalidate_all (BT_SEQUENCE_VIEW (widget));
+
+  GTK_WIDGET_CLASS (bt_sequence_view_parent_class)->state_flags_changed
+      (widget, previous_state);
+}
+
+static gboolean
+bt_sequence_view_focus_in_event (GtkWidget * widget, GdkEventFocus * event)
+{
+  BtSequenceView *self = BT_SEQUENCE_VIEW (widget);
+
+  // the cursor is drawn differently
+  bt_sequence_view_invalidate_rows (self, self->priv->cursor_row,
+      self->priv->cursor_row);
+
+  return GTK_WIDGET_CLASS (bt_sequence_view_parent_class)->focus_in_event
+      (widget, event);
+}
+
+static gboolean
+bt_sequence_view_focus_out_event (GtkWidget * widget, GdkEventFocus * event)
+{
+  BtSequenceView *self = BT_SEQUENCE_VIEW (widget);
+
+  bt_sequence_view_invalidate_rows (self, self->priv->cursor_row,
+      self->priv->cursor_row);
+
+  return GTK_WIDGET_CLASS (bt_sequence_view_parent_class)->focus_out_event
+      (widget, event);
+}
+
+static void
+bt_sequence_view_set_hover_row (BtSequenceView * self, gint row)
+{
+  // the tree-view highlights the row below the pointer
+  if (row != self->priv->hover_row) {
+    bt_sequence_view_invalidate_rows (self, self->priv->hover_row,
+        self->priv->hover_row);
+    bt_sequence_view_invalidate_rows (self, row, row);
+    self->priv->hover_row = row;
+  }
+}
+
+static gboolean
+bt_sequence_view_motion_notify_event (GtkWidget * widget,
+    GdkEventMotion * event)
+{
+  BtSequenceView *self = BT_SEQUENCE_VIEW (widget);
+  GtkTreePath *path = NULL;
+  gint row = -1;
+
+  if (event->window == self->priv->window &&
+      gtk_tree_view_get_path_at_pos (GTK_TREE_VIEW (widget), (gint) event->x,
+          (gint) event->y, &path, NULL, NULL, NULL)) {
+    row = get_path_row (path);
+    gtk_tree_path_free (path);
+  }
+  bt_sequence_view_set_hover_row (self, row);
+
+  return GTK_WIDGET_CLASS (bt_sequence_view_parent_class)->motion_notify_event
+      (widget, event);
+}
+
+static gboolean
+bt_sequence_view_leave_notify_event (GtkWidget * widget,
+    GdkEventCrossing * event)
+{
+  bt_sequence_view_set_hover_row (BT_SEQUENCE_VIEW (widget), -1);
+
+  return GTK_WIDGET_CLASS (bt_sequence_view_parent_class)->leave_notify_event
+      (widget, event);
+}
+
+static void
+bt_sequence_view_cursor_changed (GtkTreeView * tree_view)
+{
+  BtSequenceView *self = BT_SEQUENCE_VIEW (tree_view);
+  GtkTreePath *path;
+  gint row;
+
+  gtk_tree_view_get_cursor (tree_view, &path, NULL);
+  row = get_path_row (path);
+  if (path)
+    gtk_tree_path_free (path);
+
+  bt_sequence_view_invalidate_rows (self, self->priv->cursor_row,
+      self->priv->cursor_row);
+  bt_sequence_view_invalidate_rows (self, row, row);
+  self->priv->cursor_row = row;
+
+  if (GTK_TREE_VIEW_CLASS (bt_sequence_view_parent_class)->cursor_changed)
+    GTK_TREE_VIEW_CLASS (bt_sequence_view_parent_class)->cursor_changed
+        (tree_view);
+}
+
+static void
+bt_sequence_view_columns_changed (GtkTreeView * tree_view)
+{
+  bt_sequence_view_invalidate_all (BT_SEQUENCE_VIEW (tree_view));
+
+  if (GTK_TREE_VIEW_CLASS (bt_sequence_view_parent_class)->columns_changed)
+    GTK_TREE_VIEW_CLASS (bt_sequence_view_parent_class)->columns_changed
+        (tree_view);
+}
+
 static void
 bt_sequence_view_set_property (GObject * object, guint property_id,
     const GValue * value, GParamSpec * pspec)
@@ -277,17 +692,39 @@ bt_sequence_view_dispose (GObject * object)
   self->priv->dispose_has_run = TRUE;
 
   GST_DEBUG ("!!!! self=%p", self);
+  if (self->priv->model) {
+    g_signal_handlers_disconnect_by_data (self->priv->model, self);
+    g_object_unref (self->priv->model);
+    self->priv->model = NULL;
+  }
   g_object_unref (self->priv->app);
 
   G_OBJECT_CLASS (bt_sequence_view_parent_class)->dispose (object);
 }
 
+static void
+bt_sequence_view_finalize (GObject * object)
+{
+  BtSequenceView *self = BT_SEQUENCE_VIEW (object);
+
+  GST_DEBUG ("!!!! self=%p", self);
+  g_hash_table_destroy (self->priv->tiles);
+
+  G_OBJECT_CLASS (bt_sequence_view_parent_class)->finalize (object);
+}
+
 static void
 bt_sequence_view_init (BtSequenceView * self)
 {
   self->priv = bt_sequence_view_get_instance_private(self);
   GST_DEBUG ("!!!! self=%p", self);
   self->priv->app = bt_edit_application_new ();
+  self->priv->tiles = g_hash_table_new_full (NULL, NULL, NULL,
+      bt_sequence_view_tile_free);
+  self->priv->cursor_row = self->priv->hover_row = -1;
+
+  g_signal_connect (self, "notify::model", G_CALLBACK (on_model_notify),
+      (gpointer) self);
 }
 
 static void
@@ -295,12 +732,24 @@ bt_sequence_view_class_init (BtSequenceViewClass * klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *gtkwidget_class = GTK_WIDGET_CLASS (klass);
+  GtkTreeViewClass *gtktreeview_class = GTK_TREE_VIEW_CLASS (klass);
 
   gobject_class->set_property = bt_sequence_view_set_property;
   gobject_class->dispose = bt_sequence_view_dispose;
+  gobject_class->finalize = bt_sequence_view_finalize;
 
   gtkwidget_class->realize = bt_sequence_view_realize;
+  gtkwidget_class->unrealize = bt_sequence_view_unrealize;
   gtkwidget_class->draw = bt_sequence_view_draw;
+  gtkwidget_class->style_updated = bt_sequence_view_style_updated;
+  gtkwidget_class->state_flags_changed = bt_sequence_view_state_flags_changed;
+  gtkwidget_class->focus_in_event = bt_sequence_view_focus_in_event;
+  gtkwidget_class->focus_out_event = bt_sequence_view_focus_out_event;
+  gtkwidget_class->motion_notify_event = bt_sequence_view_motion_notify_event;
+  gtkwidget_class->leave_notify_event = bt_sequence_view_leave_notify_event;
+
+  gtktreeview_class->cursor_changed = bt_sequence_view_cursor_changed;
+  gtktreeview_class->columns_changed = bt_sequence_view_columns_changed;
 
 
   g_object_class_install_property (gobject_class, SEQUENCE_VIEW_PLAY_POSITION,
@@ -55,4 +55,6 @@ GType bt_sequence_view_get_type(void) G_GNUC_CONST;
 
 BtSequenceView *bt_sequence_view_new(void);
 
+void bt_sequence_view_refresh(const BtSequenceView *self);
+
 #endif // BT_SEQUENCE_VIEW_H
@@ -62,6 +62,7 @@ struct _BtSettingsPageAudiodevicesPrivate
   GtkComboBox *samplerate_menu;
   GtkComboBox *channels_menu;
   GtkSpinButton *latency_entry;
+  GtkSpinButton *buffer_size_entry;
 };
 
 //-- the class
@@ -234,6 +235,19 @@ on_latency_entry_changed (GtkSpinButton * spinbutton, gpointer user_data)
   bt_child_proxy_set (self->priv->app, "settings::latency", latency, NULL);
 }
 
+static void
+on_buffer_size_entry_changed (GtkSpinButton * spinbutton, gpointer user_data)
+{
+  BtSettingsPageAudiodevices *self = BT_SETTINGS_PAGE_AUDIODEVICES (user_data);
+  guint buffer_size;
+
+  buffer_size = gtk_spin_button_get_value_as_int (spinbutton);
+  GST_INFO ("buffer size changed : buffer_size=%u", buffer_size);
+
+  bt_child_proxy_set (self->priv->app, "settings::buffer-size", buffer_size,
+      NULL);
+}
+
 //-- helper methods
 
 static void
@@ -249,7 +263,7 @@ bt_settings_page_audiodevices_init_ui (const BtSettingsPageAudiodevices * self,
   gchar *audiosink_name, *system_audiosink_name, *str;
   GList *node, *audiosink_factories;
   gboolean use_system_audiosink = TRUE;
-  guint sample_rate, channels, latency;
+  guint sample_rate, channels, latency, buffer_size;
   glong audiosink_index = 0, sampling_rate_index, ct;
 
   gtk_widget_set_name (GTK_WIDGET (self), "audio device settings");
@@ -260,7 +274,8 @@ bt_settings_page_audiodevices_init_ui (const BtSettingsPageAudiodevices * self,
       "audiosink", &audiosink_name,
       "system-audiosink", &system_audiosink_name,
       "sample-rate", &sample_rate,
-      "channels", &channels, "latency", &latency, NULL);
+      "channels", &channels, "latency", &latency,
+      "buffer-size", &buffer_size, NULL);
   if (BT_IS_STRING (audiosink_name))
     use_system_audiosink = FALSE;
   settings_class = BT_SETTINGS_GET_CLASS (settings);
@@ -272,7 +287,7 @@ bt_settings_page_audiodevices_init_ui (const BtSettingsPageAudiodevices * self,
   g_free (str);
   g_object_set (label, "hexpand", TRUE, "xalign", 0.0, NULL);
   gtk_grid_attach (GTK_GRID (self), label, 0, 0, 3, 1);
-  gtk_grid_attach (GTK_GRID (self), gtk_label_new ("    "), 0, 1, 1, 5);
+  gtk_grid_attach (GTK_GRID (self), gtk_label_new ("    "), 0, 1, 1, 6);
 
   label = gtk_label_new (_("Sink"));
   g_object_set (label, "xalign", 1.0, NULL);
@@ -473,6 +488,26 @@ bt_settings_page_audiodevices_init_ui (const BtSettingsPageAudiodevices * self,
   g_signal_connect (self->priv->latency_entry, "value-changed",
       G_CALLBACK (on_latency_entry_changed), (gpointer) self);
 
+  label = gtk_label_new (_("Buffer size"));
+  g_object_set (label, "xalign", 1.0, NULL);
+  gtk_grid_attach (GTK_GRID (self), label, 1, 6, 1, 1);
+
+  // 0 renders one sub-tick per buffer
+  pspec = (GParamSpecUInt *) g_object_class_find_property ((GObjectClass *)
+      settings_class, "buffer-size");
+  spin_adjustment = gtk_adjustment_new (buffer_size, pspec->minimum,
+      pspec->maximum, 64.0, 256.0, 0.0);
+  self->priv->buffer_size_entry =
+      GTK_SPIN_BUTTON (gtk_spin_button_new (spin_adjustment, 1.0, 0));
+  gtk_widget_set_tooltip_text (GTK_WIDGET (self->priv->buffer_size_entry),
+      _("Frames per audio buffer, 0 renders one sub-tick per buffer"));
+  g_object_set (self->priv->buffer_size_entry, "hexpand", TRUE, "margin-left",
+      LABEL_PADDING, NULL);
+  gtk_grid_attach (GTK_GRID (self), GTK_WIDGET (self->priv->buffer_size_entry),
+      2, 6, 1, 1);
+  g_signal_connect (self->priv->buffer_size_entry, "value-changed",
+      G_CALLBACK (on_buffer_size_entry_changed), (gpointer) self);
+
   /* TODO(ensonic): add audiosink parameters
    * GstBaseSink: preroll-queue-len (buffers), max-lateness (ns)
    * GstBaseAudioSink: buffer-time (ms), latency-time (ms)
@@ -22,6 +22,10 @@
  * channel. The spectrum analyzer support mono and stereo display. It has a few
  * settings for logarithmic/linear mapping and precission.
  *
+ * The samples are tapped at the end of the analyzer chain and copied into a
+ * ring buffer. The spectrum is computed from the ring once per frame, using the
+ * samples that are audible at that moment.
+ *
  * Right now the analyser-section can be attached to a #BtWire and the
  * #BtSinkBin.
  *
@@ -46,6 +50,8 @@
 /* frequency spacing in a FFT is always linear:
  * - for 44100 Hz and 256 bands, spacing is 22050/256 = ~86.13
  * - log-grid should have lines at 1,2,5, 10,20,50, 100,200,500, ....
+ * therefore we compute a larger FFT and bin the results into the bands we
+ * show, either linear or logarithmic
  */
 #define BT_EDIT
 #define BT_SIGNAL_ANALYSIS_DIALOG_C
@@ -56,6 +62,7 @@
 #include "gtkvumeter.h"
 #include <glib/gprintf.h>
 #include <gst/audio/audio.h>
+#include <gst/fft/gstfftf32.h>
 
 //-- property ids
 
@@ -75,8 +82,7 @@ typedef enum
   ANALYZER_QUEUE = 0,
   // real analyzers
   ANALYZER_LEVEL,
-  ANALYZER_SPECTRUM,
-  // this can be 'mis'used for an oszilloscope by connecting to hand-off
+  // the samples for the spectrum are tapped from its sink pad
   ANALYZER_FAKESINK,
   // how many elements are used
   ANALYZER_COUNT
@@ -96,6 +102,45 @@ typedef enum
 
 #define UPDATE_INTERVAL ((GstClockTime)(0.05*GST_SECOND))
 
+/* fft size for the single precision, doubled for each step */
+#define FFT_SIZE 2048
+
+/* ring buffer for the tapped samples in frames, needs to be a power of 2 and
+ * at least twice as large as the biggest fft */
+#define TAP_RING_SIZE (1 << 15)
+#define TAP_RING_MASK (TAP_RING_SIZE - 1)
+#define TAP_MARKS 16
+
+typedef struct
+{
+  guint pos;
+  GstClockTime time;
+} BtAnalyzerTapMark;
+
+/* the samples copied from the streaming thread
+ *
+ * There is only one writer, the buffer probe. After each buffer it publishes
+ * the ring position and the running time the buffer ends at by bumping
+ * n_marks. Readers copy the newest mark and check that it has not been
+ * reused meanwhile. They only read samples from the half of the ring the
+ * writer won't touch for a while.
+ */
+typedef struct
+{
+  gint ref_count;
+
+  /* only used from the streaming thread */
+  GstAudioInfo info;
+  GstSegment segment;
+  guint pos;
+
+  /* published for the readers */
+  gint rate, channels;
+  gint n_marks;
+  BtAnalyzerTapMark marks[TAP_MARKS];
+  gfloat ring[2][TAP_RING_SIZE];
+} BtAnalyzerTap;
+
 struct _BtSignalAnalysisDialogPrivate
 {
   /* used to validate if dispose has run */
@@ -119,9 +164,21 @@ struct _BtSignalAnalysisDialogPrivate
   GstElement *analyzers[ANALYZER_COUNT];
   GList *analyzers_list;
 
+  /* the tapped samples and the fft */
+  BtAnalyzerTap *tap;
+  GstFFTF32 *fft;
+  guint fft_size;
+  gfloat *fft_in;
+  GstFFTF32Complex *fft_out;
+  /* fft bin positions of the band edges */
+  gfloat *band_pos;
+  /* ring position of the last analysis, if valid */
+  guint spect_end;
+  gboolean spect_valid;
+  guint tick_id;
+
   /* the analyzer results (max stereo) */
   gfloat *spect[2];
-  GMutex lock;
 
   guint spect_channels;
   guint spect_height;
@@ -136,7 +193,6 @@ struct _BtSignalAnalysisDialogPrivate
 
   /* up to srat=900000 */
   gdouble grid_log10[6 * 10];
-  gdouble *graph_log10;
 
   // DEBUG
   //gdouble min_rms,max_rms, min_peak,max_peak;
@@ -144,7 +200,6 @@ struct _BtSignalAnalysisDialogPrivate
 };
 
 static GQuark bus_msg_level_quark = 0;
-static GQuark bus_msg_spectrum_quark = 0;
 
 //-- the class
 
@@ -153,6 +208,110 @@ G_DEFINE_TYPE_WITH_CODE (BtSignalAnalysisDialog, bt_signal_analysis_dialog,
     G_ADD_PRIVATE(BtSignalAnalysisDialog));
 
 
+//-- analyzer tap
+
+static BtAnalyzerTap *
+bt_analyzer_tap_new (void)
+{
+  BtAnalyzerTap *tap = g_new0 (BtAnalyzerTap, 1);
+
+  tap->ref_count = 1;
+  gst_audio_info_init (&tap->info);
+  gst_segment_init (&tap->segment, GST_FORMAT_TIME);
+  return tap;
+}
+
+static BtAnalyzerTap *
+bt_analyzer_tap_ref (BtAnalyzerTap * tap)
+{
+  g_atomic_int_inc (&tap->ref_count);
+  return tap;
+}
+
+static void
+bt_analyzer_tap_unref (BtAnalyzerTap * tap)
+{
+  if (g_atomic_int_dec_and_test (&tap->ref_count)) {
+    g_free (tap);
+  }
+}
+
+#define TAP_COPY(type,scale) G_STMT_START { \
+  const type *d = ((const type *) map.data) + skip * channels; \
+  for (i = skip; i < frames; i++, pos++, d += channels) { \
+    for (c = 0; c < n; c++) \
+      tap->ring[c][pos & TAP_RING_MASK] = d[c] * (scale); \
+  } \
+} G_STMT_END
+
+static void
+bt_analyzer_tap_push (BtAnalyzerTap * tap, GstBuffer * buffer)
+{
+  GstAudioInfo *info = &tap->info;
+  GstClockTime ts = GST_BUFFER_PTS (buffer);
+  GstMapInfo map;
+  BtAnalyzerTapMark *mark;
+  guint bpf = GST_AUDIO_INFO_BPF (info);
+  guint channels = GST_AUDIO_INFO_CHANNELS (info);
+  guint n = MIN (channels, 2);
+  guint c, i, frames, skip, pos = tap->pos;
+  gint m;
+
+  if (!bpf || !gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return;
+
+  frames = map.size / bpf;
+  // only the tail of a huge buffer fits into the ring
+  skip = (frames > TAP_RING_SIZE) ? frames - TAP_RING_SIZE : 0;
+  switch (GST_AUDIO_INFO_FORMAT (info)) {
+    case GST_AUDIO_FORMAT_F32:
+      TAP_COPY (gfloat, 1.0f);
+      break;
+    case GST_AUDIO_FORMAT_F64:
+      TAP_COPY (gdouble, 1.0);
+      break;
+    case GST_AUDIO_FORMAT_S16:
+      TAP_COPY (gint16, 1.0f / 32768.0f);
+      break;
+    case GST_AUDIO_FORMAT_S32:
+      TAP_COPY (gint32, 1.0 / 2147483648.0);
+      break;
+    default:
+      GST_WARNING ("unsupported sample format: %s",
+          GST_AUDIO_INFO_NAME (info));
+      gst_buffer_unmap (buffer, &map);
+      return;
+  }
+  gst_buffer_unmap (buffer, &map);
+  tap->pos = pos;
+
+  if (GST_CLOCK_TIME_IS_VALID (ts)) {
+    ts += gst_util_uint64_scale_int (frames, GST_SECOND,
+        GST_AUDIO_INFO_RATE (info));
+    ts = gst_segment_to_running_time (&tap->segment, GST_FORMAT_TIME, ts);
+  }
+  m = g_atomic_int_get (&tap->n_marks);
+  mark = &tap->marks[(guint) m % TAP_MARKS];
+  mark->pos = pos;
+  mark->time = ts;
+  g_atomic_int_set (&tap->n_marks, (m + 1) & G_MAXINT);
+}
+
+/* copy the newest mark, returns %FALSE if nothing has been tapped so far */
+static gboolean
+bt_analyzer_tap_get_mark (BtAnalyzerTap * tap, BtAnalyzerTapMark * mark)
+{
+  gint m1, m2;
+
+  do {
+    if (!(m1 = g_atomic_int_get (&tap->n_marks)))
+      return FALSE;
+    *mark = tap->marks[((guint) m1 - 1) % TAP_MARKS];
+    m2 = g_atomic_int_get (&tap->n_marks);
+  } while (((m2 - m1) & G_MAXINT) >= TAP_MARKS - 1);
+  return TRUE;
+}
+
 //-- event handler helper
 
 static gboolean
@@ -163,42 +322,151 @@ update_spectrum_ruler (gpointer user_data)
   return FALSE;
 }
 
+/* calculate the range of fft bins for each band, the bands are spaced like the
+ * grid lines */
 static void
-update_spectrum_graph_log10 (BtSignalAnalysisDialog * self)
+update_spectrum_bands (BtSignalAnalysisDialog * self)
 {
-  guint i, spect_bands = self->priv->spect_bands * self->priv->frq_precision;
-  gdouble *graph_log10 = self->priv->graph_log10;
-  gdouble srat2 = self->priv->srate / 2.0;
-
-  for (i = 0; i < spect_bands; i++) {
-    graph_log10[i] = log10 (1.0 + (i * srat2) / spect_bands);
+  BtSignalAnalysisDialogPrivate *p = self->priv;
+  guint i, spect_bands = p->spect_bands * p->frq_precision;
+  gdouble srat2 = p->srate / 2.0;
+  gdouble bins_per_hz = p->fft_size / (gdouble) p->srate;
+  gdouble l = log10 (srat2), f;
+
+  for (i = 0; i <= spect_bands; i++) {
+    if (p->frq_map == MAP_LIN) {
+      f = (i * srat2) / spect_bands;
+    } else {
+      f = pow (10.0, (i * l) / spect_bands) - 1.0;
+    }
+    p->band_pos[i] = f * bins_per_hz;
   }
+  p->spect_valid = FALSE;
 }
 
 static void
 update_spectrum_analyzer (BtSignalAnalysisDialog * self)
 {
-  guint spect_bands;
+  BtSignalAnalysisDialogPrivate *p = self->priv;
+  guint spect_bands = p->spect_bands * p->frq_precision;
+  guint fft_size = FFT_SIZE << (p->frq_precision - 1);
+
+  g_free (p->spect[0]);
+  p->spect[0] = g_new0 (gfloat, spect_bands);
+  g_free (p->spect[1]);
+  p->spect[1] = g_new0 (gfloat, spect_bands);
+
+  g_free (p->band_pos);
+  p->band_pos = g_new (gfloat, spect_bands + 1);
+
+  if (fft_size != p->fft_size) {
+    if (p->fft)
+      gst_fft_f32_free (p->fft);
+    g_free (p->fft_in);
+    g_free (p->fft_out);
+    p->fft_size = fft_size;
+    p->fft = gst_fft_f32_new (fft_size, FALSE);
+    p->fft_in = g_new (gfloat, fft_size);
+    p->fft_out = g_new (GstFFTF32Complex, fft_size / 2 + 1);
+  }
+  update_spectrum_bands (self);
+}
 
-  g_mutex_lock (&self->priv->lock);
+/* reduce the fft power values to the bands we show and scale them to pixels */
+static void
+update_spectrum_channel (BtSignalAnalysisDialog * self, const gfloat * power,
+    gfloat * spect)
+{
+  BtSignalAnalysisDialogPrivate *p = self->priv;
+  guint i, k, kend, spect_bands = p->spect_bands * p->frq_precision;
+  guint bins = p->fft_size / 2 + 1;
+  gfloat spect_height = p->spect_height, height_scale = p->height_scale;
+  gfloat norm = 1.0f / ((gfloat) p->fft_size * (gfloat) p->fft_size);
+  gfloat lo, hi, v, t, db;
+  const gfloat *band_pos = p->band_pos;
 
-  spect_bands = self->priv->spect_bands * self->priv->frq_precision;
+  for (i = 0; i < spect_bands; i++) {
+    lo = band_pos[i];
+    hi = band_pos[i + 1];
+    k = (guint) ceilf (lo);
+    kend = MIN ((guint) ceilf (hi), bins);
+    if (k < kend) {
+      // show the peak of the bins in this band
+      for (v = power[k++]; k < kend; k++) {
+        v = MAX (v, power[k]);
+      }
+    } else {
+      // band is narrower than a bin, interpolate at the center
+      t = (lo + hi) / 2.0f;
+      k = MIN ((guint) t, bins - 2);
+      t = MIN (t - k, 1.0f);
+      v = power[k] + t * (power[k + 1] - power[k]);
+    }
+    v *= norm;
+    db = (v > 0.0f) ? 10.0f * log10f (v) : SPECTRUM_FLOOR;
+    if (db < SPECTRUM_FLOOR)
+      db = SPECTRUM_FLOOR;
+    spect[i] = spect_height - height_scale * db;
+  }
+}
 
-  g_free (self->priv->spect[0]);
-  self->priv->spect[0] = g_new0 (gfloat, spect_bands);
-  g_free (self->priv->spect[1]);
-  self->priv->spect[1] = g_new0 (gfloat, spect_bands);
+/* analyse the tapped samples that are audible right now */
+static void
+update_spectrum (BtSignalAnalysisDialog * self)
+{
+  BtSignalAnalysisDialogPrivate *p = self->priv;
+  BtAnalyzerTap *tap = p->tap;
+  BtAnalyzerTapMark mark;
+  guint c, i, n = p->fft_size, bins = n / 2 + 1;
+  guint channels, end, back, pos;
+  gint rate = g_atomic_int_get (&tap->rate);
+
+  if (rate && rate != p->srate) {
+    p->srate = rate;
+    update_spectrum_bands (self);
+    update_spectrum_ruler (self);
+  }
+  if (!bt_analyzer_tap_get_mark (tap, &mark))
+    return;
+
+  /* the tap runs ahead of the audio by the latency of the sink, step back by
+   * the time it takes until the end of the tapped data will be played */
+  end = mark.pos;
+  if (GST_CLOCK_TIME_IS_VALID (mark.time) && p->clock) {
+    GstClockTime now = gst_clock_get_time (p->clock) -
+        gst_element_get_base_time (p->analyzers[ANALYZER_FAKESINK]);
+
+    if (mark.time > now) {
+      back = (guint) MIN (gst_util_uint64_scale_int (mark.time - now,
+              p->srate, GST_SECOND), TAP_RING_SIZE / 2 - n);
+      end -= back;
+    }
+  }
+  if (p->spect_valid && end == p->spect_end)
+    return;
 
-  g_free (self->priv->graph_log10);
-  self->priv->graph_log10 = g_new (gdouble, spect_bands);
-  update_spectrum_graph_log10 (self);
+  channels = g_atomic_int_get (&tap->channels);
+  for (c = 0; c < channels; c++) {
+    const gfloat *ring = tap->ring[c];
+    gfloat *power = p->fft_in;
 
-  if (self->priv->analyzers[ANALYZER_SPECTRUM]) {
-    g_object_set ((GObject *) (self->priv->analyzers[ANALYZER_SPECTRUM]),
-        "bands", spect_bands, NULL);
+    pos = end - n;
+    for (i = 0; i < n; i++) {
+      p->fft_in[i] = ring[(pos + i) & TAP_RING_MASK];
+    }
+    gst_fft_f32_window (p->fft, p->fft_in, GST_FFT_WINDOW_HAMMING);
+    gst_fft_f32_fft (p->fft, p->fft_in, p->fft_out);
+    // the input is not needed anymore, reuse it for the power values
+    for (i = 0; i < bins; i++) {
+      gfloat re = p->fft_out[i].r, im = p->fft_out[i].i;
+      power[i] = re * re + im * im;
+    }
+    update_spectrum_channel (self, power, p->spect[c]);
   }
-
-  g_mutex_unlock (&self->priv->lock);
+  p->spect_channels = channels;
+  p->spect_end = end;
+  p->spect_valid = TRUE;
+  gtk_widget_queue_draw (p->spectrum_drawingarea);
 }
 
 static void
@@ -270,7 +538,6 @@ on_spectrum_draw (GtkWidget * widget, cairo_t * cr, gpointer user_data)
   guint spect_bands = self->priv->spect_bands;
   guint spect_height = self->priv->spect_height;
   gdouble *grid_log10 = self->priv->grid_log10;
-  gdouble *graph_log10 = self->priv->graph_log10;
   gdouble grid_dash_pattern[] = { 1.0 };
   gdouble prec = self->priv->frq_precision;
   GtkStyleContext *style = gtk_widget_get_style_context (widget);
@@ -310,8 +577,7 @@ on_spectrum_draw (GtkWidget * widget, cairo_t * cr, gpointer user_data)
     }
   }
   cairo_stroke (cr);
-  // draw frequencies
-  g_mutex_lock (&self->priv->lock);
+  // draw frequencies, the bands are already spaced like the grid
   for (c = 0; c < self->priv->spect_channels; c++) {
     if (self->priv->spect[c]) {
       gfloat *spect = self->priv->spect[c];
@@ -321,19 +587,8 @@ on_spectrum_draw (GtkWidget * widget, cairo_t * cr, gpointer user_data)
       cairo_set_line_width (cr, 1.0);
       cairo_set_dash (cr, NULL, 0, 0.0);
       cairo_move_to (cr, 0, spect_height);
-      if (self->priv->frq_map == MAP_LIN) {
-        for (i = 0; i < (spect_bands * prec); i++) {
-          cairo_line_to (cr, (i / prec), spect_height - spect[i]);
-        }
-      } else {
-        srat2 = self->priv->srate / 2.0;
-        v = spect_bands / log10 (srat2);
-        for (i = 0; i < (spect_bands * prec); i++) {
-          // db value
-          //y=-20.0*log10(-spect[i]);
-          x = 0.5 + v * graph_log10[i];
-          cairo_line_to (cr, x, spect_height - spect[i]);
-        }
+      for (i = 0; i < (spect_bands * prec); i++) {
+        cairo_line_to (cr, (i / prec), spect_height - spect[i]);
       }
       // close the path
       cairo_line_to (cr, (gdouble) spect_bands - 0.5,
@@ -344,7 +599,6 @@ on_spectrum_draw (GtkWidget * widget, cairo_t * cr, gpointer user_data)
       cairo_fill (cr);
     }
   }
-  g_mutex_unlock (&self->priv->lock);
 
   // draw cross-hair for mouse
   // TODO(ensonic): cache GdkDevice*
@@ -656,101 +910,50 @@ on_level_axis_draw (GtkWidget * widget, cairo_t * cr, gpointer user_data)
 #define g_value_array_get_ix(va,ix) (va->values + ix)
 
 static gboolean
-on_delayed_idle_signal_analyser_change (gpointer user_data)
+on_delayed_idle_level_change (gpointer user_data)
 {
   gconstpointer *const params = (gconstpointer *) user_data;
   BtSignalAnalysisDialog *self = BT_SIGNAL_ANALYSIS_DIALOG (params[0]);
   GstMessage *message = (GstMessage *) params[1];
   const GstStructure *structure = gst_message_get_structure (message);
-  const GQuark name_id = gst_structure_get_name_id (structure);
+  const GValue *values;
+  GValueArray *peak_arr, *decay_arr;
+  guint i;
+  gdouble peak, decay;
 
   if (!self)
     goto done;
 
   g_object_remove_weak_pointer ((gpointer) self, (gpointer *) & params[0]);
 
-  if (name_id == bus_msg_level_quark) {
-    const GValue *values;
-    GValueArray *peak_arr, *decay_arr;
-    guint i;
-    gdouble peak, decay;
-
-    //GST_INFO("get level data");
-    values = (GValue *) gst_structure_get_value (structure, "peak");
-    peak_arr = (GValueArray *) g_value_get_boxed (values);
-    values = (GValue *) gst_structure_get_value (structure, "decay");
-    decay_arr = (GValueArray *) g_value_get_boxed (values);
-    // size of list is number of channels
-    switch (decay_arr->n_values) {
-      case 1:                  // mono
-        peak = g_value_get_double (g_value_array_get_ix (peak_arr, 0));
+  values = (GValue *) gst_structure_get_value (structure, "peak");
+  peak_arr = (GValueArray *) g_value_get_boxed (values);
+  values = (GValue *) gst_structure_get_value (structure, "decay");
+  decay_arr = (GValueArray *) g_value_get_boxed (values);
+  // size of list is number of channels
+  switch (decay_arr->n_values) {
+    case 1:                    // mono
+      peak = g_value_get_double (g_value_array_get_ix (peak_arr, 0));
+      if (isinf (peak) || isnan (peak))
+        peak = LOW_VUMETER_VAL;
+      decay = g_value_get_double (g_value_array_get_ix (decay_arr, 0));
+      if (isinf (decay) || isnan (decay))
+        decay = LOW_VUMETER_VAL;
+      for (i = 0; i < 2; i++) {
+        gtk_vumeter_set_levels (self->priv->vumeter[i], peak, decay);
+      }
+      break;
+    case 2:                    // stereo
+      for (i = 0; i < 2; i++) {
+        peak = g_value_get_double (g_value_array_get_ix (peak_arr, i));
         if (isinf (peak) || isnan (peak))
           peak = LOW_VUMETER_VAL;
-        decay = g_value_get_double (g_value_array_get_ix (decay_arr, 0));
+        decay = g_value_get_double (g_value_array_get_ix (decay_arr, i));
         if (isinf (decay) || isnan (decay))
           decay = LOW_VUMETER_VAL;
-        for (i = 0; i < 2; i++) {
-          gtk_vumeter_set_levels (self->priv->vumeter[i], peak, decay);
-        }
-        break;
-      case 2:                  // stereo
-        for (i = 0; i < 2; i++) {
-          peak = g_value_get_double (g_value_array_get_ix (peak_arr, i));
-          if (isinf (peak) || isnan (peak))
-            peak = LOW_VUMETER_VAL;
-          decay = g_value_get_double (g_value_array_get_ix (decay_arr, i));
-          if (isinf (decay) || isnan (decay))
-            decay = LOW_VUMETER_VAL;
-          gtk_vumeter_set_levels (self->priv->vumeter[i], peak, decay);
-        }
-        break;
-    }
-  } else if (name_id == bus_msg_spectrum_quark) {
-    const GValue *data;
-    const GValue *value;
-    guint i, size, spect_bands, spect_height = self->priv->spect_height;
-    gfloat height_scale = self->priv->height_scale;
-    gfloat *spect;
-
-    g_mutex_lock (&self->priv->lock);
-    spect_bands = self->priv->spect_bands * self->priv->frq_precision;
-    //GST_INFO("get spectrum data");
-    if ((data = gst_structure_get_value (structure, "magnitude"))) {
-      if (GST_VALUE_HOLDS_ARRAY (data)) {
-        const GValue *cdata;
-        guint c = gst_value_array_get_size (data);
-
-        self->priv->spect_channels = MIN (2, c);
-        for (c = 0; c < self->priv->spect_channels; c++) {
-          cdata = gst_value_array_get_value (data, c);
-          size = gst_value_array_get_size (cdata);
-          if (size != spect_bands)
-            break;
-          spect = self->priv->spect[c];
-          for (i = 0; i < spect_bands; i++) {
-            value = gst_value_array_get_value (cdata, i);
-            spect[i] = spect_height - height_scale * g_value_get_float (value);
-          }
-        }
-        if (c == self->priv->spect_channels) {
-          gtk_widget_queue_draw (self->priv->spectrum_drawingarea);
-          GST_INFO ("trigger spectrum update");
-        }
-      } else if (GST_VALUE_HOLDS_LIST (data)) {
-        // only in the multi-channel=FALSE case
-        size = gst_value_list_get_size (data);
-        if (size == spect_bands) {
-          spect = self->priv->spect[0];
-          for (i = 0; i < spect_bands; i++) {
-            value = gst_value_list_get_value (data, i);
-            spect[i] = spect_height - height_scale * g_value_get_float (value);
-          }
-          gtk_widget_queue_draw (self->priv->spectrum_drawingarea);
-          GST_INFO ("trigger spectrum update");
-        }
+        gtk_vumeter_set_levels (self->priv->vumeter[i], peak, decay);
       }
-    }
-    g_mutex_unlock (&self->priv->lock);
+      break;
   }
 
 done:
@@ -760,39 +963,36 @@ done:
 }
 
 static gboolean
-on_delayed_signal_analyser_change (GstClock * clock, GstClockTime time,
+on_delayed_level_change (GstClock * clock, GstClockTime time,
     GstClockID id, gpointer user_data)
 {
   // the callback is called from a clock thread
   if (GST_CLOCK_TIME_IS_VALID (time))
-    g_idle_add_full (G_PRIORITY_HIGH, on_delayed_idle_signal_analyser_change,
+    g_idle_add_full (G_PRIORITY_HIGH, on_delayed_idle_level_change,
         user_data, NULL);
   else {
     gconstpointer *const params = (gconstpointer *) user_data;
     GstMessage *message = (GstMessage *) params[1];
-    gst_message_unref (message);
-    g_slice_free1 (2 * sizeof (gpointer), user_data);
     GST_WARNING_OBJECT (GST_MESSAGE_SRC (message),
         "dropped analyzer update due to invalid ts");
+    gst_message_unref (message);
+    g_slice_free1 (2 * sizeof (gpointer), user_data);
   }
   return TRUE;
 }
 
 static void
-on_signal_analyser_change (GstBus * bus, GstMessage * message,
-    gpointer user_data)
+on_level_change (GstBus * bus, GstMessage * message, gpointer user_data)
 {
   const GstStructure *s = gst_message_get_structure (message);
   const GQuark name_id = gst_structure_get_name_id (s);
 
-  if ((name_id == bus_msg_level_quark) || (name_id == bus_msg_spectrum_quark)) {
+  if (name_id == bus_msg_level_quark) {
     BtSignalAnalysisDialog *self = BT_SIGNAL_ANALYSIS_DIALOG (user_data);
     GstElement *meter = GST_ELEMENT (GST_MESSAGE_SRC (message));
 
-    if ((meter == self->priv->analyzers[ANALYZER_LEVEL]) ||
-        (meter == self->priv->analyzers[ANALYZER_SPECTRUM])) {
-      GstClockTime waittime = bt_gst_analyzer_get_waittime (meter, s,
-          (name_id == bus_msg_level_quark));
+    if (meter == self->priv->analyzers[ANALYZER_LEVEL]) {
+      GstClockTime waittime = bt_gst_analyzer_get_waittime (meter, s, TRUE);
 
       if (GST_CLOCK_TIME_IS_VALID (waittime)) {
         gpointer *data = (gpointer *) g_slice_alloc (2 * sizeof (gpointer));
@@ -800,15 +1000,6 @@ on_signal_analyser_change (GstBus * bus, GstMessage * message,
         GstClockReturn clk_ret;
         GstClockTime basetime = gst_element_get_base_time (meter);
 
-        /* debug
-           gint64 playtime;
-           gst_element_query_position (meter, GST_FORMAT_TIME, &playtime);
-           GST_LOG_OBJECT (meter, "update for wait + basetime %" GST_TIME_FORMAT
-           " + %" GST_TIME_FORMAT " at %" GST_TIME_FORMAT,
-           GST_TIME_ARGS (waittime), GST_TIME_ARGS (basetime),
-           GST_TIME_ARGS (playtime));
-           debug */
-
         data[0] = (gpointer) self;
         data[1] = (gpointer) gst_message_ref (message);
         g_object_add_weak_pointer ((gpointer) self, (gpointer *) & data[0]);
@@ -817,11 +1008,13 @@ on_signal_analyser_change (GstBus * bus, GstMessage * message,
             gst_clock_new_single_shot_id (self->priv->clock,
             waittime + basetime);
         if ((clk_ret = gst_clock_id_wait_async (clock_id,
-                    on_delayed_signal_analyser_change,
-                    (gpointer) data, NULL)) != GST_CLOCK_OK) {
+                    on_delayed_level_change, (gpointer) data,
+                    NULL)) != GST_CLOCK_OK) {
           GST_WARNING_OBJECT (meter, "clock wait failed: %d", clk_ret);
+          g_object_remove_weak_pointer ((gpointer) self,
+              (gpointer *) & data[0]);
           gst_message_unref (message);
-          g_slice_free1 (2 * sizeof (gconstpointer), data);
+          g_slice_free1 (2 * sizeof (gpointer), data);
         }
         gst_clock_id_unref (clock_id);
       }
@@ -829,6 +1022,57 @@ on_signal_analyser_change (GstBus * bus, GstMessage * message,
   }
 }
 
+static GstPadProbeReturn
+on_tap_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  BtAnalyzerTap *tap = (BtAnalyzerTap *) user_data;
+
+  // this is called from the streaming thread
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+    bt_analyzer_tap_push (tap, GST_PAD_PROBE_INFO_BUFFER (info));
+  } else if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+    GstCaps *caps;
+
+    switch (GST_EVENT_TYPE (event)) {
+      case GST_EVENT_CAPS:
+        gst_event_parse_caps (event, &caps);
+        if (gst_audio_info_from_caps (&tap->info, caps)) {
+          g_atomic_int_set (&tap->rate, GST_AUDIO_INFO_RATE (&tap->info));
+          g_atomic_int_set (&tap->channels,
+              MIN (GST_AUDIO_INFO_CHANNELS (&tap->info), 2));
+        } else {
+          GST_WARNING_OBJECT (pad, "unexpected caps: %" GST_PTR_FORMAT, caps);
+          gst_audio_info_init (&tap->info);
+        }
+        break;
+      case GST_EVENT_SEGMENT:
+        gst_event_copy_segment (event, &tap->segment);
+        break;
+      default:
+        break;
+    }
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+#if GTK_CHECK_VERSION (3,8,0)
+static gboolean
+on_spectrum_tick (GtkWidget * widget, GdkFrameClock * frame_clock,
+    gpointer user_data)
+{
+  update_spectrum (BT_SIGNAL_ANALYSIS_DIALOG (user_data));
+  return G_SOURCE_CONTINUE;
+}
+#else
+static gboolean
+on_spectrum_tick (gpointer user_data)
+{
+  update_spectrum (BT_SIGNAL_ANALYSIS_DIALOG (user_data));
+  return G_SOURCE_CONTINUE;
+}
+#endif
+
 static void
 on_size_allocate (GtkWidget * widget, GtkAllocation * allocation,
     gpointer user_data)
@@ -867,36 +1111,13 @@ on_size_allocate (GtkWidget * widget, GtkAllocation * allocation,
   gtk_widget_queue_draw (self->priv->spectrum_drawingarea);
 }
 
-static void
-on_caps_negotiated (GstPad * pad, GParamSpec * arg, gpointer user_data)
-{
-  BtSignalAnalysisDialog *self = BT_SIGNAL_ANALYSIS_DIALOG (user_data);
-  GstCaps *caps;
-
-  if ((caps = (GstCaps *) gst_pad_get_current_caps (pad))) {
-    if (GST_CAPS_IS_SIMPLE (caps)) {
-      gint old_srate = self->priv->srate;
-      gst_structure_get_int (gst_caps_get_structure (caps, 0), "rate",
-          &self->priv->srate);
-      if (self->priv->srate != old_srate) {
-        update_spectrum_graph_log10 (self);
-        // need to call this via g_idle_add as it triggers the redraw
-        bt_g_object_idle_add ((GObject *) self, G_PRIORITY_DEFAULT_IDLE,
-            update_spectrum_ruler);
-      }
-    } else {
-      GST_WARNING_OBJECT (pad, "expecting simple caps");
-    }
-    gst_caps_unref (caps);
-  }
-}
-
 static void
 on_spectrum_frequency_mapping_changed (GtkComboBox * combo, gpointer user_data)
 {
   BtSignalAnalysisDialog *self = BT_SIGNAL_ANALYSIS_DIALOG (user_data);
 
   self->priv->frq_map = gtk_combo_box_get_active (combo);
+  update_spectrum_bands (self);
   update_spectrum_ruler (self);
   gtk_widget_queue_draw (self->priv->spectrum_drawingarea);
 }
@@ -1104,21 +1325,14 @@ bt_signal_analysis_dialog_init_ui (const BtSignalAnalysisDialog * self)
   g_object_set (p->analyzers[ANALYZER_FAKESINK],
       "sync", FALSE, "qos", FALSE, "silent", TRUE, "async", FALSE,
       "enable-last-sample", FALSE, NULL);
-  // create spectrum analyzer
-  if (!bt_signal_analysis_dialog_make_element (self, ANALYZER_SPECTRUM,
-          "spectrum")) {
-    res = FALSE;
-    goto Error;
-  }
-  g_object_set (p->analyzers[ANALYZER_SPECTRUM], "interval",
-      UPDATE_INTERVAL, "post-messages", TRUE, "bands",
-      p->spect_bands * p->frq_precision, "threshold",
-      SPECTRUM_FLOOR, "multi-channel", TRUE, NULL);
+  // tap the samples for the spectrum analyzer
   if ((pad =
-          gst_element_get_static_pad (p->analyzers[ANALYZER_SPECTRUM],
+          gst_element_get_static_pad (p->analyzers[ANALYZER_FAKESINK],
               "sink"))) {
-    g_signal_connect_object (pad, "notify::caps",
-        G_CALLBACK (on_caps_negotiated), (gpointer) self, 0);
+    gst_pad_add_probe (pad,
+        GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+        on_tap_probe, bt_analyzer_tap_ref (p->tap),
+        (GDestroyNotify) bt_analyzer_tap_unref);
     gst_object_unref (pad);
   }
   // create level meter
@@ -1153,10 +1367,19 @@ bt_signal_analysis_dialog_init_ui (const BtSignalAnalysisDialog * self)
   g_object_get (song, "bin", &bin, NULL);
   p->bus = gst_element_get_bus (GST_ELEMENT (bin));
   g_signal_connect_object (p->bus, "sync-message::element",
-      G_CALLBACK (on_signal_analyser_change), (gpointer) self, 0);
+      G_CALLBACK (on_level_change), (gpointer) self, 0);
   p->clock = gst_pipeline_get_clock (GST_PIPELINE (bin));
   gst_object_unref (bin);
 
+  // analyse the tapped samples once per frame
+#if GTK_CHECK_VERSION (3,8,0)
+  p->tick_id = gtk_widget_add_tick_callback (p->spectrum_drawingarea,
+      on_spectrum_tick, (gpointer) self, NULL);
+#else
+  p->tick_id = g_timeout_add_full (G_PRIORITY_HIGH, 1000 / 60,
+      on_spectrum_tick, (gpointer) self, NULL);
+#endif
+
   // allocate visual ressources after the window has been realized
   g_signal_connect ((gpointer) self, "realize", G_CALLBACK (on_dialog_realize),
       (gpointer) self);
@@ -1237,6 +1460,14 @@ bt_signal_analysis_dialog_dispose (GObject * object)
      GST_DEBUG("levels: peak=%7.4lf .. %7.4lf",self->priv->min_peak,self->priv->max_peak);
      // DEBUG */
 
+  if (self->priv->tick_id) {
+#if GTK_CHECK_VERSION (3,8,0)
+    gtk_widget_remove_tick_callback (self->priv->spectrum_drawingarea,
+        self->priv->tick_id);
+#else
+    g_source_remove (self->priv->tick_id);
+#endif
+  }
   if (self->priv->clock)
     gst_object_unref (self->priv->clock);
 
@@ -1278,9 +1509,13 @@ bt_signal_analysis_dialog_finalize (GObject * object)
 
   g_free (self->priv->spect[0]);
   g_free (self->priv->spect[1]);
-  g_free (self->priv->graph_log10);
+  g_free (self->priv->band_pos);
+  if (self->priv->fft)
+    gst_fft_f32_free (self->priv->fft);
+  g_free (self->priv->fft_in);
+  g_free (self->priv->fft_out);
+  bt_analyzer_tap_unref (self->priv->tap);
   g_list_free (self->priv->analyzers_list);
-  g_mutex_clear (&self->priv->lock);
 
   GST_DEBUG ("!!!! done");
 
@@ -1297,8 +1532,7 @@ bt_signal_analysis_dialog_init (BtSignalAnalysisDialog * self)
   self->priv = bt_signal_analysis_dialog_get_instance_private(self);
   GST_DEBUG ("!!!! self=%p", self);
   self->priv->app = bt_edit_application_new ();
-
-  g_mutex_init (&self->priv->lock);
+  self->priv->tap = bt_analyzer_tap_new ();
 
   self->priv->spect_height = 64;
   self->priv->spect_bands = 256;
@@ -1306,11 +1540,10 @@ bt_signal_analysis_dialog_init (BtSignalAnalysisDialog * self)
 
   self->priv->frq_map = MAP_LIN;
   self->priv->frq_precision = 1;
+  self->priv->srate = GST_AUDIO_DEF_RATE;
 
   update_spectrum_analyzer (self);
 
-  self->priv->srate = GST_AUDIO_DEF_RATE;
-
   /* precalc some log10 values */
   grid_log10 = self->priv->grid_log10;
   i = 0;
@@ -1333,7 +1566,6 @@ bt_signal_analysis_dialog_class_init (BtSignalAnalysisDialogClass * klass)
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
   bus_msg_level_quark = g_quark_from_static_string ("level");
-  bus_msg_spectrum_quark = g_quark_from_static_string ("spectrum");
 
   gobject_class->set_property = bt_signal_analysis_dialog_set_property;
   gobject_class->dispose = bt_signal_analysis_dialog_dispose;
@@ -20,6 +20,11 @@
  *
  * This class serves as a central storage for colors and icons.
  * It is implemented as a singleton.
+ *
+ * The graphics for the machine view are rendered once per zoom level and
+ * uploaded as shared #ClutterContent. All canvas items of the same kind and
+ * state use the same image. The last few zoom levels are kept, so that zooming
+ * back and forth does not render the svg icons again.
  */
 
 #define BT_EDIT
@@ -27,6 +32,19 @@
 
 #include "bt-edit.h"
 
+/* how many zoom levels we keep the machine graphics for */
+#define MAX_GRAPHICS_LEVELS 4
+
+/* the machine view graphics for one zoom level */
+typedef struct
+{
+  gint zoom_key;
+  ClutterContent *source_machine_images[BT_MACHINE_STATE_COUNT];
+  ClutterContent *processor_machine_images[BT_MACHINE_STATE_COUNT];
+  ClutterContent *sink_machine_images[BT_MACHINE_STATE_COUNT];
+  ClutterContent *wire_images[2];
+} BtUIResourcesGraphics;
+
 struct _BtUIResourcesPrivate
 {
   /* used to validate if dispose has run */
@@ -40,12 +58,8 @@ struct _BtUIResourcesPrivate
   /* the keyboard shortcut table for the window */
   GtkAccelGroup *accel_group;
 
-  /* machine graphics */
-  gdouble zoom;
-  GdkPixbuf *source_machine_pixbufs[BT_MACHINE_STATE_COUNT];
-  GdkPixbuf *processor_machine_pixbufs[BT_MACHINE_STATE_COUNT];
-  GdkPixbuf *sink_machine_pixbufs[BT_MACHINE_STATE_COUNT];
-  GdkPixbuf *wire_pixbuf[2];
+  /* machine graphics, the most recently used zoom level first */
+  GQueue graphics;
 
   /* css provider */
   GtkStyleProvider *provider;
@@ -145,59 +159,105 @@ bt_ui_resources_init_icons (void)
   GST_INFO ("images created");
 }
 
+static ClutterContent *
+bt_ui_resources_make_image (const gchar * name, gint size)
+{
+  ClutterContent *image = clutter_image_new ();
+  GdkPixbuf *pixbuf;
+
+  if (!(pixbuf = gdk_pixbuf_new_from_theme (name, size)))
+    return image;
+
+  clutter_image_set_data (CLUTTER_IMAGE (image),
+      gdk_pixbuf_get_pixels (pixbuf), gdk_pixbuf_get_has_alpha (pixbuf)
+      ? COGL_PIXEL_FORMAT_RGBA_8888
+      : COGL_PIXEL_FORMAT_RGB_888,
+      gdk_pixbuf_get_width (pixbuf),
+      gdk_pixbuf_get_height (pixbuf), gdk_pixbuf_get_rowstride (pixbuf), NULL);
+  g_object_unref (pixbuf);
+  return image;
+}
+
 static void
-bt_ui_resources_free_graphics (BtUIResources * self)
+bt_ui_resources_free_graphics (BtUIResourcesGraphics * gfx)
 {
   guint state;
 
   for (state = 0; state < BT_MACHINE_STATE_COUNT; state++) {
-    g_object_try_unref (self->priv->source_machine_pixbufs[state]);
-    g_object_try_unref (self->priv->processor_machine_pixbufs[state]);
-    g_object_try_unref (self->priv->sink_machine_pixbufs[state]);
+    g_object_try_unref (gfx->source_machine_images[state]);
+    g_object_try_unref (gfx->processor_machine_images[state]);
+    g_object_try_unref (gfx->sink_machine_images[state]);
   }
-  g_object_try_unref (self->priv->wire_pixbuf[0]);
-  g_object_try_unref (self->priv->wire_pixbuf[1]);
+  g_object_try_unref (gfx->wire_images[0]);
+  g_object_try_unref (gfx->wire_images[1]);
+  g_slice_free (BtUIResourcesGraphics, gfx);
 }
 
-static void
-bt_ui_resources_init_graphics (BtUIResources * self)
+static BtUIResourcesGraphics *
+bt_ui_resources_init_graphics (gint zoom_key)
 {
+  BtUIResourcesGraphics *gfx = g_slice_new0 (BtUIResourcesGraphics);
   // 12*6=72, 14*6=84
   const gint size =
-      (gint) (self->priv->zoom * (gdouble) (GTK_ICON_SIZE_DIALOG * 14));
-  //const gint size=(gint)(self->priv->zoom*(gdouble)(6*14));
+      (gint) ((zoom_key / 1000.0) * (gdouble) (GTK_ICON_SIZE_DIALOG * 14));
+  //const gint size=(gint)(zoom*(gdouble)(6*14));
 
   GST_INFO ("regenerating machine graphics at %d pixels", size);
 
-  self->priv->source_machine_pixbufs[BT_MACHINE_STATE_NORMAL] =
-      gdk_pixbuf_new_from_theme ("buzztrax_generator", size);
-  self->priv->source_machine_pixbufs[BT_MACHINE_STATE_MUTE] =
-      gdk_pixbuf_new_from_theme ("buzztrax_generator_mute", size);
-  self->priv->source_machine_pixbufs[BT_MACHINE_STATE_SOLO] =
-      gdk_pixbuf_new_from_theme ("buzztrax_generator_solo", size);
-
-  self->priv->processor_machine_pixbufs[BT_MACHINE_STATE_NORMAL] =
-      gdk_pixbuf_new_from_theme ("buzztrax_effect", size);
-  self->priv->processor_machine_pixbufs[BT_MACHINE_STATE_MUTE] =
-      gdk_pixbuf_new_from_theme ("buzztrax_effect_mute", size);
-  self->priv->processor_machine_pixbufs[BT_MACHINE_STATE_BYPASS] =
-      gdk_pixbuf_new_from_theme ("buzztrax_effect_bypass", size);
-
-  self->priv->sink_machine_pixbufs[BT_MACHINE_STATE_NORMAL] =
-      gdk_pixbuf_new_from_theme ("buzztrax_master", size);
-  self->priv->sink_machine_pixbufs[BT_MACHINE_STATE_MUTE] =
-      gdk_pixbuf_new_from_theme ("buzztrax_master_mute", size);
-
-  self->priv->wire_pixbuf[0] =
-      gdk_pixbuf_new_from_theme ("buzztrax_wire", size * 2.0);
-  self->priv->wire_pixbuf[1] =
-      gdk_pixbuf_new_from_theme ("buzztrax_wire_nopan", size * 2.0);
-
-  /* DEBUG
-     gint w,h;
-     g_object_get(self->priv->source_machine_pixbufs[BT_MACHINE_STATE_NORMAL],"width",&w,"height",&h,NULL);
-     GST_DEBUG("svg: w,h = %d, %d",w,h);
-   */
+  gfx->zoom_key = zoom_key;
+  gfx->source_machine_images[BT_MACHINE_STATE_NORMAL] =
+      bt_ui_resources_make_image ("buzztrax_generator", size);
+  gfx->source_machine_images[BT_MACHINE_STATE_MUTE] =
+      bt_ui_resources_make_image ("buzztrax_generator_mute", size);
+  gfx->source_machine_images[BT_MACHINE_STATE_SOLO] =
+      bt_ui_resources_make_image ("buzztrax_generator_solo", size);
+
+  gfx->processor_machine_images[BT_MACHINE_STATE_NORMAL] =
+      bt_ui_resources_make_image ("buzztrax_effect", size);
+  gfx->processor_machine_images[BT_MACHINE_STATE_MUTE] =
+      bt_ui_resources_make_image ("buzztrax_effect_mute", size);
+  gfx->processor_machine_images[BT_MACHINE_STATE_BYPASS] =
+      bt_ui_resources_make_image ("buzztrax_effect_bypass", size);
+
+  gfx->sink_machine_images[BT_MACHINE_STATE_NORMAL] =
+      bt_ui_resources_make_image ("buzztrax_master", size);
+  gfx->sink_machine_images[BT_MACHINE_STATE_MUTE] =
+      bt_ui_resources_make_image ("buzztrax_master_mute", size);
+
+  gfx->wire_images[0] =
+      bt_ui_resources_make_image ("buzztrax_wire", size * 2.0);
+  gfx->wire_images[1] =
+      bt_ui_resources_make_image ("buzztrax_wire_nopan", size * 2.0);
+  return gfx;
+}
+
+/* get the graphics for the zoom level, render them if needed */
+static BtUIResourcesGraphics *
+bt_ui_resources_get_graphics (gdouble zoom)
+{
+  GQueue *graphics = &singleton->priv->graphics;
+  BtUIResourcesGraphics *gfx;
+  const gint zoom_key = (gint) (zoom * 1000.0 + 0.5);
+  GList *node;
+
+  for (node = graphics->head; node; node = g_list_next (node)) {
+    gfx = (BtUIResourcesGraphics *) node->data;
+    if (gfx->zoom_key == zoom_key) {
+      if (node != graphics->head) {
+        g_queue_unlink (graphics, node);
+        g_queue_push_head_link (graphics, node);
+      }
+      return gfx;
+    }
+  }
+
+  GST_DEBUG ("add zoom level %f", zoom);
+  gfx = bt_ui_resources_init_graphics (zoom_key);
+  g_queue_push_head (graphics, gfx);
+  if (g_queue_get_length (graphics) > MAX_GRAPHICS_LEVELS) {
+    bt_ui_resources_free_graphics (g_queue_pop_tail (graphics));
+  }
+  return gfx;
 }
 
 //-- constructor methods
@@ -239,36 +299,30 @@ bt_ui_resources_get_icon_pixbuf_by_machine (const BtMachine * machine)
 }
 
 /**
- * bt_ui_resources_get_machine_graphics_pixbuf_by_machine:
+ * bt_ui_resources_get_machine_graphics_by_machine:
  * @machine: the machine to get the image for
  * @zoom: scaling factor for the icons
  *
- * Gets a #GdkPixbuf image that matches the given machine type for use on the
- * canvas.
+ * Gets an image that matches the given machine type and state for use on the
+ * canvas. The image is shared by all machines of the same type and state.
  *
- * Returns: a #GdkPixbuf image
+ * Returns: (transfer full): a #ClutterContent image
  */
-GdkPixbuf *
-bt_ui_resources_get_machine_graphics_pixbuf_by_machine (const BtMachine *
-    machine, gdouble zoom)
+ClutterContent *
+bt_ui_resources_get_machine_graphics_by_machine (const BtMachine * machine,
+    gdouble zoom)
 {
+  BtUIResourcesGraphics *gfx = bt_ui_resources_get_graphics (zoom);
   BtMachineState state;
 
-  if (zoom != singleton->priv->zoom) {
-    GST_DEBUG ("change zoom %f -> %f", singleton->priv->zoom, zoom);
-    bt_ui_resources_free_graphics (singleton);
-    singleton->priv->zoom = zoom;
-    bt_ui_resources_init_graphics (singleton);
-  }
-
   g_object_get ((gpointer) machine, "state", &state, NULL);
 
   if (BT_IS_SOURCE_MACHINE (machine)) {
-    return g_object_ref (singleton->priv->source_machine_pixbufs[state]);
+    return g_object_ref (gfx->source_machine_images[state]);
   } else if (BT_IS_PROCESSOR_MACHINE (machine)) {
-    return g_object_ref (singleton->priv->processor_machine_pixbufs[state]);
+    return g_object_ref (gfx->processor_machine_images[state]);
   } else if (BT_IS_SINK_MACHINE (machine)) {
-    return g_object_ref (singleton->priv->sink_machine_pixbufs[state]);
+    return g_object_ref (gfx->sink_machine_images[state]);
   }
   return NULL;
 }
@@ -318,18 +372,19 @@ bt_ui_resources_get_icon_image_by_machine_type (GType machine_type)
 }
 
 /**
- * bt_ui_resources_get_wire_graphics_pixbuf_by_wire:
+ * bt_ui_resources_get_wire_graphics_by_wire:
  * @wire: the wire to get the image for
  * @zoom: scaling factor for the icons
  *
- * Gets a #GdkPixbuf image for use on the canvas.
+ * Gets an image for the wire pad for use on the canvas. The image is shared by
+ * all wires of the same kind.
  *
- * Returns: a #GdkPixbuf image
+ * Returns: (transfer full): a #ClutterContent image
  */
-GdkPixbuf *
-bt_ui_resources_get_wire_graphics_pixbuf_by_wire (const BtWire * wire,
-    gdouble zoom)
+ClutterContent *
+bt_ui_resources_get_wire_graphics_by_wire (const BtWire * wire, gdouble zoom)
 {
+  BtUIResourcesGraphics *gfx = bt_ui_resources_get_graphics (zoom);
   GstElement *wire_pan;
   guint state = 0;
 
@@ -339,17 +394,7 @@ bt_ui_resources_get_wire_graphics_pixbuf_by_wire (const BtWire * wire,
   } else {
     state = 1;
   }
-
-  /*
-     if (zoom != singleton->priv->zoom) {
-     GST_DEBUG ("change zoom %f -> %f", singleton->priv->zoom, zoom);
-     bt_ui_resources_free_graphics (singleton);
-     singleton->priv->zoom = zoom;
-     bt_ui_resources_init_graphics (singleton);
-     }
-   */
-
-  return g_object_ref (singleton->priv->wire_pixbuf[state]);
+  return g_object_ref (gfx->wire_images[state]);
 }
 
 /**
@@ -387,7 +432,9 @@ bt_ui_resources_dispose (GObject * object)
   g_object_try_unref (self->priv->processor_machine_pixbuf);
   g_object_try_unref (self->priv->sink_machine_pixbuf);
 
-  bt_ui_resources_free_graphics (self);
+  while (!g_queue_is_empty (&self->priv->graphics)) {
+    bt_ui_resources_free_graphics (g_queue_pop_head (&self->priv->graphics));
+  }
 
   g_object_try_unref (self->priv->accel_group);
 
@@ -439,6 +486,7 @@ static void
 bt_ui_resources_init (BtUIResources * self)
 {
   self->priv = bt_ui_resources_get_instance_private(self);
+  g_queue_init (&self->priv->graphics);
 }
 
 static void
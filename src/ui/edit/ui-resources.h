@@ -73,11 +73,11 @@ GType bt_ui_resources_get_type(void) G_GNUC_CONST;
 BtUIResources *bt_ui_resources_new(void);
 
 GdkPixbuf *bt_ui_resources_get_icon_pixbuf_by_machine(const BtMachine *machine);
-GdkPixbuf *bt_ui_resources_get_machine_graphics_pixbuf_by_machine(const BtMachine *machine, gdouble zoom);
+ClutterContent *bt_ui_resources_get_machine_graphics_by_machine(const BtMachine *machine, gdouble zoom);
 GtkWidget *bt_ui_resources_get_icon_image_by_machine(const BtMachine *machine);
 GtkWidget *bt_ui_resources_get_icon_image_by_machine_type(GType machine_type);
 
-GdkPixbuf *bt_ui_resources_get_wire_graphics_pixbuf_by_wire(const BtWire *wire, gdouble zoom);
+ClutterContent *bt_ui_resources_get_wire_graphics_by_wire(const BtWire *wire, gdouble zoom);
 
 GtkAccelGroup *bt_ui_resources_get_accel_group(void);
 
@@ -44,6 +44,8 @@ struct _BtWaveListModelPrivate
 
   GType param_types[N_COLUMNS];
   GPtrArray *seq;
+  /* the resident size the views have been told about per row */
+  guint64 resident_size[N_ROWS];
 };
 
 //-- the class
@@ -74,6 +76,7 @@ bt_wave_list_model_add (BtWaveListModel * model, BtWave * wave)
   iter.stamp = model->priv->stamp;
   iter.user_data = GINT_TO_POINTER (pos);
   g_ptr_array_index (model->priv->seq, pos) = wave;
+  bt_wave_get_memory_usage (wave, &model->priv->resident_size[pos], NULL);
 
   // signal to the view/app
   path = gtk_tree_path_new ();
@@ -98,6 +101,7 @@ bt_wave_list_model_rem (BtWaveListModel * model, BtWave * wave)
   iter.stamp = model->priv->stamp;
   iter.user_data = GINT_TO_POINTER (pos);
   g_ptr_array_index (model->priv->seq, pos) = NULL;
+  model->priv->resident_size[pos] = 0;
 
   // signal to the view/app
   path = gtk_tree_path_new ();
@@ -125,6 +129,36 @@ on_wave_removed (BtWavetable * wavetable, BtWave * wave, gpointer user_data)
   bt_wave_list_model_rem (model, wave);
 }
 
+static void
+on_wavetable_resident_size_changed (BtWavetable * wavetable, GParamSpec * arg,
+    gpointer user_data)
+{
+  BtWaveListModel *model = BT_WAVE_LIST_MODEL (user_data);
+  GtkTreePath *path;
+  GtkTreeIter iter;
+  BtWave *wave;
+  guint64 resident;
+  gint pos;
+
+  // the memory usage of the waves has changed, update the size columns of
+  // the waves that it changed for
+  iter.stamp = model->priv->stamp;
+  for (pos = 0; pos < N_ROWS; pos++) {
+    if (!(wave = g_ptr_array_index (model->priv->seq, pos)))
+      continue;
+    bt_wave_get_memory_usage (wave, &resident, NULL);
+    if (resident == model->priv->resident_size[pos])
+      continue;
+    model->priv->resident_size[pos] = resident;
+
+    iter.user_data = GINT_TO_POINTER (pos);
+    path = gtk_tree_path_new ();
+    gtk_tree_path_append_index (path, pos);
+    gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+    gtk_tree_path_free (path);
+  }
+}
+
 //-- constructor methods
 
 /**
@@ -154,13 +188,21 @@ bt_wave_list_model_new (BtWavetable * wavetable)
   self->priv->param_types[BT_WAVE_LIST_MODEL_HEX_ID] = G_TYPE_STRING;
   self->priv->param_types[BT_WAVE_LIST_MODEL_NAME] = G_TYPE_STRING;
   self->priv->param_types[BT_WAVE_LIST_MODEL_HAS_WAVE] = G_TYPE_BOOLEAN;
+  self->priv->param_types[BT_WAVE_LIST_MODEL_RESIDENT_SIZE] = G_TYPE_STRING;
+  self->priv->param_types[BT_WAVE_LIST_MODEL_DISK_SIZE] = G_TYPE_STRING;
 
   // get wave list from wavetable
   g_object_get ((gpointer) wavetable, "waves", &list, NULL);
-  // add waves
+  // add waves, nobody is watching the model yet, thus we don't need to
+  // signal the rows
   for (node = list; node; node = g_list_next (node)) {
+    gulong pos;
+
     wave = BT_WAVE (node->data);
-    bt_wave_list_model_add (self, wave);
+    g_object_get (wave, "index", &pos, NULL);
+    pos--;
+    g_ptr_array_index (self->priv->seq, pos) = wave;
+    bt_wave_get_memory_usage (wave, &self->priv->resident_size[pos], NULL);
   }
   g_list_free (list);
 
@@ -168,6 +210,8 @@ bt_wave_list_model_new (BtWavetable * wavetable)
       (gpointer) self, 0);
   g_signal_connect_object (wavetable, "wave-removed",
       G_CALLBACK (on_wave_removed), (gpointer) self, 0);
+  g_signal_connect_object (wavetable, "notify::resident-size",
+      G_CALLBACK (on_wavetable_resident_size_changed), (gpointer) self, 0);
 
   return self;
 }
@@ -285,6 +329,16 @@ bt_wave_list_model_tree_model_get_value (GtkTreeModel * tree_model,
     case BT_WAVE_LIST_MODEL_HAS_WAVE:
       g_value_set_boolean (value, (wave != NULL));
       break;
+    case BT_WAVE_LIST_MODEL_RESIDENT_SIZE:
+    case BT_WAVE_LIST_MODEL_DISK_SIZE:
+      if (wave) {
+        guint64 resident, on_disk;
+
+        bt_wave_get_memory_usage (wave, &resident, &on_disk);
+        g_value_take_string (value, g_format_size (column ==
+                BT_WAVE_LIST_MODEL_RESIDENT_SIZE ? resident : on_disk));
+      }
+      break;
   }
 }
 
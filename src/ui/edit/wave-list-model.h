@@ -55,6 +55,8 @@ enum {
   BT_WAVE_LIST_MODEL_HEX_ID,
   BT_WAVE_LIST_MODEL_NAME,
   BT_WAVE_LIST_MODEL_HAS_WAVE,
+  BT_WAVE_LIST_MODEL_RESIDENT_SIZE,
+  BT_WAVE_LIST_MODEL_DISK_SIZE,
   __BT_WAVE_LIST_MODEL_N_COLUMNS
 };
 
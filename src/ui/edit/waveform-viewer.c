@@ -20,7 +20,15 @@
  * @see_also: #BtWave, #BtMainPageWaves
  *
  * Provides an viewer for audio waveforms. It can handle multi-channel
- * waveforms, show loop-markers and a playback cursor.
+ * waveforms, show loop-markers and a playback cursor. The mouse wheel zooms
+ * in and out around the pointer, with shift held down it scrolls.
+ *
+ * The widget draws from a pyramid of min/max peaks. The finest level has one
+ * entry per 64 frames, each further level combines 4 entries. Each column
+ * is drawn from the level that has less than a column's worth of frames per
+ * entry, so drawing takes the same time at every zoom level. The pyramid is
+ * built in a worker thread and kept with the owner of the wave data, so that
+ * showing the same wave again is instant.
  */
 /* TODO(ensonic): add selection support
  * - export the selection as two properties
@@ -28,6 +36,9 @@
 
 #include <string.h>
 #include "waveform-viewer.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 enum
 {
@@ -41,12 +52,292 @@ enum
 #define MIN_W 24
 #define MIN_H 16
 
-#define DEF_PEAK_SIZE 1000
+/* frames per entry on the finest level of the peak pyramid */
+#define PEAK_BLOCK 64
+/* entries of a level that are combined into one of the next level */
+#define PEAK_FACTOR 4
+#define PEAK_MAX_LEVELS 16
+/* waves with fewer samples get their peaks right away */
+#define PEAK_SYNC_SIZE (1 << 16)
+/* the number of frames shown when zoomed in all the way */
+#define MIN_VIEW 16
+
+struct _BtWaveformPeaks
+{
+  volatile gint ref_count;
+
+  /* the wave the peaks belong to */
+  const gint16 *data;
+  gint channels;
+  gint64 length;
+
+  /* min/max pairs per entry and channel, frames per entry and entries */
+  guint n_levels;
+  gint16 *peaks[PEAK_MAX_LEVELS];
+  gint64 block[PEAK_MAX_LEVELS];
+  gint64 size[PEAK_MAX_LEVELS];
+};
+
+static GQuark peaks_quark = 0;
 
 //-- the class
 
 G_DEFINE_TYPE (BtWaveformViewer, bt_waveform_viewer, GTK_TYPE_WIDGET);
 
+//-- peak pyramid
+
+static BtWaveformPeaks *
+bt_waveform_peaks_new (const gint16 * data, gint channels, gint64 length)
+{
+  BtWaveformPeaks *peaks = g_slice_new0 (BtWaveformPeaks);
+  gint64 block = PEAK_BLOCK, size = (length + PEAK_BLOCK - 1) / PEAK_BLOCK;
+
+  peaks->ref_count = 1;
+  peaks->data = data;
+  peaks->channels = channels;
+  peaks->length = length;
+  do {
+    peaks->block[peaks->n_levels] = block;
+    peaks->size[peaks->n_levels] = size;
+    peaks->peaks[peaks->n_levels] = g_new (gint16, size * channels * 2);
+    peaks->n_levels++;
+    block *= PEAK_FACTOR;
+    size = (size + PEAK_FACTOR - 1) / PEAK_FACTOR;
+  } while (peaks->size[peaks->n_levels - 1] > 1 &&
+      peaks->n_levels < PEAK_MAX_LEVELS);
+  return peaks;
+}
+
+static BtWaveformPeaks *
+bt_waveform_peaks_ref (BtWaveformPeaks * peaks)
+{
+  g_atomic_int_inc (&peaks->ref_count);
+  return peaks;
+}
+
+static void
+bt_waveform_peaks_unref (BtWaveformPeaks * peaks)
+{
+  guint i;
+
+  if (!g_atomic_int_dec_and_test (&peaks->ref_count))
+    return;
+  for (i = 0; i < peaks->n_levels; i++) {
+    g_free (peaks->peaks[i]);
+  }
+  g_slice_free (BtWaveformPeaks, peaks);
+}
+
+/* get min/max for each channel of interleaved frames, the result is stored as
+ * min/max pairs */
+static void
+scan_frames (const gint16 * data, gint channels, gint frames, gint16 * out)
+{
+  gint c, i, n = frames * channels;
+
+#ifdef __SSE2__
+  /* if the channels divide the vector size, each lane always sees the same
+   * channel */
+  if (n >= 8 && !(8 % channels)) {
+    __m128i vmin, vmax;
+    gint16 lmin[8], lmax[8];
+
+    vmin = vmax = _mm_loadu_si128 ((const __m128i *) data);
+    for (i = 8; i + 8 <= n; i += 8) {
+      __m128i v = _mm_loadu_si128 ((const __m128i *) (data + i));
+      vmin = _mm_min_epi16 (vmin, v);
+      vmax = _mm_max_epi16 (vmax, v);
+    }
+    _mm_storeu_si128 ((__m128i *) lmin, vmin);
+    _mm_storeu_si128 ((__m128i *) lmax, vmax);
+    for (c = 0; c < channels; c++) {
+      out[c * 2] = lmin[c];
+      out[c * 2 + 1] = lmax[c];
+    }
+    for (c = channels; c < 8; c++) {
+      gint16 *o = &out[(c % channels) * 2];
+      o[0] = MIN (o[0], lmin[c]);
+      o[1] = MAX (o[1], lmax[c]);
+    }
+    for (; i < n; i++) {
+      gint16 *o = &out[(i % channels) * 2];
+      o[0] = MIN (o[0], data[i]);
+      o[1] = MAX (o[1], data[i]);
+    }
+    return;
+  }
+#endif
+  for (c = 0; c < channels; c++) {
+    out[c * 2] = out[c * 2 + 1] = data[c];
+  }
+  for (i = channels; i < n; i++) {
+    gint16 *o = &out[(i % channels) * 2];
+    o[0] = MIN (o[0], data[i]);
+    o[1] = MAX (o[1], data[i]);
+  }
+}
+
+/* fill the pyramid, returns FALSE if it got cancelled */
+static gboolean
+bt_waveform_peaks_build (BtWaveformPeaks * peaks, GCancellable * cancellable)
+{
+  const gint cc = peaks->channels;
+  gint64 i, j, n;
+  guint l;
+  gint c;
+
+  n = peaks->size[0];
+  for (i = 0; i < n; i++) {
+    gint64 p = i * PEAK_BLOCK;
+
+    scan_frames (&peaks->data[p * cc], cc, MIN (PEAK_BLOCK, peaks->length - p),
+        &peaks->peaks[0][i * cc * 2]);
+    if (!(i & 0xfff) && g_cancellable_is_cancelled (cancellable))
+      return FALSE;
+  }
+  for (l = 1; l < peaks->n_levels; l++) {
+    const gint16 *src = peaks->peaks[l - 1];
+    gint16 *dst = peaks->peaks[l];
+    gint64 src_n = peaks->size[l - 1];
+
+    n = peaks->size[l];
+    for (i = 0; i < n; i++) {
+      gint64 e = i * PEAK_FACTOR;
+      gint64 e_end = MIN (e + PEAK_FACTOR, src_n);
+
+      for (c = 0; c < cc; c++) {
+        gint16 vmin = src[(e * cc + c) * 2];
+        gint16 vmax = src[(e * cc + c) * 2 + 1];
+
+        for (j = e + 1; j < e_end; j++) {
+          vmin = MIN (vmin, src[(j * cc + c) * 2]);
+          vmax = MAX (vmax, src[(j * cc + c) * 2 + 1]);
+        }
+        dst[(i * cc + c) * 2] = vmin;
+        dst[(i * cc + c) * 2 + 1] = vmax;
+      }
+    }
+    if (g_cancellable_is_cancelled (cancellable))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* get min/max of one channel for the frames in [f0,f1) */
+static void
+bt_waveform_peaks_get_range (BtWaveformPeaks * peaks, gint ch, gint64 f0,
+    gint64 f1, gint * vmin, gint * vmax)
+{
+  const gint cc = peaks->channels;
+  gint16 lo, hi;
+  gint64 i, e0, e1;
+  guint l = 0;
+
+  f1 = MIN (f1, peaks->length);
+  f0 = MIN (f0, f1 - 1);
+  if (f1 - f0 < PEAK_BLOCK) {
+    // fewer frames than an entry of the finest level, use the samples
+    lo = hi = peaks->data[f0 * cc + ch];
+    for (i = f0 + 1; i < f1; i++) {
+      lo = MIN (lo, peaks->data[i * cc + ch]);
+      hi = MAX (hi, peaks->data[i * cc + ch]);
+    }
+  } else {
+    // use the coarsest level that still has an entry per column
+    while (l + 1 < peaks->n_levels && peaks->block[l + 1] <= f1 - f0)
+      l++;
+    e0 = f0 / peaks->block[l];
+    e1 = MIN ((f1 + peaks->block[l] - 1) / peaks->block[l], peaks->size[l]);
+    lo = peaks->peaks[l][(e0 * cc + ch) * 2];
+    hi = peaks->peaks[l][(e0 * cc + ch) * 2 + 1];
+    for (i = e0 + 1; i < e1; i++) {
+      lo = MIN (lo, peaks->peaks[l][(i * cc + ch) * 2]);
+      hi = MAX (hi, peaks->peaks[l][(i * cc + ch) * 2 + 1]);
+    }
+  }
+  *vmin = lo;
+  *vmax = hi;
+}
+
+static void
+bt_waveform_peaks_thread (GTask * task, gpointer source_object,
+    gpointer task_data, GCancellable * cancellable)
+{
+  BtWaveformPeaks *peaks = (BtWaveformPeaks *) task_data;
+
+  if (bt_waveform_peaks_build (peaks, cancellable)) {
+    g_task_return_pointer (task, bt_waveform_peaks_ref (peaks),
+        (GDestroyNotify) bt_waveform_peaks_unref);
+  } else {
+    g_task_return_error_if_cancelled (task);
+  }
+}
+
+static void
+on_peaks_ready (GObject * object, GAsyncResult * result, gpointer user_data)
+{
+  BtWaveformViewer *self = BT_WAVEFORM_VIEWER (object);
+  GObject *owner = G_OBJECT (user_data);
+  BtWaveformPeaks *peaks;
+
+  if ((peaks = g_task_propagate_pointer (G_TASK (result), NULL))) {
+    // keep the peaks with the wave data
+    g_object_set_qdata_full (owner, peaks_quark,
+        bt_waveform_peaks_ref (peaks),
+        (GDestroyNotify) bt_waveform_peaks_unref);
+    if (owner == self->owner && peaks->data == self->data && !self->peaks) {
+      self->peaks = peaks;
+      gtk_widget_queue_draw (GTK_WIDGET (self));
+    } else {
+      bt_waveform_peaks_unref (peaks);
+    }
+  }
+  g_object_unref (owner);
+}
+
+//-- helper methods
+
+static gint
+get_view_width (BtWaveformViewer * self)
+{
+  return gtk_widget_get_allocated_width (GTK_WIDGET (self)) -
+      (self->border.left + self->border.right);
+}
+
+static gdouble
+pos_to_x (BtWaveformViewer * self, gint64 pos)
+{
+  return self->border.left + (pos - self->view_start) *
+      (gdouble) get_view_width (self) / (self->view_end - self->view_start);
+}
+
+static gint64
+x_to_pos (BtWaveformViewer * self, gdouble x)
+{
+  gint64 pos = self->view_start + (x - self->border.left) *
+      (gdouble) (self->view_end - self->view_start) / get_view_width (self);
+
+  return CLAMP (pos, 0, self->wave_length);
+}
+
+static void
+cancel_peaks (BtWaveformViewer * self)
+{
+  if (self->peaks_cancellable) {
+    g_cancellable_cancel (self->peaks_cancellable);
+    g_object_unref (self->peaks_cancellable);
+    self->peaks_cancellable = NULL;
+  }
+  if (self->peaks) {
+    bt_waveform_peaks_unref (self->peaks);
+    self->peaks = NULL;
+  }
+  if (self->owner) {
+    g_object_unref (self->owner);
+    self->owner = NULL;
+  }
+}
+
 
 static void
 bt_waveform_viewer_realize (GtkWidget * widget)
@@ -77,7 +368,7 @@ bt_waveform_viewer_realize (GtkWidget * widget)
       GDK_BUTTON_RELEASE_MASK |
       GDK_BUTTON_MOTION_MASK |
       GDK_ENTER_NOTIFY_MASK |
-      GDK_LEAVE_NOTIFY_MASK |
+      GDK_LEAVE_NOTIFY_MASK | GDK_SCROLL_MASK |
       GDK_POINTER_MOTION_MASK | GDK_POINTER_MOTION_HINT_MASK);
   attributes_mask = GDK_WA_X | GDK_WA_Y;
 
@@ -130,9 +421,10 @@ bt_waveform_viewer_draw (GtkWidget * widget, cairo_t * cr)
   BtWaveformViewer *self = BT_WAVEFORM_VIEWER (widget);
   GtkStyleContext *style_ctx;
   gint width, height, left, top;
-  gint i, ch, x;
-  gdouble xscl;
-  gfloat *peaks = self->peaks;
+  gint ch, x, vmin, vmax;
+  gdouble *ymin, *ymax;
+  gdouble view_len;
+  BtWaveformPeaks *peaks = self->peaks;
   GdkRGBA wave_color, peak_color, line_color;
 
   width = gtk_widget_get_allocated_width (widget);
@@ -150,45 +442,54 @@ bt_waveform_viewer_draw (GtkWidget * widget, cairo_t * cr)
   top = self->border.top;
   width -= self->border.left + self->border.right;
   height -= self->border.top + self->border.bottom;
+  if (width <= 0 || height <= 0)
+    return FALSE;
 
   cairo_set_line_join (cr, CAIRO_LINE_JOIN_ROUND);
   cairo_set_line_width (cr, 1.0);
 
-  // waveform
+  // waveform, outline the max values left to right and the min values back
   gtk_style_context_lookup_color (style_ctx, "wave_color", &wave_color);
   gtk_style_context_lookup_color (style_ctx, "peak_color", &peak_color);
+  view_len = self->view_end - self->view_start;
+  ymin = g_new (gdouble, width);
+  ymax = g_new (gdouble, width);
   for (ch = 0; ch < self->channels; ch++) {
     gint lsy = height / self->channels;
     gint loy = top + ch * lsy;
-    for (i = 0; i < 4 * width; i++) {
-      gint imirror = i < 2 * width ? i : 4 * width - 1 - i;
-      // peaks has all channel-data interleaved in one buffer
-      gint ix =
-          (imirror * self->peaks_size / (2 * width)) * self->channels + ch;
-      gint sign = i < 2 * width ? +1 : -1;
-      gdouble y = (loy + lsy / 2 - (lsy / 2 - 1) * sign * peaks[ix]);
-      if (y < loy)
-        y = loy;
-      if (y >= loy + lsy)
-        y = loy + lsy - 1;
-      if (i)
-        cairo_line_to (cr, left + imirror * 0.5, y);
-      else
-        cairo_move_to (cr, left, y);
+    gdouble mid = loy + lsy / 2, scl = (lsy / 2 - 1) / 32768.0;
+
+    for (x = 0; x < width; x++) {
+      gint64 f0 = self->view_start + (gint64) (x * view_len / width);
+      gint64 f1 = self->view_start + (gint64) ((x + 1) * view_len / width);
+
+      bt_waveform_peaks_get_range (peaks, ch, f0, MAX (f1, f0 + 1), &vmin,
+          &vmax);
+      // always include the zero line to get a closed shape
+      ymax[x] = CLAMP (mid - MAX (vmax, 0) * scl, loy, loy + lsy - 1);
+      ymin[x] = CLAMP (mid - MIN (vmin, 0) * scl, loy, loy + lsy - 1);
+    }
+    cairo_move_to (cr, left, ymax[0]);
+    for (x = 1; x < width; x++) {
+      cairo_line_to (cr, left + x, ymax[x]);
     }
+    for (x = width - 1; x >= 0; x--) {
+      cairo_line_to (cr, left + x, ymin[x]);
+    }
+    cairo_close_path (cr);
 
     gdk_cairo_set_source_rgba (cr, &wave_color);
     cairo_fill_preserve (cr);
     gdk_cairo_set_source_rgba (cr, &peak_color);
     cairo_stroke (cr);
   }
+  g_free (ymin);
+  g_free (ymax);
 
-  // casting to double loses precision, but we're not planning to deal with multiterabyte waveforms here :)
-  xscl = (gdouble) width / self->wave_length;
   if (self->loop_start != -1) {
     gtk_style_context_lookup_color (style_ctx, "loopline_color", &line_color);
     gdk_cairo_set_source_rgba (cr, &line_color);
-    x = (gint) (left + self->loop_start * xscl);
+    x = (gint) pos_to_x (self, self->loop_start);
     cairo_move_to (cr, x, top + height);
     cairo_line_to (cr, x, top);
     cairo_stroke (cr);
@@ -198,7 +499,7 @@ bt_waveform_viewer_draw (GtkWidget * widget, cairo_t * cr)
     cairo_line_to (cr, x, top);
     cairo_fill (cr);
 
-    x = (gint) (left + self->loop_end * xscl) - 1;
+    x = (gint) pos_to_x (self, self->loop_end) - 1;
     cairo_move_to (cr, x, top + height);
     cairo_line_to (cr, x, top);
     cairo_stroke (cr);
@@ -211,7 +512,7 @@ bt_waveform_viewer_draw (GtkWidget * widget, cairo_t * cr)
   if (self->playback_cursor != -1) {
     gtk_style_context_lookup_color (style_ctx, "playline_color", &line_color);
     gdk_cairo_set_source_rgba (cr, &line_color);
-    x = (gint) (left + self->playback_cursor * xscl) - 1;
+    x = (gint) pos_to_x (self, self->playback_cursor) - 1;
     cairo_move_to (cr, x, top + height);
     cairo_line_to (cr, x, top);
     cairo_stroke (cr);
@@ -270,20 +571,20 @@ static gboolean
 bt_waveform_viewer_button_press (GtkWidget * widget, GdkEventButton * event)
 {
   BtWaveformViewer *self = BT_WAVEFORM_VIEWER (widget);
-  const gint ox = 1, oy = 1;
-  const gint sx = gtk_widget_get_allocated_width (widget) - 2;
 
-  if (event->y < oy + MARKER_BOX_H) {
+  if (!self->wave_length)
+    return FALSE;
+
+  if (event->y < self->border.top + MARKER_BOX_H) {
     // check if we're over a loop-knob 
     if (self->loop_start != -1) {
-      gint x =
-          (gint) (ox + self->loop_start * (gdouble) sx / self->wave_length);
+      gint x = (gint) pos_to_x (self, self->loop_start);
       if ((event->x >= x - MARKER_BOX_W) && (event->x <= x + MARKER_BOX_W)) {
         self->edit_loop_start = TRUE;
       }
     }
     if (self->loop_end != -1) {
-      gint x = (gint) (ox + self->loop_end * (gdouble) sx / self->wave_length);
+      gint x = (gint) pos_to_x (self, self->loop_end);
       if ((event->x >= x - MARKER_BOX_W) && (event->x <= x + MARKER_BOX_W)) {
         self->edit_loop_end = TRUE;
       }
@@ -308,11 +609,11 @@ static gboolean
 bt_waveform_viewer_motion_notify (GtkWidget * widget, GdkEventMotion * event)
 {
   BtWaveformViewer *self = BT_WAVEFORM_VIEWER (widget);
-  const gint ox = 1;
-  const gint sx = gtk_widget_get_allocated_width (widget) - 2;
-  gint64 pos = (event->x - ox) * (gdouble) self->wave_length / sx;
+  gint64 pos;
 
-  pos = CLAMP (pos, 0, self->wave_length);
+  if (!self->wave_length)
+    return FALSE;
+  pos = x_to_pos (self, event->x);
 
   // if we're in loop or selection mode, map event->x to sample pos
   // clip loop/selection boundaries
@@ -340,12 +641,65 @@ bt_waveform_viewer_motion_notify (GtkWidget * widget, GdkEventMotion * event)
   return FALSE;
 }
 
+static gboolean
+bt_waveform_viewer_scroll (GtkWidget * widget, GdkEventScroll * event)
+{
+  BtWaveformViewer *self = BT_WAVEFORM_VIEWER (widget);
+  gint64 len, new_len, pos, start;
+  gdouble x = event->x;
+  GdkScrollDirection direction = event->direction;
+
+  if (!self->wave_length)
+    return FALSE;
+
+  len = self->view_end - self->view_start;
+  if (event->state & GDK_SHIFT_MASK) {
+    if (direction == GDK_SCROLL_UP)
+      direction = GDK_SCROLL_LEFT;
+    else if (direction == GDK_SCROLL_DOWN)
+      direction = GDK_SCROLL_RIGHT;
+  }
+  switch (direction) {
+    case GDK_SCROLL_UP:
+      new_len = MAX (len / 2, MIN (MIN_VIEW, self->wave_length));
+      break;
+    case GDK_SCROLL_DOWN:
+      new_len = MIN (len * 2, self->wave_length);
+      break;
+    case GDK_SCROLL_LEFT:
+      new_len = len;
+      x = self->border.left - get_view_width (self) / 8.0;
+      break;
+    case GDK_SCROLL_RIGHT:
+      new_len = len;
+      x = self->border.left + get_view_width (self) / 8.0;
+      break;
+    default:
+      return FALSE;
+  }
+  // keep the frame under the pointer in place
+  pos = self->view_start + (x - self->border.left) *
+      (gdouble) len / get_view_width (self);
+  if (direction == GDK_SCROLL_LEFT || direction == GDK_SCROLL_RIGHT)
+    start = pos;
+  else
+    start = pos - (gint64) ((pos - self->view_start) *
+        ((gdouble) new_len / len));
+  start = CLAMP (start, 0, self->wave_length - new_len);
+  if (start != self->view_start || new_len != len) {
+    self->view_start = start;
+    self->view_end = start + new_len;
+    gtk_widget_queue_draw (widget);
+  }
+  return TRUE;
+}
+
 static void
 bt_waveform_viewer_finalize (GObject * object)
 {
   BtWaveformViewer *self = BT_WAVEFORM_VIEWER (object);
 
-  g_free (self->peaks);
+  cancel_peaks (self);
 
   G_OBJECT_CLASS (bt_waveform_viewer_parent_class)->finalize (object);
 }
@@ -406,6 +760,8 @@ bt_waveform_viewer_class_init (BtWaveformViewerClass * klass)
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
+  peaks_quark = g_quark_from_static_string ("BtWaveformViewer::peaks");
+
   widget_class->realize = bt_waveform_viewer_realize;
   widget_class->unrealize = bt_waveform_viewer_unrealize;
   widget_class->map = bt_waveform_viewer_map;
@@ -417,6 +773,7 @@ bt_waveform_viewer_class_init (BtWaveformViewerClass * klass)
   widget_class->button_press_event = bt_waveform_viewer_button_press;
   widget_class->button_release_event = bt_waveform_viewer_button_release;
   widget_class->motion_notify_event = bt_waveform_viewer_motion_notify;
+  widget_class->scroll_event = bt_waveform_viewer_scroll;
 
   gobject_class->set_property = bt_waveform_viewer_set_property;
   gobject_class->get_property = bt_waveform_viewer_get_property;
@@ -447,9 +804,8 @@ bt_waveform_viewer_init (BtWaveformViewer * self)
   GtkStyleContext *context;
 
   self->channels = 2;
-  self->peaks_size = DEF_PEAK_SIZE;
-  self->peaks = g_malloc (sizeof (gfloat) * self->channels * self->peaks_size);
   self->wave_length = 0;
+  self->view_start = self->view_end = 0;
   self->loop_start = self->loop_end = self->playback_cursor = -1;
 
   context = gtk_widget_get_style_context (GTK_WIDGET (self));
@@ -462,51 +818,61 @@ bt_waveform_viewer_init (BtWaveformViewer * self)
 /**
  * bt_waveform_viewer_set_wave:
  * @self: the widget
+ * @owner: the object that owns @data
  * @data: memory block of samples (interleaved for channels>1)
  * @channels: number channels
  * @length: number samples per channel
  *
- * Set wave data to show in the widget.
+ * Set wave data to show in the widget. The widget keeps a reference to
+ * @owner while it shows the data. The peaks are computed in the background
+ * and are kept with @owner.
  */
 void
-bt_waveform_viewer_set_wave (BtWaveformViewer * self, gint16 * data,
-    gint channels, gint length)
+bt_waveform_viewer_set_wave (BtWaveformViewer * self, GObject * owner,
+    gint16 * data, gint channels, gint length)
 {
-  gint i, c, p, cc = channels;
-  gint64 len = length;
+  BtWaveformPeaks *peaks;
+
+  cancel_peaks (self);
 
   self->channels = channels;
   self->wave_length = length;
+  self->data = data;
+  self->view_start = 0;
+  self->view_end = length;
 
-  g_free (self->peaks);
-  self->peaks = NULL;
-
-  if (!data || !length) {
+  if (!data || !length || !owner) {
+    self->data = NULL;
+    self->wave_length = 0;
     gtk_widget_queue_draw (GTK_WIDGET (self));
     return;
   }
-  // calculate peak data
-  self->peaks_size = length < DEF_PEAK_SIZE ? length : DEF_PEAK_SIZE;
-  self->peaks = g_malloc (sizeof (gfloat) * channels * self->peaks_size);
-
-  for (i = 0; i < self->peaks_size; i++) {
-    gint p1 = len * i / self->peaks_size;
-    gint p2 = len * (i + 1) / self->peaks_size;
-    for (c = 0; c < self->channels; c++) {
-      // get min max for peak slot
-      gfloat vmin = data[p1 * cc + c], vmax = data[p1 * cc + c];
-      for (p = p1 + 1; p < p2; p++) {
-        gfloat d = data[p * cc + c];
-        if (d < vmin)
-          vmin = d;
-        if (d > vmax)
-          vmax = d;
-      }
-      if (vmin > 0 && vmax > 0)
-        vmin = 0;
-      else if (vmin < 0 && vmax < 0)
-        vmax = 0;
-      self->peaks[i * cc + c] = (vmax - vmin) / 32768.0;
+  self->owner = g_object_ref (owner);
+
+  // reuse the peaks if we have computed them before
+  if ((peaks = g_object_get_qdata (owner, peaks_quark)) &&
+      peaks->data == data && peaks->channels == channels &&
+      peaks->length == length) {
+    self->peaks = bt_waveform_peaks_ref (peaks);
+  } else {
+    peaks = bt_waveform_peaks_new (data, channels, length);
+    if ((gint64) length * channels < PEAK_SYNC_SIZE) {
+      bt_waveform_peaks_build (peaks, NULL);
+      g_object_set_qdata_full (owner, peaks_quark,
+          bt_waveform_peaks_ref (peaks),
+          (GDestroyNotify) bt_waveform_peaks_unref);
+      self->peaks = peaks;
+    } else {
+      GTask *task;
+
+      // the task keeps the owner and thus the data alive
+      self->peaks_cancellable = g_cancellable_new ();
+      task = g_task_new (self, self->peaks_cancellable, on_peaks_ready,
+          g_object_ref (owner));
+      g_task_set_task_data (task, peaks,
+          (GDestroyNotify) bt_waveform_peaks_unref);
+      g_task_run_in_thread (task, bt_waveform_peaks_thread);
+      g_object_unref (task);
     }
   }
   gtk_widget_queue_draw (GTK_WIDGET (self));
@@ -30,6 +30,7 @@ G_BEGIN_DECLS
 
 typedef struct _BtWaveformViewer      BtWaveformViewer;
 typedef struct _BtWaveformViewerClass BtWaveformViewerClass;
+typedef struct _BtWaveformPeaks       BtWaveformPeaks;
 
 /**
  * BtWaveformViewer:
@@ -39,11 +40,14 @@ typedef struct _BtWaveformViewerClass BtWaveformViewerClass;
 struct _BtWaveformViewer {
   GtkWidget parent;
 
-  gfloat *peaks;
-  gint peaks_size;
+  BtWaveformPeaks *peaks;
+  GCancellable *peaks_cancellable;
+  GObject *owner;
+  gint16 *data;
   gint channels;
     
   gint64 wave_length;
+  gint64 view_start, view_end;
   gint64 loop_start, loop_end;
   gint64 playback_cursor;
   
@@ -59,7 +63,7 @@ struct _BtWaveformViewerClass {
 
 GtkWidget *bt_waveform_viewer_new(void);
 
-void bt_waveform_viewer_set_wave(BtWaveformViewer *self, gint16 *data, gint channels, gint length);
+void bt_waveform_viewer_set_wave(BtWaveformViewer *self, GObject *owner, gint16 *data, gint channels, gint length);
 
 GType bt_waveform_viewer_get_type(void) G_GNUC_CONST;
 
@@ -21,6 +21,9 @@
  *
  * Provides volume control on the wires, as well as a menu to disconnect wires
  * and to launch the analyzer screen.
+ *
+ * The wire lines are not drawn by the items. The #BtMainPageMachines draws
+ * all of them together in one layer.
  */
 /* TODO(ensonic): mixer strip
  *   - right now a click on the triangle pops up the volume or panorama slider
@@ -70,12 +73,10 @@ struct _BtWireCanvasItemPrivate
   /* source and dst machine canvas item */
   BtMachineCanvasItem *src, *dst;
 
-  /* the graphical components */
-  ClutterContent *canvas;
+  /* the graphical components, the pad image is shared via ui-resources */
   ClutterActor *pad;
   ClutterContent *pad_image;
   ClutterActor *vol_level, *pan_pos;
-  GdkRGBA wire_color;
 
   /* wire context_menu */
   GtkMenu *context_menu;
@@ -93,8 +94,6 @@ struct _BtWireCanvasItemPrivate
 
 static GQuark wire_canvas_item_quark = 0;
 
-#define WIRE_UPSAMPLING 2.0
-
 //-- the class
 
 G_DEFINE_TYPE_WITH_CODE (BtWireCanvasItem, bt_wire_canvas_item, CLUTTER_TYPE_ACTOR, 
@@ -110,21 +109,17 @@ static void on_signal_analysis_dialog_destroy (GtkWidget * widget,
 static void
 update_wire_graphics (BtWireCanvasItem * self)
 {
-  GdkPixbuf *pixbuf =
-      bt_ui_resources_get_wire_graphics_pixbuf_by_wire (self->priv->wire,
+  ClutterContent *image =
+      bt_ui_resources_get_wire_graphics_by_wire (self->priv->wire,
       self->priv->zoom);
 
-  clutter_image_set_data (CLUTTER_IMAGE (self->priv->pad_image),
-      gdk_pixbuf_get_pixels (pixbuf), gdk_pixbuf_get_has_alpha (pixbuf)
-      ? COGL_PIXEL_FORMAT_RGBA_8888
-      : COGL_PIXEL_FORMAT_RGB_888,
-      gdk_pixbuf_get_width (pixbuf),
-      gdk_pixbuf_get_height (pixbuf), gdk_pixbuf_get_rowstride (pixbuf), NULL);
-
-  GST_INFO ("pixbuf: %dx%d", gdk_pixbuf_get_width (pixbuf),
-      gdk_pixbuf_get_height (pixbuf));
-
-  g_object_unref (pixbuf);
+  if (image != self->priv->pad_image) {
+    clutter_actor_set_content (self->priv->pad, image);
+    g_object_try_unref (self->priv->pad_image);
+    self->priv->pad_image = image;
+  } else {
+    g_object_unref (image);
+  }
 }
 
 static void
@@ -149,46 +144,6 @@ show_wire_analyzer_dialog (BtWireCanvasItem * self)
 
 //-- event handler
 
-static void
-on_wire_size_changed (const BtWireCanvasItem * self, GParamSpec * arg,
-    gpointer user_data)
-{
-  gfloat w, h;
-
-  clutter_actor_get_size ((ClutterActor *) self, &w, &h);
-  if (w > 0.0 && h > 0.0) {
-    clutter_canvas_set_size (CLUTTER_CANVAS (self->priv->canvas),
-        (gint) (w * WIRE_UPSAMPLING), (gint) (h * WIRE_UPSAMPLING));
-  }
-}
-
-/* draw the connecting wire */
-static gboolean
-on_wire_draw (ClutterCanvas * canvas, cairo_t * cr, gint width,
-    gint height, gpointer user_data)
-{
-  BtWireCanvasItem *self = BT_WIRE_CANVAS_ITEM (user_data);
-  //const gfloat xm = (gfloat) width / 2.0;
-  const gfloat ym = (gfloat) height / 2.0;
-
-  /* clear the contents of the canvas, to not paint over the previous frame */
-  cairo_save (cr);
-  cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
-  cairo_paint (cr);
-  cairo_restore (cr);
-  cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
-
-  cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
-  cairo_set_line_width (cr, 2.0);
-  gdk_cairo_set_source_rgba (cr, &self->priv->wire_color);
-
-  cairo_move_to (cr, 0.0, ym);
-  cairo_line_to (cr, width, ym);
-  cairo_stroke (cr);
-
-  return TRUE;
-}
-
 static void
 on_signal_analysis_dialog_destroy (GtkWidget * widget, gpointer user_data)
 {
@@ -460,20 +415,6 @@ on_wire_pad_key_release (ClutterActor * citem, ClutterEvent * event,
   return res;
 }
 
-static void
-on_canvas_style_updated (GtkWidget * widget, gconstpointer user_data)
-{
-  BtWireCanvasItem *self = BT_WIRE_CANVAS_ITEM (user_data);
-  GtkStyleContext *style = gtk_widget_get_style_context (widget);
-
-  gtk_style_context_lookup_color (style, "wire_line", &self->priv->wire_color);
-  if (self->priv->canvas) {
-    // a directy invalidate crashes
-    g_idle_add_full (G_PRIORITY_HIGH, (GSourceFunc) clutter_content_invalidate,
-        self->priv->canvas, NULL);
-  }
-}
-
 //-- helper methods
 
 //-- constructor methods
@@ -581,7 +522,6 @@ bt_wire_canvas_item_constructed (GObject * object)
 
   // the wire pad
   self->priv->pad = clutter_actor_new ();
-  self->priv->pad_image = clutter_image_new ();
   update_wire_graphics (self);
   clutter_actor_set_content_scaling_filters (self->priv->pad,
       CLUTTER_SCALING_FILTER_TRILINEAR, CLUTTER_SCALING_FILTER_LINEAR);
@@ -591,7 +531,6 @@ bt_wire_canvas_item_constructed (GObject * object)
       (WIRE_PAD_W / -2.0), (WIRE_PAD_H / -2.0), 0.0);
   clutter_actor_set_reactive (self->priv->pad, TRUE);
   clutter_actor_add_child ((ClutterActor *) self, self->priv->pad);
-  clutter_actor_set_content (self->priv->pad, self->priv->pad_image);
   clutter_actor_set_child_above_sibling ((ClutterActor *) self, self->priv->pad,
       NULL);
   g_signal_connect (self->priv->pad, "button-press-event",
@@ -618,19 +557,6 @@ bt_wire_canvas_item_constructed (GObject * object)
     on_pan_changed (self->priv->wire_pan, NULL, (gpointer) self);
   }
   clutter_color_free (meter_bg);
-  // the wire line
-  self->priv->canvas = clutter_canvas_new ();
-  clutter_actor_set_content ((ClutterActor *) self, self->priv->canvas);
-  clutter_actor_set_content_scaling_filters ((ClutterActor *) self,
-      CLUTTER_SCALING_FILTER_TRILINEAR, CLUTTER_SCALING_FILTER_LINEAR);
-  g_signal_connect_object (self->priv->canvas, "draw",
-      G_CALLBACK (on_wire_draw), self, 0);
-  g_signal_connect (self, "notify::width", G_CALLBACK (on_wire_size_changed),
-      self);
-  g_signal_connect (self, "notify::height", G_CALLBACK (on_wire_size_changed),
-      self);
-  on_wire_size_changed (self, NULL, self);
-  clutter_content_invalidate (self->priv->canvas);
 
   GST_INFO ("done and all shown");
 
@@ -692,11 +618,6 @@ bt_wire_canvas_item_set_property (GObject * object, guint property_id,
       self->priv->main_page_machines =
           BT_MAIN_PAGE_MACHINES (g_value_get_object (value));
       g_object_try_weak_ref (self->priv->main_page_machines);
-      on_canvas_style_updated ((GtkWidget *) self->priv->main_page_machines,
-          (gpointer) self);
-      g_signal_connect_object (self->priv->main_page_machines, "style-updated",
-          G_CALLBACK (on_canvas_style_updated), (gpointer) self,
-          G_CONNECT_AFTER);
       //GST_DEBUG("set the main_page_machines for wire_canvas_item: %p",self->priv->main_page_machines);
       break;
     case WIRE_CANVAS_ITEM_WIRE:
@@ -729,7 +650,7 @@ bt_wire_canvas_item_set_property (GObject * object, guint property_id,
     case WIRE_CANVAS_ITEM_ZOOM:
       self->priv->zoom = g_value_get_double (value);
       GST_DEBUG ("set the zoom for wire_canvas_item: %f", self->priv->zoom);
-      /* reload the svg icons, we do this to keep them sharp */
+      /* use the icons rendered for this zoom level, to keep them sharp */
       if (self->priv->pad_image) {
         update_wire_graphics (self);
       }
@@ -752,7 +673,7 @@ bt_wire_canvas_item_dispose (GObject * object)
 
   g_object_try_unref (self->priv->wire_gain);
   g_object_try_unref (self->priv->wire_pan);
-  g_object_unref (self->priv->pad_image);
+  g_object_try_unref (self->priv->pad_image);
   g_object_try_unref (self->priv->wire);
   g_object_try_unref (self->priv->src);
   g_object_try_unref (self->priv->dst);
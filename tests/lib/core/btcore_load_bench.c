@@ -0,0 +1,215 @@
+/* Buzztrax
+ * Copyright (C) 2026 Buzztrax team <buzztrax-devel@buzztrax.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * benchmark for loading pattern heavy songs
+ *
+ * invoke it from the build dir e.g. as
+ *   GSETTINGS_BACKEND=memory GSETTINGS_SCHEMA_DIR=. ./btcore_load_bench \
+ *     --save /tmp/big.xml --patterns=200 --ticks=256
+ *   ... ./btcore_load_bench --load=stream /tmp/big.xml
+ *   ... ./btcore_load_bench --load=dom /tmp/big.xml
+ *
+ * Each mode has to run in its own process, as the peak memory of a process
+ * never goes down again. The 'stream' mode uses the regular song-io (the
+ * xmlTextReader based loader), the 'dom' mode parses the whole file into a
+ * xmlDoc and runs the BtPersistence loaders on it. Results are printed as:
+ *   <mode> <seconds> <peak-kb> <peak-kb-before-load>
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <glib.h>
+#include <libxml/parser.h>
+
+#include "core/core.h"
+#include "../../bt-check.h"
+#include "../../bt-test-application.h"
+
+static gint num_patterns = 100;
+static gint num_ticks = 256;
+static gchar *save_name = NULL;
+static gchar *load_mode = NULL;
+
+//-- helpers
+
+static glong
+get_peak_kb (void)
+{
+  struct rusage ru;
+
+  return getrusage (RUSAGE_SELF, &ru) ? 0 : ru.ru_maxrss;
+}
+
+static gboolean
+save_song (BtApplication * app, const gchar * file_name)
+{
+  BtSong *song = bt_song_new (app);
+  BtMachineConstructorParams cparams;
+  BtMachine *sink, *gen;
+  BtParameterGroup *pg, *vpg;
+  BtSongIO *song_io;
+  GError *err = NULL;
+  glong p_uint, p_double, p_note;
+  gboolean res = FALSE;
+  gint i, t;
+
+  cparams.song = song;
+  cparams.id = "master";
+  sink = BT_MACHINE (bt_sink_machine_new (&cparams, NULL));
+  cparams.id = "gen";
+  gen = BT_MACHINE (bt_source_machine_new (&cparams,
+          "buzztrax-test-poly-source", 2L, NULL));
+  bt_wire_new (song, gen, sink, NULL);
+
+  pg = bt_machine_get_global_param_group (gen);
+  vpg = bt_machine_get_voice_param_group (gen, 0);
+  p_uint = bt_parameter_group_get_param_index (pg, "g-uint");
+  p_double = bt_parameter_group_get_param_index (pg, "g-double");
+  p_note = bt_parameter_group_get_param_index (vpg, "v-note");
+
+  for (i = 0; i < num_patterns; i++) {
+    gchar *name = g_strdup_printf ("%03d", i);
+    BtPattern *pattern = bt_pattern_new (song, name, num_ticks, gen);
+
+    for (t = 0; t < num_ticks; t++) {
+      gchar val[G_ASCII_DTOSTR_BUF_SIZE];
+
+      g_snprintf (val, sizeof (val), "%d", (i + t) % 100);
+      bt_pattern_set_global_event (pattern, t, p_uint, val);
+      g_ascii_dtostr (val, sizeof (val), ((i * t) % 2000) / 2.0 - 500.0);
+      bt_pattern_set_global_event (pattern, t, p_double, val);
+      bt_pattern_set_voice_event (pattern, t, 0, p_note, "c-4");
+      bt_pattern_set_voice_event (pattern, t, 1, p_note, "e-4");
+    }
+    g_object_unref (pattern);
+    g_free (name);
+  }
+
+  if ((song_io = bt_song_io_from_file (file_name, &err))) {
+    if (!(res = bt_song_io_save (song_io, song, &err))) {
+      fprintf (stderr, "can't save song: %s\n",
+          err ? err->message : "unknown error");
+    }
+    g_object_unref (song_io);
+  } else {
+    fprintf (stderr, "can't create song-io: %s\n", err->message);
+  }
+  g_clear_error (&err);
+  printf ("# %d patterns, %d ticks, %d cells\n", num_patterns, num_ticks,
+      num_patterns * num_ticks * 4);
+  g_object_unref (song);
+  return res;
+}
+
+static gboolean
+load_song_stream (BtSong * song, const gchar * file_name)
+{
+  BtSongIO *song_io;
+  GError *err = NULL;
+  gboolean res = FALSE;
+
+  if ((song_io = bt_song_io_from_file (file_name, &err))) {
+    res = bt_song_io_load (song_io, song, &err);
+    g_object_unref (song_io);
+  }
+  if (err) {
+    fprintf (stderr, "can't load song: %s\n", err->message);
+    g_error_free (err);
+  }
+  return res;
+}
+
+static gboolean
+load_song_dom (BtSong * song, const gchar * file_name)
+{
+  xmlDocPtr doc;
+  gboolean res = FALSE;
+
+  if ((doc = xmlReadFile (file_name, NULL, 0))) {
+    res = bt_persistence_load (BT_TYPE_SONG, BT_PERSISTENCE (song),
+        xmlDocGetRootElement (doc), NULL, NULL) != NULL;
+    xmlFreeDoc (doc);
+  } else {
+    fprintf (stderr, "can't parse song\n");
+  }
+  return res;
+}
+
+//-- main
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  BtApplication *app;
+  BtSong *song;
+  gint64 t0, t1;
+  glong peak0, peak1;
+  gboolean res;
+  GOptionEntry options[] = {
+    {"save", 's', 0, G_OPTION_ARG_FILENAME, &save_name,
+        "Generate a song and save it", "<file>"},
+    {"load", 'l', 0, G_OPTION_ARG_STRING, &load_mode,
+        "Load the song given as argument", "stream|dom"},
+    {"patterns", 'p', 0, G_OPTION_ARG_INT, &num_patterns,
+        "Number of patterns in the generated song", "<number>"},
+    {"ticks", 't', 0, G_OPTION_ARG_INT, &num_ticks,
+        "Length of each generated pattern", "<number>"},
+    {NULL}
+  };
+
+  ctx = g_option_context_new ("[song-file]");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  bt_init (ctx, &argc, &argv);
+  g_option_context_free (ctx);
+  // we need the test elements, but not the resource limits for the tests
+  g_setenv ("CK_FORK", "no", TRUE);
+  bt_check_init ();
+
+  app = bt_test_application_new ();
+  if (save_name) {
+    res = save_song (app, save_name);
+  } else if (load_mode && argc > 1) {
+    song = bt_song_new (app);
+    peak0 = get_peak_kb ();
+    t0 = g_get_monotonic_time ();
+    if (!strcmp (load_mode, "dom")) {
+      res = load_song_dom (song, argv[1]);
+    } else {
+      res = load_song_stream (song, argv[1]);
+    }
+    t1 = g_get_monotonic_time ();
+    peak1 = get_peak_kb ();
+    printf ("# mode     seconds    peak-kb   before-kb\n");
+    printf ("%-8s %10.3lf %10ld %10ld\n", load_mode,
+        (t1 - t0) / (gdouble) G_USEC_PER_SEC, peak1, peak0);
+    g_object_unref (song);
+  } else {
+    fprintf (stderr, "use --save <file> or --load=stream|dom <file>\n");
+    res = FALSE;
+  }
+  g_object_unref (app);
+  g_free (save_name);
+  g_free (load_mode);
+  return res ? 0 : 1;
+}
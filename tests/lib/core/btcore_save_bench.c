@@ -0,0 +1,220 @@
+/* Buzztrax
+ * Copyright (C) 2026 Buzztrax team <buzztrax-devel@buzztrax.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * benchmark for saving sample heavy songs
+ *
+ * invoke it from the build dir e.g. as
+ *   GSETTINGS_BACKEND=memory GSETTINGS_SCHEMA_DIR=. ./btcore_save_bench
+ *   ... ./btcore_save_bench --waves=16 --seconds=120 --runs=5
+ *
+ * The song gets a number of generated waves (16 bit stereo wav files). It is
+ * saved to a new file first, then to the same file again. The second save can
+ * reuse the unchanged waves. Results are printed as one line per run:
+ *   <mode> <run> <seconds> <MB/s> <file-size>
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "core/core.h"
+#include "../../bt-test-application.h"
+
+#define SAMPLERATE 44100
+#define CHANNELS 2
+
+static gint num_waves = 8;
+static gint num_seconds = 30;
+static gint num_runs = 3;
+
+//-- helpers
+
+static void
+put_le16 (guint8 * data, guint16 val)
+{
+  data[0] = val & 0xff;
+  data[1] = (val >> 8) & 0xff;
+}
+
+static void
+put_le32 (guint8 * data, guint32 val)
+{
+  put_le16 (data, val & 0xffff);
+  put_le16 (data + 2, val >> 16);
+}
+
+/* write a wav file with a decaying tone and some noise, so that it compresses
+ * like a real sample */
+static gchar *
+make_wave_file (const gchar * dir, gint ix)
+{
+  gchar *name = g_strdup_printf ("wave%03d.wav", ix);
+  gchar *file_name = g_build_filename (dir, name, NULL);
+  guint frames = SAMPLERATE * num_seconds;
+  guint data_size = frames * CHANNELS * sizeof (gint16);
+  guint8 header[44];
+  gint16 *data = g_new (gint16, frames * CHANNELS);
+  gdouble freq = 110.0 * (1 + ix % 8);
+  FILE *out;
+  guint i;
+
+  for (i = 0; i < frames; i++) {
+    gdouble t = (gdouble) i / SAMPLERATE;
+    gdouble v = sin (2.0 * G_PI * freq * t) * exp (-t) * 20000.0;
+
+    data[i * CHANNELS] = (gint16) (v + g_random_int_range (-64, 64));
+    data[i * CHANNELS + 1] = (gint16) (v + g_random_int_range (-64, 64));
+  }
+
+  memcpy (header, "RIFF", 4);
+  put_le32 (header + 4, 36 + data_size);
+  memcpy (header + 8, "WAVEfmt ", 8);
+  put_le32 (header + 16, 16);
+  put_le16 (header + 20, 1);
+  put_le16 (header + 22, CHANNELS);
+  put_le32 (header + 24, SAMPLERATE);
+  put_le32 (header + 28, SAMPLERATE * CHANNELS * sizeof (gint16));
+  put_le16 (header + 32, CHANNELS * sizeof (gint16));
+  put_le16 (header + 34, 16);
+  memcpy (header + 36, "data", 4);
+  put_le32 (header + 40, data_size);
+
+  if ((out = fopen (file_name, "wb"))) {
+    fwrite (header, sizeof (header), 1, out);
+    fwrite (data, data_size, 1, out);
+    fclose (out);
+  }
+  g_free (data);
+  g_free (name);
+  return file_name;
+}
+
+static gint64
+get_file_size (const gchar * file_name)
+{
+  GStatBuf st;
+
+  return g_stat (file_name, &st) ? 0 : (gint64) st.st_size;
+}
+
+static void
+bench_save (const gchar * mode, gint run, BtSong * song,
+    const gchar * file_name, gint64 data_size)
+{
+  BtSongIO *song_io;
+  GError *err = NULL;
+  gint64 t0, t1;
+  gdouble secs;
+
+  if (!(song_io = bt_song_io_from_file (file_name, &err))) {
+    fprintf (stderr, "can't create song-io: %s\n", err->message);
+    g_error_free (err);
+    return;
+  }
+  t0 = g_get_monotonic_time ();
+  if (!bt_song_io_save (song_io, song, &err)) {
+    fprintf (stderr, "can't save song: %s\n",
+        err ? err->message : "unknown error");
+    g_clear_error (&err);
+  }
+  t1 = g_get_monotonic_time ();
+  g_object_unref (song_io);
+
+  secs = (t1 - t0) / (gdouble) G_USEC_PER_SEC;
+  printf ("%-8s %3d %10.3lf %10.1lf %12" G_GINT64_FORMAT "\n", mode, run, secs,
+      (data_size / (1024.0 * 1024.0)) / secs, get_file_size (file_name));
+}
+
+//-- main
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  BtApplication *app;
+  BtSong *song;
+  gchar *dir, *song_name;
+  GPtrArray *wave_files;
+  gint64 data_size = 0;
+  gint i;
+  GOptionEntry options[] = {
+    {"waves", 'w', 0, G_OPTION_ARG_INT, &num_waves,
+        "Number of waves in the song", "<number>"},
+    {"seconds", 's', 0, G_OPTION_ARG_INT, &num_seconds,
+        "Length of each wave in seconds", "<seconds>"},
+    {"runs", 'r', 0, G_OPTION_ARG_INT, &num_runs,
+        "Number of runs for each mode", "<number>"},
+    {NULL}
+  };
+
+  ctx = g_option_context_new (NULL);
+  g_option_context_add_main_entries (ctx, options, NULL);
+  bt_init (ctx, &argc, &argv);
+  g_option_context_free (ctx);
+
+  if (!(dir = g_dir_make_tmp ("btcore_save_bench-XXXXXX", NULL))) {
+    fprintf (stderr, "can't create temp dir\n");
+    return 1;
+  }
+  app = bt_test_application_new ();
+  song = bt_song_new (app);
+
+  wave_files = g_ptr_array_new_with_free_func (g_free);
+  for (i = 0; i < num_waves; i++) {
+    gchar *file_name = make_wave_file (dir, i);
+    gchar *uri = g_filename_to_uri (file_name, NULL, NULL);
+    gchar *name = g_path_get_basename (file_name);
+    BtWave *wave = bt_wave_new (song, name, uri, i + 1, 1.0,
+        BT_WAVE_LOOP_MODE_OFF, 0);
+
+    data_size += get_file_size (file_name);
+    g_ptr_array_add (wave_files, file_name);
+    g_object_unref (wave);
+    g_free (name);
+    g_free (uri);
+  }
+
+  printf ("# %d waves, %.1lf MB\n", num_waves,
+      data_size / (1024.0 * 1024.0));
+  printf ("# mode     run    seconds       MB/s    file-size\n");
+  song_name = g_build_filename (dir, "song.bzt", NULL);
+  for (i = 0; i < num_runs; i++) {
+    g_unlink (song_name);
+    bench_save ("new", i, song, song_name, data_size);
+  }
+  for (i = 0; i < num_runs; i++) {
+    bench_save ("again", i, song, song_name, data_size);
+  }
+
+  g_unlink (song_name);
+  for (i = 0; i < (gint) wave_files->len; i++) {
+    g_unlink (g_ptr_array_index (wave_files, i));
+  }
+  g_rmdir (dir);
+  g_ptr_array_free (wave_files, TRUE);
+  g_free (song_name);
+  g_free (dir);
+  g_object_unref (song);
+  g_object_unref (app);
+  return 0;
+}
@@ -526,6 +526,57 @@ START_TEST (test_bt_sink_bin_analyzers)
 }
 END_TEST
 
+START_TEST (test_bt_sink_bin_playback_position)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  g_object_set (settings, "audiosink", "fakesink", NULL);
+  make_new_song ( /*square */ 1);
+  GstElement *sink_bin = get_sink_bin ();
+  gulong tick = G_MAXULONG;
+
+  GST_INFO ("-- act --");
+  bt_song_play (song);
+  check_run_main_loop_until_playing_or_error (song);
+  g_usleep (G_USEC_PER_SEC / 10);
+
+  GST_INFO ("-- assert --");
+  ck_assert (bt_sink_bin_get_playback_position ((BtSinkBin *) sink_bin, NULL,
+          &tick));
+  ck_assert_ulong_lt (tick, 4UL);
+
+  GST_INFO ("-- cleanup --");
+  bt_song_stop (song);
+  gst_object_unref (sink_bin);
+  BT_TEST_END;
+}
+END_TEST
+
+START_TEST (test_bt_sink_bin_playback_position_is_reset_on_stop)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  g_object_set (settings, "audiosink", "fakesink", NULL);
+  make_new_song ( /*square */ 1);
+  GstElement *sink_bin = get_sink_bin ();
+  gulong tick = G_MAXULONG;
+  bt_song_play (song);
+  check_run_main_loop_until_playing_or_error (song);
+  g_usleep (G_USEC_PER_SEC / 10);
+
+  GST_INFO ("-- act --");
+  bt_song_stop (song);
+
+  GST_INFO ("-- assert --");
+  ck_assert (!bt_sink_bin_get_playback_position ((BtSinkBin *) sink_bin,
+          NULL, &tick));
+
+  GST_INFO ("-- cleanup --");
+  gst_object_unref (sink_bin);
+  BT_TEST_END;
+}
+END_TEST
+
 TCase *
 bt_sink_bin_example_case (void)
 {
@@ -538,6 +589,8 @@ bt_sink_bin_example_case (void)
       BT_SINK_BIN_RECORD_FORMAT_COUNT);
   tcase_add_loop_test (tc, test_bt_sink_bin_master_volume, 1, 3);
   tcase_add_test (tc, test_bt_sink_bin_analyzers);
+  tcase_add_test (tc, test_bt_sink_bin_playback_position);
+  tcase_add_test (tc, test_bt_sink_bin_playback_position_is_reset_on_stop);
   tcase_add_checked_fixture (tc, test_setup, test_teardown);
   tcase_add_unchecked_fixture (tc, case_setup, case_teardown);
   return tc;
@@ -17,6 +17,12 @@
 
 #include "m-bt-core.h"
 #include "core/song-io-native.h"
+#include <glib/gstdio.h>
+#ifdef USE_GSF
+#include <gsf/gsf-outfile.h>
+#include <gsf/gsf-outfile-zip.h>
+#include <gsf/gsf-output-stdio.h>
+#endif
 
 //-- globals
 
@@ -516,6 +522,424 @@ START_TEST (test_bt_song_io_write_song)
 }
 END_TEST
 
+START_TEST (test_bt_song_io_native_pattern_data_roundtrip)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtSongIOFormatInfo *fi = &bt_song_io_native_module_info.formats[_i];
+  gchar *song_path = make_tmp_song_path ("bt-test-pattern-data.",
+      fi->extension);
+  make_song_normal ();
+  BtSongIO *song_io = bt_song_io_from_file (song_path, NULL);
+  bt_song_io_save (song_io, song, NULL);
+  ck_g_object_final_unref (song_io);
+  ck_g_object_final_unref (song);
+  song = bt_song_new (app);
+
+  GST_INFO ("-- act --");
+  song_io = bt_song_io_from_file (song_path, NULL);
+  bt_song_io_load (song_io, song, NULL);
+
+  GST_INFO ("-- assert --");
+  BtSetup *setup =
+      BT_SETUP (check_gobject_get_object_property (song, "setup"));
+  BtMachine *machine = bt_setup_get_machine_by_id (setup, "gen-p");
+  BtPattern *pattern =
+      (BtPattern *) bt_machine_get_pattern_by_name (machine, "melo");
+  ck_assert_str_eq_and_free (bt_pattern_get_global_event (pattern, 0, 0), "5");
+  ck_assert_str_eq_and_free (bt_pattern_get_voice_event (pattern, 0, 0, 0),
+      "5");
+  ck_assert_ptr_null (bt_pattern_get_global_event (pattern, 1, 0));
+
+  GST_INFO ("-- cleanup --");
+  g_object_unref (pattern);
+  g_object_unref (machine);
+  g_object_unref (setup);
+  ck_g_object_final_unref (song_io);
+  g_free (song_path);
+  BT_TEST_END;
+}
+END_TEST
+
+// waves are decoded in the background and joined by bt_song_io_load()
+START_TEST (test_bt_song_io_native_wave_data_roundtrip)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtSongIOFormatInfo *fi = &bt_song_io_native_module_info.formats[_i];
+  gchar *song_path = make_tmp_song_path ("bt-test-wave-data.",
+      fi->extension);
+  make_song_with_externals ();
+  BtSongIO *song_io = bt_song_io_from_file (song_path, NULL);
+  bt_song_io_save (song_io, song, NULL);
+  ck_g_object_final_unref (song_io);
+  ck_g_object_final_unref (song);
+  song = bt_song_new (app);
+
+  GST_INFO ("-- act --");
+  song_io = bt_song_io_from_file (song_path, NULL);
+  bt_song_io_load (song_io, song, NULL);
+
+  GST_INFO ("-- assert --");
+  BtWavetable *wavetable =
+      BT_WAVETABLE (check_gobject_get_object_property (song, "wavetable"));
+  BtWave *wave = bt_wavetable_get_wave_by_index (wavetable, 1);
+  ck_assert (wave != NULL);
+  GList *list = (GList *) check_gobject_get_ptr_property (wave, "wavelevels");
+  ck_assert_int_eq (g_list_length (list), 1);
+  ck_assert_ptr_null (check_gobject_get_ptr_property (wavetable,
+          "missing-waves"));
+
+  GST_INFO ("-- cleanup --");
+  g_list_free (list);
+  g_object_unref (wave);
+  g_object_unref (wavetable);
+  ck_g_object_final_unref (song_io);
+  g_free (song_path);
+  BT_TEST_END;
+}
+END_TEST
+
+// without wave-data the waves are created, but no samples are loaded
+START_TEST (test_bt_song_io_native_load_without_wave_data)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtSongIOFormatInfo *fi = &bt_song_io_native_module_info.formats[_i];
+  gchar *song_path = make_tmp_song_path ("bt-test-wave-meta-data.",
+      fi->extension);
+  make_song_with_externals ();
+  BtSongIO *song_io = bt_song_io_from_file (song_path, NULL);
+  bt_song_io_save (song_io, song, NULL);
+  ck_g_object_final_unref (song_io);
+  ck_g_object_final_unref (song);
+  song = bt_song_new (app);
+
+  GST_INFO ("-- act --");
+  song_io = bt_song_io_from_file (song_path, NULL);
+  g_object_set (song_io, "wave-data", FALSE, NULL);
+  gboolean res = bt_song_io_load (song_io, song, NULL);
+
+  GST_INFO ("-- assert --");
+  ck_assert (res == TRUE);
+  BtWavetable *wavetable =
+      BT_WAVETABLE (check_gobject_get_object_property (song, "wavetable"));
+  BtWave *wave = bt_wavetable_get_wave_by_index (wavetable, 1);
+  ck_assert (wave != NULL);
+  ck_assert_ptr_null (check_gobject_get_ptr_property (wave, "wavelevels"));
+  ck_assert_ptr_null (check_gobject_get_ptr_property (wavetable,
+          "missing-waves"));
+
+  GST_INFO ("-- cleanup --");
+  g_object_unref (wave);
+  g_object_unref (wavetable);
+  ck_g_object_final_unref (song_io);
+  g_free (song_path);
+  BT_TEST_END;
+}
+END_TEST
+
+#ifdef USE_GSF
+// unchanged waves are copied from the previous song file when saving again
+START_TEST (test_bt_song_io_native_bzt_save_again)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  gchar *song_path = make_tmp_song_path ("bt-test-save-again.", "bzt");
+  make_song_with_externals ();
+  BtSongIO *song_io = bt_song_io_from_file (song_path, NULL);
+  bt_song_io_save (song_io, song, NULL);
+  ck_g_object_final_unref (song_io);
+  ck_g_object_final_unref (song);
+  song = bt_song_new (app);
+  song_io = bt_song_io_from_file (song_path, NULL);
+  bt_song_io_load (song_io, song, NULL);
+  ck_g_object_final_unref (song_io);
+
+  GST_INFO ("-- act --");
+  song_io = bt_song_io_from_file (song_path, NULL);
+  gboolean res = bt_song_io_save (song_io, song, NULL);
+
+  GST_INFO ("-- assert --");
+  ck_assert (res == TRUE);
+  // the wave has not been changed and is copied from the previous file
+  BtSongIONativeBZT *bzt = BT_SONG_IO_NATIVE_BZT (song_io);
+  ck_assert_uint_eq (bt_song_io_native_bzt_get_reused_members (bzt), 1);
+  ck_g_object_final_unref (song_io);
+  ck_g_object_final_unref (song);
+  song = bt_song_new (app);
+  song_io = bt_song_io_from_file (song_path, NULL);
+  ck_assert (bt_song_io_load (song_io, song, NULL));
+  BtWavetable *wavetable =
+      BT_WAVETABLE (check_gobject_get_object_property (song, "wavetable"));
+  BtWave *wave = bt_wavetable_get_wave_by_index (wavetable, 1);
+  ck_assert (wave != NULL);
+  GList *list = (GList *) check_gobject_get_ptr_property (wave, "wavelevels");
+  ck_assert_int_eq (g_list_length (list), 1);
+  ck_assert_ptr_null (check_gobject_get_ptr_property (wavetable,
+          "missing-waves"));
+
+  GST_INFO ("-- cleanup --");
+  g_list_free (list);
+  g_object_unref (wave);
+  g_object_unref (wavetable);
+  ck_g_object_final_unref (song_io);
+  g_free (song_path);
+  BT_TEST_END;
+}
+END_TEST
+#endif
+
+#ifdef USE_GSF
+// enum columns keep values that are not valid for the parameter
+START_TEST (test_bt_song_io_native_bzt_enum_pattern_data_roundtrip)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  gchar *song_path = make_tmp_song_path ("bt-test-enum-data.", "bzt");
+  BtMachineConstructorParams cparams;
+  cparams.song = song;
+  cparams.id = "gen";
+  BtMachine *gen = BT_MACHINE (bt_source_machine_new (&cparams,
+          "buzztrax-test-mono-source", 0L, NULL));
+  BtParameterGroup *pg = bt_machine_get_global_param_group (gen);
+  glong p_note = bt_parameter_group_get_param_index (pg, "g-note");
+  glong p_enum = bt_parameter_group_get_param_index (pg, "g-sparse-enum");
+  BtPattern *pattern = bt_pattern_new (song, "enums", 4L, gen);
+  bt_pattern_set_global_event (pattern, 0, p_note, "c-4");
+  bt_pattern_set_global_event (pattern, 0, p_enum, "10");
+  bt_pattern_set_global_event (pattern, 2, p_enum, "5");
+  g_object_unref (pattern);
+  // only use the binary pattern data
+  g_object_set (settings, "xml-pattern-data", FALSE, NULL);
+  BtSongIO *song_io = bt_song_io_from_file (song_path, NULL);
+  bt_song_io_save (song_io, song, NULL);
+  ck_g_object_final_unref (song_io);
+  ck_g_object_final_unref (song);
+  song = bt_song_new (app);
+
+  GST_INFO ("-- act --");
+  song_io = bt_song_io_from_file (song_path, NULL);
+  gboolean res = bt_song_io_load (song_io, song, NULL);
+
+  GST_INFO ("-- assert --");
+  ck_assert (res == TRUE);
+  BtSetup *setup =
+      BT_SETUP (check_gobject_get_object_property (song, "setup"));
+  BtMachine *machine = bt_setup_get_machine_by_id (setup, "gen");
+  pattern = (BtPattern *) bt_machine_get_pattern_by_name (machine, "enums");
+  ck_assert_str_eq_and_free (bt_pattern_get_global_event (pattern, 0, p_note),
+      "c-4");
+  ck_assert_str_eq_and_free (bt_pattern_get_global_event (pattern, 0, p_enum),
+      "10");
+  ck_assert_ptr_null (bt_pattern_get_global_event (pattern, 1, p_enum));
+  ck_assert_str_eq_and_free (bt_pattern_get_global_event (pattern, 2, p_enum),
+      "5");
+  ck_assert_ptr_null (bt_pattern_get_global_event (pattern, 2, p_note));
+
+  GST_INFO ("-- cleanup --");
+  g_object_set (settings, "xml-pattern-data", TRUE, NULL);
+  g_object_unref (pattern);
+  g_object_unref (machine);
+  g_object_unref (setup);
+  ck_g_object_final_unref (song_io);
+  g_free (song_path);
+  BT_TEST_END;
+}
+END_TEST
+
+static void
+write_zip_member (GsfOutfile * outfile, const gchar * name,
+    const guint8 * data, gsize len)
+{
+  GsfOutput *output = gsf_outfile_new_child (outfile, name, FALSE);
+
+  gsf_output_write (output, len, data);
+  gsf_output_close (output);
+  g_object_unref (output);
+}
+
+// a damaged patterns.bin is ignored and the events are read from song.xml
+START_TEST (test_bt_song_io_native_bzt_truncated_pattern_data)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  gchar *xml_path = make_tmp_song_path ("bt-test-truncated-data.", "xml");
+  gchar *song_path = make_tmp_song_path ("bt-test-truncated-data.", "bzt");
+  gchar *xml_data;
+  gsize xml_len;
+  make_song_normal ();
+  BtSongIO *song_io = bt_song_io_from_file (xml_path, NULL);
+  bt_song_io_save (song_io, song, NULL);
+  ck_g_object_final_unref (song_io);
+  ck_g_object_final_unref (song);
+  song = bt_song_new (app);
+  g_file_get_contents (xml_path, &xml_data, &xml_len, NULL);
+  // header, version 2, one pattern, but the pattern is cut off
+  const guint8 pattern_data[] = { 'B', 'T', 'P', 'D', 2, 0, 0, 0, 1, 0, 0, 0,
+    5, 0, 0, 0, 'g', 'e'
+  };
+  GsfOutput *output = gsf_output_stdio_new (song_path, NULL);
+  GsfOutfile *outfile = gsf_outfile_zip_new (output, NULL);
+  write_zip_member (outfile, "song.xml", (guint8 *) xml_data, xml_len);
+  write_zip_member (outfile, "patterns.bin", pattern_data,
+      sizeof (pattern_data));
+  gsf_output_close ((GsfOutput *) outfile);
+  g_object_unref (outfile);
+  gsf_output_close (output);
+  g_object_unref (output);
+
+  GST_INFO ("-- act --");
+  song_io = bt_song_io_from_file (song_path, NULL);
+  gboolean res = bt_song_io_load (song_io, song, NULL);
+
+  GST_INFO ("-- assert --");
+  ck_assert (res == TRUE);
+  BtSetup *setup =
+      BT_SETUP (check_gobject_get_object_property (song, "setup"));
+  BtMachine *machine = bt_setup_get_machine_by_id (setup, "gen-p");
+  BtPattern *pattern =
+      (BtPattern *) bt_machine_get_pattern_by_name (machine, "melo");
+  ck_assert_str_eq_and_free (bt_pattern_get_global_event (pattern, 0, 0), "5");
+  ck_assert_str_eq_and_free (bt_pattern_get_voice_event (pattern, 0, 0, 0),
+      "5");
+
+  GST_INFO ("-- cleanup --");
+  g_object_unref (pattern);
+  g_object_unref (machine);
+  g_object_unref (setup);
+  ck_g_object_final_unref (song_io);
+  g_unlink (xml_path);
+  g_unlink (song_path);
+  g_free (xml_data);
+  g_free (xml_path);
+  g_free (song_path);
+  BT_TEST_END;
+}
+END_TEST
+
+// patterns that are missing from patterns.bin or have a different length get
+// their events from song.xml
+START_TEST (test_bt_song_io_native_bzt_pattern_data_length_mismatch)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  gchar *xml_path = make_tmp_song_path ("bt-test-length-mismatch.", "xml");
+  gchar *song_path = make_tmp_song_path ("bt-test-length-mismatch.", "bzt");
+  gchar *xml_data;
+  gsize xml_len;
+  make_song_normal ();
+  BtSongIO *song_io = bt_song_io_from_file (xml_path, NULL);
+  bt_song_io_save (song_io, song, NULL);
+  ck_g_object_final_unref (song_io);
+  ck_g_object_final_unref (song);
+  song = bt_song_new (app);
+  g_file_get_contents (xml_path, &xml_data, &xml_len, NULL);
+  // header, version 2, one pattern 'gen-p:melo' with 16 ticks and no columns
+  const guint8 pattern_data[] = { 'B', 'T', 'P', 'D', 2, 0, 0, 0, 1, 0, 0, 0,
+    5, 0, 0, 0, 'g', 'e', 'n', '-', 'p', 4, 0, 0, 0, 'm', 'e', 'l', 'o',
+    16, 0, 0, 0, 0, 0, 0, 0
+  };
+  GsfOutput *output = gsf_output_stdio_new (song_path, NULL);
+  GsfOutfile *outfile = gsf_outfile_zip_new (output, NULL);
+  write_zip_member (outfile, "song.xml", (guint8 *) xml_data, xml_len);
+  write_zip_member (outfile, "patterns.bin", pattern_data,
+      sizeof (pattern_data));
+  gsf_output_close ((GsfOutput *) outfile);
+  g_object_unref (outfile);
+  gsf_output_close (output);
+  g_object_unref (output);
+
+  GST_INFO ("-- act --");
+  song_io = bt_song_io_from_file (song_path, NULL);
+  gboolean res = bt_song_io_load (song_io, song, NULL);
+
+  GST_INFO ("-- assert --");
+  ck_assert (res == TRUE);
+  BtSetup *setup =
+      BT_SETUP (check_gobject_get_object_property (song, "setup"));
+  BtMachine *machine1 = bt_setup_get_machine_by_id (setup, "gen-m");
+  BtPattern *pattern1 =
+      (BtPattern *) bt_machine_get_pattern_by_name (machine1, "melo");
+  ck_assert_str_eq_and_free (bt_pattern_get_global_event (pattern1, 0, 0),
+      "5");
+  BtMachine *machine2 = bt_setup_get_machine_by_id (setup, "gen-p");
+  BtPattern *pattern2 =
+      (BtPattern *) bt_machine_get_pattern_by_name (machine2, "melo");
+  ck_assert_gobject_gulong_eq (pattern2, "length", 8L);
+  ck_assert_str_eq_and_free (bt_pattern_get_global_event (pattern2, 0, 0),
+      "5");
+  ck_assert_str_eq_and_free (bt_pattern_get_voice_event (pattern2, 0, 0, 0),
+      "5");
+
+  GST_INFO ("-- cleanup --");
+  g_object_unref (pattern1);
+  g_object_unref (machine1);
+  g_object_unref (pattern2);
+  g_object_unref (machine2);
+  g_object_unref (setup);
+  ck_g_object_final_unref (song_io);
+  g_unlink (xml_path);
+  g_unlink (song_path);
+  g_free (xml_data);
+  g_free (xml_path);
+  g_free (song_path);
+  BT_TEST_END;
+}
+END_TEST
+#endif
+
+static void
+on_song_saved (GObject * object, GAsyncResult * result, gpointer user_data)
+{
+  gint *res = (gint *) user_data;
+
+  *res = bt_song_io_save_finish (BT_SONG_IO (object), result, NULL);
+}
+
+// the song is written from a snapshot in the background
+START_TEST (test_bt_song_io_native_save_async)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtSongIOFormatInfo *fi = &bt_song_io_native_module_info.formats[_i];
+  gchar *song_path = make_tmp_song_path ("bt-test-save-async.",
+      fi->extension);
+  make_song_normal ();
+  BtSongIO *song_io = bt_song_io_from_file (song_path, NULL);
+  gint res = -1;
+
+  GST_INFO ("-- act --");
+  bt_song_io_save_async (song_io, song, on_song_saved, &res);
+  // drop the song while it is being written, the save holds a ref
+  g_object_unref (song);
+  song = bt_song_new (app);
+  while (res == -1) {
+    g_main_context_iteration (NULL, TRUE);
+  }
+
+  GST_INFO ("-- assert --");
+  ck_assert_int_eq (res, TRUE);
+  ck_g_object_final_unref (song_io);
+  song_io = bt_song_io_from_file (song_path, NULL);
+  ck_assert (bt_song_io_load (song_io, song, NULL));
+  BtSetup *setup =
+      BT_SETUP (check_gobject_get_object_property (song, "setup"));
+  BtMachine *machine = bt_setup_get_machine_by_id (setup, "gen-p");
+  BtPattern *pattern =
+      (BtPattern *) bt_machine_get_pattern_by_name (machine, "melo");
+  ck_assert_str_eq_and_free (bt_pattern_get_global_event (pattern, 0, 0), "5");
+
+  GST_INFO ("-- cleanup --");
+  g_object_unref (pattern);
+  g_object_unref (machine);
+  g_object_unref (setup);
+  ck_g_object_final_unref (song_io);
+  g_free (song_path);
+  BT_TEST_END;
+}
+END_TEST
+
 START_TEST (test_bt_song_io_native_load_legacy_0_7)
 {
   BT_TEST_START;
@@ -546,6 +970,42 @@ START_TEST (test_bt_song_io_native_load_legacy_0_7)
 }
 END_TEST
 
+// pattern data is streamed into the patterns of the machines
+START_TEST (test_bt_song_io_native_load_pattern_data)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtSetup *setup;
+  BtSongIO *song_io =
+      bt_song_io_from_file (check_get_test_song_path ("simple2.xml"), NULL);
+  g_object_get (song, "setup", &setup, NULL);
+
+  GST_INFO ("-- act --");
+  bt_song_io_load (song_io, song, NULL);
+
+  GST_INFO ("-- assert --");
+  BtMachine *machine = bt_setup_get_machine_by_id (setup, "sine1");
+  BtCmdPattern *pattern = bt_machine_get_pattern_by_name (machine, "beeps");
+  glong param =
+      bt_parameter_group_get_param_index (bt_machine_get_global_param_group
+      (machine), "freq");
+  ck_assert_gobject_gulong_eq (pattern, "length", 16L);
+  ck_assert_str_eq_and_free (bt_pattern_get_global_event ((BtPattern *)
+          pattern, 0, param), "440");
+  ck_assert_str_eq_and_free (bt_pattern_get_global_event ((BtPattern *)
+          pattern, 8, param), "1760");
+  ck_assert_ptr_null (bt_pattern_get_global_event ((BtPattern *) pattern, 1,
+          param));
+
+  GST_INFO ("-- cleanup --");
+  g_object_unref (pattern);
+  g_object_unref (machine);
+  g_object_unref (setup);
+  ck_g_object_final_unref (song_io);
+  BT_TEST_END;
+}
+END_TEST
+
 TCase *
 bt_song_io_native_example_case (void)
 {
@@ -569,7 +1029,22 @@ bt_song_io_native_example_case (void)
       G_N_ELEMENTS (input_song_names));
   tcase_add_loop_test (tc, test_bt_song_io_write_song, 0,
       num_formats * NUM_SONG_TYPES);
+  tcase_add_loop_test (tc, test_bt_song_io_native_pattern_data_roundtrip, 0,
+      num_formats);
+  tcase_add_loop_test (tc, test_bt_song_io_native_wave_data_roundtrip, 0,
+      num_formats);
+  tcase_add_loop_test (tc, test_bt_song_io_native_load_without_wave_data, 0,
+      num_formats);
+  tcase_add_loop_test (tc, test_bt_song_io_native_save_async, 0,
+      num_formats);
+#ifdef USE_GSF
+  tcase_add_test (tc, test_bt_song_io_native_bzt_save_again);
+  tcase_add_test (tc, test_bt_song_io_native_bzt_enum_pattern_data_roundtrip);
+  tcase_add_test (tc, test_bt_song_io_native_bzt_truncated_pattern_data);
+  tcase_add_test (tc, test_bt_song_io_native_bzt_pattern_data_length_mismatch);
+#endif
   tcase_add_test (tc, test_bt_song_io_native_load_legacy_0_7);
+  tcase_add_test (tc, test_bt_song_io_native_load_pattern_data);
   tcase_add_checked_fixture (tc, test_setup, test_teardown);
   tcase_add_unchecked_fixture (tc, case_setup, case_teardown);
   return tc;
@@ -72,6 +72,14 @@ get_mono_value_group (void)
 }
 
 
+static void
+on_group_changed (BtValueGroup * vg, BtParameterGroup * pg,
+    gboolean intermediate, gpointer user_data)
+{
+  if (!intermediate)
+    (*(guint *) user_data)++;
+}
+
 //-- tests
 
 START_TEST (test_bt_value_group_default_empty)
@@ -227,6 +235,123 @@ START_TEST (test_bt_value_group_blend_column)
 }
 END_TEST
 
+START_TEST (test_bt_value_group_pack_unpack_column)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  struct _blend_column *p = &blend_column[_i];
+  BtValueGroup *vg = get_mono_value_group ();
+  GByteArray *data = g_byte_array_new ();
+  guint i;
+  for (i = 0; i < 4; i++) {
+    bt_value_group_set_event (vg, i, _i, p->res[i]);
+  }
+
+  GST_INFO ("-- act --");
+  bt_value_group_pack_column (vg, _i, data);
+  bt_value_group_transform_colum (vg, BT_VALUE_GROUP_OP_CLEAR, 0, 3, _i);
+  gboolean res = bt_value_group_unpack_column (vg, _i, data->data, data->len);
+
+  GST_INFO ("-- assert --");
+  ck_assert (res);
+  for (i = 0; i < 4; i++) {
+    ck_assert_str_eq_and_free (bt_value_group_get_event (vg, i, _i), p->res[i]);
+  }
+
+  GST_INFO ("-- cleanup --");
+  g_byte_array_free (data, TRUE);
+  BT_TEST_END;
+}
+END_TEST
+
+// invalid enum values are kept as plain values, empty cells get cleared
+START_TEST (test_bt_value_group_pack_unpack_enum_column)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtValueGroup *vg = get_mono_value_group ();
+  GByteArray *data = g_byte_array_new ();
+  bt_value_group_set_event (vg, 0, 4, "10");
+  bt_value_group_set_event (vg, 1, 4, "5");
+  bt_value_group_set_event (vg, 3, 4, "20");
+  bt_value_group_pack_column (vg, 4, data);
+  bt_value_group_set_event (vg, 0, 4, NULL);
+  bt_value_group_set_event (vg, 2, 4, "1");
+
+  GST_INFO ("-- act --");
+  gboolean res = bt_value_group_unpack_column (vg, 4, data->data, data->len);
+
+  GST_INFO ("-- assert --");
+  ck_assert (res);
+  ck_assert_str_eq_and_free (bt_value_group_get_event (vg, 0, 4), "10");
+  ck_assert_str_eq_and_free (bt_value_group_get_event (vg, 1, 4), "5");
+  ck_assert (!bt_value_group_test_event (vg, 1, 4));
+  ck_assert_ptr_null (bt_value_group_get_event (vg, 2, 4));
+  ck_assert_str_eq_and_free (bt_value_group_get_event (vg, 3, 4), "20");
+
+  GST_INFO ("-- cleanup --");
+  g_byte_array_free (data, TRUE);
+  BT_TEST_END;
+}
+END_TEST
+
+// truncated data is rejected without changing the column
+START_TEST (test_bt_value_group_unpack_truncated_column)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtValueGroup *vg = get_mono_value_group ();
+  GByteArray *data = g_byte_array_new ();
+  bt_value_group_set_event (vg, 0, 0, "10");
+  bt_value_group_set_event (vg, 3, 0, "40");
+  bt_value_group_pack_column (vg, 0, data);
+  bt_value_group_set_event (vg, 1, 0, "20");
+
+  GST_INFO ("-- act --");
+  gboolean res =
+      bt_value_group_unpack_column (vg, 0, data->data, data->len - 1);
+
+  GST_INFO ("-- assert --");
+  ck_assert (!res);
+  ck_assert_str_eq_and_free (bt_value_group_get_event (vg, 0, 0), "10");
+  ck_assert_str_eq_and_free (bt_value_group_get_event (vg, 1, 0), "20");
+  ck_assert_str_eq_and_free (bt_value_group_get_event (vg, 3, 0), "40");
+
+  GST_INFO ("-- cleanup --");
+  g_byte_array_free (data, TRUE);
+  BT_TEST_END;
+}
+END_TEST
+
+// only the range is restored, the other cells are kept
+START_TEST (test_bt_value_group_pack_unpack_column_range)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtValueGroup *vg = get_mono_value_group ();
+  GByteArray *data = g_byte_array_new ();
+  bt_value_group_set_event (vg, 1, 0, "20");
+  bt_value_group_pack_column_range (vg, 1, 2, 0, data);
+  bt_value_group_set_event (vg, 0, 0, "10");
+  bt_value_group_set_event (vg, 1, 0, NULL);
+  bt_value_group_set_event (vg, 2, 0, "30");
+
+  GST_INFO ("-- act --");
+  gboolean res =
+      bt_value_group_unpack_column_range (vg, 1, 2, 0, data->data, data->len);
+
+  GST_INFO ("-- assert --");
+  ck_assert (res);
+  ck_assert_str_eq_and_free (bt_value_group_get_event (vg, 0, 0), "10");
+  ck_assert_str_eq_and_free (bt_value_group_get_event (vg, 1, 0), "20");
+  ck_assert_ptr_null (bt_value_group_get_event (vg, 2, 0));
+
+  GST_INFO ("-- cleanup --");
+  g_byte_array_free (data, TRUE);
+  BT_TEST_END;
+}
+END_TEST
+
 START_TEST (test_bt_value_group_flip_column)
 {
   BT_TEST_START;
@@ -343,6 +468,31 @@ START_TEST (test_bt_value_group_transpose_fine_down_column)
 }
 END_TEST
 
+START_TEST (test_bt_value_group_deserialize_column)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtValueGroup *vg = get_mono_value_group ();
+  guint changes = 0;
+  g_signal_connect (vg, "group-changed", G_CALLBACK (on_group_changed),
+      &changes);
+
+  GST_INFO ("-- act --");
+  gboolean res = bt_value_group_deserialize_column (vg, 1, 2, 0,
+      "guint,10,20");
+
+  GST_INFO ("-- assert --");
+  ck_assert (res);
+  ck_assert_str_eq_and_free (bt_value_group_get_event (vg, 0, 0), NULL);
+  ck_assert_str_eq_and_free (bt_value_group_get_event (vg, 1, 0), "10");
+  ck_assert_str_eq_and_free (bt_value_group_get_event (vg, 2, 0), "20");
+  ck_assert_uint_eq (changes, 1);
+
+  GST_INFO ("-- cleanup --");
+  BT_TEST_END;
+}
+END_TEST
+
 START_TEST (test_bt_value_group_copy)
 {
   BT_TEST_START;
@@ -374,12 +524,18 @@ bt_value_group_example_case (void)
   tcase_add_test (tc, test_bt_value_group_clear_column);
   tcase_add_test (tc, test_bt_value_group_clear_columns);
   tcase_add_loop_test (tc, test_bt_value_group_blend_column, 0, NUM_COLUMNS);
+  tcase_add_loop_test (tc, test_bt_value_group_pack_unpack_column, 0,
+      NUM_COLUMNS);
+  tcase_add_test (tc, test_bt_value_group_pack_unpack_enum_column);
+  tcase_add_test (tc, test_bt_value_group_unpack_truncated_column);
+  tcase_add_test (tc, test_bt_value_group_pack_unpack_column_range);
   tcase_add_test (tc, test_bt_value_group_flip_column);
   tcase_add_loop_test (tc, test_bt_value_group_randomize_column, 0,
       NUM_COLUMNS);
   tcase_add_test (tc, test_bt_value_group_range_randomize_column);
   tcase_add_test (tc, test_bt_value_group_transpose_fine_up_column);
   tcase_add_test (tc, test_bt_value_group_transpose_fine_down_column);
+  tcase_add_test (tc, test_bt_value_group_deserialize_column);
   tcase_add_test (tc, test_bt_value_group_copy);
   tcase_add_checked_fixture (tc, test_setup, test_teardown);
   tcase_add_unchecked_fixture (tc, case_setup, case_teardown);
@@ -222,6 +222,152 @@ START_TEST (test_bt_wave_table_callbacks_get_wave)
 }
 END_TEST
 
+START_TEST (test_bt_wave_table_evicts_least_recently_used)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtWavetable *wave_table =
+      (BtWavetable *) check_gobject_get_object_property (song, "wavetable");
+  BtWave *wave1 = bt_wave_new (song, "sample1", ext_data_uri, 1, 1.0,
+      BT_WAVE_LOOP_MODE_OFF, 0);
+  BtWave *wave2 = bt_wave_new (song, "sample2", ext_data_uri, 2, 1.0,
+      BT_WAVE_LOOP_MODE_OFF, 0);
+  guint64 size, resident1, resident2;
+  bt_wave_get_memory_usage (wave1, NULL, &size);
+  g_object_set (wave_table, "memory-budget", size, NULL);
+
+  GST_INFO ("-- act --");
+  bt_wavetable_touch_wave (wave_table, wave1);
+  while (g_main_context_iteration (NULL, FALSE));
+  bt_wavetable_touch_wave (wave_table, wave2);
+  while (g_main_context_iteration (NULL, FALSE));
+
+  GST_INFO ("-- assert --");
+  bt_wave_get_memory_usage (wave1, &resident1, NULL);
+  bt_wave_get_memory_usage (wave2, &resident2, NULL);
+  ck_assert_uint_gt (size, 0);
+  ck_assert_uint_eq (resident1, 0);
+  ck_assert_uint_eq (resident2, size);
+  guint64 resident_size;
+  g_object_get (wave_table, "resident-size", &resident_size, NULL);
+  ck_assert_uint_eq (resident_size, size);
+
+  GST_INFO ("-- cleanup --");
+  g_object_unref (wave1);
+  g_object_unref (wave2);
+  g_object_unref (wave_table);
+  BT_TEST_END;
+}
+END_TEST
+
+START_TEST (test_bt_wave_table_keeps_waves_in_use)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtWavetable *wave_table =
+      (BtWavetable *) check_gobject_get_object_property (song, "wavetable");
+  BtWave *wave1 = bt_wave_new (song, "sample1", ext_data_uri, 1, 1.0,
+      BT_WAVE_LOOP_MODE_OFF, 0);
+  BtWave *wave2 = bt_wave_new (song, "sample2", ext_data_uri, 2, 1.0,
+      BT_WAVE_LOOP_MODE_OFF, 0);
+  gpointer *cb = (gpointer *) bt_wavetable_get_callbacks (wave_table);
+  GstStructure *(*get_wave_buffer) (gpointer, guint, guint) = cb[1];
+  guint64 size, resident1, resident2;
+  bt_wave_get_memory_usage (wave1, NULL, &size);
+  g_object_set (wave_table, "memory-budget", size, NULL);
+
+  GST_INFO ("-- act --");
+  GstStructure *s = get_wave_buffer (cb[0], 1, 0);
+  while (g_main_context_iteration (NULL, FALSE));
+  bt_wavetable_use_wave (wave_table, wave2);
+  while (g_main_context_iteration (NULL, FALSE));
+
+  GST_INFO ("-- assert --");
+  bt_wave_get_memory_usage (wave1, &resident1, NULL);
+  bt_wave_get_memory_usage (wave2, &resident2, NULL);
+  ck_assert_uint_eq (resident1, size);
+  ck_assert_uint_eq (resident2, size);
+
+  GST_INFO ("-- cleanup --");
+  bt_wavetable_release_wave (wave_table, wave2);
+  gst_structure_free (s);
+  g_object_unref (wave1);
+  g_object_unref (wave2);
+  g_object_unref (wave_table);
+  BT_TEST_END;
+}
+END_TEST
+
+START_TEST (test_bt_wave_table_evicts_released_waves)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtWavetable *wave_table =
+      (BtWavetable *) check_gobject_get_object_property (song, "wavetable");
+  BtWave *wave1 = bt_wave_new (song, "sample1", ext_data_uri, 1, 1.0,
+      BT_WAVE_LOOP_MODE_OFF, 0);
+  BtWave *wave2 = bt_wave_new (song, "sample2", ext_data_uri, 2, 1.0,
+      BT_WAVE_LOOP_MODE_OFF, 0);
+  guint64 size, resident1, resident2;
+  bt_wave_get_memory_usage (wave1, NULL, &size);
+  g_object_set (wave_table, "memory-budget", size, NULL);
+  bt_wavetable_use_wave (wave_table, wave1);
+  bt_wavetable_touch_wave (wave_table, wave2);
+  while (g_main_context_iteration (NULL, FALSE));
+
+  GST_INFO ("-- act --");
+  bt_wavetable_release_wave (wave_table, wave1);
+  bt_wavetable_touch_wave (wave_table, wave2);
+  while (g_main_context_iteration (NULL, FALSE));
+
+  GST_INFO ("-- assert --");
+  bt_wave_get_memory_usage (wave1, &resident1, NULL);
+  bt_wave_get_memory_usage (wave2, &resident2, NULL);
+  ck_assert_uint_eq (resident1, 0);
+  ck_assert_uint_eq (resident2, size);
+
+  GST_INFO ("-- cleanup --");
+  g_object_unref (wave1);
+  g_object_unref (wave2);
+  g_object_unref (wave_table);
+  BT_TEST_END;
+}
+END_TEST
+
+START_TEST (test_bt_wave_table_keeps_modified_waves)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtWavetable *wave_table =
+      (BtWavetable *) check_gobject_get_object_property (song, "wavetable");
+  BtWave *wave1 = bt_wave_new (song, "sample1", ext_data_uri, 1, 1.0,
+      BT_WAVE_LOOP_MODE_OFF, 0);
+  BtWave *wave2 = bt_wave_new (song, "sample2", ext_data_uri, 2, 1.0,
+      BT_WAVE_LOOP_MODE_OFF, 0);
+  guint64 size, resident1;
+  bt_wave_get_memory_usage (wave1, NULL, &size);
+  g_object_set (wave_table, "memory-budget", size, NULL);
+
+  GST_INFO ("-- act --");
+  bt_wave_mark_modified (wave1);
+  bt_wavetable_touch_wave (wave_table, wave1);
+  while (g_main_context_iteration (NULL, FALSE));
+  bt_wavetable_touch_wave (wave_table, wave2);
+  while (g_main_context_iteration (NULL, FALSE));
+
+  GST_INFO ("-- assert --");
+  bt_wave_get_memory_usage (wave1, &resident1, NULL);
+  ck_assert_uint_eq (resident1, size);
+  ck_assert_uint_eq (bt_wave_evict (wave1), 0);
+
+  GST_INFO ("-- cleanup --");
+  g_object_unref (wave1);
+  g_object_unref (wave2);
+  g_object_unref (wave_table);
+  BT_TEST_END;
+}
+END_TEST
+
 TCase *
 bt_wave_table_example_case (void)
 {
@@ -234,6 +380,10 @@ bt_wave_table_example_case (void)
   tcase_add_test (tc, test_bt_wave_table_replace_wave);
   tcase_add_test (tc, test_bt_wave_table_get_callbacks);
   tcase_add_test (tc, test_bt_wave_table_callbacks_get_wave);
+  tcase_add_test (tc, test_bt_wave_table_evicts_least_recently_used);
+  tcase_add_test (tc, test_bt_wave_table_keeps_waves_in_use);
+  tcase_add_test (tc, test_bt_wave_table_evicts_released_waves);
+  tcase_add_test (tc, test_bt_wave_table_keeps_modified_waves);
   tcase_add_checked_fixture (tc, test_setup, test_teardown);
   tcase_add_unchecked_fixture (tc, case_setup, case_teardown);
   return tc;
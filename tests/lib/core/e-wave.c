@@ -16,6 +16,8 @@
  */
 
 #include "m-bt-core.h"
+#include <glib/gstdio.h>
+#include <utime.h>
 
 //-- globals
 
@@ -54,6 +56,55 @@ case_teardown (void)
 {
 }
 
+//-- helper
+
+static gchar *
+get_cache_dir (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), PACKAGE, "waves", NULL);
+}
+
+static void
+put_le32 (guint8 * data, guint32 val)
+{
+  data[0] = val & 0xff;
+  data[1] = (val >> 8) & 0xff;
+  data[2] = (val >> 16) & 0xff;
+  data[3] = (val >> 24) & 0xff;
+}
+
+/* write a short mono wav file with random samples, so that it is not in the
+ * wave cache yet */
+static gchar *
+make_random_wave_uri (void)
+{
+  gchar *path = g_build_filename (g_get_tmp_dir (), "bt-test-random.wav",
+      NULL);
+  gchar *uri = g_strconcat ("file://", path, NULL);
+  const guint frames = 1000;
+  gsize size = 44 + frames * sizeof (gint16);
+  guint8 *data = g_malloc (size);
+  guint i;
+
+  memcpy (data, "RIFF", 4);
+  put_le32 (data + 4, size - 8);
+  memcpy (data + 8, "WAVEfmt ", 8);
+  put_le32 (data + 16, 16);
+  put_le32 (data + 20, 1 | (1 << 16));  // pcm, mono
+  put_le32 (data + 24, 44100);
+  put_le32 (data + 28, 44100 * sizeof (gint16));
+  put_le32 (data + 32, sizeof (gint16) | (16 << 16));
+  memcpy (data + 36, "data", 4);
+  put_le32 (data + 40, frames * sizeof (gint16));
+  for (i = 44; i < size; i++) {
+    data[i] = (guint8) g_random_int ();
+  }
+  g_file_set_contents (path, (gchar *) data, size, NULL);
+  g_free (data);
+  g_free (path);
+  return uri;
+}
+
 
 //-- tests
 
@@ -77,12 +128,136 @@ START_TEST (test_bt_wave_default_levels)
 }
 END_TEST
 
+// the second wave maps the decoded sample from the cache
+START_TEST (test_bt_wave_cached_data)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtWave *wave1 = bt_wave_new (song, "sample1", ext_data_uri, 1, 1.0,
+      BT_WAVE_LOOP_MODE_OFF, 0);
+
+  GST_INFO ("-- act --");
+  BtWave *wave2 = bt_wave_new (song, "sample2", ext_data_uri, 2, 1.0,
+      BT_WAVE_LOOP_MODE_OFF, 0);
+
+  GST_INFO ("-- assert --");
+  BtWavelevel *wl1 = bt_wave_get_level_by_index (wave1, 0);
+  BtWavelevel *wl2 = bt_wave_get_level_by_index (wave2, 0);
+  GMappedFile *mapping;
+  gint16 *data1, *data2;
+  gulong length1, length2;
+  g_object_get (wl1, "data", &data1, "length", &length1, NULL);
+  g_object_get (wl2, "data", &data2, "length", &length2, "mapped-file",
+      &mapping, NULL);
+  ck_assert (mapping != NULL);
+  ck_assert_ulong_eq (length1, length2);
+  ck_assert (!memcmp (data1, data2, length1 * sizeof (gint16)));
+
+  GST_INFO ("-- cleanup --");
+  g_mapped_file_unref (mapping);
+  g_object_unref (wl1);
+  g_object_unref (wl2);
+  g_object_unref (wave1);
+  g_object_unref (wave2);
+  BT_TEST_END;
+}
+END_TEST
+
+// local files get a link in the cache, so that they don't need to be hashed
+START_TEST (test_bt_wave_cache_link)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  gchar *cache_dir = get_cache_dir ();
+
+  GST_INFO ("-- act --");
+  BtWave *wave = bt_wave_new (song, "sample1", ext_data_uri, 1, 1.0,
+      BT_WAVE_LOOP_MODE_OFF, 0);
+
+  GST_INFO ("-- assert --");
+  BtWavelevel *wl = bt_wave_get_level_by_index (wave, 0);
+  gchar *data_file, *data_name, *target;
+  const gchar *name;
+  gboolean found = FALSE;
+  g_object_get (wl, "data-file", &data_file, NULL);
+  ck_assert (data_file != NULL);
+  data_name = g_path_get_basename (data_file);
+  GDir *dir = g_dir_open (cache_dir, 0, NULL);
+  ck_assert (dir != NULL);
+  while ((name = g_dir_read_name (dir)) && !found) {
+    if (g_str_has_suffix (name, ".lnk")) {
+      gchar *path = g_build_filename (cache_dir, name, NULL);
+      if ((target = g_file_read_link (path, NULL))) {
+        found = !strcmp (target, data_name);
+        g_free (target);
+      }
+      g_free (path);
+    }
+  }
+  ck_assert (found);
+
+  GST_INFO ("-- cleanup --");
+  g_dir_close (dir);
+  g_free (data_name);
+  g_free (data_file);
+  g_free (cache_dir);
+  g_object_unref (wl);
+  g_object_unref (wave);
+  BT_TEST_END;
+}
+END_TEST
+
+// decoding a new sample removes the least recently used ones
+START_TEST (test_bt_wave_cache_is_trimmed)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtSettings *settings = bt_settings_make ();
+  gchar *cache_dir = get_cache_dir ();
+  gchar *old_path = g_build_filename (cache_dir, "bt-test-old.raw", NULL);
+  gchar *uri = make_random_wave_uri ();
+  gchar *old_data = g_malloc0 (2 * 1024 * 1024);
+  struct utimbuf times = { 0, 0 };
+  g_mkdir_with_parents (cache_dir, 0700);
+  g_file_set_contents (old_path, old_data, 2 * 1024 * 1024, NULL);
+  utime (old_path, &times);
+  g_object_set (settings, "wave-cache-size", 1, NULL);
+
+  GST_INFO ("-- act --");
+  BtWave *wave = bt_wave_new (song, "sample1", uri, 1, 1.0,
+      BT_WAVE_LOOP_MODE_OFF, 0);
+
+  GST_INFO ("-- assert --");
+  BtWavelevel *wl = bt_wave_get_level_by_index (wave, 0);
+  gchar *data_file;
+  g_object_get (wl, "data-file", &data_file, NULL);
+  ck_assert (!g_file_test (old_path, G_FILE_TEST_EXISTS));
+  ck_assert (g_file_test (data_file, G_FILE_TEST_EXISTS));
+
+  GST_INFO ("-- cleanup --");
+  g_object_set (settings, "wave-cache-size", 4096, NULL);
+  g_unlink (old_path);
+  g_free (data_file);
+  g_free (old_data);
+  g_free (old_path);
+  g_free (cache_dir);
+  g_free (uri);
+  g_object_unref (wl);
+  g_object_unref (wave);
+  g_object_unref (settings);
+  BT_TEST_END;
+}
+END_TEST
+
 TCase *
 bt_wave_example_case (void)
 {
   TCase *tc = tcase_create ("BtWaveExamples");
 
   tcase_add_test (tc, test_bt_wave_default_levels);
+  tcase_add_test (tc, test_bt_wave_cached_data);
+  tcase_add_test (tc, test_bt_wave_cache_link);
+  tcase_add_test (tc, test_bt_wave_cache_is_trimmed);
   tcase_add_checked_fixture (tc, test_setup, test_teardown);
   tcase_add_unchecked_fixture (tc, case_setup, case_teardown);
   return tc;
@@ -27,8 +27,11 @@
 typedef struct
 {
   gsize size;
+  gpointer data;
+  GstBufferPool *pool;
   GstClockTime ts, duration;
   guint64 offset, offset_end;
+  guint subtick_offset;
 } BufferFields;
 
 typedef struct _BtTestAudioSynth
@@ -85,8 +88,8 @@ bt_test_audio_synth_reset (GstBtAudioSynth * base)
 }
 
 static gboolean
-bt_test_audio_synth_process (GstBtAudioSynth * base, GstBuffer * data,
-    GstMapInfo * info)
+bt_test_audio_synth_process_segment (GstBtAudioSynth * base, GstBuffer * data,
+    GstMapInfo * info, guint offset)
 {
   BtTestAudioSynth *self = (BtTestAudioSynth *) base;
   BufferFields *bf = g_new (BufferFields, 1);
@@ -96,10 +99,20 @@ bt_test_audio_synth_process (GstBtAudioSynth * base, GstBuffer * data,
   bf->offset = GST_BUFFER_OFFSET (data);
   bf->offset_end = GST_BUFFER_OFFSET_END (data);
   bf->size = info->size;
+  bf->data = info->data;
+  bf->pool = data->pool;
+  bf->subtick_offset = offset;
   self->buffer_info = g_list_append (self->buffer_info, bf);
   return TRUE;
 }
 
+static gboolean
+bt_test_audio_synth_process (GstBtAudioSynth * base, GstBuffer * data,
+    GstMapInfo * info)
+{
+  return bt_test_audio_synth_process_segment (base, data, info, 0);
+}
+
 static void
 bt_test_audio_synth_init (BtTestAudioSynth * self)
 {
@@ -130,6 +143,7 @@ bt_test_audio_synth_class_init (BtTestAudioSynthClass * klass)
   object_class->finalize = bt_test_audio_synth_finalize;
 
   audio_synth_class->process = bt_test_audio_synth_process;
+  audio_synth_class->process_segment = bt_test_audio_synth_process_segment;
   audio_synth_class->reset = bt_test_audio_synth_reset;
   audio_synth_class->negotiate = bt_test_audio_synth_negotiate;
 
@@ -138,12 +152,38 @@ bt_test_audio_synth_class_init (BtTestAudioSynthClass * klass)
       "Use in unit tests", "Stefan Sauer <ensonic@users.sf.net>");
 }
 
+/* a subclass that only implements process() and thus expects to be called
+ * once per subtick */
+#define GSTBT_TYPE_TEST_SUBTICK_AUDIO_SYNTH \
+    (bt_test_subtick_audio_synth_get_type())
+
+typedef BtTestAudioSynth BtTestSubtickAudioSynth;
+typedef BtTestAudioSynthClass BtTestSubtickAudioSynthClass;
+
+G_DEFINE_TYPE (BtTestSubtickAudioSynth, bt_test_subtick_audio_synth,
+    GSTBT_TYPE_TEST_AUDIO_SYNTH);
+
+static void
+bt_test_subtick_audio_synth_init (BtTestSubtickAudioSynth * self)
+{
+}
+
+static void
+bt_test_subtick_audio_synth_class_init (BtTestSubtickAudioSynthClass * klass)
+{
+  GstBtAudioSynthClass *audio_synth_class = (GstBtAudioSynthClass *) klass;
+
+  audio_synth_class->process_segment = NULL;
+}
+
 gboolean
 bt_test_audio_synth_plugin_init (GstPlugin * const plugin)
 {
   GST_INFO ("register element");
   gst_element_register (plugin, "buzztrax-test-audio-synth",
       GST_RANK_NONE, GSTBT_TYPE_TEST_AUDIO_SYNTH);
+  gst_element_register (plugin, "buzztrax-test-subtick-audio-synth",
+      GST_RANK_NONE, GSTBT_TYPE_TEST_SUBTICK_AUDIO_SYNTH);
   return TRUE;
 }
 
@@ -522,6 +562,171 @@ START_TEST (test_position_query_time)
 }
 END_TEST
 
+START_TEST (test_buffers_come_from_pool)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  GstElement *p =
+      gst_parse_launch
+      ("buzztrax-test-audio-synth name=\"src\" num-buffers=200 ! fakesink async=false",
+      NULL);
+  BtTestAudioSynth *e =
+      (BtTestAudioSynth *) gst_bin_get_by_name (GST_BIN (p), "src");
+  GstBus *bus = gst_element_get_bus (p);
+  GHashTable *allocs = g_hash_table_new (NULL, NULL);
+  GstClockTime duration = G_GUINT64_CONSTANT (0);
+  GstBufferPool *pool;
+  GList *node;
+
+  GST_INFO ("-- act --");
+  gst_element_set_state (p, GST_STATE_READY);
+  gst_element_set_context (p, ctx);
+  gst_element_set_state (p, GST_STATE_PLAYING);
+  gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, GST_CLOCK_TIME_NONE);
+  pool = gst_base_src_get_buffer_pool (GST_BASE_SRC (e));
+
+  GST_INFO ("-- assert --");
+  ck_assert (pool != NULL);
+  // every new memory block we get to fill counts as an allocation
+  for (node = e->buffer_info; node; node = g_list_next (node)) {
+    BufferFields *bf = (BufferFields *) node->data;
+    ck_assert (bf->pool == pool);
+    g_hash_table_add (allocs, bf->data);
+    duration += bf->duration;
+  }
+  guint num_allocs = g_hash_table_size (allocs);
+  GST_INFO ("%u allocations for %u buffers, %.1lf allocations/s", num_allocs,
+      g_list_length (e->buffer_info),
+      (gdouble) num_allocs * GST_SECOND / (gdouble) duration);
+  ck_assert_uint_le (num_allocs, 4);
+
+  GST_INFO ("-- cleanup --");
+  g_hash_table_destroy (allocs);
+  gst_object_unref (pool);
+  gst_element_set_state (p, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (e);
+  gst_object_unref (p);
+  BT_TEST_END;
+}
+END_TEST
+
+START_TEST (test_fixed_buffer_size_is_split_at_subticks)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  GstElement *p =
+      gst_parse_launch
+      ("buzztrax-test-audio-synth name=\"src\" num-buffers=1 ! fakesink async=false",
+      NULL);
+  BtTestAudioSynth *e =
+      (BtTestAudioSynth *) gst_bin_get_by_name (GST_BIN (p), "src");
+  GstBus *bus = gst_element_get_bus (p);
+  GstContext *block_ctx = gstbt_audio_tempo_context_new (120, 4, 8);
+  gstbt_audio_tempo_context_set_buffer_frames (block_ctx, 1024);
+
+  GST_INFO ("-- act --");
+  gst_element_set_state (p, GST_STATE_READY);
+  gst_element_set_context (p, block_ctx);
+  gst_element_set_state (p, GST_STATE_PLAYING);
+  gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, GST_CLOCK_TIME_NONE);
+
+  GST_INFO ("-- assert --");
+  // one subtick is (44100 * (60.0 / 8)) / (120 * 4) = 689.06 frames
+  ck_assert_uint_eq (g_list_length (e->buffer_info), 2);
+  BufferFields *bf0 = get_buffer_info (e, 0);
+  BufferFields *bf1 = get_buffer_info (e, 1);
+  ck_assert_uint_eq (bf0->size, sizeof (gint16) * 689);
+  ck_assert_uint_eq (bf1->size, sizeof (gint16) * (1024 - 689));
+  ck_assert_uint64_eq (bf0->ts, 0L);
+  ck_assert_uint64_eq (bf1->ts, gst_util_uint64_scale_int (689, GST_SECOND,
+          44100));
+
+  GST_INFO ("-- cleanup --");
+  gst_element_set_state (p, GST_STATE_NULL);
+  gst_context_unref (block_ctx);
+  gst_object_unref (bus);
+  gst_object_unref (e);
+  gst_object_unref (p);
+  BT_TEST_END;
+}
+END_TEST
+
+START_TEST (test_fixed_buffer_size_continues_subtick)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  GstElement *p =
+      gst_parse_launch
+      ("buzztrax-test-audio-synth name=\"src\" num-buffers=2 ! fakesink async=false",
+      NULL);
+  BtTestAudioSynth *e =
+      (BtTestAudioSynth *) gst_bin_get_by_name (GST_BIN (p), "src");
+  GstBus *bus = gst_element_get_bus (p);
+  GstContext *block_ctx = gstbt_audio_tempo_context_new (120, 4, 8);
+  gstbt_audio_tempo_context_set_buffer_frames (block_ctx, 1024);
+
+  GST_INFO ("-- act --");
+  gst_element_set_state (p, GST_STATE_READY);
+  gst_element_set_context (p, block_ctx);
+  gst_element_set_state (p, GST_STATE_PLAYING);
+  gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, GST_CLOCK_TIME_NONE);
+
+  GST_INFO ("-- assert --");
+  // the 2nd subtick starts at 689 and ends at 1378 in the 2nd buffer
+  ck_assert_uint_eq (g_list_length (e->buffer_info), 4);
+  ck_assert_uint_eq (get_buffer_info (e, 0)->subtick_offset, 0);
+  ck_assert_uint_eq (get_buffer_info (e, 1)->subtick_offset, 0);
+  ck_assert_uint_eq (get_buffer_info (e, 2)->subtick_offset, 1024 - 689);
+  ck_assert_uint_eq (get_buffer_info (e, 2)->size,
+      sizeof (gint16) * (1378 - 1024));
+  ck_assert_uint_eq (get_buffer_info (e, 3)->subtick_offset, 0);
+
+  GST_INFO ("-- cleanup --");
+  gst_element_set_state (p, GST_STATE_NULL);
+  gst_context_unref (block_ctx);
+  gst_object_unref (bus);
+  gst_object_unref (e);
+  gst_object_unref (p);
+  BT_TEST_END;
+}
+END_TEST
+
+START_TEST (test_fixed_buffer_size_needs_process_segment)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  GstElement *p =
+      gst_parse_launch
+      ("buzztrax-test-subtick-audio-synth name=\"src\" num-buffers=1 ! fakesink async=false",
+      NULL);
+  BtTestAudioSynth *e =
+      (BtTestAudioSynth *) gst_bin_get_by_name (GST_BIN (p), "src");
+  GstBus *bus = gst_element_get_bus (p);
+  GstContext *block_ctx = gstbt_audio_tempo_context_new (120, 4, 8);
+  gstbt_audio_tempo_context_set_buffer_frames (block_ctx, 1024);
+
+  GST_INFO ("-- act --");
+  gst_element_set_state (p, GST_STATE_READY);
+  gst_element_set_context (p, block_ctx);
+  gst_element_set_state (p, GST_STATE_PLAYING);
+  gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, GST_CLOCK_TIME_NONE);
+
+  GST_INFO ("-- assert --");
+  // process() is called once for a buffer of one subtick
+  ck_assert_uint_eq (g_list_length (e->buffer_info), 1);
+  ck_assert_uint_eq (get_buffer_info (e, 0)->size, sizeof (gint16) * 689);
+
+  GST_INFO ("-- cleanup --");
+  gst_element_set_state (p, GST_STATE_NULL);
+  gst_context_unref (block_ctx);
+  gst_object_unref (bus);
+  gst_object_unref (e);
+  gst_object_unref (p);
+  BT_TEST_END;
+}
+END_TEST
+
 /*
 test buffer metadata in process
   - backwards playback
@@ -543,6 +748,10 @@ gst_buzztrax_audiosynth_example_case (void)
   tcase_add_test (tc, test_no_reset_without_seeks);
   tcase_add_test (tc, test_reset_on_seek);
   tcase_add_test (tc, test_position_query_time);
+  tcase_add_test (tc, test_buffers_come_from_pool);
+  tcase_add_test (tc, test_fixed_buffer_size_is_split_at_subticks);
+  tcase_add_test (tc, test_fixed_buffer_size_continues_subtick);
+  tcase_add_test (tc, test_fixed_buffer_size_needs_process_segment);
   tcase_add_unchecked_fixture (tc, case_setup, case_teardown);
   return tc;
 }
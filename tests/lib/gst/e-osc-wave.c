@@ -17,6 +17,9 @@
 
 #include "m-bt-gst.h"
 
+#include <unistd.h>
+#include <glib/gstdio.h>
+
 #include "gst/osc-wave.h"
 
 //-- globals
@@ -49,6 +52,53 @@ get_stereo_wave_buffer (gpointer user_data, guint wave_ix, guint wave_level_ix)
       "buffer", GST_TYPE_BUFFER, buffer, NULL);
 }
 
+// a wave that is longer than the resident head of a stream
+#define STREAM_WAVE_SIZE 100000
+#define STREAM_WAVE_OFFSET 16
+
+static GstStructure *
+get_streamed_wave_buffer (gpointer user_data, guint wave_ix,
+    guint wave_level_ix)
+{
+  gsize size = STREAM_WAVE_SIZE * sizeof (gint16);
+  GstBuffer *buffer = gst_buffer_new_allocate (NULL, size, NULL);
+  GstMapInfo info;
+  gint16 *data;
+  gint i;
+
+  // the buffer maps the same samples that are in the file
+  gst_buffer_map (buffer, &info, GST_MAP_WRITE);
+  data = (gint16 *) info.data;
+  for (i = 0; i < STREAM_WAVE_SIZE; i++)
+    data[i] = i & 0x7FFF;
+  gst_buffer_unmap (buffer, &info);
+
+  return gst_structure_new ("audio/x-raw",
+      "channels", G_TYPE_INT, 1,
+      "root-note", GSTBT_TYPE_NOTE, (guint) GSTBT_NOTE_C_3,
+      "buffer", GST_TYPE_BUFFER, buffer,
+      "file", G_TYPE_STRING, (gchar *) user_data,
+      "offset", G_TYPE_UINT64, (guint64) STREAM_WAVE_OFFSET, NULL);
+}
+
+static gchar *
+make_streamed_wave_file (void)
+{
+  gint16 *data = g_new (gint16, STREAM_WAVE_SIZE);
+  gchar *file_name;
+  gint i, fd = g_file_open_tmp (NULL, &file_name, NULL);
+  guint8 header[STREAM_WAVE_OFFSET] = { 0, };
+
+  for (i = 0; i < STREAM_WAVE_SIZE; i++)
+    data[i] = i & 0x7FFF;
+  ck_assert (write (fd, header, sizeof (header)) == sizeof (header));
+  ck_assert (write (fd, data, STREAM_WAVE_SIZE * sizeof (gint16)) ==
+      STREAM_WAVE_SIZE * sizeof (gint16));
+  close (fd);
+  g_free (data);
+  return file_name;
+}
+
 static GstStructure *
 get_no_wave_buffer (gpointer user_data, guint wave_ix, guint wave_level_ix)
 {
@@ -259,6 +309,69 @@ START_TEST (test_osc_wave_create_stereo_beyond_size)
 }
 END_TEST
 
+START_TEST (test_osc_wave_create_streamed)
+{
+  BT_TEST_START;
+  GstBtOscWave *osc;
+  gint16 data[WAVE_SIZE];
+  gchar *file_name = make_streamed_wave_file ();
+  gpointer wave_callbacks[] = { file_name, get_streamed_wave_buffer };
+  gint i, tries = 0;
+  const guint64 off = STREAM_WAVE_SIZE - 1000;
+
+  GST_INFO ("-- arrange --");
+  osc = gstbt_osc_wave_new ();
+  g_object_set (osc, "wave-callbacks", wave_callbacks, NULL);
+
+  GST_INFO ("-- act --");
+  // this will underrun until the io thread has read the data
+  while (!osc->process (osc, off, WAVE_SIZE, data) && tries++ < 200)
+    g_usleep (G_USEC_PER_SEC / 100);
+
+  GST_INFO ("-- assert --");
+  ck_assert (osc->stream != NULL);
+  for (i = 0; i < WAVE_SIZE; i++)
+    ck_assert_int_eq (data[i], (gint16) ((off + i) & 0x7FFF));
+
+  GST_INFO ("-- cleanup --");
+  ck_gst_object_final_unref (osc);
+  g_unlink (file_name);
+  g_free (file_name);
+  BT_TEST_END;
+}
+END_TEST
+
+START_TEST (test_osc_wave_create_streamed_head)
+{
+  BT_TEST_START;
+  GstBtOscWave *osc;
+  gint16 data[WAVE_SIZE];
+  gchar *file_name = make_streamed_wave_file ();
+  gpointer wave_callbacks[] = { file_name, get_streamed_wave_buffer };
+  gint i;
+
+  GST_INFO ("-- arrange --");
+  osc = gstbt_osc_wave_new ();
+  g_object_set (osc, "wave-callbacks", wave_callbacks, NULL);
+
+  GST_INFO ("-- act --");
+  // the start of the wave is there without waiting for the io thread
+  gboolean res = osc->process (osc, 0, WAVE_SIZE, data);
+
+  GST_INFO ("-- assert --");
+  ck_assert (osc->stream != NULL);
+  ck_assert (res);
+  for (i = 0; i < WAVE_SIZE; i++)
+    ck_assert_int_eq (data[i], (gint16) (i & 0x7FFF));
+
+  GST_INFO ("-- cleanup --");
+  ck_gst_object_final_unref (osc);
+  g_unlink (file_name);
+  g_free (file_name);
+  BT_TEST_END;
+}
+END_TEST
+
 TCase *
 gst_buzztrax_osc_wave_example_case (void)
 {
@@ -272,6 +385,8 @@ gst_buzztrax_osc_wave_example_case (void)
   tcase_add_test (tc, test_osc_wave_create_stereo);
   tcase_add_test (tc, test_osc_wave_create_mono_beyond_size);
   tcase_add_test (tc, test_osc_wave_create_stereo_beyond_size);
+  tcase_add_test (tc, test_osc_wave_create_streamed);
+  tcase_add_test (tc, test_osc_wave_create_streamed_head);
   tcase_add_unchecked_fixture (tc, case_setup, case_teardown);
   return tc;
 }
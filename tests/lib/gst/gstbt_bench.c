@@ -0,0 +1,389 @@
+/* Buzztrax
+ * Copyright (C) 2016 Buzztrax team <buzztrax-devel@buzztrax.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * micro benchmarks for the dsp building blocks in libbuzztrax-gst
+ *
+ * invoke it e.g. as
+ *   ./gstbt_bench
+ *   ./gstbt_bench --samples=4000000 --filter=filter-svf
+ *
+ * For each block size and channel layout the kernel is run over the same
+ * amount of samples. Results are printed as one line per run:
+ *   <kernel> <variant> <channels> <block-size> <ns/sample> <samples/s>
+ *
+ * The output can be plotted with gnuplot, e.g.
+ *   ./gstbt_bench --filter=osc-synth >bench.txt
+ *   plot 'bench.txt' using 4:5 with linespoints
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "gst/combine.h"
+#include "gst/delay.h"
+#include "gst/envelope-ad.h"
+#include "gst/envelope-adsr.h"
+#include "gst/envelope-d.h"
+#include "gst/filter-svf.h"
+#include "gst/musicenums.h"
+#include "gst/osc-synth.h"
+#include "gst/osc-wave.h"
+
+#define SAMPLERATE 44100
+#define MIN_BLOCK_SIZE 64
+#define MAX_BLOCK_SIZE 8192
+/* size of the wave used for the wave oscillator in frames */
+#define WAVE_FRAMES (SAMPLERATE * 2)
+
+static gint64 num_samples = 2 * 1024 * 1024;
+static gchar *filter = NULL;
+
+/* scratch buffers, large enough for a stereo block of MAX_BLOCK_SIZE frames */
+static gint16 buf1[MAX_BLOCK_SIZE * 2];
+static gint16 buf2[MAX_BLOCK_SIZE * 2];
+static gdouble envbuf[MAX_BLOCK_SIZE * 2];
+
+/* keeps the optimizer from dropping the computation */
+static volatile gint64 sink;
+
+//-- helpers
+
+static void
+fill_noise (gint16 * data, guint size)
+{
+  guint i;
+
+  for (i = 0; i < size; i++)
+    data[i] = (gint16) g_random_int_range (G_MININT16, G_MAXINT16);
+}
+
+static void
+consume (gint16 * data, guint size)
+{
+  sink += data[0] + data[size - 1];
+}
+
+static void
+report (const gchar * kernel, const gchar * variant, gint channels,
+    guint block_size, gint64 samples, gdouble elapsed)
+{
+  gdouble ns_per_sample = (elapsed * 1.0e9) / (gdouble) samples;
+  gdouble samples_per_sec = (gdouble) samples / elapsed;
+
+  printf ("%-12s %-20s %d %5u %10.3lf %14.0lf\n", kernel, variant, channels,
+      block_size, ns_per_sample, samples_per_sec);
+}
+
+static gboolean
+is_selected (const gchar * kernel)
+{
+  return !filter || !strcmp (filter, kernel);
+}
+
+/* run the kernel for all block sizes, the kernel processes a block of
+ * 'block_size' frames with 'channels' interleaved channels */
+#define BENCH(kernel, variant, channels, block_code) G_STMT_START { \
+  guint block_size;                                                  \
+  for (block_size = MIN_BLOCK_SIZE; block_size <= MAX_BLOCK_SIZE;    \
+      block_size <<= 1) {                                            \
+    guint size = block_size * (channels);                            \
+    gint64 n, blocks = MAX (1, num_samples / size);                  \
+    GTimer *timer;                                                   \
+    /* warm caches and state */                                      \
+    block_code;                                                      \
+    timer = g_timer_new ();                                          \
+    for (n = 0; n < blocks; n++) {                                   \
+      block_code;                                                    \
+    }                                                                \
+    g_timer_stop (timer);                                            \
+    report (kernel, variant, (channels), block_size, blocks * size,  \
+        g_timer_elapsed (timer, NULL));                              \
+    g_timer_destroy (timer);                                         \
+  }                                                                  \
+} G_STMT_END
+
+//-- kernels
+
+static void
+bench_osc_synth (void)
+{
+  GEnumClass *enum_class = g_type_class_ref (GSTBT_TYPE_OSC_SYNTH_WAVE);
+  GstBtOscSynth *osc = gstbt_osc_synth_new ();
+  gint channels;
+  guint i;
+
+  g_object_set (osc, "sample-rate", SAMPLERATE, "frequency", 440.0,
+      "volume", 0.8, NULL);
+  for (i = 0; i < enum_class->n_values; i++) {
+    const gchar *variant = enum_class->values[i].value_nick;
+
+    g_object_set (osc, "wave", enum_class->values[i].value, NULL);
+    gstbt_osc_synth_trigger (osc);
+    /* the oscillator is mono, stereo is measured as an interleaved block */
+    for (channels = 1; channels <= 2; channels++) {
+      BENCH ("osc-synth", variant, channels, {
+            gstbt_osc_synth_process (osc, size, buf1); consume (buf1, size);}
+      );
+    }
+  }
+  gst_object_unref (osc);
+  g_type_class_unref (enum_class);
+}
+
+static void
+bench_filter_svf (void)
+{
+  GEnumClass *enum_class = g_type_class_ref (GSTBT_TYPE_FILTER_SVF_TYPE);
+  GstBtFilterSVF *flt = gstbt_filter_svf_new ();
+  gint channels;
+  guint i;
+
+  g_object_set (flt, "cut-off", 0.5, "resonance", 0.7, NULL);
+  for (i = 0; i < enum_class->n_values; i++) {
+    const gchar *variant = enum_class->values[i].value_nick;
+
+    g_object_set (flt, "filter", enum_class->values[i].value, NULL);
+    gstbt_filter_svf_trigger (flt);
+    for (channels = 1; channels <= 2; channels++) {
+      fill_noise (buf2, MAX_BLOCK_SIZE * 2);
+      /* restore the input each time, otherwise we filter silence after a
+       * while */
+      BENCH ("filter-svf", variant, channels, {
+            memcpy (buf1, buf2, size * sizeof (gint16));
+            gstbt_filter_svf_process (flt, size, buf1); consume (buf1, size);}
+      );
+    }
+  }
+  gst_object_unref (flt);
+  g_type_class_unref (enum_class);
+}
+
+static void
+bench_combine (void)
+{
+  GEnumClass *enum_class = g_type_class_ref (GSTBT_TYPE_COMBINE_TYPE);
+  GstBtCombine *cmb = gstbt_combine_new ();
+  gint16 *src = g_new (gint16, MAX_BLOCK_SIZE * 2);
+  gint channels;
+  guint i;
+
+  fill_noise (src, MAX_BLOCK_SIZE * 2);
+  fill_noise (buf2, MAX_BLOCK_SIZE * 2);
+  for (i = 0; i < enum_class->n_values; i++) {
+    const gchar *variant = enum_class->values[i].value_nick;
+
+    g_object_set (cmb, "combine", enum_class->values[i].value, NULL);
+    gstbt_combine_trigger (cmb);
+    for (channels = 1; channels <= 2; channels++) {
+      BENCH ("combine", variant, channels, {
+            memcpy (buf1, src, size * sizeof (gint16));
+            gstbt_combine_process (cmb, size, buf1, buf2);
+            consume (buf1, size);}
+      );
+    }
+  }
+  g_free (src);
+  gst_object_unref (cmb);
+  g_type_class_unref (enum_class);
+}
+
+static void
+bench_delay (void)
+{
+  GstBtDelay *delay = gstbt_delay_new ();
+  gint channels;
+
+  g_object_set (delay, "delaytime", 50, NULL);
+  gstbt_delay_start (delay, SAMPLERATE);
+  fill_noise (buf2, MAX_BLOCK_SIZE * 2);
+  /* same read/mix/write loop as the audiodelay element */
+  for (channels = 1; channels <= 2; channels++) {
+    BENCH ("delay", "feedback", channels, {
+          guint rb_in, rb_out, j;
+          gint32 v; gint16 d;
+          GSTBT_DELAY_BEFORE (delay, rb_in, rb_out);
+          for (j = 0; j < size; j++) {
+            GSTBT_DELAY_READ (delay, rb_out, d);
+            v = buf2[j] + ((d * 50) / 100);
+            buf1[j] = (gint16) CLAMP (v, G_MININT16, G_MAXINT16);
+            GSTBT_DELAY_WRITE (delay, rb_in, buf1[j]);}
+          GSTBT_DELAY_AFTER (delay, rb_in, rb_out); consume (buf1, size);}
+    );
+  }
+  gstbt_delay_stop (delay);
+  g_object_unref (delay);
+}
+
+static void
+bench_envelope (const gchar * variant, GstBtEnvelope * env)
+{
+  GstControlSource *cs = (GstControlSource *) env;
+  gint channels;
+
+  for (channels = 1; channels <= 2; channels++) {
+    guint64 offset = 0;
+
+    /* sweep through the whole envelope and wrap around */
+    BENCH ("envelope", variant, channels, {
+          gst_control_source_get_value_array (cs, offset, 1, size, envbuf);
+          sink += (gint64) envbuf[size - 1]; offset += size;
+          if (offset > env->length) offset = 0;}
+    );
+  }
+}
+
+static void
+bench_envelopes (void)
+{
+  GstBtEnvelopeAD *ad = gstbt_envelope_ad_new ();
+  GstBtEnvelopeADSR *adsr = gstbt_envelope_adsr_new ();
+  GstBtEnvelopeD *d = gstbt_envelope_d_new ();
+
+  g_object_set (ad, "attack", 0.05, "decay", 0.5, NULL);
+  gstbt_envelope_ad_setup (ad, SAMPLERATE);
+  bench_envelope ("ad", (GstBtEnvelope *) ad);
+
+  g_object_set (adsr, "length", 4, "attack", 0.05, "decay", 0.2,
+      "release", 0.5, NULL);
+  gstbt_envelope_adsr_setup (adsr, SAMPLERATE, GST_SECOND / 8);
+  bench_envelope ("adsr", (GstBtEnvelope *) adsr);
+
+  g_object_set (d, "decay", 0.5, NULL);
+  gstbt_envelope_d_setup (d, SAMPLERATE);
+  bench_envelope ("d", (GstBtEnvelope *) d);
+
+  gst_object_unref (ad);
+  gst_object_unref (adsr);
+  gst_object_unref (d);
+}
+
+static GstStructure *
+get_wave_buffer (gpointer user_data, guint wave_ix, guint wave_level_ix)
+{
+  gint channels = GPOINTER_TO_INT (user_data);
+  gsize size = WAVE_FRAMES * channels * sizeof (gint16);
+  gint16 *data = g_malloc (size);
+  GstBuffer *buffer;
+  GstStructure *s;
+
+  fill_noise (data, WAVE_FRAMES * channels);
+  buffer = gst_buffer_new_wrapped (data, size);
+  s = gst_structure_new ("audio/x-raw",
+      "channels", G_TYPE_INT, channels,
+      "root-note", GSTBT_TYPE_NOTE, (guint) GSTBT_NOTE_C_3,
+      "buffer", GST_TYPE_BUFFER, buffer, NULL);
+  gst_buffer_unref (buffer);
+  return s;
+}
+
+static void
+bench_osc_wave (void)
+{
+  static const struct
+  {
+    const gchar *name;
+    gdouble freq;
+  } variants[] = {
+    {"original", 0.0},
+    {"resampled", 440.0}
+  };
+  gint channels;
+  guint i;
+
+  for (channels = 1; channels <= 2; channels++) {
+    gpointer wave_callbacks[] = { GINT_TO_POINTER (channels),
+      get_wave_buffer
+    };
+
+    for (i = 0; i < G_N_ELEMENTS (variants); i++) {
+      GstBtOscWave *osc = gstbt_osc_wave_new ();
+      guint64 off = 0;
+
+      g_object_set (osc, "wave-callbacks", wave_callbacks, NULL);
+      if (variants[i].freq > 0.0) {
+        g_object_set (osc, "frequency", variants[i].freq, NULL);
+      }
+      if (!osc->process) {
+        fprintf (stderr, "osc-wave is not configured\n");
+        g_object_unref (osc);
+        continue;
+      }
+      /* loop over the wave, the process function handles stereo itself */
+      BENCH ("osc-wave", variants[i].name, channels, {
+            osc->process (osc, off, block_size, buf1); consume (buf1, size);
+            off += block_size; if (off >= osc->duration) off = 0;}
+      );
+      g_object_unref (osc);
+    }
+  }
+}
+
+//-- main
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GOptionEntry options[] = {
+    {"samples", 's', 0, G_OPTION_ARG_INT64, &num_samples,
+        "Number of samples to process per run", "<number>"},
+    {"filter", 'f', 0, G_OPTION_ARG_STRING, &filter,
+          "Only run the given kernel (osc-synth, filter-svf, combine, delay, "
+          "envelope, osc-wave)", "<kernel>"},
+    {NULL}
+  };
+
+  ctx = g_option_context_new (NULL);
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    fprintf (stderr, "Error initializing: %s\n", err->message);
+    g_error_free (err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+  if (num_samples < MAX_BLOCK_SIZE * 2) {
+    num_samples = MAX_BLOCK_SIZE * 2;
+  }
+
+  printf ("# kernel      variant              ch block    ns/sample      "
+      "samples/s\n");
+  if (is_selected ("osc-synth"))
+    bench_osc_synth ();
+  if (is_selected ("filter-svf"))
+    bench_filter_svf ();
+  if (is_selected ("combine"))
+    bench_combine ();
+  if (is_selected ("delay"))
+    bench_delay ();
+  if (is_selected ("envelope"))
+    bench_envelopes ();
+  if (is_selected ("osc-wave"))
+    bench_osc_wave ();
+
+  g_free (filter);
+  return 0;
+}
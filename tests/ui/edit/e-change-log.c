@@ -29,6 +29,8 @@ typedef struct
   gint *data;
   gint data_size;
 
+  GBytes *column;
+
 } BtTestChangeLogger;
 
 typedef struct
@@ -82,6 +84,18 @@ bt_test_change_logger_change (const BtChangeLogger * owner, const gchar * data)
   return res;
 }
 
+static gboolean
+bt_test_change_logger_change_column (const BtChangeLogger * owner,
+    const gchar * data, GBytes * column)
+{
+  BtTestChangeLogger *self = (BtTestChangeLogger *) owner;
+
+  if (self->column)
+    g_bytes_unref (self->column);
+  self->column = g_bytes_ref (column);
+  return bt_test_change_logger_change (owner, data);
+}
+
 static void
 bt_test_change_logger_interface_init (gpointer const g_iface,
     gconstpointer const iface_data)
@@ -89,6 +103,7 @@ bt_test_change_logger_interface_init (gpointer const g_iface,
   BtChangeLoggerInterface *const iface = g_iface;
 
   iface->change = bt_test_change_logger_change;
+  iface->change_column = bt_test_change_logger_change_column;
 }
 
 static void
@@ -97,6 +112,8 @@ bt_test_change_logger_finalize (GObject * object)
   BtTestChangeLogger *self = (BtTestChangeLogger *) object;
 
   g_free (self->data);
+  if (self->column)
+    g_bytes_unref (self->column);
 
   G_OBJECT_CLASS (test_change_logger_parent_class)->finalize (object);
 }
@@ -136,11 +153,111 @@ make_change (BtChangeLog * cl, BtTestChangeLogger * tcl,
       g_strdup (change));
 }
 
+/* append a record to a binary journal, see change-log.c for the format */
+static void
+append_journal_record (GByteArray * journal, guint8 type, const gchar * data,
+    gsize size)
+{
+  guint32 header[2], hash = (2166136261U ^ type) * 16777619U;
+  gsize i;
+
+  for (i = 0; i < size; i++) {
+    hash = (hash ^ (guint8) data[i]) * 16777619U;
+  }
+  header[0] = GUINT32_TO_LE (size + 1);
+  header[1] = GUINT32_TO_LE (hash);
+  g_byte_array_append (journal, (const guint8 *) header, sizeof (header));
+  g_byte_array_append (journal, &type, 1);
+  g_byte_array_append (journal, (const guint8 *) data, size);
+}
+
+static void
+append_journal_change (GString * changes, guint8 owner_id, const gchar * data)
+{
+  guint32 size = GUINT32_TO_LE (strlen (data) + 1);
+
+  g_string_append_c (changes, owner_id);
+  g_string_append_len (changes, (const gchar *) &size, sizeof (size));
+  g_string_append_len (changes, data, strlen (data) + 1);
+}
+
+/* make a journal for the current song that adds a machine "synth" and then
+ * moves and mutes it in a second record */
+static GByteArray *
+make_journal (void)
+{
+  GByteArray *journal = g_byte_array_new ();
+  GString *changes = g_string_new (NULL);
+
+  g_byte_array_append (journal, (const guint8 *) "BTJOURNAL1", 11);
+  append_journal_record (journal, 0, "", 0);
+  append_journal_record (journal, 1, "\0BtMainPageMachines", 19);
+  append_journal_change (changes, 0, "add_machine 0,\"synth\",\"simsyn\"");
+  append_journal_record (journal, 2, changes->str, changes->len);
+  g_string_truncate (changes, 0);
+  append_journal_change (changes, 0,
+      "set_machine_property \"synth\",\"ypos\",\"-0.3\"");
+  append_journal_change (changes, 0,
+      "set_machine_property \"synth\",\"xpos\",\"-0.4\"");
+  append_journal_change (changes, 0,
+      "set_machine_property \"synth\",\"state\",\"mute\"");
+  append_journal_record (journal, 2, changes->str, changes->len);
+  g_string_free (changes, TRUE);
+  return journal;
+}
+
+/* make a change with large undo/redo data, the data is padded with spaces or
+ * random bytes that the test change logger ignores */
+static void
+make_large_change (BtChangeLog * cl, BtTestChangeLogger * tcl, gint val,
+    gint old_val, gboolean random)
+{
+  gchar *change = g_strdup_printf ("set_val %d %300000d", val, 0);
+  gchar *undo = g_strdup_printf ("set_val %d %300000d", old_val, 0);
+  gint i;
+
+  if (random) {
+    for (i = 12; i < 300000; i++) {
+      change[i] = (gchar) g_random_int_range (1, 256);
+      undo[i] = (gchar) g_random_int_range (1, 256);
+    }
+  }
+  make_change (cl, tcl, change, undo);
+  g_free (change);
+  g_free (undo);
+}
+
 //-- globals
 
 static BtEditApplication *app;
 static BtMainWindow *main_window;
 
+//-- helper
+
+static BtMachine *
+get_machine (const gchar * id)
+{
+  BtSong *song;
+  BtSetup *setup;
+  BtMachine *machine;
+
+  g_object_get (app, "song", &song, NULL);
+  g_object_get (song, "setup", &setup, NULL);
+  machine = bt_setup_get_machine_by_id (setup, id);
+  g_object_unref (setup);
+  g_object_unref (song);
+  return machine;
+}
+
+static void
+make_column_change (BtChangeLog * cl, BtTestChangeLogger * tcl)
+{
+  bt_test_change_logger_change ((const BtChangeLogger *) tcl, "set_val 2");
+  bt_change_log_add_column (cl, (BtChangeLogger *) tcl, g_strdup ("set_val 1"),
+      g_strdup ("set_val 2"), g_bytes_new_static ("1", 1),
+      g_bytes_new_static ("2", 1));
+}
+
 //-- fixtures
 
 static void
@@ -547,11 +664,193 @@ START_TEST (test_bt_change_log_recover)
 
   GST_INFO ("-- assert --");
   ck_assert (res);
+  BtMachine *machine = get_machine ("synth");
+  ck_assert (machine != NULL);
+
+  GST_INFO ("-- cleanup --");
+  flush_main_loop ();
+  g_object_unref (machine);
+  g_unlink (log_name);
+  g_free (log_name);
+  g_object_unref (cl);
+  BT_TEST_END;
+}
+END_TEST
+
+START_TEST (test_bt_change_log_recover_journal)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtChangeLog *cl = bt_change_log_new ();
+  gchar *log_name = g_build_filename (g_get_tmp_dir (), "bt-crash.log", NULL);
+  GByteArray *journal = make_journal ();
+  g_file_set_contents (log_name, (const gchar *) journal->data, journal->len,
+      NULL);
+
+  GST_INFO ("-- act --");
+  gboolean res = bt_change_log_recover (cl, log_name);
+
+  GST_INFO ("-- assert --");
+  ck_assert (res);
+  BtMachine *machine = get_machine ("synth");
+  ck_assert (machine != NULL);
+  BtMachineState state;
+  g_object_get (machine, "state", &state, NULL);
+  ck_assert_int_eq (state, BT_MACHINE_STATE_MUTE);
 
   GST_INFO ("-- cleanup --");
   flush_main_loop ();
+  g_object_unref (machine);
   g_unlink (log_name);
   g_free (log_name);
+  g_byte_array_unref (journal);
+  g_object_unref (cl);
+  BT_TEST_END;
+}
+END_TEST
+
+// the last record is corrupt (0) or truncated (1)
+START_TEST (test_bt_change_log_recover_broken_journal)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtChangeLog *cl = bt_change_log_new ();
+  gchar *log_name = g_build_filename (g_get_tmp_dir (), "bt-crash.log", NULL);
+  GByteArray *journal = make_journal ();
+  if (_i == 0) {
+    journal->data[journal->len - 3] ^= 0x01;
+  } else {
+    g_byte_array_set_size (journal, journal->len - 3);
+  }
+  g_file_set_contents (log_name, (const gchar *) journal->data, journal->len,
+      NULL);
+
+  GST_INFO ("-- act --");
+  gboolean res = bt_change_log_recover (cl, log_name);
+
+  GST_INFO ("-- assert --");
+  ck_assert (!res);
+  // the changes before the broken record are replayed, the others not
+  BtMachine *machine = get_machine ("synth");
+  ck_assert (machine != NULL);
+  BtMachineState state;
+  g_object_get (machine, "state", &state, NULL);
+  ck_assert_int_eq (state, BT_MACHINE_STATE_NORMAL);
+
+  GST_INFO ("-- cleanup --");
+  flush_main_loop ();
+  g_object_unref (machine);
+  g_unlink (log_name);
+  g_free (log_name);
+  g_byte_array_unref (journal);
+  g_object_unref (cl);
+  BT_TEST_END;
+}
+END_TEST
+
+START_TEST (test_bt_change_log_undo_compressed_changes)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtSettings *settings = bt_settings_make ();
+  g_object_set (settings, "undo-memory-budget", 1, NULL);
+  BtChangeLog *cl = bt_change_log_new ();
+  BtTestChangeLogger *tcl = bt_test_change_logger_new ();
+  make_large_change (cl, tcl, 5, 0, FALSE);
+  make_large_change (cl, tcl, 10, 5, FALSE);
+  make_large_change (cl, tcl, 15, 10, FALSE);
+
+  GST_INFO ("-- act --");
+  bt_change_log_undo (cl);
+  bt_change_log_undo (cl);
+  bt_change_log_undo (cl);
+
+  GST_INFO ("-- assert --");
+  ck_assert_int_eq (tcl->val, 0);
+
+  GST_INFO ("-- cleanup --");
+  g_object_set (settings, "undo-memory-budget", 64, NULL);
+  g_object_unref (tcl);
+  g_object_unref (cl);
+  g_object_unref (settings);
+  BT_TEST_END;
+}
+END_TEST
+
+START_TEST (test_bt_change_log_drop_changes_over_budget)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtSettings *settings = bt_settings_make ();
+  g_object_set (settings, "undo-memory-budget", 1, NULL);
+  BtChangeLog *cl = bt_change_log_new ();
+  BtTestChangeLogger *tcl = bt_test_change_logger_new ();
+  gboolean can_undo;
+  make_large_change (cl, tcl, 5, 0, TRUE);
+  make_large_change (cl, tcl, 10, 5, TRUE);
+  make_large_change (cl, tcl, 15, 10, TRUE);
+  make_large_change (cl, tcl, 20, 15, TRUE);
+
+  GST_INFO ("-- act --");
+  bt_change_log_undo (cl);
+  g_object_get (cl, "can-undo", &can_undo, NULL);
+
+  GST_INFO ("-- assert --");
+  ck_assert_int_eq (tcl->val, 15);
+  ck_assert (!can_undo);
+
+  GST_INFO ("-- cleanup --");
+  g_object_set (settings, "undo-memory-budget", 64, NULL);
+  g_object_unref (tcl);
+  g_object_unref (cl);
+  g_object_unref (settings);
+  BT_TEST_END;
+}
+END_TEST
+
+START_TEST (test_bt_change_log_undo_column_change)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtChangeLog *cl = bt_change_log_new ();
+  BtTestChangeLogger *tcl = bt_test_change_logger_new ();
+  make_column_change (cl, tcl);
+
+  GST_INFO ("-- act --");
+  bt_change_log_undo (cl);
+
+  GST_INFO ("-- assert --");
+  ck_assert_int_eq (tcl->val, 1);
+  ck_assert (tcl->column != NULL);
+  ck_assert_int_eq (((const gchar *) g_bytes_get_data (tcl->column, NULL))[0],
+      '1');
+
+  GST_INFO ("-- cleanup --");
+  g_object_unref (tcl);
+  g_object_unref (cl);
+  BT_TEST_END;
+}
+END_TEST
+
+START_TEST (test_bt_change_log_redo_column_change)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtChangeLog *cl = bt_change_log_new ();
+  BtTestChangeLogger *tcl = bt_test_change_logger_new ();
+  make_column_change (cl, tcl);
+  bt_change_log_undo (cl);
+
+  GST_INFO ("-- act --");
+  bt_change_log_redo (cl);
+
+  GST_INFO ("-- assert --");
+  ck_assert_int_eq (tcl->val, 2);
+  ck_assert_int_eq (((const gchar *) g_bytes_get_data (tcl->column, NULL))[0],
+      '2');
+
+  GST_INFO ("-- cleanup --");
+  g_object_unref (tcl);
   g_object_unref (cl);
   BT_TEST_END;
 }
@@ -579,6 +878,12 @@ bt_change_log_example_case (void)
   tcase_add_test (tc, test_bt_change_log_group);
   tcase_add_test (tc, test_bt_change_log_nested_groups);
   tcase_add_test (tc, test_bt_change_log_recover);
+  tcase_add_test (tc, test_bt_change_log_recover_journal);
+  tcase_add_loop_test (tc, test_bt_change_log_recover_broken_journal, 0, 2);
+  tcase_add_test (tc, test_bt_change_log_undo_compressed_changes);
+  tcase_add_test (tc, test_bt_change_log_drop_changes_over_budget);
+  tcase_add_test (tc, test_bt_change_log_undo_column_change);
+  tcase_add_test (tc, test_bt_change_log_redo_column_change);
   tcase_add_checked_fixture (tc, test_setup, test_teardown);
   tcase_add_unchecked_fixture (tc, case_setup, case_teardown);
   return tc;
@@ -375,6 +375,55 @@ START_TEST (test_bt_main_page_patterns_pattern_voices)
 }
 END_TEST
 
+// undo restores the cell and brings the pattern and the cursor back
+START_TEST (test_bt_main_page_patterns_undo_note)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  BtMachineConstructorParams cparams;
+  cparams.song = song;
+  cparams.id = "gen";
+  BtMachine *machine = BT_MACHINE (bt_source_machine_new (&cparams,
+          "buzztrax-test-mono-source", 0L, NULL));
+  BtPattern *pattern1 = bt_pattern_new (song, "pattern-1", 8L, machine);
+  BtPattern *pattern2 = bt_pattern_new (song, "pattern-2", 8L, machine);
+  BtChangeLog *change_log = bt_change_log_new ();
+  BtMainPagePatterns *pattern_page;
+  GtkWidget *pattern_editor;
+  gchar *str;
+  guint row;
+
+  g_object_get (G_OBJECT (pages), "patterns-page", &pattern_page, NULL);
+  bt_main_page_patterns_show_pattern (pattern_page, pattern1);
+  pattern_editor = gtk_window_get_focus ((GtkWindow *) main_window);
+  move_cursor_to (pattern_editor, 0, 3, 0, 2);
+  check_send_key (pattern_editor, 0, 'q', 0x18);
+  bt_main_page_patterns_show_pattern (pattern_page, pattern2);
+
+  GST_INFO ("-- act --");
+  bt_change_log_undo (change_log);
+
+  GST_INFO ("-- assert --");
+  ck_assert_ptr_null (bt_pattern_get_global_event (pattern1, 2, 3));
+  g_object_get (pattern_editor, "cursor-row", &row, NULL);
+  ck_assert_uint_eq (row, 2);
+  // the next key goes to the restored pattern again
+  check_send_key (pattern_editor, 0, 'q', 0x18);
+  str = bt_pattern_get_global_event (pattern1, 2, 3);
+  ck_assert (str != NULL);
+  str[2] = '0';
+  ck_assert_str_eq_and_free (str, "c-0");
+  ck_assert_ptr_null (bt_pattern_get_global_event (pattern2, 2, 3));
+
+  GST_INFO ("-- cleanup --");
+  g_object_unref (change_log);
+  g_object_unref (pattern_page);
+  g_object_unref (pattern2);
+  g_object_unref (pattern1);
+  BT_TEST_END;
+}
+END_TEST
+
 TCase *
 bt_main_page_patterns_example_case (void)
 {
@@ -389,6 +438,7 @@ bt_main_page_patterns_example_case (void)
   tcase_add_test (tc, test_bt_main_page_patterns_enter_invalid_sparse_enum);
   tcase_add_test (tc, test_bt_main_page_patterns_enter_sparse_enum_in_2_steps);
   tcase_add_test (tc, test_bt_main_page_patterns_pattern_voices);
+  tcase_add_test (tc, test_bt_main_page_patterns_undo_note);
   tcase_add_checked_fixture (tc, test_setup, test_teardown);
   tcase_add_unchecked_fixture (tc, case_setup, case_teardown);
   return tc;
@@ -99,6 +99,47 @@ START_TEST (test_bt_object_list_model_add_entry)
 }
 END_TEST
 
+static void
+on_row_changed (GtkTreeModel * model, GtkTreePath * path, GtkTreeIter * iter,
+    gpointer user_data)
+{
+  gint *ct = (gint *) user_data;
+
+  (*ct)++;
+}
+
+START_TEST (test_bt_object_list_model_property_change_updates_row)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  GtkWidget *l1 = gtk_label_new ("test1");
+  GtkWidget *l2 = gtk_label_new ("test2");
+  BtObjectListModel *model = bt_object_list_model_new (1, GTK_TYPE_LABEL,
+      "label");
+  GtkTreeIter iter;
+  gchar *str;
+  gint ct = 0;
+  bt_object_list_model_append (model, (GObject *) l1);
+  bt_object_list_model_append (model, (GObject *) l2);
+  g_signal_connect (model, "row-changed", G_CALLBACK (on_row_changed), &ct);
+
+  GST_INFO ("-- act --");
+  gtk_label_set_text (GTK_LABEL (l2), "changed");
+
+  GST_INFO ("-- assert --");
+  ck_assert_int_eq (ct, 1);
+  gtk_tree_model_iter_nth_child ((GtkTreeModel *) model, &iter, NULL, 1);
+  gtk_tree_model_get ((GtkTreeModel *) model, &iter, 0, &str, -1);
+  ck_assert_str_eq_and_free (str, "changed");
+
+  GST_INFO ("-- cleanup --");
+  g_object_unref (g_object_ref_sink (model));
+  g_object_unref (g_object_ref_sink (l1));
+  g_object_unref (g_object_ref_sink (l2));
+  BT_TEST_END;
+}
+END_TEST
+
 TCase *
 bt_object_list_model_example_case (void)
 {
@@ -106,6 +147,7 @@ bt_object_list_model_example_case (void)
 
   tcase_add_test (tc, test_bt_object_list_model_create);
   tcase_add_test (tc, test_bt_object_list_model_add_entry);
+  tcase_add_test (tc, test_bt_object_list_model_property_change_updates_row);
   tcase_add_checked_fixture (tc, test_setup, test_teardown);
   tcase_add_unchecked_fixture (tc, case_setup, case_teardown);
   return tc;
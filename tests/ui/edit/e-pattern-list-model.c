@@ -116,6 +116,35 @@ START_TEST (test_bt_pattern_list_model_get_pattern)
 }
 END_TEST
 
+START_TEST (test_bt_pattern_list_model_rename_pattern_resorts)
+{
+  BT_TEST_START;
+  GST_INFO ("-- arrange --");
+  GtkTreeIter iter;
+  BtMachine *machine = bt_setup_get_machine_by_id (setup, "master");
+  BtPattern *pattern1 = bt_pattern_new (song, "a", /*length= */ 16, machine);
+  BtPattern *pattern2 = bt_pattern_new (song, "b", /*length= */ 16, machine);
+  BtPatternListModel *model = bt_pattern_list_model_new (machine, sequence,
+      TRUE);
+
+  GST_INFO ("-- act --");
+  g_object_set (pattern1, "name", "c", NULL);
+
+  GST_INFO ("-- assert --");
+  gtk_tree_model_get_iter_first ((GtkTreeModel *) model, &iter);
+  ck_assert (bt_pattern_list_model_get_object (model, &iter) == pattern2);
+  gtk_tree_model_iter_next ((GtkTreeModel *) model, &iter);
+  ck_assert (bt_pattern_list_model_get_object (model, &iter) == pattern1);
+
+  GST_INFO ("-- cleanup --");
+  g_object_unref (model);
+  g_object_unref (pattern1);
+  g_object_unref (pattern2);
+  g_object_unref (machine);
+  BT_TEST_END;
+}
+END_TEST
+
 TCase *
 bt_pattern_list_model_example_case (void)
 {
@@ -123,6 +152,7 @@ bt_pattern_list_model_example_case (void)
 
   tcase_add_test (tc, test_bt_pattern_list_model_create);
   tcase_add_test (tc, test_bt_pattern_list_model_get_pattern);
+  tcase_add_test (tc, test_bt_pattern_list_model_rename_pattern_resorts);
   tcase_add_checked_fixture (tc, test_setup, test_teardown);
   tcase_add_unchecked_fixture (tc, case_setup, case_teardown);
   return tc;